@@ -1271,6 +1271,13 @@ function test_mon_osd_pool_set()
   ceph --format=xml osd pool get $TEST_POOL_GETSET auid | grep $auid
   ceph osd pool set $TEST_POOL_GETSET auid 0
 
+  for s in client_throttle_ops client_throttle_bps client_throttle_ops_max client_throttle_bps_max; do
+    ceph osd pool set $TEST_POOL_GETSET $s 1000
+    ceph osd pool get $TEST_POOL_GETSET $s | grep "$s: 1000"
+    ceph osd pool set $TEST_POOL_GETSET $s 0
+    expect_false ceph osd pool set $TEST_POOL_GETSET $s -1
+  done
+
   for flag in hashpspool nodelete nopgchange nosizechange; do
       ceph osd pool set $TEST_POOL_GETSET $flag false
       ceph osd pool set $TEST_POOL_GETSET $flag true
@@ -23,13 +23,12 @@
 
 LeakyBucketThrottle::LeakyBucketThrottle(CephContext *c, uint64_t op_size)
   : cct(c), op_size(op_size), lock("LeakyBucketThrottle::lock"),
-    timer(c, lock, false), enable(false), mode(THROTTLE_MODE_NONE),
-    client_bw_threshold(0), client_iops_threshold(0),
+    timer(c, lock, false), timer_started(false), enable(false),
+    mode(THROTTLE_MODE_NONE), client_bw_threshold(0), client_iops_threshold(0),
     avg_is_max(false), avg_reset(false)
 {
   timer_cb[0] = timer_cb[1] = NULL;
   timer_wait[0] = timer_wait[1] = false;
-  timer.init();
 }
 
 LeakyBucketThrottle::~LeakyBucketThrottle()
@@ -49,6 +48,10 @@ void LeakyBucketThrottle::attach_context(Context *reader, Context *writer)
   delete timer_cb[1];
   timer_cb[0] = reader;
   timer_cb[1] = writer;
+  if (!timer_started) {
+    timer.init();
+    timer_started = true;
+  }
 }
 
 /* Does any throttling must be done
@@ -230,6 +233,21 @@ bool LeakyBucketThrottle::schedule_timer(bool is_write, bool release_timer_wait)
   return true;
 }
 
+/* Compute the wait time without arming the timer
+ *
+ * @is_write: the type of operation (read/write)
+ * @ret:      time to wait(seconds), 0 if the operation can go through
+ */
+double LeakyBucketThrottle::compute_wait(bool is_write)
+{
+  Mutex::Locker l(lock);
+
+  /* leak proportionally to the time elapsed */
+  throttle_do_leak();
+
+  return throttle_compute_wait_for(is_write);
+}
+
 /*
  * NOTE: no read/write differentiation version of schedule_timer
  *
@@ -74,6 +74,7 @@ class LeakyBucketThrottle {
   /* 0 for read, 1 for write. 0 is used if no read/write differentiation */
   Context *timer_cb[2];
   bool timer_wait[2];
+  bool timer_started;       /* timer thread is only started once a context is attached */
   bool enable;
   ThrottleMode mode;
   int64_t client_bw_threshold;
@@ -112,6 +113,9 @@ class LeakyBucketThrottle {
   void adjust(BucketType type, uint64_t add_size, uint64_t substract_size);
   void increase_bucket_average();
   void reset_bucket_average();
+  /* leak and return the time (seconds) an op would have to wait, for callers
+   * that wait synchronously instead of attaching a timer context */
+  double compute_wait(bool is_write);
   // no read/write differentiation version
   bool schedule_timer(bool release_timer_wait);
   void account(uint64_t size, bool lock_hold=false);
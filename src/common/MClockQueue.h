@@ -0,0 +1,370 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef MCLOCK_QUEUE_H
+#define MCLOCK_QUEUE_H
+
+#include "common/Clock.h"
+#include "common/Formatter.h"
+#include "common/OpQueue.h"
+#include "include/assert.h"
+
+#include <limits>
+#include <list>
+#include <map>
+
+/**
+ * Queue scheduling items by reservation, limit and weight (mClock)
+ *
+ * Each item is classified into a client class by a Classifier, which
+ * also gives the class its reservation (items/s it is guaranteed), its
+ * limit (items/s it gets at most, 0 for none) and its weight (its share
+ * of whatever is left).  Items of a class are served in FIFO order.
+ * The front item of every class is tagged when it reaches the front:
+ *
+ *   R = max(R' + c / reservation, now)
+ *   L = max(L' + c / limit, now)
+ *   P = max(P' + c / weight, vtime)
+ *
+ * where R', L' and P' are the tags of the previous item of the class, c
+ * is the cost of the item in units of cost_per_io, counting at least 1,
+ * and vtime the P tag of the last item served by weight.
+ *
+ * dequeue serves the smallest R tag that is due, if any, and otherwise
+ * the smallest P tag among the classes under their limit, in which case
+ * the R tags of the class are moved back by what the item would have
+ * taken from its reservation.  When every class is over its limit the
+ * one closest to it is served, so that workers are never left idle with
+ * items queued.
+ *
+ * The priority of items not queued strict is ignored.  Items queued
+ * strict are served first, in priority order, as with PrioritizedQueue.
+ */
+template <typename T, typename K>
+class MClockQueue : public OpQueue<T, K> {
+public:
+  struct ClientInfo {
+    double reservation; ///< items/s, 0 for none
+    double limit;       ///< items/s, 0 for none
+    double weight;
+    ClientInfo(double r = 0, double l = 0, double w = 1)
+      : reservation(r), limit(l), weight(w) {}
+  };
+
+  /// maps items to their client class and its tags
+  class Classifier {
+  public:
+    virtual uint64_t classify(const K &cl, const T &item, ClientInfo *info) = 0;
+    virtual ~Classifier() {}
+  };
+
+private:
+  struct Request {
+    K cl;
+    double cost;
+    T item;
+    Request(const K &cl, double cost, const T &item)
+      : cl(cl), cost(cost), item(item) {}
+  };
+
+  struct Class {
+    ClientInfo info;
+    std::list<Request> q;
+    bool tagged;                 ///< r, l and p are set for the front of q
+    double r, l, p;              ///< tags of the front of q
+    double prev_r, prev_l, prev_p; ///< tags of the last item served
+    Class()
+      : tagged(false), r(0), l(0), p(0), prev_r(0), prev_l(0), prev_p(0) {}
+  };
+
+  static double no_tag() {
+    return std::numeric_limits<double>::max();
+  }
+
+  double cost_per_io;
+  Classifier *classifier;
+  double vtime;
+  unsigned size;
+  unsigned dequeues_since_trim;
+  std::map<uint64_t, Class> classes;
+  std::map<unsigned, std::list<std::pair<K, T> > > high_queue;
+
+  void tag(Class &c, double now) {
+    if (c.tagged || c.q.empty())
+      return;
+    double cost = c.q.front().cost;
+    c.r = c.info.reservation > 0 ?
+      std::max(c.prev_r + cost / c.info.reservation, now) : no_tag();
+    c.l = c.info.limit > 0 ?
+      std::max(c.prev_l + cost / c.info.limit, now) : 0;
+    c.p = c.info.weight > 0 ?
+      std::max(c.prev_p + cost / c.info.weight, vtime) : no_tag();
+    c.tagged = true;
+  }
+
+  void untag(Class &c) {
+    c.tagged = false;
+  }
+
+  /**
+   * Drop the idle classes whose tags are all behind, they are tagged the
+   * same when they get busy again as a class seen for the first time
+   */
+  void trim(double now) {
+    for (typename std::map<uint64_t, Class>::iterator i = classes.begin();
+	 i != classes.end(); ) {
+      Class &c = i->second;
+      if (c.q.empty() && c.prev_r <= now && c.prev_l <= now &&
+	  c.prev_p <= vtime)
+	classes.erase(i++);
+      else
+	++i;
+    }
+  }
+
+  T serve(Class &c, bool by_weight) {
+    Request &req = c.q.front();
+    T ret = req.item;
+    if (c.info.reservation > 0)
+      c.prev_r = by_weight ? c.r - req.cost / c.info.reservation : c.r;
+    if (c.info.limit > 0)
+      c.prev_l = c.l;
+    if (c.info.weight > 0) {
+      c.prev_p = c.p;
+      if (by_weight && c.p > vtime)
+	vtime = c.p;
+    }
+    c.q.pop_front();
+    --size;
+    untag(c);
+    return ret;
+  }
+
+protected:
+  /// seconds, virtual for the simulator
+  virtual double get_time() const {
+    return (double)ceph_clock_now(NULL);
+  }
+
+public:
+  MClockQueue(uint64_t cost_per_io, Classifier *classifier)
+    : cost_per_io(cost_per_io > 0 ? cost_per_io : 1),
+      classifier(classifier),
+      vtime(0),
+      size(0),
+      dequeues_since_trim(0) {}
+
+  unsigned length() const {
+    return size;
+  }
+
+  void remove_by_filter(typename OpQueue<T, K>::Filter &f,
+			std::list<T> *removed = 0) {
+    for (typename std::map<uint64_t, Class>::iterator i = classes.begin();
+	 i != classes.end();
+	 ++i) {
+      for (typename std::list<Request>::iterator j = i->second.q.begin();
+	   j != i->second.q.end(); ) {
+	if (f(j->item)) {
+	  if (removed)
+	    removed->push_back(j->item);
+	  if (j == i->second.q.begin())
+	    untag(i->second);
+	  i->second.q.erase(j++);
+	  --size;
+	} else {
+	  ++j;
+	}
+      }
+    }
+    for (typename std::map<unsigned, std::list<std::pair<K, T> > >::iterator i =
+	   high_queue.begin();
+	 i != high_queue.end(); ) {
+      for (typename std::list<std::pair<K, T> >::iterator j = i->second.begin();
+	   j != i->second.end(); ) {
+	if (f(j->second)) {
+	  if (removed)
+	    removed->push_back(j->second);
+	  i->second.erase(j++);
+	  --size;
+	} else {
+	  ++j;
+	}
+      }
+      if (i->second.empty())
+	high_queue.erase(i++);
+      else
+	++i;
+    }
+  }
+
+  void remove_by_class(K k, std::list<T> *out = 0) {
+    for (typename std::map<uint64_t, Class>::iterator i = classes.begin();
+	 i != classes.end();
+	 ++i) {
+      for (typename std::list<Request>::iterator j = i->second.q.begin();
+	   j != i->second.q.end(); ) {
+	if (j->cl == k) {
+	  if (out)
+	    out->push_back(j->item);
+	  if (j == i->second.q.begin())
+	    untag(i->second);
+	  i->second.q.erase(j++);
+	  --size;
+	} else {
+	  ++j;
+	}
+      }
+    }
+    for (typename std::map<unsigned, std::list<std::pair<K, T> > >::iterator i =
+	   high_queue.begin();
+	 i != high_queue.end(); ) {
+      for (typename std::list<std::pair<K, T> >::iterator j = i->second.begin();
+	   j != i->second.end(); ) {
+	if (j->first == k) {
+	  if (out)
+	    out->push_back(j->second);
+	  i->second.erase(j++);
+	  --size;
+	} else {
+	  ++j;
+	}
+      }
+      if (i->second.empty())
+	high_queue.erase(i++);
+      else
+	++i;
+    }
+  }
+
+  void enqueue_strict(const K &cl, unsigned priority, const T &item) {
+    high_queue[priority].push_back(std::make_pair(cl, item));
+    ++size;
+  }
+
+  void enqueue_strict_front(const K &cl, unsigned priority, const T &item) {
+    high_queue[priority].push_front(std::make_pair(cl, item));
+    ++size;
+  }
+
+  void enqueue(const K &cl, unsigned priority, unsigned cost, const T &item) {
+    ClientInfo info;
+    Class &c = classes[classifier->classify(cl, item, &info)];
+    c.info = info;
+    bool was_empty = c.q.empty();
+    c.q.push_back(Request(cl, std::max(1.0, cost / cost_per_io), item));
+    ++size;
+    if (was_empty)
+      tag(c, get_time());
+  }
+
+  void enqueue_front(const K &cl, unsigned priority, unsigned cost,
+		     const T &item) {
+    ClientInfo info;
+    Class &c = classes[classifier->classify(cl, item, &info)];
+    c.info = info;
+    c.q.push_front(Request(cl, std::max(1.0, cost / cost_per_io), item));
+    ++size;
+    untag(c);
+    tag(c, get_time());
+  }
+
+  bool empty() const {
+    return size == 0;
+  }
+
+  T dequeue() {
+    assert(!empty());
+
+    if (!high_queue.empty()) {
+      typename std::map<unsigned, std::list<std::pair<K, T> > >::iterator i =
+	--high_queue.end();
+      T ret = i->second.front().second;
+      i->second.pop_front();
+      if (i->second.empty())
+	high_queue.erase(i);
+      --size;
+      return ret;
+    }
+
+    double now = get_time();
+    if (++dequeues_since_trim >= 1000) {
+      trim(now);
+      dequeues_since_trim = 0;
+    }
+
+    Class *by_r = NULL, *by_p = NULL, *by_l = NULL;
+    for (typename std::map<uint64_t, Class>::iterator i = classes.begin();
+	 i != classes.end();
+	 ++i) {
+      Class &c = i->second;
+      if (c.q.empty())
+	continue;
+      tag(c, now);
+      if (c.r <= now && (!by_r || c.r < by_r->r))
+	by_r = &c;
+      if (c.l <= now) {
+	if (!by_p || c.p < by_p->p)
+	  by_p = &c;
+      } else if (!by_l || c.l < by_l->l) {
+	by_l = &c;
+      }
+    }
+
+    // reservations first, then weights among the classes under their
+    // limit, then whoever is closest to its limit
+    if (by_r)
+      return serve(*by_r, false);
+    if (by_p)
+      return serve(*by_p, true);
+    assert(by_l);
+    return serve(*by_l, true);
+  }
+
+  void dump(Formatter *f) const {
+    f->dump_float("cost_per_io", cost_per_io);
+    f->dump_float("vtime", vtime);
+    f->dump_int("size", size);
+    f->open_array_section("high_queues");
+    for (typename std::map<unsigned, std::list<std::pair<K, T> > >::const_iterator i =
+	   high_queue.begin();
+	 i != high_queue.end();
+	 ++i) {
+      f->open_object_section("subqueue");
+      f->dump_int("priority", i->first);
+      f->dump_int("size", i->second.size());
+      f->close_section();
+    }
+    f->close_section();
+    f->open_array_section("classes");
+    for (typename std::map<uint64_t, Class>::const_iterator i = classes.begin();
+	 i != classes.end();
+	 ++i) {
+      const Class &c = i->second;
+      f->open_object_section("class");
+      f->dump_unsigned("id", i->first);
+      f->dump_float("reservation", c.info.reservation);
+      f->dump_float("limit", c.info.limit);
+      f->dump_float("weight", c.info.weight);
+      f->dump_int("size", c.q.size());
+      if (c.tagged) {
+	f->dump_float("r_tag", c.r == no_tag() ? -1 : c.r);
+	f->dump_float("l_tag", c.l);
+	f->dump_float("p_tag", c.p == no_tag() ? -1 : c.p);
+      }
+      f->close_section();
+    }
+    f->close_section();
+  }
+};
+
+#endif
@@ -0,0 +1,57 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef OP_QUEUE_H
+#define OP_QUEUE_H
+
+#include "common/Formatter.h"
+
+#include <list>
+
+/**
+ * Interface of the queues ops wait in for a worker
+ *
+ * Items of class K are queued with a priority and a cost, items queued
+ * strict are served before the others in priority order.  How the
+ * others are ordered is up to the implementation, @see PrioritizedQueue
+ * and MClockQueue.
+ */
+template <typename T, typename K>
+class OpQueue {
+public:
+  /// selects the items remove_by_filter removes
+  class Filter {
+  public:
+    virtual bool operator()(const T &item) = 0;
+    virtual ~Filter() {}
+  };
+
+  virtual ~OpQueue() {}
+
+  virtual unsigned length() const = 0;
+  /// remove the items f matches, adding them to removed if set
+  virtual void remove_by_filter(Filter &f, std::list<T> *removed = 0) = 0;
+  virtual void remove_by_class(K k, std::list<T> *out = 0) = 0;
+  virtual void enqueue_strict(const K &cl, unsigned priority,
+			      const T &item) = 0;
+  virtual void enqueue_strict_front(const K &cl, unsigned priority,
+				    const T &item) = 0;
+  virtual void enqueue(const K &cl, unsigned priority, unsigned cost,
+		       const T &item) = 0;
+  virtual void enqueue_front(const K &cl, unsigned priority, unsigned cost,
+			     const T &item) = 0;
+  virtual bool empty() const = 0;
+  virtual T dequeue() = 0;
+  virtual void dump(Formatter *f) const = 0;
+};
+
+#endif
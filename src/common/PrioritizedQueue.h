@@ -17,6 +17,7 @@
 
 #include "common/Mutex.h"
 #include "common/Formatter.h"
+#include "common/OpQueue.h"
 
 #include <map>
 #include <utility>
@@ -44,7 +45,7 @@
  * to provide fairness for different clients.
  */
 template <typename T, typename K>
-class PrioritizedQueue {
+class PrioritizedQueue : public OpQueue<T, K> {
   int64_t total_priority;
   int64_t max_tokens_per_subqueue;
   int64_t min_cost;
@@ -76,6 +77,15 @@ class PrioritizedQueue {
     return ret;
   }
 
+  /// copyable wrapper handing an OpQueue::Filter to the templates below
+  struct FilterRef {
+    typename OpQueue<T, K>::Filter *f;
+    FilterRef(typename OpQueue<T, K>::Filter *f) : f(f) {}
+    bool operator()(const T &item) {
+      return (*f)(item);
+    }
+  };
+
   struct SubQueue {
   private:
     ceph::unordered_map<K, list<pair<unsigned, T> > > q;
@@ -318,6 +328,11 @@ public:
     }
   }
 
+  void remove_by_filter(typename OpQueue<T, K>::Filter &f,
+			list<T> *removed = 0) {
+    remove_by_filter<FilterRef>(FilterRef(&f), removed);
+  }
+
   void remove_by_class(K k, list<T> *out = 0) {
     for (typename set<unsigned>::iterator i = queue_keys.begin();
 	 i != queue_keys.end();
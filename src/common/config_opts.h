@@ -360,6 +360,7 @@ OPTION(objecter_inflight_op_bytes, OPT_U64, 1024*1024*100) // max in-flight data
 OPTION(objecter_inflight_ops, OPT_U64, 1024)               // max in-flight ios
 OPTION(objecter_completion_locks_per_session, OPT_U64, 32) // num of completion locks per each session, for serializing same object responses
 OPTION(objecter_inject_no_watch_ping, OPT_BOOL, false)   // suppress watch pings
+OPTION(objecter_submit_shards, OPT_INT, 16)   // lock shards for submitting ops without the objecter lock, 0 to always take it
 
 OPTION(journaler_allow_split_entries, OPT_BOOL, true)
 OPTION(journaler_write_head_interval, OPT_INT, 15)
@@ -484,8 +485,10 @@ OPTION(osd_backfill_full_ratio, OPT_FLOAT, 0.85)
 // Seconds to wait before retrying refused backfills
 OPTION(osd_backfill_retry_interval, OPT_DOUBLE, 10.0)
 
+OPTION(osd_agent_threads, OPT_INT, 1)   // tiering agent threads
 // max agent flush ops
 OPTION(osd_agent_max_ops, OPT_INT, 4)
+OPTION(osd_agent_min_flush_effort, OPT_FLOAT, .1)   // share of osd_agent_max_ops a pg just over its dirty target may use
 OPTION(osd_agent_min_evict_effort, OPT_FLOAT, .1)
 OPTION(osd_agent_quantize_effort, OPT_FLOAT, .1)
 OPTION(osd_agent_delay_time, OPT_FLOAT, 5.0)
@@ -543,6 +546,7 @@ OPTION(osd_pool_default_flag_hashpspool, OPT_BOOL, true)   // use new pg hashing
 OPTION(osd_pool_default_flag_nodelete, OPT_BOOL, false) // pool can't be deleted
 OPTION(osd_pool_default_flag_nopgchange, OPT_BOOL, false) // pool's pg and pgp num can't be changed
 OPTION(osd_pool_default_flag_nosizechange, OPT_BOOL, false) // pool's size and min size can't be changed
+OPTION(osd_pool_default_ec_fast_read, OPT_BOOL, false) // erasure coded pools read all shards and decode from the first k
 OPTION(osd_pool_default_hit_set_bloom_fpp, OPT_FLOAT, .05)
 OPTION(osd_pool_default_cache_target_dirty_ratio, OPT_FLOAT, .4)
 OPTION(osd_pool_default_cache_target_full_ratio, OPT_FLOAT, .8)
@@ -573,11 +577,28 @@ OPTION(osd_op_threads, OPT_INT, 2)    // 0 == no threading
 OPTION(osd_peering_wq_batch_size, OPT_U64, 20)
 OPTION(osd_op_pq_max_tokens_per_priority, OPT_U64, 4194304)
 OPTION(osd_op_pq_min_cost, OPT_U64, 65536)
+OPTION(osd_op_queue, OPT_STR, "prioritized") // op queue of the op shards: prioritized or mclock
+OPTION(osd_op_queue_mclock_cost_per_io, OPT_U64, 65536) // bytes of op cost the mclock queue counts as one io
+// mclock reservation and limit in ios/s (0 for none) and weight of each class of ops
+OPTION(osd_op_queue_mclock_client_op_res, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_client_op_lim, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_client_op_wgt, OPT_DOUBLE, 100)
+OPTION(osd_op_queue_mclock_osd_subop_res, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_osd_subop_lim, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_osd_subop_wgt, OPT_DOUBLE, 100)
+OPTION(osd_op_queue_mclock_recovery_res, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_recovery_lim, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_recovery_wgt, OPT_DOUBLE, 10)
+OPTION(osd_op_queue_mclock_scrub_res, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_scrub_lim, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_scrub_wgt, OPT_DOUBLE, 10)
+OPTION(osd_op_queue_mclock_pool_qos, OPT_STR, "") // client op tags of pools, <pool id>:<res>:<lim>:<wgt>[,...]
 OPTION(osd_disk_threads, OPT_INT, 1)
 OPTION(osd_disk_thread_ioprio_class, OPT_STR, "") // rt realtime be best effort idle
 OPTION(osd_disk_thread_ioprio_priority, OPT_INT, -1) // 0-7
 OPTION(osd_recovery_threads, OPT_INT, 1)
 OPTION(osd_recover_clone_overlap, OPT_BOOL, true)   // preserve clone_overlap during recovery/migration
+OPTION(osd_recover_dirty_extents, OPT_BOOL, true)   // only push the extents written since the version a replica has
 OPTION(osd_op_num_threads_per_shard, OPT_INT, 2)
 OPTION(osd_op_num_shards, OPT_INT, 5)
 
@@ -648,6 +669,7 @@ OPTION(osd_scrub_chunk_max, OPT_INT, 25)
 OPTION(osd_scrub_sleep, OPT_FLOAT, 0)   // sleep between [deep]scrub ops
 OPTION(osd_deep_scrub_interval, OPT_FLOAT, 60*60*24*7) // once a week
 OPTION(osd_deep_scrub_stride, OPT_INT, 524288)
+OPTION(osd_deep_scrub_full_verify_ratio, OPT_FLOAT, 1) // fraction of scheduled deep scrubs that read objects unchanged since the last one
 OPTION(osd_deep_scrub_update_digest_min_age, OPT_INT, 2*60*60)   // objects must be this old (seconds) before we update the whole-object digest on scrub
 OPTION(osd_scan_list_ping_tp_interval, OPT_U64, 100)
 OPTION(osd_auto_weight, OPT_BOOL, false)
@@ -665,6 +687,8 @@ OPTION(osd_recovery_throttle_bw_client_threshold, OPT_U64, 100*1024*1024) // cli
 OPTION(osd_recovery_throttle_ops, OPT_U64, 5)                             // recovery ops 
 OPTION(osd_recovery_throttle_ops_max, OPT_U64, 20)                        // max recovery ops
 OPTION(osd_recovery_throttle_ops_client_threshold, OPT_U64, 100)          // client ops threshold
+OPTION(osd_pool_client_throttle_bw_threshold, OPT_U64, 100*1024*1024)    // client bytes/s above which pool client throttles go back to their base limit
+OPTION(osd_pool_client_throttle_ops_threshold, OPT_U64, 1000)            // client ops/s above which pool client throttles go back to their base limit
 
 // Bounds how infrequently a new map epoch will be persisted for a pg
 OPTION(osd_pg_epoch_persisted_max_stale, OPT_U32, 200)
@@ -689,6 +713,7 @@ OPTION(osd_debug_verify_stray_on_activate, OPT_BOOL, false)
 OPTION(osd_debug_skip_full_check_in_backfill_reservation, OPT_BOOL, false)
 OPTION(osd_debug_reject_backfill_probability, OPT_DOUBLE, 0)
 OPTION(osd_debug_inject_copyfrom_error, OPT_BOOL, false)  // inject failure during copyfrom completion
+OPTION(osd_debug_inject_ec_sub_read_delay, OPT_DOUBLE, 0)  // seconds to sleep before replying to an EC sub read
 OPTION(osd_enable_op_tracker, OPT_BOOL, true) // enable/disable OSD op tracking
 OPTION(osd_num_op_tracker_shard, OPT_U32, 32) // The number of shards for holding the ops
 OPTION(osd_op_history_size, OPT_U32, 20)    // Max number of completed ops to track
@@ -781,6 +806,8 @@ OPTION(osd_bench_max_block_size, OPT_U64, 64 << 20) // cap the block size at 64M
 OPTION(osd_bench_duration, OPT_U32, 30) // duration of 'osd bench', capped at 30s to avoid triggering timeouts
 
 OPTION(memstore_device_bytes, OPT_U64, 1024*1024*1024)
+OPTION(memstore_page_set, OPT_BOOL, false) // keep object data in pages, shared copy-on-write with clones
+OPTION(memstore_page_size, OPT_U64, 64 << 10)
 
 OPTION(filestore_omap_backend, OPT_STR, "leveldb")
 
@@ -803,6 +830,9 @@ OPTION(filestore_wbthrottle_xfs_inodes_start_flusher, OPT_U64, 500)
 /// These must be less than the fd limit
 OPTION(filestore_wbthrottle_btrfs_inodes_hard_limit, OPT_U64, 5000)
 OPTION(filestore_wbthrottle_xfs_inodes_hard_limit, OPT_U64, 5000)
+// adapt the bytes and ios start_flusher limits to the measured writeback rate
+OPTION(filestore_wbthrottle_adaptive, OPT_BOOL, false)
+OPTION(filestore_wbthrottle_adaptive_target_latency, OPT_DOUBLE, .5) // seconds
 
 // Tests index failure paths
 OPTION(filestore_index_retry_probability, OPT_DOUBLE, 0)
@@ -812,6 +842,7 @@ OPTION(filestore_debug_inject_read_err, OPT_BOOL, false)
 
 OPTION(filestore_debug_omap_check, OPT_BOOL, 0) // Expensive debugging check on sync
 OPTION(filestore_omap_header_cache_size, OPT_INT, 1024)
+OPTION(filestore_omap_header_stripes, OPT_INT, 16) // number of lock stripes for omap header lookups and the header cache
 
 // Use omap for xattrs for attrs over
 // filestore_max_inline_xattr_size or
@@ -826,6 +857,13 @@ OPTION(filestore_max_inline_xattrs_xfs, OPT_U32, 10)
 OPTION(filestore_max_inline_xattrs_btrfs, OPT_U32, 10)
 OPTION(filestore_max_inline_xattrs_other, OPT_U32, 2)
 
+// pack the inline xattrs of an object into a single xattr, up to
+// filestore_xattr_packed_max_bytes of them instead of
+// filestore_max_inline_xattrs
+OPTION(filestore_xattr_packed, OPT_BOOL, false)
+OPTION(filestore_xattr_packed_max_bytes, OPT_U32, 16384)
+OPTION(filestore_xattr_packed_cache_size, OPT_INT, 1024) // inodes whose decoded packed xattrs are cached
+
 OPTION(filestore_sloppy_crc, OPT_BOOL, false)         // track sloppy crcs
 OPTION(filestore_sloppy_crc_block_size, OPT_INT, 65536)
 
@@ -864,11 +902,15 @@ OPTION(filestore_commit_timeout, OPT_FLOAT, 600)
 OPTION(filestore_fiemap_threshold, OPT_INT, 4096)
 OPTION(filestore_merge_threshold, OPT_INT, 10)
 OPTION(filestore_split_multiple, OPT_INT, 2)
+OPTION(filestore_split_background, OPT_BOOL, false) // link split subdirs outside the collection lock
+OPTION(filestore_list_threads, OPT_INT, 0) // threads listing collection subdirs in parallel, 0 to disable
+OPTION(filestore_list_cache_dirs, OPT_INT, 0) // directory listings cached per collection
 OPTION(filestore_update_to, OPT_INT, 1000)
 OPTION(filestore_blackhole, OPT_BOOL, false)     // drop any new transactions on the floor
 OPTION(filestore_fd_cache_size, OPT_INT, 128)    // FD lru size
 OPTION(filestore_fd_cache_shards, OPT_INT, 16)   // FD number of shards
 OPTION(filestore_fd_cache_random, OPT_BOOL, false)
+OPTION(filestore_fd_cache_clock, OPT_BOOL, false) // clock eviction, lookups only take a shared lock
 OPTION(filestore_pgmeta_cache_shards, OPT_INT, 16)
 OPTION(filestore_pgmeta_cache_shard_bytes, OPT_U64, 2 << 20)
 OPTION(filestore_ondisk_finisher_threads, OPT_INT, 4)
@@ -878,6 +920,7 @@ OPTION(filestore_kill_at, OPT_INT, 0)            // inject a failure at the n'th
 OPTION(filestore_inject_stall, OPT_INT, 0)       // artificially stall for N seconds in op queue thread
 OPTION(filestore_fail_eio, OPT_BOOL, true)       // fail/crash on EIO
 OPTION(filestore_debug_verify_split, OPT_BOOL, false)
+OPTION(filestore_debug_split_delay, OPT_DOUBLE, 0) // seconds between the two phases of a background split
 
 OPTION(xstore_mscache_enable, OPT_BOOL, true)
 OPTION(xstore_mscache_aio_enable, OPT_BOOL, true)
@@ -886,6 +929,8 @@ OPTION(xstore_max_commit_entries, OPT_U32, 512)
 OPTION(journal_dio, OPT_BOOL, true)
 OPTION(journal_aio, OPT_BOOL, true)
 OPTION(journal_force_aio, OPT_BOOL, false)
+OPTION(journal_aio_batch, OPT_BOOL, false) // submit a journal write's aios together and reap completions in the write thread
+OPTION(journal_aio_batch_reap_wait, OPT_INT, 100) // us an idle write thread waits for aio completions before checking the queue again
 OPTION(journal_force_odsync, OPT_BOOL, true)
 
 OPTION(keyvaluestore_queue_max_ops, OPT_INT, 50)
@@ -897,6 +942,7 @@ OPTION(keyvaluestore_op_thread_suicide_timeout, OPT_INT, 180)
 OPTION(keyvaluestore_default_strip_size, OPT_INT, 4096) // Only affect new object
 OPTION(keyvaluestore_max_expected_write_size, OPT_U64, 1ULL << 24) // bytes
 OPTION(keyvaluestore_header_cache_size, OPT_INT, 4096)    // Header cache size
+OPTION(keyvaluestore_strip_cache_size, OPT_U64, 0)    // bytes of object data strips to cache (0 disables)
 OPTION(keyvaluestore_backend, OPT_STR, "leveldb")
 
 // max bytes to search ahead in journal searching for corruption
@@ -905,6 +951,8 @@ OPTION(journal_block_align, OPT_BOOL, true)
 OPTION(journal_write_header_frequency, OPT_U64, 0)
 OPTION(journal_max_write_bytes, OPT_INT, 10 << 20)
 OPTION(journal_max_write_entries, OPT_INT, 100)
+OPTION(journal_group_commit_us, OPT_INT, 0) // us the write thread waits for more entries to join a journal write (0 disables)
+OPTION(journal_group_commit_bytes, OPT_INT, 1 << 20) // stop waiting once this many bytes are queued (0 waits out the window)
 OPTION(journal_queue_max_ops, OPT_INT, 300)
 OPTION(journal_queue_max_bytes, OPT_INT, 32 << 20)
 OPTION(journal_align_min_size, OPT_INT, 64 << 10)  // align data payloads >= this.
@@ -1000,6 +1048,7 @@ OPTION(rgw_data, OPT_STR, "/var/lib/ceph/radosgw/$cluster-$id")
 OPTION(rgw_enable_apis, OPT_STR, "s3, swift, swift_auth, admin")
 OPTION(rgw_cache_enabled, OPT_BOOL, true)   // rgw cache enabled
 OPTION(rgw_cache_lru_size, OPT_INT, 10000)   // num of entries in rgw cache
+OPTION(rgw_cache_coalesce_misses, OPT_BOOL, true)   // concurrent misses on the same cache entry wait for a single fetch
 OPTION(rgw_socket_path, OPT_STR, "")   // path to unix domain socket, if not specified, rgw will not run as external fcgi
 OPTION(rgw_host, OPT_STR, "")  // host for radosgw, can be an IP, default is 0.0.0.0
 OPTION(rgw_port, OPT_STR, "")  // port to listen, format as "8080" "5000", if not specified, rgw will not run external fcgi
@@ -1071,6 +1120,7 @@ OPTION(rgw_get_obj_max_req_size, OPT_INT, 4 << 20) // max length of a single get
 OPTION(rgw_relaxed_s3_bucket_names, OPT_BOOL, false) // enable relaxed bucket name rules for US region buckets
 OPTION(rgw_defer_to_bucket_acls, OPT_STR, "") // if the user has bucket perms, use those before key perms (recurse and full_control)
 OPTION(rgw_list_buckets_max_chunk, OPT_INT, 1000) // max buckets to retrieve in a single op when listing user buckets
+OPTION(rgw_orphan_scan_threads, OPT_INT, 8) // worker threads used by radosgw-admin orphans find
 OPTION(rgw_md_log_max_shards, OPT_INT, 64) // max shards for metadata log
 OPTION(rgw_num_zone_opstate_shards, OPT_INT, 128) // max shards for keeping inter-region copy progress info
 OPTION(rgw_opstate_ratelimit_sec, OPT_INT, 30) // min time between opstate updates on a single upload (0 for disabling ratelimit)
@@ -1082,6 +1132,7 @@ OPTION(rgw_data_log_window, OPT_INT, 30) // data log entries window (in seconds)
 OPTION(rgw_data_log_changes_size, OPT_INT, 1000) // number of in-memory entries to hold for data changes log
 OPTION(rgw_data_log_num_shards, OPT_INT, 128) // number of objects to keep data changes log on
 OPTION(rgw_data_log_obj_prefix, OPT_STR, "data_log") //
+OPTION(rgw_data_log_batch_window_ms, OPT_INT, 0) // how long a data log flush waits for more entries to join the batch
 OPTION(rgw_replica_log_obj_prefix, OPT_STR, "replica_log") //
 
 OPTION(rgw_bucket_quota_ttl, OPT_INT, 600) // time for cached bucket stats to be cached within rgw instance
@@ -1096,8 +1147,14 @@ OPTION(rgw_user_quota_bucket_sync_interval, OPT_INT, 180) // time period for acc
 OPTION(rgw_user_quota_sync_interval, OPT_INT, 3600 * 24) // time period for accumulating modified buckets before syncing entire user stats
 OPTION(rgw_user_quota_sync_idle_users, OPT_BOOL, false) // whether stats for idle users be fully synced
 OPTION(rgw_user_quota_sync_wait_time, OPT_INT, 3600 * 24) // min time between two full stats sync for non-idle users
+OPTION(rgw_qos_max_delay, OPT_DOUBLE, 1.0) // requests that would be delayed longer than this (seconds) by user/bucket qos are rejected with SlowDown
+OPTION(rgw_qos_max_delayed, OPT_INT, 4) // requests of one user/bucket that may sleep on its qos limits at the same time, further ones are rejected with SlowDown
+OPTION(rgw_qos_table_shards, OPT_INT, 32) // number of shards of the user/bucket qos throttle table
+OPTION(rgw_qos_max_entries, OPT_INT, 10000) // number of user/bucket qos throttles kept before idle ones are expired
+OPTION(rgw_qos_idle_expire, OPT_INT, 60) // time after which an unused qos throttle can be expired
 
 OPTION(rgw_multipart_min_part_size, OPT_INT, 5 * 1024 * 1024) // min size for each part (except for last one) in multipart upload
+OPTION(rgw_multipart_complete_keepalive_interval, OPT_INT, 10) // seconds between whitespace sent to the client while completing a multipart upload, 0 to disable
 
 OPTION(rgw_olh_pending_timeout_sec, OPT_INT, 3600) // time until we retire a pending olh change
 
@@ -0,0 +1,226 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_SHAREDCLOCKCACHE_H
+#define CEPH_SHAREDCLOCKCACHE_H
+
+#include <list>
+#include <memory>
+#include <utility>
+#include "common/RWLock.h"
+#include "common/dout.h"
+#include "include/atomic.h"
+#include "include/memory.h"
+#include "include/unordered_map.h"
+
+/**
+ * Variant of SharedLRU for read mostly caches
+ *
+ * Values are handed out as shared pointers and stay reachable by key for
+ * as long as a reference to them exists, like with SharedLRU.  Recency is
+ * tracked with a reference bit per entry which eviction sweeps in clock
+ * order instead of an LRU list, so a hit only needs the lock shared and
+ * concurrent lookups don't serialize.  Inserts, purges and the sweep
+ * take it exclusive.
+ */
+template <class K, class V, class H = ceph::hash<K> >
+class SharedClockCache {
+  typedef ceph::shared_ptr<V> VPtr;
+  typedef ceph::weak_ptr<V> WeakVPtr;
+
+  struct Entry {
+    K key;
+    WeakVPtr weak;
+    V *ptr;
+    VPtr strong;        ///< set while the entry counts against max_size
+    atomic_t referenced; ///< set by hits, cleared by the clock hand
+    typename std::list<Entry*>::iterator pos; ///< in ring if strong is set
+
+    Entry(const K &key, V *ptr) : key(key), ptr(ptr) {}
+  };
+
+  CephContext *cct;
+  RWLock lock;
+  size_t max_size;
+  size_t size;
+  ceph::unordered_map<K, Entry*, H> contents; ///< all reachable values
+  std::list<Entry*> ring;                     ///< cached values
+  typename std::list<Entry*>::iterator hand;
+
+  void uncache(Entry *e, std::list<VPtr> *to_release) {
+    assert(e->strong);
+    if (hand == e->pos)
+      ++hand;
+    ring.erase(e->pos);
+    --size;
+    to_release->push_back(e->strong);
+    e->strong.reset();
+  }
+
+  void erase(typename ceph::unordered_map<K, Entry*, H>::iterator i,
+	     std::list<VPtr> *to_release) {
+    Entry *e = i->second;
+    if (e->strong)
+      uncache(e, to_release);
+    contents.erase(i);
+    delete e;
+  }
+
+  void trim_cache(std::list<VPtr> *to_release) {
+    while (size > max_size) {
+      if (hand == ring.end())
+	hand = ring.begin();
+      Entry *e = *hand;
+      if (e->referenced.read()) {
+	e->referenced.set(0);
+	++hand;
+      } else {
+	uncache(e, to_release);
+      }
+    }
+  }
+
+  void remove(const K &key, V *valptr) {
+    RWLock::WLocker l(lock);
+    typename ceph::unordered_map<K, Entry*, H>::iterator i = contents.find(key);
+    if (i != contents.end() && i->second->ptr == valptr) {
+      Entry *e = i->second;
+      assert(!e->strong);
+      contents.erase(i);
+      delete e;
+    }
+  }
+
+  class Cleanup {
+  public:
+    SharedClockCache<K, V, H> *cache;
+    K key;
+    Cleanup(SharedClockCache<K, V, H> *cache, K key) : cache(cache), key(key) {}
+    void operator()(V *ptr) {
+      cache->remove(key, ptr);
+      delete ptr;
+    }
+  };
+
+public:
+  SharedClockCache(CephContext *cct = NULL, size_t max_size = 20)
+    : cct(cct), lock("SharedClockCache::lock"), max_size(max_size),
+      size(0), hand(ring.end()) {
+    contents.rehash(max_size);
+  }
+
+  ~SharedClockCache() {
+    clear();
+    if (!contents.empty()) {
+      lderr(cct) << "leaked refs:\n";
+      for (typename ceph::unordered_map<K, Entry*, H>::iterator i = contents.begin();
+	   i != contents.end();
+	   ++i)
+	*_dout << __func__ << " " << this << " refs: " << i->first
+	       << " = " << i->second->ptr << std::endl;
+      *_dout << dendl;
+      assert(contents.empty());
+    }
+  }
+
+  void set_cct(CephContext *c) {
+    cct = c;
+  }
+
+  /// drop all strong references held by the cache
+  void clear() {
+    std::list<VPtr> to_release; // released after we drop the lock
+    RWLock::WLocker l(lock);
+    while (!ring.empty())
+      uncache(ring.front(), &to_release);
+  }
+
+  /// forget key, later lookups miss even if a reference is still held
+  void purge(const K &key) {
+    std::list<VPtr> to_release;
+    RWLock::WLocker l(lock);
+    typename ceph::unordered_map<K, Entry*, H>::iterator i = contents.find(key);
+    if (i != contents.end())
+      erase(i, &to_release);
+  }
+
+  void set_size(size_t new_size) {
+    std::list<VPtr> to_release;
+    RWLock::WLocker l(lock);
+    max_size = new_size;
+    trim_cache(&to_release);
+  }
+
+  VPtr lookup(const K &key) {
+    {
+      RWLock::RLocker l(lock);
+      typename ceph::unordered_map<K, Entry*, H>::iterator i = contents.find(key);
+      if (i == contents.end())
+	return VPtr();
+      VPtr val = i->second->weak.lock();
+      if (val) {
+	if (!i->second->referenced.read())
+	  i->second->referenced.set(1);
+	return val;
+      }
+    }
+    // the last reference is being dropped, unlink the value now rather
+    // than waiting for its cleanup so that the caller can add a new one
+    std::list<VPtr> to_release;
+    RWLock::WLocker l(lock);
+    typename ceph::unordered_map<K, Entry*, H>::iterator i = contents.find(key);
+    if (i == contents.end())
+      return VPtr();
+    VPtr val = i->second->weak.lock();
+    if (!val)
+      erase(i, &to_release);
+    return val;
+  }
+
+  /**
+   * Inserts a key if not present and returns a reference to its value
+   *
+   * If the key already existed, the value already in the cache is
+   * returned and you are responsible for deleting the one you tried to
+   * insert, @see SharedLRU::add
+   */
+  VPtr add(const K &key, V *value, bool *existed = NULL) {
+    VPtr val;
+    std::list<VPtr> to_release;
+    RWLock::WLocker l(lock);
+    typename ceph::unordered_map<K, Entry*, H>::iterator i = contents.find(key);
+    if (i != contents.end()) {
+      val = i->second->weak.lock();
+      if (val) {
+	if (existed)
+	  *existed = true;
+	i->second->referenced.set(1);
+	return val;
+      }
+      erase(i, &to_release);
+    }
+    if (existed)
+      *existed = false;
+
+    Entry *e = new Entry(key, value);
+    val = VPtr(value, Cleanup(this, key));
+    e->weak = val;
+    e->strong = val;
+    e->pos = ring.insert(hand, e);
+    ++size;
+    contents[key] = e;
+    trim_cache(&to_release);
+    return val;
+  }
+};
+
+#endif
@@ -70,6 +70,8 @@
 
 // xskyio private featrue
 #define CEPH_FEATURE_NEW_OSDOPREPLY_ENCODING   (1ULL<<60) /* New, v7 encoding */
+#define CEPH_FEATURE_OSD_PARTIAL_RECOVERY (1ULL<<57) /* push dirty extents only */
+#define CEPH_FEATURE_OSD_CHAIN_REPLICATION (1ULL<<58) /* forwarded MOSDRepOp */
 #define CEPH_FEATURE_RESERVED2 (1ULL<<61)  /* slow down, we are almost out... */
 #define CEPH_FEATURE_RESERVED  (1ULL<<62)  /* DO NOT USE THIS ... last bit! */
 #define CEPH_FEATURE_RESERVED_BROKEN  (1ULL<<63)  /* DO NOT USE THIS; see below */
@@ -157,6 +159,8 @@ static inline unsigned long long ceph_sanitize_features(unsigned long long f) {
          CEPH_FEATURE_CRUSH_V4 |	     \
          CEPH_FEATURE_OSD_MIN_SIZE_RECOVERY |		 \
 	 CEPH_FEATURE_HAMMER_0_94_4 |		 \
+	 CEPH_FEATURE_OSD_PARTIAL_RECOVERY |	 \
+	 CEPH_FEATURE_OSD_CHAIN_REPLICATION |	 \
 	 0ULL)
 
 #define CEPH_FEATURES_SUPPORTED_DEFAULT  CEPH_FEATURES_ALL
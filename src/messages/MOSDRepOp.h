@@ -25,7 +25,7 @@
 
 class MOSDRepOp : public Message {
 
-  static const int HEAD_VERSION = 1;
+  static const int HEAD_VERSION = 2;
   static const int COMPAT_VERSION = 1;
 
 public:
@@ -64,6 +64,9 @@ public:
   /// non-empty if this transaction involves a hit_set history update
   boost::optional<pg_hit_set_history_t> updated_hit_set_history;
 
+  /// replicas to pass this op on to, in order, after the receiver
+  vector<pg_shard_t> forward_to;
+
   int get_cost() const {
     return data.length();
   }
@@ -94,6 +97,8 @@ public:
     ::decode(from, p);
     ::decode(updated_hit_set_history, p);
     ::decode(pg_trim_rollback_to, p);
+    if (header.version >= 2)
+      ::decode(forward_to, p);
     final_decode_needed = false;
   }
 
@@ -113,6 +118,7 @@ public:
     ::encode(from, payload);
     ::encode(updated_hit_set_history, payload);
     ::encode(pg_trim_rollback_to, payload);
+    ::encode(forward_to, payload);
   }
 
   MOSDRepOp()
@@ -145,6 +151,8 @@ public:
         out << " " << poid << " v " << version;
       if (updated_hit_set_history)
         out << ", has_updated_hit_set_history";
+      if (!forward_to.empty())
+        out << " forward_to " << forward_to;
     }
     out << ")";
   }
@@ -24,7 +24,7 @@
 
 struct MOSDRepScrub : public Message {
 
-  static const int HEAD_VERSION = 6;
+  static const int HEAD_VERSION = 7;
   static const int COMPAT_VERSION = 2;
 
   spg_t pgid;             // PG to scrub
@@ -36,6 +36,8 @@ struct MOSDRepScrub : public Message {
   hobject_t end;         // upper bound of scrub, exclusive
   bool deep;             // true if scrub should be deep
   uint32_t seed;         // seed value for digest calculation
+  eversion_t trust_digests_to; // deep scrub uses the stored digests of
+                               // objects not modified since this version
 
   MOSDRepScrub()
     : Message(MSG_OSD_REP_SCRUB, HEAD_VERSION, COMPAT_VERSION),
@@ -44,7 +46,8 @@ struct MOSDRepScrub : public Message {
       seed(0) { }
 
   MOSDRepScrub(spg_t pgid, eversion_t scrub_to, epoch_t map_epoch,
-               hobject_t start, hobject_t end, bool deep, uint32_t seed)
+               hobject_t start, hobject_t end, bool deep, uint32_t seed,
+	       eversion_t trust_digests_to)
     : Message(MSG_OSD_REP_SCRUB, HEAD_VERSION, COMPAT_VERSION),
       pgid(pgid),
       scrub_to(scrub_to),
@@ -53,7 +56,8 @@ struct MOSDRepScrub : public Message {
       start(start),
       end(end),
       deep(deep),
-      seed(seed) { }
+      seed(seed),
+      trust_digests_to(trust_digests_to) { }
 
 
 private:
@@ -68,6 +72,7 @@ public:
         << ",chunky:" << chunky
         << ",deep:" << deep
 	<< ",seed:" << seed
+	<< ",trust_digests_to:" << trust_digests_to
         << ",version:" << header.version;
     out << ")";
   }
@@ -83,6 +88,7 @@ public:
     ::encode(deep, payload);
     ::encode(pgid.shard, payload);
     ::encode(seed, payload);
+    ::encode(trust_digests_to, payload);
   }
   void decode_payload() {
     bufferlist::iterator p = payload.begin();
@@ -115,6 +121,9 @@ public:
     } else {
       seed = 0;
     }
+    if (header.version >= 7) {
+      ::decode(trust_digests_to, p);
+    }
   }
 };
 
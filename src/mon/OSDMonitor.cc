@@ -2346,7 +2346,7 @@ bool OSDMonitor::prepare_remove_snaps(MRemoveSnaps *m)
   for (map<int, vector<snapid_t> >::iterator p = m->snaps.begin(); 
        p != m->snaps.end();
        ++p) {
-    pg_pool_t& pi = osdmap.pools[p->first];
+    pg_pool_t& pi = (*osdmap.pools)[p->first];
     for (vector<snapid_t>::iterator q = p->second.begin();
 	 q != p->second.end();
 	 ++q) {
@@ -2867,8 +2867,8 @@ void OSDMonitor::get_health(list<pair<health_status_t,string> >& summary,
     // hit_set-less cache_mode?
     if (g_conf->mon_warn_on_cache_pools_without_hit_sets) {
       int problem_cache_pools = 0;
-      for (map<int64_t, pg_pool_t>::const_iterator p = osdmap.pools.begin();
-	   p != osdmap.pools.end();
+      for (map<int64_t, pg_pool_t>::const_iterator p = osdmap.pools->begin();
+	   p != osdmap.pools->end();
 	   ++p) {
 	const pg_pool_t& info = p->second;
 	if (info.cache_mode_requires_hit_set() &&
@@ -3261,8 +3261,8 @@ bool OSDMonitor::preprocess_command(MMonCommand *m)
     cmd_getval(g_ceph_context, cmdmap, "auid", auid, int64_t(0));
     if (f)
       f->open_array_section("pools");
-    for (map<int64_t, pg_pool_t>::iterator p = osdmap.pools.begin();
-	 p != osdmap.pools.end();
+    for (map<int64_t, pg_pool_t>::iterator p = osdmap.pools->begin();
+	 p != osdmap.pools->end();
 	 ++p) {
       if (!auid || p->second.auid == (uint64_t)auid) {
 	if (f) {
@@ -3455,6 +3455,18 @@ bool OSDMonitor::preprocess_command(MMonCommand *m)
 	f->dump_int("min_read_recency_for_promote", p->min_read_recency_for_promote);
       } else if (var == "write_fadvise_dontneed") {
 	f->dump_string("write_fadvise_dontneed", p->has_flag(pg_pool_t::FLAG_WRITE_FADVISE_DONTNEED) ? "true" : "false");
+      } else if (var == "fast_read") {
+	f->dump_string("fast_read", p->has_flag(pg_pool_t::FLAG_EC_FAST_READ) ? "true" : "false");
+      } else if (var == "chain_replication") {
+	f->dump_string("chain_replication", p->has_flag(pg_pool_t::FLAG_CHAIN_REPLICATION) ? "true" : "false");
+      } else if (var == "client_throttle_ops") {
+	f->dump_unsigned("client_throttle_ops", p->client_throttle_ops);
+      } else if (var == "client_throttle_bps") {
+	f->dump_unsigned("client_throttle_bps", p->client_throttle_bps);
+      } else if (var == "client_throttle_ops_max") {
+	f->dump_unsigned("client_throttle_ops_max", p->client_throttle_ops_max);
+      } else if (var == "client_throttle_bps_max") {
+	f->dump_unsigned("client_throttle_bps_max", p->client_throttle_bps_max);
       }
 
       f->close_section();
@@ -3508,6 +3520,18 @@ bool OSDMonitor::preprocess_command(MMonCommand *m)
 	ss << "min_read_recency_for_promote: " << p->min_read_recency_for_promote;
       } else if (var == "write_fadvise_dontneed") {
 	ss << "write_fadvise_dontneed: " <<  (p->has_flag(pg_pool_t::FLAG_WRITE_FADVISE_DONTNEED) ? "true" : "false");
+      } else if (var == "fast_read") {
+	ss << "fast_read: " <<  (p->has_flag(pg_pool_t::FLAG_EC_FAST_READ) ? "true" : "false");
+      } else if (var == "chain_replication") {
+	ss << "chain_replication: " <<  (p->has_flag(pg_pool_t::FLAG_CHAIN_REPLICATION) ? "true" : "false");
+      } else if (var == "client_throttle_ops") {
+	ss << "client_throttle_ops: " << p->client_throttle_ops;
+      } else if (var == "client_throttle_bps") {
+	ss << "client_throttle_bps: " << p->client_throttle_bps;
+      } else if (var == "client_throttle_ops_max") {
+	ss << "client_throttle_ops_max: " << p->client_throttle_ops_max;
+      } else if (var == "client_throttle_bps_max") {
+	ss << "client_throttle_bps_max: " << p->client_throttle_bps_max;
       }
 
       rdata.append(ss);
@@ -4370,6 +4394,9 @@ int OSDMonitor::prepare_new_pool(string& name, uint64_t auid,
     pi->set_flag(pg_pool_t::FLAG_NOPGCHANGE);
   if (g_conf->osd_pool_default_flag_nosizechange)
     pi->set_flag(pg_pool_t::FLAG_NOSIZECHANGE);
+  if (g_conf->osd_pool_default_ec_fast_read &&
+      pool_type == pg_pool_t::TYPE_ERASURE)
+    pi->set_flag(pg_pool_t::FLAG_EC_FAST_READ);
 
   pi->size = size;
   pi->min_size = min_size;
@@ -4776,6 +4803,51 @@ int OSDMonitor::prepare_command_pool_set(map<string,cmd_vartype> &cmdmap,
       ss << "expecting value 'true', 'false', '0', or '1'";
       return -EINVAL;
     }
+  } else if (var == "fast_read") {
+    if (!p.is_erasure()) {
+      ss << "fast read is only supported by erasure coded pools";
+      return -EINVAL;
+    }
+    if (val == "true" || (interr.empty() && n == 1)) {
+      p.flags |= pg_pool_t::FLAG_EC_FAST_READ;
+    } else if (val == "false" || (interr.empty() && n == 0)) {
+      p.flags &= ~pg_pool_t::FLAG_EC_FAST_READ;
+    } else {
+      ss << "expecting value 'true', 'false', '0', or '1'";
+      return -EINVAL;
+    }
+  } else if (var == "chain_replication") {
+    if (!p.is_replicated()) {
+      ss << "chain replication is only supported by replicated pools";
+      return -EINVAL;
+    }
+    if (val == "true" || (interr.empty() && n == 1)) {
+      p.flags |= pg_pool_t::FLAG_CHAIN_REPLICATION;
+    } else if (val == "false" || (interr.empty() && n == 0)) {
+      p.flags &= ~pg_pool_t::FLAG_CHAIN_REPLICATION;
+    } else {
+      ss << "expecting value 'true', 'false', '0', or '1'";
+      return -EINVAL;
+    }
+  } else if (var == "client_throttle_ops" || var == "client_throttle_bps" ||
+	     var == "client_throttle_ops_max" ||
+	     var == "client_throttle_bps_max") {
+    if (interr.length()) {
+      ss << "error parsing integer value '" << val << "': " << interr;
+      return -EINVAL;
+    }
+    if (n < 0) {
+      ss << var << " must be >= 0";
+      return -EINVAL;
+    }
+    if (var == "client_throttle_ops")
+      p.client_throttle_ops = n;
+    else if (var == "client_throttle_bps")
+      p.client_throttle_bps = n;
+    else if (var == "client_throttle_ops_max")
+      p.client_throttle_ops_max = n;
+    else
+      p.client_throttle_bps_max = n;
   } else {
     ss << "unrecognized variable '" << var << "'";
     return -EINVAL;
@@ -5451,7 +5523,7 @@ bool OSDMonitor::prepare_command_impl(MMonCommand *m,
     if (erasure_code_profile_in_use(pending_inc.new_pools, name, ss))
       goto wait;
 
-    if (erasure_code_profile_in_use(osdmap.pools, name, ss)) {
+    if (erasure_code_profile_in_use(*osdmap.pools, name, ss)) {
       err = -EBUSY;
       goto reply;
     }
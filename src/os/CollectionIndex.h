@@ -17,6 +17,7 @@
 
 #include <string>
 #include <vector>
+#include <sys/stat.h>
 #include "include/memory.h"
 
 #include "osd/osd_types.h"
@@ -138,6 +139,20 @@ protected:
     const ghobject_t &oid ///< [in] Object to remove
     ) = 0;
 
+  /**
+   * Drops the links to oid the index made for its own use
+   *
+   * Lets the caller tell the last link of an object from one an index
+   * keeps while it reorganizes a directory.  Called with access_lock
+   * held for write.
+   *
+   * @return Error Code, otherwise the number of links dropped
+   */
+  virtual int drop_private_links(
+    const ghobject_t &oid, ///< [in] Object about to be removed
+    const struct stat &st  ///< [in] Stat of its file
+    ) { return 0; }
+
   /**
    * Gets the IndexedPath for oid.
    *
@@ -17,6 +17,8 @@
 
 #include "common/debug.h"
 #include "common/config.h"
+#include "common/perf_counters.h"
+#include "common/Clock.h"
 #include "include/assert.h"
 
 #define dout_subsys ceph_subsys_filestore
@@ -1066,20 +1068,104 @@ int DBObjectMap::write_state(KeyValueDB::Transaction _t) {
 }
 
 
-DBObjectMap::Header DBObjectMap::_lookup_map_header(
+DBObjectMap::DBObjectMap(KeyValueDB *db)
+  : db(db), header_lock("DBOBjectMap"),
+    num_stripes(MAX(1, g_conf->filestore_omap_header_stripes)),
+    object_stripes(NULL), seq_stripes(NULL), logger(NULL)
+{
+  object_stripes = new ObjectStripe[num_stripes];
+  seq_stripes = new SeqStripe[num_stripes];
+  size_t cache_size = MAX(1, g_conf->filestore_omap_header_cache_size / num_stripes);
+  for (unsigned i = 0; i < num_stripes; ++i)
+    object_stripes[i].cache.set_size(cache_size);
+
+  PerfCountersBuilder plb(g_ceph_context, "dbobjectmap", l_dbom_first, l_dbom_last);
+  plb.add_u64_counter(l_dbom_stripe_lock_contended, "stripe_lock_contended");
+  plb.add_time_avg(l_dbom_stripe_lock_wait, "stripe_lock_wait");
+  plb.add_u64_counter(l_dbom_map_header_wait, "map_header_wait");
+  plb.add_u64_counter(l_dbom_parent_wait, "parent_header_wait");
+  logger = plb.create_perf_counters();
+  g_ceph_context->get_perfcounters_collection()->add(logger);
+}
+
+DBObjectMap::~DBObjectMap()
+{
+  g_ceph_context->get_perfcounters_collection()->remove(logger);
+  delete logger;
+  delete[] object_stripes;
+  delete[] seq_stripes;
+}
+
+DBObjectMap::ObjectStripe &DBObjectMap::get_object_stripe(const ghobject_t &oid)
+{
+  static CEPH_HASH_NAMESPACE::hash<ghobject_t> H;
+  return object_stripes[H(oid) % num_stripes];
+}
+
+void DBObjectMap::lock_stripe(Mutex &lock)
+{
+  if (lock.TryLock())
+    return;
+  utime_t start = ceph_clock_now(g_ceph_context);
+  lock.Lock();
+  logger->inc(l_dbom_stripe_lock_contended);
+  logger->tinc(l_dbom_stripe_lock_wait, ceph_clock_now(g_ceph_context) - start);
+}
+
+void DBObjectMap::lock_map_header(const ghobject_t &oid)
+{
+  ObjectStripe &stripe = get_object_stripe(oid);
+  StripeLocker l(this, stripe.lock);
+  if (stripe.map_header_in_use.count(oid)) {
+    logger->inc(l_dbom_map_header_wait);
+    while (stripe.map_header_in_use.count(oid))
+      stripe.cond.Wait(stripe.lock);
+  }
+  stripe.map_header_in_use.insert(oid);
+}
+
+void DBObjectMap::unlock_map_header(const ghobject_t &oid)
+{
+  ObjectStripe &stripe = get_object_stripe(oid);
+  StripeLocker l(this, stripe.lock);
+  assert(stripe.map_header_in_use.count(oid));
+  stripe.cond.Signal();
+  stripe.map_header_in_use.erase(oid);
+}
+
+void DBObjectMap::get_seq(uint64_t seq, bool wait)
+{
+  SeqStripe &stripe = get_seq_stripe(seq);
+  StripeLocker l(this, stripe.lock);
+  if (wait && stripe.in_use.count(seq)) {
+    logger->inc(l_dbom_parent_wait);
+    while (stripe.in_use.count(seq))
+      stripe.cond.Wait(stripe.lock);
+  }
+  assert(!stripe.in_use.count(seq));
+  stripe.in_use.insert(seq);
+}
+
+void DBObjectMap::put_seq(uint64_t seq)
+{
+  SeqStripe &stripe = get_seq_stripe(seq);
+  StripeLocker l(this, stripe.lock);
+  assert(stripe.in_use.count(seq));
+  stripe.in_use.erase(seq);
+  stripe.cond.Signal();
+}
+
+DBObjectMap::Header DBObjectMap::lookup_map_header(
   const MapHeaderLock &l,
   const ghobject_t &oid)
 {
   assert(l.get_locked() == oid);
 
+  ObjectStripe &stripe = get_object_stripe(oid);
   _Header *header = new _Header();
-  {
-    Mutex::Locker l(cache_lock);
-    if (caches.lookup(oid, header)) {
-      assert(!in_use.count(header->seq));
-      in_use.insert(header->seq);
-      return Header(header, RemoveOnDelete(this));
-    }
+  if (stripe.cache.lookup(oid, header)) {
+    get_seq(header->seq);
+    return Header(header, RemoveOnDelete(this));
   }
 
   map<string, bufferlist> out;
@@ -1091,17 +1177,12 @@ DBObjectMap::Header DBObjectMap::_lookup_map_header(
     return Header();
   }
 
-  Header ret(header, RemoveOnDelete(this));
   bufferlist::iterator iter = out.begin()->second.begin();
-  ret->decode(iter);
-  {
-    Mutex::Locker l(cache_lock);
-    caches.add(oid, *ret);
-  }
+  header->decode(iter);
+  stripe.cache.add(oid, *header);
 
-  assert(!in_use.count(header->seq));
-  in_use.insert(header->seq);
-  return ret;
+  get_seq(header->seq);
+  return Header(header, RemoveOnDelete(this));
 }
 
 DBObjectMap::Header DBObjectMap::_generate_new_header(const ghobject_t &oid,
@@ -1115,8 +1196,7 @@ DBObjectMap::Header DBObjectMap::_generate_new_header(const ghobject_t &oid,
   }
   header->num_children = 1;
   header->oid = oid;
-  assert(!in_use.count(header->seq));
-  in_use.insert(header->seq);
+  get_seq(header->seq);
 
   write_state();
   return header;
@@ -1124,9 +1204,7 @@ DBObjectMap::Header DBObjectMap::_generate_new_header(const ghobject_t &oid,
 
 DBObjectMap::Header DBObjectMap::lookup_parent(Header input)
 {
-  Mutex::Locker l(header_lock);
-  while (in_use.count(input->parent))
-    header_cond.Wait(header_lock);
+  get_seq(input->parent, true);
   map<string, bufferlist> out;
   set<string> keys;
   keys.insert(HEADER_KEY);
@@ -1136,10 +1214,12 @@ DBObjectMap::Header DBObjectMap::lookup_parent(Header input)
   int r = db->get(sys_parent_prefix(input), keys, &out);
   if (r < 0) {
     assert(0);
+    put_seq(input->parent);
     return Header();
   }
   if (out.empty()) {
     assert(0);
+    put_seq(input->parent);
     return Header();
   }
 
@@ -1149,7 +1229,7 @@ DBObjectMap::Header DBObjectMap::lookup_parent(Header input)
   header->decode(iter);
   dout(20) << "lookup_parent: parent seq is " << header->seq << " with parent "
        << header->parent << dendl;
-  in_use.insert(header->seq);
+  assert(header->seq == input->parent);
   return header;
 }
 
@@ -1158,10 +1238,9 @@ DBObjectMap::Header DBObjectMap::lookup_create_map_header(
   const ghobject_t &oid,
   KeyValueDB::Transaction t)
 {
-  Mutex::Locker l(header_lock);
-  Header header = _lookup_map_header(hl, oid);
+  Header header = lookup_map_header(hl, oid);
   if (!header) {
-    header = _generate_new_header(oid, Header());
+    header = generate_new_header(oid, Header());
     set_map_header(hl, oid, *header, t);
   }
   return header;
@@ -1199,10 +1278,7 @@ void DBObjectMap::remove_map_header(
   set<string> to_remove;
   to_remove.insert(map_header_key(oid));
   t->rmkeys(HOBJECT_TO_SEQ, to_remove);
-  {
-    Mutex::Locker l(cache_lock);
-    caches.clear(oid);
-  }
+  get_object_stripe(oid).cache.clear(oid);
 }
 
 void DBObjectMap::set_map_header(
@@ -1217,10 +1293,7 @@ void DBObjectMap::set_map_header(
   map<string, bufferlist> to_set;
   header.encode(to_set[map_header_key(oid)]);
   t->set(HOBJECT_TO_SEQ, to_set);
-  {
-    Mutex::Locker l(cache_lock);
-    caches.add(oid, header);
-  }
+  get_object_stripe(oid).cache.add(oid, header);
 }
 
 bool DBObjectMap::check_spos(const ghobject_t &oid,
@@ -19,6 +19,17 @@
 #include <boost/optional/optional_io.hpp>
 #include "common/random_cache.hpp"
 
+class PerfCounters;
+
+enum {
+  l_dbom_first = 34500,
+  l_dbom_stripe_lock_contended,
+  l_dbom_stripe_lock_wait,
+  l_dbom_map_header_wait,
+  l_dbom_parent_wait,
+  l_dbom_last,
+};
+
 /**
  * DBObjectMap: Implements ObjectMap in terms of KeyValueDB
  *
@@ -58,17 +69,9 @@ public:
   boost::scoped_ptr<KeyValueDB> db;
 
   /**
-   * Serializes access to next_seq as well as the in_use set
+   * Serializes access to next_seq
    */
   Mutex header_lock;
-  Cond header_cond;
-  Cond map_header_cond;
-
-  /**
-   * Set of headers currently in use
-   */
-  set<uint64_t> in_use;
-  set<ghobject_t> map_header_in_use;
 
   /**
    * Takes the map_header_in_use entry in constructor, releases in
@@ -83,10 +86,7 @@ public:
   public:
     MapHeaderLock(DBObjectMap *db) : db(db) {}
     MapHeaderLock(DBObjectMap *db, const ghobject_t &oid) : db(db), locked(oid) {
-      Mutex::Locker l(db->header_lock);
-      while (db->map_header_in_use.count(*locked))
-	db->map_header_cond.Wait(db->header_lock);
-      db->map_header_in_use.insert(*locked);
+      db->lock_map_header(*locked);
     }
 
     const ghobject_t &get_locked() const {
@@ -104,19 +104,13 @@ public:
     }
 
     ~MapHeaderLock() {
-      if (locked) {
-	Mutex::Locker l(db->header_lock);
-	assert(db->map_header_in_use.count(*locked));
-	db->map_header_cond.Signal();
-	db->map_header_in_use.erase(*locked);
-      }
+      if (locked)
+	db->unlock_map_header(*locked);
     }
   };
 
-  DBObjectMap(KeyValueDB *db) : db(db), header_lock("DBOBjectMap"),
-                                cache_lock("DBObjectMap::CacheLock"),
-                                caches(g_conf->filestore_omap_header_cache_size)
-    {}
+  DBObjectMap(KeyValueDB *db);
+  ~DBObjectMap();
 
   KeyValueDB::Transaction get_transaction() { return db->get_transaction(); }
   int prepare_set_keys(
@@ -346,8 +340,59 @@ public:
 private:
   /// Implicit lock on Header->seq
   typedef ceph::shared_ptr<_Header> Header;
-  Mutex cache_lock;
-  RandomCache<ghobject_t, _Header> caches;
+
+  /**
+   * The objects whose map header is locked (@see MapHeaderLock) and the
+   * header cache, striped by hash of the object so that omap ops on
+   * unrelated objects don't contend on a single lock.
+   */
+  struct ObjectStripe {
+    Mutex lock;
+    Cond cond;
+    set<ghobject_t> map_header_in_use;
+    RandomCache<ghobject_t, _Header> cache;
+
+    ObjectStripe() : lock("DBObjectMap::ObjectStripe::lock") {}
+  };
+
+  /**
+   * Set of headers currently in use, striped by seq
+   */
+  struct SeqStripe {
+    Mutex lock;
+    Cond cond;
+    set<uint64_t> in_use;
+
+    SeqStripe() : lock("DBObjectMap::SeqStripe::lock") {}
+  };
+
+  unsigned num_stripes;
+  ObjectStripe *object_stripes;
+  SeqStripe *seq_stripes;
+  PerfCounters *logger;
+
+  ObjectStripe &get_object_stripe(const ghobject_t &oid);
+  SeqStripe &get_seq_stripe(uint64_t seq) {
+    return seq_stripes[seq % num_stripes];
+  }
+  /// lock a stripe, accounting for contention
+  void lock_stripe(Mutex &lock);
+  class StripeLocker {
+    Mutex &lock;
+  public:
+    StripeLocker(DBObjectMap *db, Mutex &l) : lock(l) {
+      db->lock_stripe(lock);
+    }
+    ~StripeLocker() {
+      lock.Unlock();
+    }
+  };
+
+  void lock_map_header(const ghobject_t &oid);
+  void unlock_map_header(const ghobject_t &oid);
+  /// mark header seq in use, waiting for it first if wait is set
+  void get_seq(uint64_t seq, bool wait = false);
+  void put_seq(uint64_t seq);
 
   string map_header_key(const ghobject_t &oid);
   string header_key(uint64_t seq);
@@ -478,15 +523,9 @@ private:
   }
 
   /// Lookup leaf header for c oid
-  Header _lookup_map_header(
+  Header lookup_map_header(
     const MapHeaderLock &l,
     const ghobject_t &oid);
-  Header lookup_map_header(
-    const MapHeaderLock &l2,
-    const ghobject_t &oid) {
-    Mutex::Locker l(header_lock);
-    return _lookup_map_header(l2, oid);
-  }
 
   /// Lookup header node for input
   Header lookup_parent(Header input);
@@ -537,10 +576,7 @@ private:
     RemoveOnDelete(DBObjectMap *db) :
       db(db) {}
     void operator() (_Header *header) {
-      Mutex::Locker l(db->header_lock);
-      assert(db->in_use.count(header->seq));
-      db->in_use.erase(header->seq);
-      db->header_cond.Signal();
+      db->put_seq(header->seq);
       delete header;
     }
   };
@@ -18,10 +18,12 @@
 #include <memory>
 #include <errno.h>
 #include <cstdio>
+#include <sys/stat.h>
 #include "common/hobject.h"
 #include "common/Mutex.h"
 #include "common/Cond.h"
 #include "common/shared_cache.hpp"
+#include "common/shared_clock_cache.hpp"
 #include "common/random_cache.hpp"
 #include "include/compat.h"
 #include "include/intarith.h"
@@ -44,12 +46,22 @@ public:
     atomic_t truncate;
     Mutex lock;
     Cond cond;;
-    FD(int _fd) : fd(_fd), lock("FD::lock") {
+    uint64_t ino; ///< 0 until looked up, @see get_ino
+    FD(int _fd) : fd(_fd), lock("FD::lock"), ino(0) {
       assert(_fd >= 0);
     }
     int operator*() const {
       return fd;
     }
+    uint64_t get_ino() {
+      Mutex::Locker l(lock);
+      if (!ino) {
+	struct stat st;
+	if (::fstat(fd, &st) == 0)
+	  ino = st.st_ino;
+      }
+      return ino;
+    }
     bool has_truncate() {
       Mutex::Locker l(lock);
       return truncate.read() > 0;
@@ -76,24 +88,35 @@ private:
   CephContext *cct;
   const int registry_shards;
   SharedLRU<ghobject_t, FD> *registry;
+  /// used instead of registry with filestore_fd_cache_clock
+  SharedClockCache<ghobject_t, FD> *clock_registry;
   RandomCache<ghobject_t, FDRef> random_cache;
   bool random;
 
+  int shard_size(const md_config_t *conf) const {
+    return MAX((conf->filestore_fd_cache_size / registry_shards), 1);
+  }
+
 public:
   FDCache(CephContext *cct) : cct(cct),
-  registry_shards(cct->_conf->filestore_fd_cache_shards) {
+  registry_shards(cct->_conf->filestore_fd_cache_shards),
+  registry(NULL), clock_registry(NULL), random(false) {
     assert(cct);
     cct->_conf->add_observer(this);
     if (cct->_conf->filestore_fd_cache_random) {
       random_cache.set_size(cct->_conf->filestore_fd_cache_size);
       random = true;
-      registry = NULL;
+    } else if (cct->_conf->filestore_fd_cache_clock) {
+      clock_registry = new SharedClockCache<ghobject_t, FD>[registry_shards];
+      for (int i = 0; i < registry_shards; ++i) {
+        clock_registry[i].set_cct(cct);
+        clock_registry[i].set_size(shard_size(cct->_conf));
+      }
     } else {
       registry = new SharedLRU<ghobject_t, FD>[registry_shards];
       for (int i = 0; i < registry_shards; ++i) {
         registry[i].set_cct(cct);
-        registry[i].set_size(
-            MAX((cct->_conf->filestore_fd_cache_size / registry_shards), 1));
+        registry[i].set_size(shard_size(cct->_conf));
       }
     }
   }
@@ -101,6 +124,8 @@ public:
     cct->_conf->remove_observer(this);
     if (registry)
       delete[] registry;
+    if (clock_registry)
+      delete[] clock_registry;
   }
 
   FDRef lookup(const ghobject_t &hoid) {
@@ -110,6 +135,8 @@ public:
       return ret;
     } else {
       int registry_id = hoid.hobj.get_hash() % registry_shards;
+      if (clock_registry)
+        return clock_registry[registry_id].lookup(hoid);
       return registry[registry_id].lookup(hoid);
     }
   }
@@ -123,6 +150,8 @@ public:
       return ret;
     } else {
       int registry_id = hoid.hobj.get_hash() % registry_shards;
+      if (clock_registry)
+        return clock_registry[registry_id].add(hoid, new FD(fd), existed);
       return registry[registry_id].add(hoid, new FD(fd), existed);
     }
   }
@@ -133,7 +162,10 @@ public:
       random_cache.clear(hoid);
     } else {
       int registry_id = hoid.hobj.get_hash() % registry_shards;
-      registry[registry_id].purge(hoid);
+      if (clock_registry)
+        clock_registry[registry_id].purge(hoid);
+      else
+        registry[registry_id].purge(hoid);
     }
   }
 
@@ -148,9 +180,12 @@ public:
   void handle_conf_change(const md_config_t *conf,
 			  const std::set<std::string> &changed) {
     if (changed.count("filestore_fd_cache_size") && !random) {
-      for (int i = 0; i < registry_shards; ++i)
-        registry[i].set_size(
-              MAX((conf->filestore_fd_cache_size / registry_shards), 1));
+      for (int i = 0; i < registry_shards; ++i) {
+        if (clock_registry)
+          clock_registry[i].set_size(shard_size(conf));
+        else
+          registry[i].set_size(shard_size(conf));
+      }
     }
   }
 
@@ -643,9 +643,13 @@ void FileJournal::start_writer()
 {
   write_stop = false;
   aio_stop = false;
+#ifdef HAVE_LIBAIO
+  aio_batch = aio && g_conf->journal_aio_batch;
+#endif
   write_thread.create();
 #ifdef HAVE_LIBAIO
-  if (aio)
+  // in batch mode the write thread reaps its own completions
+  if (aio && !aio_batch)
     write_finish_thread.create();
 #endif
 }
@@ -666,7 +670,7 @@ void FileJournal::stop_writer()
 #ifdef HAVE_LIBAIO
   // stop aio completeion thread *after* writer thread has stopped
   // and has submitted all of its io
-  if (aio) {
+  if (aio && !aio_batch) {
     aio_lock.Lock();
     aio_stop = true;
     aio_cond.Signal();
@@ -1169,21 +1173,81 @@ void FileJournal::flush()
 }
 
 
+/*
+ * Group commit: rather than writing out whatever is queued the moment the
+ * write thread wakes up, hold back for up to journal_group_commit_us so
+ * that concurrent submitters can share one journal write (and one
+ * fsync/aio completion), unless journal_group_commit_bytes are queued
+ * already.
+ */
+void FileJournal::wait_group_commit()
+{
+  assert(writeq_lock.is_locked());
+  int64_t window = g_conf->journal_group_commit_us;
+  if (window <= 0 || write_stop)
+    return;
+
+  uint64_t min_bytes = g_conf->journal_group_commit_bytes;
+  uint64_t max_entries = g_conf->journal_max_write_entries;
+  utime_t start = ceph_clock_now(g_ceph_context);
+  utime_t until = start;
+  until += utime_t(window / 1000000, (window % 1000000) * 1000);
+
+  group_commit_waiting = true;
+  while (!write_stop &&
+	 writeq.size() < max_entries &&
+	 (!min_bytes || (uint64_t)throttle_bytes.get_current() < min_bytes)) {
+    dout(20) << "wait_group_commit " << writeq.size() << " entries, "
+	     << throttle_bytes.get_current() << " bytes queued" << dendl;
+    if (writeq_cond.WaitUntil(writeq_lock, until) == ETIMEDOUT)
+      break;
+  }
+  group_commit_waiting = false;
+
+  if (logger)
+    logger->tinc(l_os_j_group_wait, ceph_clock_now(g_ceph_context) - start);
+}
+
 void FileJournal::write_thread_entry()
 {
   dout(1) << "write_thread_entry start, pid " << ceph_gettid() << dendl;
   while (1) {
+    bool aio_in_flight = false;
+#ifdef HAVE_LIBAIO
+    if (aio_batch) {
+      Mutex::Locker locker(aio_lock);
+      aio_in_flight = !aio_queue.empty();
+    }
+#endif
+    bool reap = false;
     {
       Mutex::Locker locker(writeq_lock);
       if (writeq.empty() && !must_write_header) {
-	if (write_stop)
+	if (write_stop && !aio_in_flight)
 	  break;
-	dout(20) << "write_thread_entry going to sleep" << dendl;
-	writeq_cond.Wait(writeq_lock);
-	dout(20) << "write_thread_entry woke up" << dendl;
-	continue;
+	if (aio_in_flight) {
+	  // nobody else will complete these
+	  reap = true;
+	} else {
+	  dout(20) << "write_thread_entry going to sleep" << dendl;
+	  writeq_cond.Wait(writeq_lock);
+	  dout(20) << "write_thread_entry woke up" << dendl;
+	  continue;
+	}
       }
+      if (!reap && !writeq.empty())
+	wait_group_commit();
     }
+#ifdef HAVE_LIBAIO
+    if (reap) {
+      // wait a little for completions, then look at the queue again
+      struct timespec timeout;
+      timeout.tv_sec = 0;
+      timeout.tv_nsec = g_conf->journal_aio_batch_reap_wait * 1000;
+      reap_aio(1, &timeout);
+      continue;
+    }
+#endif
     
 #ifdef HAVE_LIBAIO
     if (aio) {
@@ -1211,7 +1275,13 @@ void FileJournal::write_thread_entry()
 	dout(20) << "write_thread_entry deferring until more aios complete: "
 		 << aio_num << " aios with " << aio_bytes << " bytes needs " << min_new
 		 << " bytes to start a new aio (currently " << cur << " pending)" << dendl;
-	aio_cond.Wait(aio_lock);
+	if (aio_batch) {
+	  aio_lock.Unlock();
+	  reap_aio(1, NULL);
+	  aio_lock.Lock();
+	} else {
+	  aio_cond.Wait(aio_lock);
+	}
 	dout(20) << "write_thread_entry woke up" << dendl;
       }
     }
@@ -1235,6 +1305,17 @@ void FileJournal::write_thread_entry()
 	print_header();
 	r = 0;
       } else {
+#ifdef HAVE_LIBAIO
+	// the commit we wait for may need the writes we have in flight
+	while (aio_batch) {
+	  {
+	    Mutex::Locker locker(aio_lock);
+	    if (aio_queue.empty())
+	      break;
+	  }
+	  reap_aio(1, NULL);
+	}
+#endif
 	dout(20) << "write_thread_entry full, going to sleep (waiting for commit)" << dendl;
 	commit_cond.Wait(write_lock);
 	dout(20) << "write_thread_entry woke up" << dendl;
@@ -1246,6 +1327,7 @@ void FileJournal::write_thread_entry()
     if (logger) {
       logger->inc(l_os_j_wr);
       logger->inc(l_os_j_wr_bytes, bl.length());
+      logger->inc(l_os_j_wr_ops, orig_ops);
     }
 
 #ifdef HAVE_LIBAIO
@@ -1253,6 +1335,11 @@ void FileJournal::write_thread_entry()
       do_aio_write(bl);
     else
       do_write(bl);
+    if (aio_batch) {
+      // pick up whatever completed meanwhile, without blocking
+      struct timespec timeout = { 0, 0 };
+      reap_aio(0, &timeout);
+    }
 #else
     do_write(bl);
 #endif
@@ -1335,6 +1422,9 @@ void FileJournal::do_aio_write(bufferlist& bl)
     }
   }
 
+  if (aio_batch)
+    submit_aio_batch();
+
   write_pos = pos;
   if (write_pos == header.max_size)
     write_pos = get_top();
@@ -1386,6 +1476,11 @@ int FileJournal::write_aio_bl(off64_t& pos, bufferlist& bl, uint64_t seq)
     aio_lock.Unlock();
 
     iocb *piocb = &aio.iocb;
+    if (aio_batch) {
+      aio_pending.push_back(piocb);
+      pos += cur_len;
+      continue;
+    }
     int attempts = 10;
     do {
       int r = io_submit(aio_ctx, 1, &piocb);
@@ -1406,6 +1501,77 @@ int FileJournal::write_aio_bl(off64_t& pos, bufferlist& bl, uint64_t seq)
   aio_lock.Unlock();
   return 0;
 }
+
+/**
+ * submit all aios prepared for this journal write with as few
+ * io_submit calls as possible
+ */
+void FileJournal::submit_aio_batch()
+{
+  size_t done = 0;
+  int attempts = 10;
+  while (done < aio_pending.size()) {
+    int r = io_submit(aio_ctx, aio_pending.size() - done, &aio_pending[done]);
+    if (r < 0) {
+      derr << "io_submit of " << (aio_pending.size() - done) << " aios"
+	   << " got " << cpp_strerror(r) << dendl;
+      if (r == -EAGAIN && attempts-- > 0) {
+	// the ring is full of our own writes, make room
+	bool in_flight;
+	{
+	  Mutex::Locker locker(aio_lock);
+	  in_flight = aio_num > (int)(aio_pending.size() - done);
+	}
+	if (in_flight)
+	  reap_aio(1, NULL);
+	else
+	  usleep(500);
+	continue;
+      }
+      assert(0 == "io_submit got unexpected error");
+    }
+    dout(20) << "submit_aio_batch submitted " << r << " aios" << dendl;
+    done += r;
+  }
+  aio_pending.clear();
+}
+
+/**
+ * wait for at least min_nr aio completions (or until the timeout) and
+ * complete them
+ *
+ * @return number of completions reaped
+ */
+int FileJournal::reap_aio(int min_nr, struct timespec *timeout)
+{
+  io_event event[16];
+  int r = io_getevents(aio_ctx, min_nr, 16, event, timeout);
+  if (r < 0) {
+    if (r == -EINTR) {
+      dout(0) << "io_getevents got " << cpp_strerror(r) << dendl;
+      return 0;
+    }
+    derr << "io_getevents got " << cpp_strerror(r) << dendl;
+    assert(0 == "got unexpected error from io_getevents");
+  }
+  if (r == 0)
+    return 0;
+
+  Mutex::Locker locker(aio_lock);
+  for (int i=0; i<r; i++) {
+    aio_info *ai = (aio_info *)event[i].obj;
+    if (event[i].res != ai->len) {
+      derr << "aio to " << ai->off << "~" << ai->len
+	   << " wrote " << event[i].res << dendl;
+      assert(0 == "unexpected aio error");
+    }
+    dout(10) << "reap_aio aio " << ai->off
+	     << "~" << ai->len << " done" << dendl;
+    ai->done = true;
+  }
+  check_aio_completion();
+  return r;
+}
 #endif
 
 void FileJournal::write_finish_thread_entry()
@@ -1425,32 +1591,7 @@ void FileJournal::write_finish_thread_entry()
     }
     
     dout(20) << "write_finish_thread_entry waiting for aio(s)" << dendl;
-    io_event event[16];
-    int r = io_getevents(aio_ctx, 1, 16, event, NULL);
-    if (r < 0) {
-      if (r == -EINTR) {
-	dout(0) << "io_getevents got " << cpp_strerror(r) << dendl;
-	continue;
-      }
-      derr << "io_getevents got " << cpp_strerror(r) << dendl;
-      assert(0 == "got unexpected error from io_getevents");
-    }
-    
-    {
-      Mutex::Locker locker(aio_lock);
-      for (int i=0; i<r; i++) {
-	aio_info *ai = (aio_info *)event[i].obj;
-	if (event[i].res != ai->len) {
-	  derr << "aio to " << ai->off << "~" << ai->len
-	       << " wrote " << event[i].res << dendl;
-	  assert(0 == "unexpected aio error");
-	}
-	dout(10) << "write_finish_thread_entry aio " << ai->off
-		 << "~" << ai->len << " done" << dendl;
-	ai->done = true;
-      }
-      check_aio_completion();
-    }
+    reap_aio(1, NULL);
   }
   dout(10) << "write_finish_thread_entry exit" << dendl;
 #endif
@@ -1588,7 +1729,7 @@ void FileJournal::submit_entry(uint64_t seq, bufferlist& e, uint32_t orig_len,
     completions.push_back(
       completion_item(
 	seq, oncommit, ceph_clock_now(g_ceph_context), osd_op));
-    if (writeq.empty())
+    if (writeq.empty() || group_commit_waiting)
       writeq_cond.Signal();
     writeq.push_back(write_item(seq, e, orig_len, osd_op));
   }
@@ -67,6 +67,8 @@ public:
   Mutex writeq_lock;
   Cond writeq_cond;
   list<write_item> writeq;
+  bool group_commit_waiting;  ///< write thread is holding back for more entries
+  void wait_group_commit();
   bool writeq_empty();
   write_item &peek_write();
   void pop_write();
@@ -224,6 +226,7 @@ private:
   off64_t max_size;
   size_t block_size;
   bool directio, aio, force_aio;
+  bool aio_batch;         ///< submit aios together, reap them in the write thread
   bool must_write_header;
   off64_t write_pos;      // byte where the next entry to be written will go
   off64_t read_pos;       //
@@ -256,6 +259,9 @@ private:
   list<aio_info> aio_queue;
   int aio_num, aio_bytes;
   /// End protected by aio_lock
+
+  /// aios prepared but not yet submitted, batch mode only (write thread)
+  vector<iocb*> aio_pending;
 #endif
 
   uint64_t last_committed_seq;
@@ -317,6 +323,8 @@ private:
   void check_aio_completion();
   void do_aio_write(bufferlist& bl);
   int write_aio_bl(off64_t& pos, bufferlist& bl, uint64_t seq);
+  void submit_aio_batch();
+  int reap_aio(int min_nr, struct timespec *timeout);
 
 
   void align_bl(off64_t pos, bufferlist& bl);
@@ -363,12 +371,13 @@ private:
     journaled_seq(0),
     plug_journal_completions(false),
     writeq_lock("FileJournal::writeq_lock", false, true, false, g_ceph_context),
+    group_commit_waiting(false),
     completions_lock(
       "FileJournal::completions_lock", false, true, false, g_ceph_context),
     fn(f),
     zero_buf(NULL),
     max_size(0), block_size(0),
-    directio(dio), aio(ai), force_aio(faio),
+    directio(dio), aio(ai), force_aio(faio), aio_batch(false),
     must_write_header(false),
     write_pos(0), read_pos(0),
     discard(false),
@@ -104,6 +104,10 @@ using ceph::crypto::SHA1;
 #define XATTR_NO_SPILL_OUT "0"
 #define XATTR_SPILL_OUT "1"
 
+// XATTR_PACKED_NAME holds all the inline xattrs of an object whose xattrs
+// are packed, see FileStore::PackedXattrs
+#define XATTR_PACKED_NAME "user.cephos.packed"
+
 //Initial features in new superblock.
 static CompatSet get_fs_initial_compat_set() {
   CompatSet::FeatureSet ceph_osd_feature_compat;
@@ -312,6 +316,12 @@ int FileStore::lfn_open(const coll_t& cid,
                      << "):" << cpp_strerror(-r) << dendl;
       goto fail;
     }
+    if (m_filestore_xattr_packed) {
+      // the inode may have belonged to a removed object
+      struct stat st;
+      if (::fstat(fd, &st) == 0)
+	packed_xattr_cache.invalidate(st.st_ino);
+    }
   }
 
   if (!replaying) {
@@ -479,8 +489,22 @@ int FileStore::lfn_unlink(coll_t cid, const ghobject_t& o,
 	}
 	dout(25) << __func__ << " stat failed " << cpp_strerror(r) << dendl;
 	return r;
-      } else if (st.st_nlink == 1) {
+      }
+      if (st.st_nlink > 1) {
+	// a link the index keeps for itself doesn't keep the object alive
+	r = index->drop_private_links(o, st);
+	if (r < 0) {
+	  dout(25) << __func__ << " drop_private_links failed "
+		   << cpp_strerror(r) << dendl;
+	  assert(!m_filestore_fail_eio || r != -EIO);
+	  return r;
+	}
+	st.st_nlink -= r;
+      }
+      if (st.st_nlink == 1) {
 	force_clear_omap = true;
+	if (m_filestore_xattr_packed)
+	  packed_xattr_cache.invalidate(st.st_ino);
       }
     }
     if (force_clear_omap) {
@@ -530,6 +554,7 @@ FileStore::FileStore(const std::string &base, const std::string &jdev, osflagbit
   index_manager(do_update),
   pgmeta_cache(this, g_conf->filestore_pgmeta_cache_shards,
                g_conf->filestore_pgmeta_cache_shard_bytes),
+  packed_xattr_cache(g_conf->filestore_xattr_packed_cache_size),
   lock("FileStore::lock"),
   force_sync(false), 
   sync_entry_timeo_lock("sync_entry_timeo_lock"),
@@ -573,7 +598,8 @@ FileStore::FileStore(const std::string &base, const std::string &jdev, osflagbit
   m_filestore_max_alloc_hint_size(g_conf->filestore_max_alloc_hint_size),
   m_fs_type(0),
   m_filestore_max_inline_xattr_size(0),
-  m_filestore_max_inline_xattrs(0)
+  m_filestore_max_inline_xattrs(0),
+  m_filestore_xattr_packed(g_conf->filestore_xattr_packed)
 {
   m_filestore_kill_at.set(g_conf->filestore_kill_at);
   for (int i = 0; i < ondisk_finisher_num; ++i) {
@@ -617,6 +643,8 @@ FileStore::FileStore(const std::string &base, const std::string &jdev, osflagbit
   plb.add_time_avg(l_os_j_lat, "journal_latency");
   plb.add_u64_counter(l_os_j_wr, "journal_wr");
   plb.add_u64_avg(l_os_j_wr_bytes, "journal_wr_bytes");
+  plb.add_u64_avg(l_os_j_wr_ops, "journal_wr_ops");
+  plb.add_time_avg(l_os_j_group_wait, "journal_group_commit_wait");
   plb.add_u64_counter(l_os_omap_cache_shard_flush, "omap_cache_shard_flush");
   plb.add_u64(l_os_oq_max_ops, "op_queue_max_ops");
   plb.add_u64(l_os_oq_ops, "op_queue_ops");
@@ -1644,6 +1672,7 @@ int FileStore::mount()
   journal_start();
 
   op_tp.start();
+  index_manager.start_split_thread();
   for (vector<Finisher*>::iterator it = ondisk_finishers.begin(); it != ondisk_finishers.end(); ++it) {
     (*it)->start();
   }
@@ -1695,6 +1724,7 @@ int FileStore::umount()
     wbthrottles[i]->stop();
   }
   op_tp.stop();
+  index_manager.stop_split_thread();
 
   journal_stop();
   if (!(generic_flags & SKIP_JOURNAL_REPLAY))
@@ -3246,13 +3276,25 @@ int FileStore::_clone(coll_t cid, const ghobject_t& oldoid, const ghobject_t& ne
     if (r < 0)
       goto out3;
 
-    for (map<string, pair<bufferptr, int> >::iterator it = aset.begin();
-         it != aset.end();
-         ++it) {
-      r = _fsetattr(**n, it->first, it->second.first, it->second.second);
+    if (m_filestore_xattr_packed) {
+      PackedXattrs packed;
+      for (map<string, pair<bufferptr, int> >::iterator it = aset.begin();
+	   it != aset.end();
+	   ++it)
+	packed.attrs[it->first] = it->second.first;
+      r = _store_packed_xattrs(n, &packed);
+      _invalidate_packed_xattrs(n);
       if (r < 0)
-        goto out3;
+	goto out3;
+    } else {
+      for (map<string, pair<bufferptr, int> >::iterator it = aset.begin();
+	   it != aset.end();
+	   ++it) {
+	r = _fsetattr(**n, it->first, it->second.first, it->second.second);
+	if (r < 0)
+	  goto out3;
       }
+    }
   }
 
   // clone is non-idempotent; record our work.
@@ -3860,6 +3902,21 @@ int FileStore::snapshot(const string& name)
 // -------------------------------
 // attributes
 
+static int decode_packed_xattrs(bufferptr& bp, map<string, bufferptr> *attrs)
+{
+  bufferlist bl;
+  bl.push_back(bp);
+  try {
+    bufferlist::iterator p = bl.begin();
+    DECODE_START(1, p);
+    ::decode(*attrs, p);
+    DECODE_FINISH(p);
+  } catch (buffer::error& e) {
+    return -EIO;
+  }
+  return 0;
+}
+
 int FileStore::_fgetattr(int fd, const char *name, bufferptr& bp, int *chunks)
 {
   char val[CHAIN_XATTR_MAX_BLOCK_LEN];
@@ -3910,6 +3967,7 @@ int FileStore::_fgetattrs(int fd, map<string, pair<bufferptr, int> >& aset)
   name[len] = 0;
 
   char *end = name + len;
+  map<string, bufferptr> packed;
   while (name < end) {
     char *attrname = name;
     if (parse_attrname(&name)) {
@@ -3921,20 +3979,36 @@ int FileStore::_fgetattrs(int fd, map<string, pair<bufferptr, int> >& aset)
 	  return r;
         }
       }
+    } else if (strcmp(attrname, XATTR_PACKED_NAME) == 0) {
+      dout(20) << "fgetattrs " << fd << " getting packed xattrs" << dendl;
+      bufferptr bp;
+      int r = _fgetattr(fd, attrname, bp);
+      if (r >= 0)
+	r = decode_packed_xattrs(bp, &packed);
+      if (r < 0) {
+	delete[] names2;
+	return r;
+      }
     }
     name += strlen(name) + 1;
   }
+  // the packed copies win over any unpacked ones left behind
+  for (map<string, bufferptr>::iterator p = packed.begin();
+       p != packed.end();
+       ++p)
+    aset[p->first] = make_pair(p->second, -1);
 
   delete[] names2;
   return 0;
 }
 
-int FileStore::_fgetattrs_chunks(int fd, map<string, int>& aset)
+int FileStore::_fgetattrs_chunks(int fd, map<string, int>& aset, bool *packed)
 {
   // get attr list
   char names1[CHAIN_XATTR_MAX_NAME_LEN];
   int len = chain_flistxattr(fd, names1, sizeof(names1)-1, &aset);
   char *names2 = 0;
+  char *name = names1;
   if (len == -ERANGE) {
     len = chain_flistxattr(fd, 0, 0);
     if (len < 0) {
@@ -3950,10 +4024,20 @@ int FileStore::_fgetattrs_chunks(int fd, map<string, int>& aset)
       delete[] names2;
       return len;
     }
+    name = names2;
   } else if (len < 0) {
     assert(!m_filestore_fail_eio || len != -EIO);
     return len;
   }
+  if (packed) {
+    *packed = false;
+    for (char *end = name + len; name < end; name += strlen(name) + 1) {
+      if (strcmp(name, XATTR_PACKED_NAME) == 0) {
+	*packed = true;
+	break;
+      }
+    }
+  }
   delete[] names2;
   return 0;
 }
@@ -3976,6 +4060,56 @@ int FileStore::_fsetattr(int fd, const string& name, bufferptr& bp, int chunks)
   return 0;
 }
 
+int FileStore::_load_packed_xattrs(FDRef& fd, PackedXattrsRef *out)
+{
+  // the cache is only maintained while packing is enabled
+  uint64_t ino = m_filestore_xattr_packed ? fd->get_ino() : 0;
+  if (ino && packed_xattr_cache.lookup(ino, out))
+    return 0;
+
+  uint64_t seq = packed_xattr_cache.get_seq();
+  PackedXattrsRef p(new PackedXattrs);
+  bufferptr bp;
+  int r = _fgetattr(**fd, XATTR_PACKED_NAME, bp, &p->chunks);
+  if (r < 0)
+    return r;
+  r = decode_packed_xattrs(bp, &p->attrs);
+  if (r < 0) {
+    derr << __func__ << " unable to decode packed xattrs of fd " << **fd << dendl;
+    return r;
+  }
+  char buf[2];
+  r = chain_fgetxattr(**fd, XATTR_SPILL_OUT_NAME, buf, sizeof(buf));
+  p->spill_out = !(r >= 0 &&
+		   !strncmp(buf, XATTR_NO_SPILL_OUT, sizeof(XATTR_NO_SPILL_OUT)));
+  if (ino)
+    packed_xattr_cache.add(ino, p, seq);
+  *out = p;
+  return 0;
+}
+
+int FileStore::_store_packed_xattrs(FDRef& fd, PackedXattrs *p)
+{
+  bufferlist bl;
+  ENCODE_START(1, 1, bl);
+  ::encode(p->attrs, bl);
+  ENCODE_FINISH(bl);
+  int r = chain_fsetxattr(**fd, XATTR_PACKED_NAME, bl.c_str(), bl.length(),
+			  p->chunks);
+  if (r < 0) {
+    derr << __func__ << " chain_fsetxattr returned " << r << dendl;
+    return r;
+  }
+  p->chunks = chain_xattr_chunks(bl.length());
+  return 0;
+}
+
+void FileStore::_invalidate_packed_xattrs(FDRef& fd)
+{
+  if (m_filestore_xattr_packed)
+    packed_xattr_cache.invalidate(fd->get_ino());
+}
+
 // debug EIO injection
 void FileStore::inject_data_error(const ghobject_t &oid) {
   Mutex::Locker l(read_error_lock);
@@ -4026,7 +4160,26 @@ int FileStore::getattr(coll_t cid, const ghobject_t& oid, const char *name, buff
   }
   char n[CHAIN_XATTR_MAX_NAME_LEN];
   get_attrname(name, n, CHAIN_XATTR_MAX_NAME_LEN);
-  r = _fgetattr(**fd, n, bp);
+  // look at the packed xattrs first if objects are being packed, last
+  // otherwise
+  r = -ENODATA;
+  if (!m_filestore_xattr_packed)
+    r = _fgetattr(**fd, n, bp);
+  if (r == -ENODATA) {
+    PackedXattrsRef packed;
+    r = _load_packed_xattrs(fd, &packed);
+    if (r == 0) {
+      map<string, bufferptr>::iterator i = packed->attrs.find(name);
+      if (i != packed->attrs.end()) {
+	bp = bufferptr(i->second.c_str(), i->second.length());
+	r = bp.length();
+      } else {
+	r = -ENODATA;
+      }
+    } else if (r == -ENODATA && m_filestore_xattr_packed) {
+      r = _fgetattr(**fd, n, bp);
+    }
+  }
   lfn_close(fd);
   if (r == -ENODATA) {
     map<string, bufferlist> got;
@@ -4072,6 +4225,7 @@ int FileStore::getattrs(coll_t cid, const ghobject_t& oid, map<string,bufferptr>
   Index index;
   dout(15) << "getattrs " << cid << "/" << oid << dendl;
   FDRef fd;
+  PackedXattrsRef packed;
   bool spill_out = true;
   char buf[2];
 
@@ -4080,19 +4234,33 @@ int FileStore::getattrs(coll_t cid, const ghobject_t& oid, map<string,bufferptr>
     goto out;
   }
 
-  r = chain_fgetxattr(**fd, XATTR_SPILL_OUT_NAME, buf, sizeof(buf));
-  if (r >= 0 && !strncmp(buf, XATTR_NO_SPILL_OUT, sizeof(XATTR_NO_SPILL_OUT)))
-    spill_out = false;
+  r = -ENODATA;
+  if (m_filestore_xattr_packed)
+    r = _load_packed_xattrs(fd, &packed);
+  if (r == 0) {
+    for (map<string, bufferptr>::iterator it = packed->attrs.begin();
+	 it != packed->attrs.end();
+	 ++it) {
+      aset[it->first] = bufferptr(it->second.c_str(), it->second.length());
+    }
+    spill_out = packed->spill_out;
+  } else if (r == -ENODATA) {
+    r = chain_fgetxattr(**fd, XATTR_SPILL_OUT_NAME, buf, sizeof(buf));
+    if (r >= 0 && !strncmp(buf, XATTR_NO_SPILL_OUT, sizeof(XATTR_NO_SPILL_OUT)))
+      spill_out = false;
 
-  r = _fgetattrs(**fd, orig_set);
-  if (r < 0) {
+    r = _fgetattrs(**fd, orig_set);
+    if (r < 0) {
+      goto out;
+    }
+    for (map<string, pair<bufferptr, int> >::iterator it = orig_set.begin();
+	 it != orig_set.end();
+	 ++it) {
+      aset[it->first] = it->second.first;
+    }
+  } else {
     goto out;
   }
-  for (map<string, pair<bufferptr, int> >::iterator it = orig_set.begin();
-       it != orig_set.end();
-       ++it) {
-    aset[it->first] = it->second.first;
-  }
   lfn_close(fd);
 
   if (!spill_out) {
@@ -4150,12 +4318,19 @@ int FileStore::_setattrs(coll_t cid, const ghobject_t& oid, map<string,bufferptr
   FDRef fd;
   int spill_out = -1;
   bool incomplete_inline = false;
+  bool packed = false;
 
   int r = lfn_open(cid, oid, false, &fd);
   if (r < 0) {
     goto out;
   }
 
+  if (m_filestore_xattr_packed) {
+    dout(15) << "setattrs " << cid << "/" << oid << " (packed)" << dendl;
+    r = _setattrs_packed(oid, fd, aset, spos);
+    goto out_close;
+  }
+
   char buf[2];
   r = chain_fgetxattr(**fd, XATTR_SPILL_OUT_NAME, buf, sizeof(buf));
   if (r >= 0 && !strncmp(buf, XATTR_NO_SPILL_OUT, sizeof(XATTR_NO_SPILL_OUT)))
@@ -4163,9 +4338,15 @@ int FileStore::_setattrs(coll_t cid, const ghobject_t& oid, map<string,bufferptr
   else
     spill_out = 1;
 
-  r = _fgetattrs_chunks(**fd, inline_set);
+  r = _fgetattrs_chunks(**fd, inline_set, &packed);
   incomplete_inline = (r == -E2BIG);
   assert(!m_filestore_fail_eio || r != -EIO);
+  if (packed) {
+    // packed objects stay packed
+    dout(15) << "setattrs " << cid << "/" << oid << " (packed)" << dendl;
+    r = _setattrs_packed(oid, fd, aset, spos);
+    goto out_close;
+  }
   dout(15) << "setattrs " << cid << "/" << oid
     	   << (incomplete_inline ? " (incomplete_inline, forcing omap)" : "")
 	   << dendl;
@@ -4243,6 +4424,113 @@ int FileStore::_setattrs(coll_t cid, const ghobject_t& oid, map<string,bufferptr
   return r;
 }
 
+static uint64_t packed_xattr_size(const string& name, const bufferptr& bp)
+{
+  return sizeof(uint32_t) + name.length() + sizeof(uint32_t) + bp.length();
+}
+
+int FileStore::_setattrs_packed(const ghobject_t& oid, FDRef& fd,
+				map<string,bufferptr>& aset,
+				const SequencerPosition &spos)
+{
+  map<string, bufferlist> omap_set;
+  set<string> omap_remove;
+  map<string, pair<bufferptr, int> > unpacked;
+  PackedXattrsRef cur;
+  PackedXattrsRef p(new PackedXattrs);
+  uint64_t packed_bytes = 0;
+  bool spill_out;
+
+  int r = _load_packed_xattrs(fd, &cur);
+  if (r == 0) {
+    *p = *cur;
+  } else if (r == -ENODATA) {
+    // not packed yet, fold in the attrs stored one xattr each
+    r = _fgetattrs(**fd, unpacked);
+    if (r < 0) {
+      assert(!m_filestore_fail_eio || r != -EIO);
+      return r;
+    }
+    for (map<string, pair<bufferptr, int> >::iterator i = unpacked.begin();
+	 i != unpacked.end();
+	 ++i)
+      p->attrs[i->first] = i->second.first;
+    char buf[2];
+    r = chain_fgetxattr(**fd, XATTR_SPILL_OUT_NAME, buf, sizeof(buf));
+    p->spill_out = !(r >= 0 &&
+		     !strncmp(buf, XATTR_NO_SPILL_OUT, sizeof(XATTR_NO_SPILL_OUT)));
+    p->chunks = 1; // nothing past the first chunk to clean up
+  } else {
+    return r;
+  }
+  spill_out = p->spill_out;
+  for (map<string, bufferptr>::iterator i = p->attrs.begin();
+       i != p->attrs.end();
+       ++i)
+    packed_bytes += packed_xattr_size(i->first, i->second);
+
+  for (map<string,bufferptr>::iterator i = aset.begin();
+       i != aset.end();
+       ++i) {
+    map<string, bufferptr>::iterator old = p->attrs.find(i->first);
+    if (old != p->attrs.end()) {
+      packed_bytes -= packed_xattr_size(old->first, old->second);
+      p->attrs.erase(old);
+    }
+    if (i->second.length() > m_filestore_max_inline_xattr_size ||
+	packed_bytes + packed_xattr_size(i->first, i->second) >
+	  g_conf->filestore_xattr_packed_max_bytes) {
+      omap_set[i->first].push_back(i->second);
+      continue;
+    }
+    if (spill_out)
+      omap_remove.insert(i->first);
+    // copy, the cache must not pin the transaction's buffers
+    p->attrs[i->first] = bufferptr(i->second.c_str(), i->second.length());
+    packed_bytes += packed_xattr_size(i->first, i->second);
+  }
+
+  r = _store_packed_xattrs(fd, p.get());
+  if (r < 0)
+    return r;
+  // the packed copies are safe, drop the unpacked ones, including any a
+  // crash or an error left behind when the object was first packed
+  map<string, int> names;
+  r = _fgetattrs_chunks(**fd, names);
+  if (r < 0) {
+    dout(10) << __func__ << " could not list xattrs r = " << r << dendl;
+  } else {
+    for (map<string, int>::iterator i = names.begin(); i != names.end(); ++i) {
+      if (i->first.compare(0, 10, "user.ceph.") == 0)
+	chain_fremovexattr(**fd, i->first.c_str()); // ignore any error
+    }
+  }
+  if (!spill_out && !omap_set.empty()) {
+    chain_fsetxattr(**fd, XATTR_SPILL_OUT_NAME, XATTR_SPILL_OUT,
+		    sizeof(XATTR_SPILL_OUT));
+  }
+  _invalidate_packed_xattrs(fd);
+
+  if (spill_out && !omap_remove.empty()) {
+    r = object_map->remove_xattrs(oid, omap_remove, &spos);
+    if (r < 0 && r != -ENOENT) {
+      dout(10) << __func__ << " could not remove_xattrs r = " << r << dendl;
+      assert(!m_filestore_fail_eio || r != -EIO);
+      return r;
+    }
+    r = 0;
+  }
+  if (!omap_set.empty()) {
+    r = object_map->set_xattrs(oid, omap_set, &spos);
+    if (r < 0) {
+      dout(10) << __func__ << " could not set_xattrs r = " << r << dendl;
+      assert(!m_filestore_fail_eio || r != -EIO);
+      return r;
+    }
+  }
+  return 0;
+}
+
 
 int FileStore::_rmattr(coll_t cid, const ghobject_t& oid, const char *name,
 		       const SequencerPosition &spos)
@@ -4266,6 +4554,19 @@ int FileStore::_rmattr(coll_t cid, const ghobject_t& oid, const char *name,
   char n[CHAIN_XATTR_MAX_NAME_LEN];
   get_attrname(name, n, CHAIN_XATTR_MAX_NAME_LEN);
   r = chain_fremovexattr(**fd, n);
+  if (r == -ENODATA) {
+    PackedXattrsRef packed;
+    r = _load_packed_xattrs(fd, &packed);
+    if (r == 0 && packed->attrs.count(name)) {
+      PackedXattrs p = *packed;
+      p.attrs.erase(name);
+      r = _store_packed_xattrs(fd, &p);
+      _invalidate_packed_xattrs(fd);
+      goto out_close;
+    }
+    if (r == 0)
+      r = -ENODATA;
+  }
   if (r == -ENODATA && spill_out) {
     Index index;
     r = get_index(cid, &index);
@@ -4299,6 +4600,7 @@ int FileStore::_rmattrs(coll_t cid, const ghobject_t& oid,
   set<string> omap_attrs;
   Index index;
   bool spill_out = true;
+  bool packed = false;
 
   int r = lfn_open(cid, oid, false, &fd);
   if (r < 0) {
@@ -4311,7 +4613,7 @@ int FileStore::_rmattrs(coll_t cid, const ghobject_t& oid,
     spill_out = false;
   }
 
-  r = _fgetattrs_chunks(**fd, aset);
+  r = _fgetattrs_chunks(**fd, aset, &packed);
   if (r >= 0) {
     for (map<string, int>::iterator p = aset.begin(); p != aset.end(); ++p) {
       char n[CHAIN_XATTR_MAX_NAME_LEN];
@@ -4321,6 +4623,8 @@ int FileStore::_rmattrs(coll_t cid, const ghobject_t& oid,
 	break;
     }
   }
+  if (r >= 0 && packed)
+    r = chain_fremovexattr(**fd, XATTR_PACKED_NAME);
 
   if (!spill_out) {
     dout(10) << __func__ << " no xattr exists in object_map r = " << r << dendl;
@@ -4351,6 +4655,7 @@ int FileStore::_rmattrs(coll_t cid, const ghobject_t& oid,
   }
 
  out_close:
+  _invalidate_packed_xattrs(fd);
   lfn_close(fd);
  out:
   dout(10) << "rmattrs " << cid << "/" << oid << " = " << r << dendl;
@@ -35,6 +35,7 @@ using namespace std;
 #include "common/WorkQueue.h"
 
 #include "common/Mutex.h"
+#include "common/simple_cache.hpp"
 #include "HashIndex.h"
 #include "IndexManager.h"
 #include "DBObjectMap.h"
@@ -273,6 +274,61 @@ private:
     }
   } pgmeta_cache;
 
+  /**
+   * Inline xattrs of an object packed into a single xattr
+   *
+   * With filestore_xattr_packed set, the inline xattrs of an object are
+   * encoded together in XATTR_PACKED_NAME instead of one xattr each, so
+   * that getattrs is a single read, and an object is converted on its
+   * next setattrs.  Objects already packed stay packed whatever the
+   * option, and the attr readers understand both forms.  What goes to
+   * the object_map is decided as for unpacked objects.
+   */
+  struct PackedXattrs {
+    map<string, bufferptr> attrs;
+    int chunks;     ///< chained xattrs holding the encoding, -1 if unknown
+    bool spill_out; ///< some attrs may be in the object_map
+    PackedXattrs() : chunks(-1), spill_out(true) {}
+  };
+  typedef ceph::shared_ptr<PackedXattrs> PackedXattrsRef;
+
+  /**
+   * Decoded PackedXattrs by inode, used while packing is enabled
+   *
+   * Keyed by inode rather than by object since hard linked objects share
+   * their xattrs.  Entries are dropped whenever the attrs of the inode
+   * change or the inode number is handed to a new object, and what a
+   * reader decoded is only added if nothing was dropped in the meantime.
+   */
+  struct PackedXattrCache {
+    Mutex lock;
+    uint64_t invalidations;
+    SimpleLRU<uint64_t, PackedXattrsRef> lru;
+
+    PackedXattrCache(size_t size)
+      : lock("FileStore::PackedXattrCache::lock"), invalidations(0),
+	lru(size) {}
+    bool lookup(uint64_t ino, PackedXattrsRef *out) {
+      return lru.lookup(ino, out);
+    }
+    uint64_t get_seq() {
+      Mutex::Locker l(lock);
+      return invalidations;
+    }
+    void add(uint64_t ino, PackedXattrsRef p, uint64_t seq) {
+      Mutex::Locker l(lock);
+      if (seq != invalidations)
+	return;
+      lru.clear(ino);
+      lru.add(ino, p);
+    }
+    void invalidate(uint64_t ino) {
+      Mutex::Locker l(lock);
+      ++invalidations;
+      lru.clear(ino);
+    }
+  } packed_xattr_cache;
+
   // helper fns
   int get_cdir(const coll_t& cid, char *s, int len);
   
@@ -679,8 +735,11 @@ public:
 
   int _fgetattr(int fd, const char* name, bufferptr& bp, int* chunks = NULL);
   int _fgetattrs(int fd, map<string, pair<bufferptr, int> >& aset);
-  int _fgetattrs_chunks(int fd, map<string, int>& aset);
+  int _fgetattrs_chunks(int fd, map<string, int>& aset, bool *packed = NULL);
   int _fsetattr(int fd, const string& name, bufferptr& bp, int chunks);
+  int _load_packed_xattrs(FDRef& fd, PackedXattrsRef *out);
+  int _store_packed_xattrs(FDRef& fd, PackedXattrs *p);
+  void _invalidate_packed_xattrs(FDRef& fd);
 
   void _start_sync();
 
@@ -716,6 +775,9 @@ public:
 
   int _setattrs(coll_t cid, const ghobject_t& oid, map<string,bufferptr>& aset,
 		const SequencerPosition &spos);
+  int _setattrs_packed(const ghobject_t& oid, FDRef& fd,
+		       map<string,bufferptr>& aset,
+		       const SequencerPosition &spos);
   int _rmattr(coll_t cid, const ghobject_t& oid, const char *name,
 	      const SequencerPosition &spos);
   int _rmattrs(coll_t cid, const ghobject_t& oid,
@@ -843,6 +905,7 @@ private:
   void set_xattr_limits_via_conf();
   uint32_t m_filestore_max_inline_xattr_size;
   uint32_t m_filestore_max_inline_xattrs;
+  bool m_filestore_xattr_packed;
 
   FSSuperblock superblock;
 
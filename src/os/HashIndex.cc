@@ -16,18 +16,33 @@
 #include "include/buffer.h"
 #include "osd/osd_types.h"
 #include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "HashIndex.h"
 
 #include "common/debug.h"
+#include "common/Clock.h"
+#include "common/config.h"
+#include "common/errno.h"
+#include "include/compat.h"
 #define dout_subsys ceph_subsys_filestore
 
 const string HashIndex::SUBDIR_ATTR = "contents";
 const string HashIndex::IN_PROGRESS_OP_TAG = "in_progress_op";
+const string HashIndex::SPLIT_SHADOW_DIR = ".split";
 
 int HashIndex::cleanup() {
   bufferlist bl;
-  int r = get_attr_path(vector<string>(), IN_PROGRESS_OP_TAG, bl);
+  invalidate_listings();
+  // a background split interrupted before it took access_lock left only
+  // the shadow behind, the directory itself is untouched
+  int r = remove_split_shadow();
+  if (r < 0)
+    return r;
+  r = get_attr_path(vector<string>(), IN_PROGRESS_OP_TAG, bl);
   if (r < 0) {
     // No in progress operations!
     return 0;
@@ -230,6 +245,9 @@ int HashIndex::_split(
   uint32_t bits,
   CollectionIndex* dest) {
   assert(collection_version() == dest->collection_version());
+  invalidate_listings();
+  split_changed(vector<string>(), NULL);
+  static_cast<HashIndex*>(dest)->invalidate_listings();
   unsigned mkdirred = 0;
   return col_split_level(
     *this,
@@ -241,6 +259,7 @@ int HashIndex::_split(
 }
 
 int HashIndex::_init() {
+  invalidate_listings();
   subdir_info_s info;
   vector<string> path;
   return set_info(path, info);
@@ -250,6 +269,8 @@ int HashIndex::_init() {
 int HashIndex::_created(const vector<string> &path,
 			const ghobject_t &oid,
 			const string &mangled_name) {
+  invalidate_listing(path);
+  split_changed(path, &mangled_name);
   subdir_info_s info;
   int r;
   r = get_info(path, &info);
@@ -261,6 +282,11 @@ int HashIndex::_created(const vector<string> &path,
     return r;
 
   if (must_split(info)) {
+    if (split_queue && !must_split_inline(info)) {
+      queue_background_split(path);
+      return 0;
+    }
+    split_changed(path, NULL);
     int r = initiate_split(path, info);
     if (r < 0)
       return r;
@@ -274,6 +300,8 @@ int HashIndex::_remove(const vector<string> &path,
 		       const ghobject_t &oid,
 		       const string &mangled_name) {
   int r;
+  invalidate_listing(path);
+  split_changed(path, &mangled_name);
   r = remove_object(path, oid);
   if (r < 0)
     return r;
@@ -341,10 +369,52 @@ int HashIndex::_collection_list_partial(const ghobject_t &start,
 }
 
 int HashIndex::prep_delete() {
+  invalidate_listings();
+  {
+    Mutex::Locker l(shadow_lock);
+    {
+      Mutex::Locker l2(pending_lock);
+      pending_splits.clear();
+    }
+    int r = remove_split_shadow();
+    if (r < 0)
+      return r;
+  }
   return recursive_remove(vector<string>());
 }
 
+int HashIndex::drop_private_links(const ghobject_t &oid,
+				  const struct stat &st) {
+  vector<string> path;
+  string mangled_name;
+  int exists;
+  int r = _lookup(oid, &path, &mangled_name, &exists);
+  if (r < 0)
+    return r;
+  if (!exists)
+    return 0;
+  // a shadow subdir holds the objects of the next hash level
+  vector<string> comps;
+  get_path_components(oid, &comps);
+  if (path.size() >= comps.size())
+    return 0;
+  string shadow = get_base_path() + "/" + SPLIT_SHADOW_DIR + "/" +
+    comps[path.size()] + "/" + mangled_name;
+  struct stat shadow_st;
+  if (::lstat(shadow.c_str(), &shadow_st) < 0)
+    return errno == ENOENT ? 0 : -errno;
+  if (shadow_st.st_ino != st.st_ino || shadow_st.st_dev != st.st_dev)
+    return 0;
+  // a split still linking the shadow may link it again, the next
+  // sync_shadow_dir drops that link since the object is gone by then
+  if (::unlink(shadow.c_str()) < 0)
+    return errno == ENOENT ? 0 : -errno;
+  dout(20) << __func__ << " " << coll() << " " << shadow << dendl;
+  return 1;
+}
+
 int HashIndex::_pre_hash_collection(uint32_t pg_num, uint64_t expected_num_objs) {
+  invalidate_listings();
   int ret;
   vector<string> path;
   subdir_info_s root_info;
@@ -578,7 +648,12 @@ bool HashIndex::must_split(const subdir_info_s &info) {
 			    
 }
 
+bool HashIndex::must_split_inline(const subdir_info_s &info) {
+  return info.objs > 2 * ((unsigned)(abs(merge_threshold)) * 16 * split_multiplier);
+}
+
 int HashIndex::initiate_merge(const vector<string> &path, subdir_info_s info) {
+  invalidate_listings();
   return start_merge(path);
 }
 
@@ -620,6 +695,7 @@ int HashIndex::complete_merge(const vector<string> &path, subdir_info_s info) {
 }
 
 int HashIndex::initiate_split(const vector<string> &path, subdir_info_s info) {
+  invalidate_listings();
   return start_split(path);
 }
 
@@ -724,6 +800,370 @@ int HashIndex::complete_split(const vector<string> &path, subdir_info_s info) {
   return end_split_or_merge(path);
 }
 
+void HashIndex::queue_background_split(const vector<string> &path) {
+  {
+    Mutex::Locker l(pending_lock);
+    if (!pending_splits.insert(path).second)
+      return;
+  }
+  dout(10) << __func__ << " " << coll() << " " << path << dendl;
+  split_queue->queue_split(this);
+}
+
+int HashIndex::do_background_splits() {
+  while (1) {
+    vector<string> path;
+    {
+      Mutex::Locker l(pending_lock);
+      if (pending_splits.empty())
+	return 0;
+      path = *pending_splits.begin();
+    }
+    int r = prepare_background_split(path);
+    if (r == 0 && g_conf->filestore_debug_split_delay > 0) {
+      dout(0) << __func__ << " filestore_debug_split_delay "
+	      << g_conf->filestore_debug_split_delay << dendl;
+      usleep(g_conf->filestore_debug_split_delay * 1000000);
+    }
+    if (r == 0) {
+      RWLock::WLocker l(access_lock);
+      utime_t start = ceph_clock_now(g_ceph_context);
+      r = complete_background_split(path);
+      // the links of a split no longer needed would keep its objects alive
+      if (r == 1)
+	r = remove_split_shadow();
+      dout(10) << __func__ << " " << coll() << " " << path
+	       << " held access_lock for "
+	       << (ceph_clock_now(g_ceph_context) - start) << dendl;
+    }
+    if (r < 0) {
+      derr << __func__ << " " << coll() << " " << path << " failed: "
+	   << cpp_strerror(r) << dendl;
+      {
+	Mutex::Locker l(shadow_lock);
+	remove_split_shadow();
+      }
+      // the paths still pending would otherwise wait for a create in
+      // the same directory to queue the index again
+      bool more;
+      {
+	Mutex::Locker l(pending_lock);
+	more = !pending_splits.empty();
+      }
+      if (more)
+	split_queue->queue_split(this);
+      return r;
+    }
+  }
+}
+
+int HashIndex::prepare_background_split(const vector<string> &path) {
+  // same lock order as prep_delete, but access_lock is only held while
+  // path is looked at, the links are checked again under the write lock
+  RWLock::RLocker rl(access_lock);
+  Mutex::Locker l(shadow_lock);
+  {
+    // prep_delete drops the pending splits of a collection going away
+    Mutex::Locker l2(pending_lock);
+    if (!pending_splits.erase(path))
+      return 1;
+  }
+  subdir_info_s info;
+  int r = get_info(path, &info);
+  if (r == -ENOENT)
+    return 1;
+  if (r < 0)
+    return r;
+  if (!must_split(info) || info.subdirs)
+    return 1;
+
+  // from the listing on, complete_background_split only has to check
+  // the names changed since
+  {
+    Mutex::Locker l2(pending_lock);
+    split_path = path;
+    split_tracking = true;
+    split_touched.clear();
+  }
+  map<string, ghobject_t> objects;
+  r = list_objects(path, 0, 0, &objects);
+  if (r < 0)
+    return r;
+  rl.unlock();
+
+  r = remove_split_shadow();
+  if (r < 0)
+    return r;
+
+  map<string, map<string, ghobject_t> > mapped;
+  for (map<string, ghobject_t>::iterator i = objects.begin();
+       i != objects.end();
+       ++i) {
+    vector<string> new_path;
+    get_path_components(i->second, &new_path);
+    mapped[new_path[info.hash_level]][i->first] = i->second;
+  }
+
+  string shadow = get_base_path() + "/" + SPLIT_SHADOW_DIR;
+  if (::mkdir(shadow.c_str(), 0777) < 0)
+    return -errno;
+  for (map<string, map<string, ghobject_t> >::iterator i = mapped.begin();
+       i != mapped.end();
+       ++i) {
+    subdir_info_s info_new;
+    info_new.objs = i->second.size();
+    info_new.hash_level = info.hash_level + 1;
+    if (must_merge(info_new))
+      continue;
+    r = sync_shadow_dir(path, shadow + "/" + i->first, i->second, NULL);
+    if (r < 0)
+      return r;
+  }
+  dout(10) << __func__ << " " << coll() << " " << path << " linked "
+	   << objects.size() << " objects" << dendl;
+  return 0;
+}
+
+int HashIndex::complete_background_split(const vector<string> &path) {
+  set<string> touched;
+  bool tracked;
+  {
+    Mutex::Locker l(pending_lock);
+    tracked = split_tracking && split_path == path;
+    split_tracking = false;
+    touched.swap(split_touched);
+  }
+
+  // the directory may have been split, merged or removed while the
+  // shadow was populated
+  int exists;
+  int r = path_exists(path, &exists);
+  if (r < 0)
+    return r;
+  if (!exists)
+    return 1;
+  subdir_info_s info;
+  r = get_info(path, &info);
+  if (r < 0)
+    return r;
+  if (!must_split(info) || info.subdirs)
+    return 1;
+
+  int level = info.hash_level;
+  map<string, ghobject_t> objects;
+  r = list_objects(path, 0, 0, &objects);
+  if (r < 0)
+    return r;
+  map<string, map<string, ghobject_t> > mapped;
+  for (map<string, ghobject_t>::iterator i = objects.begin();
+       i != objects.end();
+       ++i) {
+    vector<string> new_path;
+    get_path_components(i->second, &new_path);
+    mapped[new_path[level]][i->first] = i->second;
+  }
+
+  string shadow = get_base_path() + "/" + SPLIT_SHADOW_DIR;
+  invalidate_listings();
+  r = start_split(path);
+  if (r < 0)
+    return r;
+  // from here on an interruption is finished by complete_split in cleanup
+  map<string, ghobject_t> moved;
+  vector<string> dst = path;
+  dst.push_back("");
+  for (map<string, map<string, ghobject_t> >::iterator i = mapped.begin();
+       i != mapped.end();
+       ++i) {
+    subdir_info_s info_new;
+    info_new.objs = i->second.size();
+    info_new.subdirs = 0;
+    info_new.hash_level = level + 1;
+    if (must_merge(info_new))
+      continue;
+
+    // catch up with the writes since prepare_background_split
+    string from = shadow + "/" + i->first;
+    r = sync_shadow_dir(path, from, i->second, tracked ? &touched : NULL);
+    if (r < 0)
+      return r;
+    dst[level] = i->first;
+    if (::rename(from.c_str(), get_full_path_subdir(dst).c_str()) < 0)
+      return -errno;
+    info.subdirs++;
+
+    // objects with hashed names need their lfn xattr checked on link
+    for (map<string, ghobject_t>::iterator j = i->second.begin();
+	 j != i->second.end();
+	 ++j) {
+      moved[j->first] = j->second;
+      objects.erase(j->first);
+      if (!lfn_is_hashed_filename(j->first))
+	continue;
+      r = link_object(path, dst, j->second, j->first);
+      if (r < 0 && r != -EEXIST)
+	return r;
+    }
+
+    r = fsync_dir(dst);
+    if (r < 0)
+      return r;
+
+    // Presence of info must imply that all objects have been copied
+    r = set_info(dst, info_new);
+    if (r < 0)
+      return r;
+
+    r = fsync_dir(dst);
+    if (r < 0)
+      return r;
+  }
+  r = remove_objects(path, moved, &objects);
+  if (r < 0)
+    return r;
+  r = reset_attr(path);
+  if (r < 0)
+    return r;
+  r = fsync_dir(path);
+  if (r < 0)
+    return r;
+  r = end_split_or_merge(path);
+  if (r < 0)
+    return r;
+  dout(10) << __func__ << " " << coll() << " " << path << " split "
+	   << moved.size() << " objects into " << info.subdirs
+	   << " subdirs, checked "
+	   << (tracked ? touched.size() : moved.size()) << " links again"
+	   << dendl;
+  return remove_split_shadow();
+}
+
+int HashIndex::sync_shadow_dir(const vector<string> &path,
+			       const string &shadow,
+			       const map<string, ghobject_t> &objects,
+			       const set<string> *touched) {
+  set<string> present;
+  DIR *dir = ::opendir(shadow.c_str());
+  if (dir) {
+    struct dirent *de;
+    while ((de = ::readdir(dir))) {
+      if (de->d_name[0] == '.' &&
+	  (de->d_name[1] == '\0' ||
+	   (de->d_name[1] == '.' && de->d_name[2] == '\0')))
+	continue;
+      present.insert(de->d_name);
+    }
+    ::closedir(dir);
+  } else if (errno == ENOENT) {
+    if (::mkdir(shadow.c_str(), 0777) < 0)
+      return -errno;
+  } else {
+    return -errno;
+  }
+
+  bool changed = false;
+  for (map<string, ghobject_t>::const_iterator i = objects.begin();
+       i != objects.end();
+       ++i) {
+    // hashed names may collide with each other across the new subdirs,
+    // they are linked by complete_background_split
+    if (lfn_is_hashed_filename(i->first))
+      continue;
+    string src = get_full_path(path, i->first);
+    string dst = shadow + "/" + i->first;
+    if (present.erase(i->first)) {
+      if (touched && !touched->count(i->first))
+	continue; // unchanged since it was linked
+      struct stat src_st, dst_st;
+      if (::stat(src.c_str(), &src_st) == 0 &&
+	  ::stat(dst.c_str(), &dst_st) == 0 &&
+	  src_st.st_ino == dst_st.st_ino)
+	continue;
+      // the object was replaced since it was linked
+      if (::unlink(dst.c_str()) < 0)
+	return -errno;
+    }
+    if (::link(src.c_str(), dst.c_str()) < 0) {
+      if (errno == ENOENT)
+	continue; // removed since it was listed, without access_lock
+      return -errno;
+    }
+    changed = true;
+  }
+  for (set<string>::iterator i = present.begin(); i != present.end(); ++i) {
+    if (::unlink((shadow + "/" + *i).c_str()) < 0)
+      return -errno;
+    changed = true;
+  }
+  if (!changed)
+    return 0;
+
+  int fd = ::open(shadow.c_str(), O_RDONLY);
+  if (fd < 0)
+    return -errno;
+  int r = ::fsync(fd);
+  if (r < 0)
+    r = -errno;
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  return r;
+}
+
+void HashIndex::split_changed(const vector<string> &path,
+			      const string *name) {
+  if (!split_queue)
+    return;
+  Mutex::Locker l(pending_lock);
+  if (!split_tracking)
+    return;
+  if (!name)
+    split_tracking = false;
+  else if (path == split_path)
+    split_touched.insert(*name);
+}
+
+int HashIndex::remove_split_shadow() {
+  string shadow = get_base_path() + "/" + SPLIT_SHADOW_DIR;
+  DIR *dir = ::opendir(shadow.c_str());
+  if (!dir)
+    return errno == ENOENT ? 0 : -errno;
+  int r = 0;
+  struct dirent *de;
+  while ((de = ::readdir(dir))) {
+    string name = de->d_name;
+    if (name == "." || name == "..")
+      continue;
+    string sub = shadow + "/" + name;
+    DIR *subdir = ::opendir(sub.c_str());
+    if (!subdir) {
+      r = -errno;
+      break;
+    }
+    struct dirent *sde;
+    while ((sde = ::readdir(subdir))) {
+      string obj = sde->d_name;
+      if (obj == "." || obj == "..")
+	continue;
+      if (::unlink((sub + "/" + obj).c_str()) < 0) {
+	r = -errno;
+	break;
+      }
+    }
+    ::closedir(subdir);
+    if (r < 0)
+      break;
+    if (::rmdir(sub.c_str()) < 0) {
+      r = -errno;
+      break;
+    }
+  }
+  ::closedir(dir);
+  if (r < 0)
+    return r;
+  if (::rmdir(shadow.c_str()) < 0)
+    return -errno;
+  return 0;
+}
+
 void HashIndex::get_path_components(const ghobject_t &oid,
 				    vector<string> *path) {
   char buf[MAX_HASH_LEVEL + 1];
@@ -769,9 +1209,9 @@ int HashIndex::get_path_contents_by_hash(const vector<string> &path,
 					 const ghobject_t *next_object,
 					 const snapid_t *seq,
 					 set<string> *hash_prefixes,
-					 set<pair<string, ghobject_t> > *objects) {
-  set<string> subdirs;
-  map<string, ghobject_t> rev_objects;
+					 set<pair<string, ghobject_t> > *objects,
+					 DirListings *prefetched) {
+  DirListingRef listing;
   int r;
   string cur_prefix;
   for (vector<string>::const_iterator i = path.begin();
@@ -779,10 +1219,12 @@ int HashIndex::get_path_contents_by_hash(const vector<string> &path,
        ++i) {
     cur_prefix.append(*i);
   }
-  r = list_objects(path, 0, 0, &rev_objects);
+  r = get_dir_listing(path, prefetched, &listing);
   if (r < 0)
     return r;
-  for (map<string, ghobject_t>::iterator i = rev_objects.begin();
+  const map<string, ghobject_t> &rev_objects = listing->objects;
+  const set<string> &subdirs = listing->subdirs;
+  for (map<string, ghobject_t>::const_iterator i = rev_objects.begin();
        i != rev_objects.end();
        ++i) {
     string hash_prefix = get_path_str(i->second);
@@ -795,10 +1237,7 @@ int HashIndex::get_path_contents_by_hash(const vector<string> &path,
     hash_prefixes->insert(hash_prefix);
     objects->insert(pair<string, ghobject_t>(hash_prefix, i->second));
   }
-  r = list_subdirs(path, &subdirs);
-  if (r < 0)
-    return r;
-  for (set<string>::iterator i = subdirs.begin();
+  for (set<string>::const_iterator i = subdirs.begin();
        i != subdirs.end();
        ++i) {
     string candidate = cur_prefix + *i;
@@ -818,7 +1257,8 @@ int HashIndex::list_by_hash(const vector<string> &path,
 			    int max_count,
 			    snapid_t seq,
 			    ghobject_t *next,
-			    vector<ghobject_t> *out) {
+			    vector<ghobject_t> *out,
+			    DirListings *prefetched) {
   assert(out);
   vector<string> next_path = path;
   next_path.push_back("");
@@ -829,10 +1269,39 @@ int HashIndex::list_by_hash(const vector<string> &path,
 				    next,
 				    &seq,
 				    &hash_prefixes,
-				    &objects);
+				    &objects,
+				    prefetched);
   if (r < 0)
     return r;
   dout(20) << " prefixes " << hash_prefixes << dendl;
+
+  DirListings local_prefetched;
+  if (!prefetched)
+    prefetched = &local_prefetched;
+  if (list_pool) {
+    // fan out over the subdirs we are about to descend into, all of them
+    // for a full listing, about as many as the remaining count needs
+    // otherwise
+    unsigned window = hash_prefixes.size();
+    if (max_count > 0)
+      window = 1 + (max_count > (int)out->size() ?
+		    (max_count - out->size()) / 256 : 0);
+    vector<vector<string> > to_prefetch;
+    for (set<string>::iterator i = hash_prefixes.begin();
+	 i != hash_prefixes.end() && to_prefetch.size() < window;
+	 ++i) {
+      set<pair<string, ghobject_t> >::iterator j = objects.lower_bound(
+	make_pair(*i, ghobject_t()));
+      if (j != objects.end() && j->first == *i)
+	continue;
+      *(next_path.rbegin()) = *(i->rbegin());
+      if (!prefetched->count(next_path))
+	to_prefetch.push_back(next_path);
+    }
+    if (to_prefetch.size() > 1)
+      prefetch_dirs(to_prefetch, prefetched);
+  }
+
   for (set<string>::iterator i = hash_prefixes.begin();
        i != hash_prefixes.end();
        ++i) {
@@ -853,7 +1322,8 @@ int HashIndex::list_by_hash(const vector<string> &path,
 		       max_count,
 		       seq,
 		       &next_recurse,
-		       out);
+		       out,
+		       prefetched);
 
       if (r < 0)
 	return r;
@@ -880,3 +1350,107 @@ int HashIndex::list_by_hash(const vector<string> &path,
     *next = ghobject_t(hobject_t::get_max());
   return 0;
 }
+
+class HashIndex::C_ListDir : public Context {
+  HashIndex *index;
+  vector<string> path;
+  DirListingRef *out;
+  int *r;
+public:
+  C_ListDir(HashIndex *index, const vector<string> &path,
+	    DirListingRef *out, int *r)
+    : index(index), path(path), out(out), r(r) {}
+  void finish(int) {
+    *r = index->list_dir(path, out);
+  }
+};
+
+int HashIndex::list_dir(const vector<string> &path, DirListingRef *out) {
+  DirListingRef listing(new DirListing);
+  int r = list_objects(path, 0, 0, &listing->objects);
+  if (r < 0)
+    return r;
+  r = list_subdirs(path, &listing->subdirs);
+  if (r < 0)
+    return r;
+  *out = listing;
+  return 0;
+}
+
+int HashIndex::get_dir_listing(const vector<string> &path,
+			       DirListings *prefetched,
+			       DirListingRef *out) {
+  if (prefetched) {
+    DirListings::iterator i = prefetched->find(path);
+    if (i != prefetched->end()) {
+      *out = i->second;
+      prefetched->erase(i);
+      return 0;
+    }
+  }
+  unsigned cache_size = g_conf->filestore_list_cache_dirs;
+  if (cache_size) {
+    Mutex::Locker l(listing_lock);
+    DirListings::iterator i = listing_cache.find(path);
+    if (i != listing_cache.end()) {
+      *out = i->second;
+      listing_lru.remove(path);
+      listing_lru.push_front(path);
+      return 0;
+    }
+  }
+  int r = list_dir(path, out);
+  if (r < 0 || !cache_size)
+    return r;
+
+  // directories are only changed with access_lock held for write, so
+  // nothing can have changed path since we listed it
+  Mutex::Locker l(listing_lock);
+  if (!listing_cache.count(path))
+    listing_lru.push_front(path);
+  listing_cache[path] = *out;
+  while (listing_lru.size() > cache_size) {
+    listing_cache.erase(listing_lru.back());
+    listing_lru.pop_back();
+  }
+  return 0;
+}
+
+void HashIndex::prefetch_dirs(const vector<vector<string> > &paths,
+			      DirListings *prefetched) {
+  vector<DirListingRef> listings(paths.size());
+  vector<int> rs(paths.size(), 0);
+  list<Context*> jobs;
+  for (unsigned i = 0; i < paths.size(); ++i) {
+    if (g_conf->filestore_list_cache_dirs) {
+      Mutex::Locker l(listing_lock);
+      if (listing_cache.count(paths[i]))
+	continue;
+    }
+    jobs.push_back(new C_ListDir(this, paths[i], &listings[i], &rs[i]));
+  }
+  if (jobs.size() < 2) {
+    for (list<Context*>::iterator i = jobs.begin(); i != jobs.end(); ++i)
+      delete *i;
+    return;
+  }
+  dout(20) << __func__ << " " << jobs.size() << " dirs" << dendl;
+  list_pool->run_jobs(jobs);
+  // failed ones are listed again, and their error reported, in order
+  for (unsigned i = 0; i < paths.size(); ++i) {
+    if (rs[i] == 0 && listings[i])
+      (*prefetched)[paths[i]] = listings[i];
+  }
+}
+
+void HashIndex::invalidate_listing(const vector<string> &path) {
+  Mutex::Locker l(listing_lock);
+  if (listing_cache.erase(path))
+    listing_lru.remove(path);
+}
+
+void HashIndex::invalidate_listings() {
+  Mutex::Locker l(listing_lock);
+  listing_cache.clear();
+  listing_lru.clear();
+}
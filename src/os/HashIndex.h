@@ -17,6 +17,8 @@
 
 #include "include/buffer.h"
 #include "include/encoding.h"
+#include "include/Context.h"
+#include "common/Mutex.h"
 #include "LFNIndex.h"
 
 
@@ -45,13 +47,48 @@
  * Subdirectories are created when the number of objects in a directory
  * exceed (abs(merge_threshhold)) * 16 * split_multiplier.  The number of objects in a directory 
  * is encoded as subdir_info_s in an xattr on the directory.
+ *
+ * With a SplitQueue, a directory which just crossed the split threshold
+ * is split in the background instead: the objects are hard linked into
+ * shadow subdirectories under SPLIT_SHADOW_DIR without holding
+ * access_lock for write, and only renaming the shadows into place and unlinking
+ * the originals happens under the write lock.  Directories more than
+ * twice over the threshold are still split inline.  Under the write lock
+ * only the names created or removed since the objects were linked are
+ * checked again, but unlinking the originals still costs one unlink per
+ * object of the directory.
+ *
+ * With a ListPool, list_by_hash lists the subdirectories it is about to
+ * descend into in parallel.  Directory listings, including the lfn
+ * translation of their objects, are kept in a small per collection cache
+ * which every change to the directory invalidates, so that chunked
+ * listings of a directory don't readdir and translate it every time.
  */
 class HashIndex : public LFNIndex {
+public:
+  /// Runs deferred splits, @see do_background_splits
+  class SplitQueue {
+  public:
+    /// Called with access_lock held, must not call back into index
+    virtual void queue_split(HashIndex *index) = 0;
+    virtual ~SplitQueue() {}
+  };
+
+  /// Runs directory listings for list_by_hash
+  class ListPool {
+  public:
+    /// Complete every job in parallel, returns once all of them have
+    virtual void run_jobs(list<Context*> &jobs) = 0;
+    virtual ~ListPool() {}
+  };
+
 private:
   /// Attribute name for storing subdir info @see subdir_info_s
   static const string SUBDIR_ATTR;
   /// Attribute name for storing in progress op tag
   static const string IN_PROGRESS_OP_TAG;
+  /// Collection root directory holding the subdirs of a background split
+  static const string SPLIT_SHADOW_DIR;
   /// Size (bits) in object hash
   static const int PATH_HASH_LEN = 32;
   /// Max length of hashed path
@@ -66,6 +103,31 @@ private:
   int merge_threshold;
   int split_multiplier;
 
+  SplitQueue *split_queue;          ///< NULL if splits are done inline
+  Mutex pending_lock;               ///< protects pending_splits
+  set<vector<string> > pending_splits; ///< paths waiting for a background split
+  /// Held while the shadow dir is populated, serializes with prep_delete
+  Mutex shadow_lock;
+  /// Subdir whose shadow is populated, protected by pending_lock
+  vector<string> split_path;
+  bool split_tracking;          ///< whether split_touched is complete
+  set<string> split_touched;    ///< names created or removed in split_path
+
+  ListPool *list_pool; ///< NULL if listings are sequential
+
+  /// Contents of a directory, @see get_dir_listing
+  struct DirListing {
+    map<string, ghobject_t> objects; ///< by short name
+    set<string> subdirs;
+  };
+  typedef ceph::shared_ptr<DirListing> DirListingRef;
+  typedef map<vector<string>, DirListingRef> DirListings;
+  class C_ListDir;
+
+  Mutex listing_lock;              ///< protects listing_cache, listing_lru
+  DirListings listing_cache;       ///< recently listed directories
+  list<vector<string> > listing_lru;
+
   /// Encodes current subdir state for determining when to split/merge.
   struct subdir_info_s {
     uint64_t objs;       ///< Objects in subdir.
@@ -138,10 +200,18 @@ public:
     int merge_at,          ///< [in] Merge threshhold.
     int split_multiple,	   ///< [in] Split threshhold.
     uint32_t index_version,///< [in] Index version
-    double retry_probability=0) ///< [in] retry probability
+    double retry_probability=0, ///< [in] retry probability
+    SplitQueue *split_queue=NULL, ///< [in] queue for background splits
+    ListPool *list_pool=NULL)     ///< [in] pool for parallel listings
     : LFNIndex(collection, base_path, index_version, retry_probability),
       merge_threshold(merge_at),
-      split_multiplier(split_multiple) {}
+      split_multiplier(split_multiple),
+      split_queue(split_queue),
+      pending_lock("HashIndex::pending_lock"),
+      shadow_lock("HashIndex::shadow_lock"),
+      split_tracking(false),
+      list_pool(list_pool),
+      listing_lock("HashIndex::listing_lock") {}
 
   /// @see CollectionIndex
   uint32_t collection_version() { return index_version; }
@@ -152,6 +222,16 @@ public:
   /// @see CollectionIndex
   int prep_delete();
 
+  /// @see CollectionIndex, drops the link into the background split shadow
+  int drop_private_links(const ghobject_t &oid, const struct stat &st);
+
+  /**
+   * Split the directories queued by _created
+   *
+   * Called from the SplitQueue thread without access_lock held.
+   */
+  int do_background_splits();
+
   /// @see CollectionIndex
   int _split(
     uint32_t match,
@@ -199,6 +279,26 @@ protected:
     vector<ghobject_t> *ls,
     ghobject_t *next
     );
+
+  /**
+   * Take path off the pending splits and link its objects into shadow subdirs
+   *
+   * Takes access_lock for read while path is looked at, and not at all
+   * while the objects are linked.
+   */
+  int prepare_background_split(
+    const vector<string> &path ///< [in] Subdir to split
+    ); /// @return Error Code, 0 on success, 1 if path needs no split
+
+  /// Move the shadow subdirs into path, with access_lock held for write
+  int complete_background_split(
+    const vector<string> &path ///< [in] Subdir to split
+    ); /// @return Error Code, 0 on success, 1 if no split is needed
+
+  /// Queue path for do_background_splits
+  void queue_background_split(
+    const vector<string> &path ///< [in] Subdir to split
+    );
 private:
   /// Recursively remove path and its subdirs
   int recursive_remove(
@@ -242,6 +342,28 @@ private:
     const subdir_info_s &info ///< [in] Info to check
     ); /// @return True if info must be split, False otherwise
 
+  /// Whether a split of info is too urgent to leave to the SplitQueue
+  bool must_split_inline(
+    const subdir_info_s &info ///< [in] Info to check
+    ); /// @return True if info must be split by the caller
+
+  /// Bring shadow dir up to date with objects, @see prepare_background_split
+  int sync_shadow_dir(
+    const vector<string> &path,             ///< [in] Subdir being split
+    const string &shadow,                   ///< [in] Full path of shadow dir
+    const map<string, ghobject_t> &objects, ///< [in] Objects it must hold
+    const set<string> *touched              ///< [in] Only links to check, or NULL
+    ); /// @return Error Code, 0 on success
+
+  /// Note a change to path for complete_background_split
+  void split_changed(
+    const vector<string> &path, ///< [in] Subdir changed
+    const string *name          ///< [in] Name changed, NULL if the index was reorganized
+    );
+
+  /// Remove SPLIT_SHADOW_DIR and everything below it
+  int remove_split_shadow();
+
   /// Initiates merge
   int initiate_merge(
     const vector<string> &path, ///< [in] Subdir to merge
@@ -360,7 +482,8 @@ private:
     const ghobject_t *next_object,          /// [in] list > *next_object
     const snapid_t *seq,                   /// [in] list >= *seq
     set<string> *hash_prefixes,            /// [out] prefixes in dir
-    set<pair<string, ghobject_t> > *objects /// [out] objects
+    set<pair<string, ghobject_t> > *objects, /// [out] objects
+    DirListings *prefetched = NULL         /// [in,out] listings to use first
     );
 
   /// List objects in collection in ghobject_t order
@@ -370,9 +493,35 @@ private:
     int max_count,              /// [in] List at most max_count
     snapid_t seq,               /// [in] list only objects where snap >= seq
     ghobject_t *next,            /// [in,out] List objects >= *next
-    vector<ghobject_t> *out      /// [out] Listed objects
+    vector<ghobject_t> *out,     /// [out] Listed objects
+    DirListings *prefetched = NULL /// [in,out] @see prefetch_dirs
     ); ///< @return Error Code, 0 on success
 
+  /// Read the contents of path from disk
+  int list_dir(
+    const vector<string> &path, ///< [in] Path to list
+    DirListingRef *out          ///< [out] Contents
+    ); ///< @return Error Code, 0 on success
+
+  /// Get contents of path from prefetched, the cache or the disk
+  int get_dir_listing(
+    const vector<string> &path, ///< [in] Path to list
+    DirListings *prefetched,    ///< [in,out] consumed if it has path
+    DirListingRef *out          ///< [out] Contents
+    ); ///< @return Error Code, 0 on success
+
+  /// List paths in parallel on list_pool into prefetched
+  void prefetch_dirs(
+    const vector<vector<string> > &paths, ///< [in] Paths to list
+    DirListings *prefetched               ///< [out] Listings
+    );
+
+  /// Drop the cached listing of path
+  void invalidate_listing(const vector<string> &path);
+
+  /// Drop all cached listings, for changes to the directory structure
+  void invalidate_listings();
+
   /// Create the given levels of sub directories from the given root.
   /// The contents of *path* is not changed after calling this function.
   int recursive_create_path(vector<string>& path, int level);
@@ -62,6 +62,8 @@ static int get_version(const char *path, uint32_t *version) {
 }
 
 IndexManager::~IndexManager() {
+  stop_split_thread();
+  stop_list_threads();
 
   for (ceph::unordered_map<coll_t, CollectionIndex* > ::iterator it = col_indices.begin(); 
        it != col_indices.end(); ++it) {
@@ -115,7 +117,9 @@ int IndexManager::build_index(const coll_t& c, const char *path, CollectionIndex
     *index = new HashIndex(c, path, g_conf->filestore_merge_threshold,
 				 g_conf->filestore_split_multiple,
 				 CollectionIndex::HOBJECT_WITH_POOL,
-				 g_conf->filestore_index_retry_probability);
+				 g_conf->filestore_index_retry_probability,
+				 g_conf->filestore_split_background ? this : NULL,
+				 g_conf->filestore_list_threads > 0 ? this : NULL);
     return 0;
   }
 }
@@ -138,3 +142,106 @@ int IndexManager::get_index(const coll_t& c, const string& baseDir, Index *index
   }
   return 0;
 }
+
+void IndexManager::queue_split(HashIndex *index) {
+  Mutex::Locker l(split_lock);
+  split_queue.push_back(index);
+  split_cond.Signal();
+}
+
+void IndexManager::start_split_thread() {
+  if (!g_conf->filestore_split_background)
+    return;
+  Mutex::Locker l(split_lock);
+  if (split_thread.is_started())
+    return;
+  split_stop = false;
+  split_thread.create();
+}
+
+void IndexManager::stop_split_thread() {
+  {
+    Mutex::Locker l(split_lock);
+    if (!split_thread.is_started())
+      return;
+    split_stop = true;
+    split_cond.Signal();
+  }
+  split_thread.join();
+}
+
+void IndexManager::split_entry() {
+  Mutex::Locker l(split_lock);
+  while (!split_stop) {
+    if (split_queue.empty()) {
+      split_cond.Wait(split_lock);
+      continue;
+    }
+    HashIndex *index = split_queue.front();
+    split_queue.pop_front();
+    split_lock.Unlock();
+    // errors are logged by the index, which queues itself again for
+    // its other pending splits; the failed directory stays over the
+    // threshold and is queued again by the next create in it
+    index->do_background_splits();
+    split_lock.Lock();
+  }
+}
+
+void IndexManager::run_jobs(list<Context*> &jobs) {
+  ListBatch batch(jobs.size());
+  Mutex::Locker l(list_lock);
+  if (list_threads.empty()) {
+    for (int i = 0; i < g_conf->filestore_list_threads; ++i) {
+      list_threads.push_back(new ListThread(this));
+      list_threads.back()->create();
+    }
+  }
+  if (list_threads.empty()) {
+    // filestore_list_threads was set to 0 since the index was built
+    list_lock.Unlock();
+    for (list<Context*>::iterator i = jobs.begin(); i != jobs.end(); ++i)
+      (*i)->complete(0);
+    jobs.clear();
+    list_lock.Lock();
+    return;
+  }
+  for (list<Context*>::iterator i = jobs.begin(); i != jobs.end(); ++i)
+    list_queue.push_back(make_pair(*i, &batch));
+  jobs.clear();
+  list_cond.SignalAll();
+  while (batch.left)
+    batch.cond.Wait(list_lock);
+}
+
+void IndexManager::list_entry() {
+  Mutex::Locker l(list_lock);
+  while (!list_stop) {
+    if (list_queue.empty()) {
+      list_cond.Wait(list_lock);
+      continue;
+    }
+    pair<Context*, ListBatch*> job = list_queue.front();
+    list_queue.pop_front();
+    list_lock.Unlock();
+    job.first->complete(0);
+    list_lock.Lock();
+    if (--job.second->left == 0)
+      job.second->cond.Signal();
+  }
+}
+
+void IndexManager::stop_list_threads() {
+  {
+    Mutex::Locker l(list_lock);
+    list_stop = true;
+    list_cond.SignalAll();
+  }
+  for (vector<ListThread*>::iterator i = list_threads.begin();
+       i != list_threads.end();
+       ++i) {
+    (*i)->join();
+    delete *i;
+  }
+  list_threads.clear();
+}
@@ -19,6 +19,7 @@
 
 #include "common/Mutex.h"
 #include "common/Cond.h"
+#include "common/Thread.h"
 #include "common/config.h"
 #include "common/debug.h"
 
@@ -48,12 +49,58 @@ struct Index {
  * the lifetime of a CollectionIndex object and any paths returned
  * by it, no other concurrent accesses may be allowed.
  * This is enforced by using CollectionIndex::access_lock
+ *
+ * With filestore_split_background, IndexManager also runs the thread
+ * doing the HashIndex splits deferred through HashIndex::SplitQueue, and
+ * with filestore_list_threads the threads listing directories for
+ * HashIndex::ListPool.
  */
-class IndexManager {
+class IndexManager : public HashIndex::SplitQueue,
+		     public HashIndex::ListPool {
   Mutex lock; ///< Lock for Index Manager
   bool upgrade;
   ceph::unordered_map<coll_t, CollectionIndex* > col_indices;
 
+  Mutex split_lock;           ///< protects split_queue and split_stop
+  Cond split_cond;
+  bool split_stop;
+  list<HashIndex*> split_queue; ///< indexes with pending splits
+
+  class SplitThread : public Thread {
+    IndexManager *im;
+  public:
+    SplitThread(IndexManager *im) : im(im) {}
+    void *entry() {
+      im->split_entry();
+      return 0;
+    }
+  } split_thread;
+  void split_entry();
+
+  /// Jobs of one run_jobs call
+  struct ListBatch {
+    unsigned left;   ///< jobs not completed yet
+    Cond cond;
+    ListBatch(unsigned left) : left(left) {}
+  };
+  Mutex list_lock;    ///< protects list_queue, list_threads, list_stop
+  Cond list_cond;
+  bool list_stop;
+  list<pair<Context*, ListBatch*> > list_queue;
+
+  class ListThread : public Thread {
+    IndexManager *im;
+  public:
+    ListThread(IndexManager *im) : im(im) {}
+    void *entry() {
+      im->list_entry();
+      return 0;
+    }
+  };
+  vector<ListThread*> list_threads;
+  void list_entry();
+  void stop_list_threads();
+
   /**
    * Index factory
    *
@@ -69,7 +116,12 @@ class IndexManager {
 public:
   /// Constructor
   IndexManager(bool upgrade) : lock("IndexManager lock"),
-			       upgrade(upgrade) {}
+			       upgrade(upgrade),
+			       split_lock("IndexManager::split_lock"),
+			       split_stop(false),
+			       split_thread(this),
+			       list_lock("IndexManager::list_lock"),
+			       list_stop(false) {}
 
   ~IndexManager();
 
@@ -92,6 +144,18 @@ public:
    * @return error code
    */
   int init_index(const coll_t& c, const char *path, uint32_t filestore_version);
+
+  /// @see HashIndex::SplitQueue
+  void queue_split(HashIndex *index);
+
+  /// Start the background split thread if filestore_split_background is set
+  void start_split_thread();
+
+  /// Stop the background split thread, queued splits wait for the next start
+  void stop_split_thread();
+
+  /// @see HashIndex::ListPool, threads are started on first use
+  void run_jobs(list<Context*> &jobs);
 };
 
 #endif
@@ -44,6 +44,7 @@
 
 #include "common/debug.h"
 #include "common/errno.h"
+#include "include/ceph_hash.h"
 #include "common/run_cmd.h"
 #include "common/safe_io.h"
 #include "common/perf_counters.h"
@@ -289,6 +290,121 @@ int StripObjectMap::get_with_header(const StripObjectHeaderRef header,
   return 0;
 }
 
+// ============== StripCache Implementation =================
+
+StripCache::Shard &StripCache::get_shard(uint64_t seq, const string &key)
+{
+  uint32_t h = ceph_str_hash_linux(key.c_str(), key.size());
+  return shards[(h + seq) % NUM_SHARDS];
+}
+
+void StripCache::_insert(Shard &shard, const key_t &k, const bufferlist &bl)
+{
+  assert(shard.lock.is_locked());
+  map<key_t, Entry>::iterator p = shard.entries.find(k);
+  if (p != shard.entries.end())
+    _erase(shard, p);
+
+  // don't pin the (possibly much larger) buffers the strip was cut from
+  bufferptr bp(bl.length());
+  bl.copy(0, bl.length(), bp.c_str());
+
+  Entry &e = shard.entries[k];
+  e.data.append(bp);
+  shard.lru.push_front(k);
+  e.lru_pos = shard.lru.begin();
+  shard.bytes += bl.length();
+  _trim(shard);
+}
+
+void StripCache::_erase(Shard &shard, map<key_t, Entry>::iterator p)
+{
+  assert(shard.lock.is_locked());
+  shard.bytes -= p->second.data.length();
+  shard.lru.erase(p->second.lru_pos);
+  shard.entries.erase(p);
+}
+
+void StripCache::_trim(Shard &shard)
+{
+  while (shard.bytes > max_shard_bytes && !shard.lru.empty())
+    _erase(shard, shard.entries.find(shard.lru.back()));
+}
+
+void StripCache::set_size(uint64_t max_bytes)
+{
+  for (unsigned i = 0; i < NUM_SHARDS; ++i) {
+    Mutex::Locker l(shards[i].lock);
+    max_shard_bytes = max_bytes / NUM_SHARDS;
+    _trim(shards[i]);
+  }
+}
+
+uint64_t StripCache::get_bytes()
+{
+  uint64_t bytes = 0;
+  for (unsigned i = 0; i < NUM_SHARDS; ++i) {
+    Mutex::Locker l(shards[i].lock);
+    bytes += shards[i].bytes;
+  }
+  return bytes;
+}
+
+uint64_t StripCache::get_epoch(uint64_t seq, const string &key)
+{
+  Shard &shard = get_shard(seq, key);
+  Mutex::Locker l(shard.lock);
+  return shard.epoch;
+}
+
+bool StripCache::lookup(uint64_t seq, const string &key, bufferlist *out)
+{
+  Shard &shard = get_shard(seq, key);
+  Mutex::Locker l(shard.lock);
+  map<key_t, Entry>::iterator p = shard.entries.find(make_pair(seq, key));
+  if (p == shard.entries.end())
+    return false;
+  shard.lru.splice(shard.lru.begin(), shard.lru, p->second.lru_pos);
+  *out = p->second.data;
+  return true;
+}
+
+void StripCache::fill(uint64_t seq, const string &key, const bufferlist &bl,
+                      uint64_t epoch)
+{
+  Shard &shard = get_shard(seq, key);
+  Mutex::Locker l(shard.lock);
+  if (shard.epoch != epoch || !max_shard_bytes)
+    return;
+  _insert(shard, make_pair(seq, key), bl);
+}
+
+void StripCache::update(uint64_t seq, const string &key, const bufferlist &bl)
+{
+  Shard &shard = get_shard(seq, key);
+  Mutex::Locker l(shard.lock);
+  ++shard.epoch;
+  if (bl.length() && max_shard_bytes) {
+    _insert(shard, make_pair(seq, key), bl);
+  } else {
+    map<key_t, Entry>::iterator p = shard.entries.find(make_pair(seq, key));
+    if (p != shard.entries.end())
+      _erase(shard, p);
+  }
+}
+
+void StripCache::invalidate(uint64_t seq)
+{
+  for (unsigned i = 0; i < NUM_SHARDS; ++i) {
+    Shard &shard = shards[i];
+    Mutex::Locker l(shard.lock);
+    ++shard.epoch;
+    map<key_t, Entry>::iterator p = shard.entries.lower_bound(make_pair(seq, string()));
+    while (p != shard.entries.end() && p->first.first == seq)
+      _erase(shard, p++);
+  }
+}
+
 // ========= KeyValueStore::BufferTransaction Implementation ============
 
 int KeyValueStore::BufferTransaction::lookup_cached_header(
@@ -355,6 +471,11 @@ int KeyValueStore::BufferTransaction::get_buffer_keys(
     }
   }
 
+  map<string, uint64_t> epochs;
+  bool use_cache = prefix == OBJECT_STRIP_PREFIX;
+  if (use_cache)
+    store->strip_cache_lookup(strip_header, &need_lookup, out, &epochs);
+
   if (!need_lookup.empty()) {
     int r = store->backend->get_values_with_header(strip_header, prefix,
                                                    need_lookup, out);
@@ -363,6 +484,8 @@ int KeyValueStore::BufferTransaction::get_buffer_keys(
                << strip_header->oid << " " << " r = " << r << dendl;
       return r;
     }
+    if (use_cache)
+      store->strip_cache_fill(strip_header, epochs, *out);
   }
 
   return 0;
@@ -377,6 +500,8 @@ void KeyValueStore::BufferTransaction::set_buffer_keys(
   uniq_id uid = make_pair(strip_header->cid, strip_header->oid);
   for (map<string, bufferlist>::iterator iter = values.begin();
        iter != values.end(); ++iter) {
+    if (prefix == OBJECT_STRIP_PREFIX)
+      strip_updates[make_pair(strip_header->header->seq, iter->first)] = iter->second;
     buffers[uid][make_pair(prefix, iter->first)].swap(iter->second);
   }
 }
@@ -392,6 +517,10 @@ int KeyValueStore::BufferTransaction::remove_buffer_keys(
       obj_it->second[make_pair(prefix, *iter)] = bufferlist();
     }
   }
+  if (prefix == OBJECT_STRIP_PREFIX) {
+    for (set<string>::iterator iter = keys.begin(); iter != keys.end(); ++iter)
+      strip_updates[make_pair(strip_header->header->seq, *iter)] = bufferlist();
+  }
 
   return store->backend->rm_keys(strip_header->header, prefix, keys, t);
 }
@@ -414,6 +543,7 @@ int KeyValueStore::BufferTransaction::clear_buffer(
      StripObjectMap::StripObjectHeaderRef strip_header)
 {
   strip_header->deleted = true;
+  strip_clears.insert(strip_header->header->seq);
 
   InvalidateCacheContext *c = new InvalidateCacheContext(store, strip_header->cid, strip_header->oid);
   finishes.push_back(c);
@@ -471,6 +601,7 @@ int KeyValueStore::BufferTransaction::submit_transaction()
   }
 
   r = store->backend->submit_transaction_sync(t);
+  store->strip_cache_commit(*this, r);
   for (list<Context*>::iterator it = finishes.begin(); it != finishes.end(); ++it) {
     (*it)->complete(r);
   }
@@ -480,6 +611,70 @@ out:
   return r;
 }
 
+// =========== KeyValueStore Strip Cache Helpers ==============
+
+void KeyValueStore::strip_cache_lookup(StripObjectMap::StripObjectHeaderRef header,
+                                       set<string> *keys,
+                                       map<string, bufferlist> *out,
+                                       map<string, uint64_t> *epochs)
+{
+  if (!strip_cache.enabled() || !header->header)
+    return;
+
+  uint64_t seq = header->header->seq;
+  for (set<string>::iterator it = keys->begin(); it != keys->end(); ) {
+    bufferlist bl;
+    if (strip_cache.lookup(seq, *it, &bl)) {
+      strip_cache_logger->inc(l_kvs_strip_cache_hit);
+      (*out)[*it].swap(bl);
+      keys->erase(it++);
+    } else {
+      strip_cache_logger->inc(l_kvs_strip_cache_miss);
+      (*epochs)[*it] = strip_cache.get_epoch(seq, *it);
+      ++it;
+    }
+  }
+}
+
+void KeyValueStore::strip_cache_fill(StripObjectMap::StripObjectHeaderRef header,
+                                     const map<string, uint64_t> &epochs,
+                                     const map<string, bufferlist> &out)
+{
+  if (!strip_cache.enabled() || !header->header)
+    return;
+
+  uint64_t seq = header->header->seq;
+  for (map<string, uint64_t>::const_iterator it = epochs.begin();
+       it != epochs.end(); ++it) {
+    map<string, bufferlist>::const_iterator p = out.find(it->first);
+    if (p != out.end())
+      strip_cache.fill(seq, it->first, p->second, it->second);
+  }
+  strip_cache_logger->set(l_kvs_strip_cache_bytes, strip_cache.get_bytes());
+}
+
+// Called with the result of submitting the transaction; on failure we
+// can't tell what the backend holds, so forget everything touched.
+void KeyValueStore::strip_cache_commit(BufferTransaction &t, int r)
+{
+  if (t.strip_updates.empty() && t.strip_clears.empty())
+    return;
+
+  for (map<pair<uint64_t, string>, bufferlist>::iterator it = t.strip_updates.begin();
+       it != t.strip_updates.end(); ++it) {
+    if (r < 0) {
+      strip_cache.update(it->first.first, it->first.second, bufferlist());
+    } else {
+      strip_cache.update(it->first.first, it->first.second, it->second);
+    }
+  }
+  for (set<uint64_t>::iterator it = t.strip_clears.begin();
+       it != t.strip_clears.end(); ++it) {
+    strip_cache.invalidate(*it);
+  }
+  strip_cache_logger->set(l_kvs_strip_cache_bytes, strip_cache.get_bytes());
+}
+
 // =========== KeyValueStore Intern Helper Implementation ==============
 
 ostream& operator<<(ostream& out, const KeyValueStore::OpSequencer& s)
@@ -530,7 +725,8 @@ KeyValueStore::KeyValueStore(const std::string &base,
         g_conf->keyvaluestore_op_threads, "keyvaluestore_op_threads"),
   op_wq(this, g_conf->keyvaluestore_op_thread_timeout,
         g_conf->keyvaluestore_op_thread_suicide_timeout, &op_tp),
-  perf_logger(NULL),
+  perf_logger(NULL), strip_cache_logger(NULL),
+  strip_cache(g_conf->keyvaluestore_strip_cache_size),
   m_keyvaluestore_queue_max_ops(g_conf->keyvaluestore_queue_max_ops),
   m_keyvaluestore_queue_max_bytes(g_conf->keyvaluestore_queue_max_bytes),
   m_keyvaluestore_strip_size(g_conf->keyvaluestore_default_strip_size),
@@ -557,6 +753,14 @@ KeyValueStore::KeyValueStore(const std::string &base,
   perf_logger = plb.create_perf_counters();
 
   g_ceph_context->get_perfcounters_collection()->add(perf_logger);
+
+  PerfCountersBuilder scb(g_ceph_context, internal_name + "_strip_cache",
+                          l_kvs_strip_cache_first, l_kvs_strip_cache_last);
+  scb.add_u64_counter(l_kvs_strip_cache_hit, "hit");
+  scb.add_u64_counter(l_kvs_strip_cache_miss, "miss");
+  scb.add_u64(l_kvs_strip_cache_bytes, "bytes");
+  strip_cache_logger = scb.create_perf_counters();
+  g_ceph_context->get_perfcounters_collection()->add(strip_cache_logger);
   g_ceph_context->_conf->add_observer(this);
 
   superblock.compat_features = get_kv_initial_compat_set();
@@ -566,8 +770,10 @@ KeyValueStore::~KeyValueStore()
 {
   g_ceph_context->_conf->remove_observer(this);
   g_ceph_context->get_perfcounters_collection()->remove(perf_logger);
+  g_ceph_context->get_perfcounters_collection()->remove(strip_cache_logger);
 
   delete perf_logger;
+  delete strip_cache_logger;
 }
 
 int KeyValueStore::statfs(struct statfs *buf)
@@ -1650,6 +1856,10 @@ int KeyValueStore::_generic_read(StripObjectMap::StripObjectHeaderRef header,
   }
 
 
+  map<string, bufferlist> cached;
+  map<string, uint64_t> epochs;
+  strip_cache_lookup(header, &keys, &cached, &epochs);
+
   int r = backend->get_values_with_header(header, OBJECT_STRIP_PREFIX, keys, &out);
   if (r < 0) {
     dout(10) << __func__ << " " << header->cid << "/" << header->oid << " "
@@ -1661,6 +1871,10 @@ int KeyValueStore::_generic_read(StripObjectMap::StripObjectHeaderRef header,
             << len << " = " << r << dendl;
     return -EBADF;
   }
+  strip_cache_fill(header, epochs, out);
+  for (map<string, bufferlist>::iterator it = cached.begin();
+       it != cached.end(); ++it)
+    out[it->first].swap(it->second);
 
   for (vector<StripObjectMap::StripExtent>::iterator iter = extents.begin();
        iter != extents.end(); ++iter) {
@@ -3053,6 +3267,7 @@ const char** KeyValueStore::get_tracked_conf_keys() const
     "keyvaluestore_queue_max_ops",
     "keyvaluestore_queue_max_bytes",
     "keyvaluestore_strip_size",
+    "keyvaluestore_strip_cache_size",
     NULL
   };
   return KEYS;
@@ -3072,6 +3287,9 @@ void KeyValueStore::handle_conf_change(const struct md_config_t *conf,
     m_keyvaluestore_strip_size = conf->keyvaluestore_default_strip_size;
     default_strip_size = m_keyvaluestore_strip_size;
   }
+  if (changed.count("keyvaluestore_strip_cache_size")) {
+    strip_cache.set_size(conf->keyvaluestore_strip_cache_size);
+  }
 }
 
 void KeyValueStore::dump_transactions(list<ObjectStore::Transaction*>& ls, uint64_t seq, OpSequencer *osr)
@@ -43,6 +43,14 @@ using namespace std;
 
 static uint64_t default_strip_size = 1024;
 
+enum {
+  l_kvs_strip_cache_first = 84100,
+  l_kvs_strip_cache_hit,
+  l_kvs_strip_cache_miss,
+  l_kvs_strip_cache_bytes,
+  l_kvs_strip_cache_last,
+};
+
 class StripObjectMap: public GenericObjectMap {
  public:
 
@@ -137,6 +145,64 @@ class StripObjectMap: public GenericObjectMap {
 };
 
 
+/**
+ * Cache of object data strips shared by readers and transactions, keyed by
+ * the seq of the header a strip is stored under and the strip key.
+ *
+ * Strips are written through: a transaction's strips are put into the
+ * cache once the backend committed them, so a hit always returns committed
+ * data.  A reader filling the cache after a miss may race with a commit of
+ * the same strip, so fills are dropped if the shard was updated since the
+ * reader looked it up (@see get_epoch).
+ */
+class StripCache {
+  typedef pair<uint64_t, string> key_t;
+  typedef list<key_t> lru_t;
+  struct Entry {
+    bufferlist data;
+    lru_t::iterator lru_pos;
+  };
+  struct Shard {
+    Mutex lock;
+    uint64_t epoch;
+    uint64_t bytes;
+    lru_t lru;  // front is most recently used
+    map<key_t, Entry> entries;
+
+    Shard() : lock("StripCache::Shard::lock"), epoch(0), bytes(0) {}
+  };
+
+  static const unsigned NUM_SHARDS = 16;
+  Shard shards[NUM_SHARDS];
+  uint64_t max_shard_bytes;
+
+  Shard &get_shard(uint64_t seq, const string &key);
+  void _insert(Shard &shard, const key_t &k, const bufferlist &bl);
+  void _erase(Shard &shard, map<key_t, Entry>::iterator p);
+  void _trim(Shard &shard);
+
+ public:
+  StripCache(uint64_t max_bytes) : max_shard_bytes(max_bytes / NUM_SHARDS) {}
+
+  bool enabled() const {
+    return max_shard_bytes > 0;
+  }
+  void set_size(uint64_t max_bytes);
+  uint64_t get_bytes();
+
+  /// current epoch of the shard, to be passed to a later fill()
+  uint64_t get_epoch(uint64_t seq, const string &key);
+  bool lookup(uint64_t seq, const string &key, bufferlist *out);
+  /// add a strip read from the backend, unless it was updated since epoch
+  void fill(uint64_t seq, const string &key, const bufferlist &bl,
+            uint64_t epoch);
+  /// update a committed strip, an empty bufferlist removes it
+  void update(uint64_t seq, const string &key, const bufferlist &bl);
+  /// drop all strips stored under seq
+  void invalidate(uint64_t seq);
+};
+
+
 class KVSuperblock {
 public:
   CompatSet compat_features;
@@ -251,6 +317,11 @@ class KeyValueStore : public ObjectStore,
 
     list<Context*> finishes;
 
+    // strips written (an empty value for removed ones) and headers cleared
+    // by this transaction, by header seq, for the strip cache
+    map<pair<uint64_t, string>, bufferlist> strip_updates;
+    set<uint64_t> strip_clears;
+
     KeyValueStore *store;
 
     KeyValueDB::Transaction t;
@@ -470,6 +541,17 @@ class KeyValueStore : public ObjectStore,
   void _finish_op(OpSequencer *osr);
 
   PerfCounters *perf_logger;
+  PerfCounters *strip_cache_logger;
+
+  StripCache strip_cache;
+  /// serve keys from the strip cache, remembering epochs of the misses
+  void strip_cache_lookup(StripObjectMap::StripObjectHeaderRef header,
+                          set<string> *keys, map<string, bufferlist> *out,
+                          map<string, uint64_t> *epochs);
+  void strip_cache_fill(StripObjectMap::StripObjectHeaderRef header,
+                        const map<string, uint64_t> &epochs,
+                        const map<string, bufferlist> &out);
+  void strip_cache_commit(BufferTransaction &t, int r);
 
  public:
 
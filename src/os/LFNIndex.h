@@ -424,6 +424,25 @@ protected:
     const string &attr_name	///< [in] attr to remove
     ); ///< @return Error code, 0 on success
 
+  /// Checks whether short_name is a hashed filename.
+  bool lfn_is_hashed_filename(
+    const string &short_name ///< [in] Name to check.
+    ); ///< @return True if short_name is hashed, False otherwise.
+
+  /// Gets the base path
+  const string &get_base_path(); ///< @return Index base_path
+
+  /// Get full path the subdir
+  string get_full_path_subdir(
+    const vector<string> &rel ///< [in] The subdir.
+    ); ///< @return Full path to rel.
+
+  /// Get full path to object
+  string get_full_path(
+    const vector<string> &rel, ///< [in] Path to object.
+    const string &name	       ///< [in] Filename of object.
+    ); ///< @return Fullpath to object at name in rel.
+
 private:
   /* lfn translation functions */
 
@@ -522,11 +541,6 @@ private:
     ghobject_t *out	     ///< [out] Resulting Object
     ); ///< @return True if successfull, False otherwise.
 
-  /// Checks whether short_name is a hashed filename.
-  bool lfn_is_hashed_filename(
-    const string &short_name ///< [in] Name to check.
-    ); ///< @return True if short_name is hashed, False otherwise.
-
   /// Checks whether long_name must be hashed.
   bool lfn_must_hash(
     const string &long_name ///< [in] Name to check.
@@ -539,20 +553,6 @@ private:
     ); ///< @return Hashed filename.
 
   /* other common methods */
-  /// Gets the base path
-  const string &get_base_path(); ///< @return Index base_path
-
-  /// Get full path the subdir
-  string get_full_path_subdir(
-    const vector<string> &rel ///< [in] The subdir.
-    ); ///< @return Full path to rel.
-
-  /// Get full path to object
-  string get_full_path(
-    const vector<string> &rel, ///< [in] Path to object.
-    const string &name	       ///< [in] Filename of object.
-    ); ///< @return Fullpath to object at name in rel.
-
   /// Get mangled path component
   string mangle_path_component(
     const string &component ///< [in] Component to mangle
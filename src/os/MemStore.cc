@@ -170,7 +170,7 @@ int MemStore::_load()
     int r = cbl.read_file(fn.c_str(), &err);
     if (r < 0)
       return r;
-    CollectionRef c(new Collection);
+    CollectionRef c = new_collection();
     bufferlist::iterator p = cbl.begin();
     c->decode(p);
     coll_map[*q] = c;
@@ -261,6 +261,12 @@ MemStore::CollectionRef MemStore::get_collection(coll_t cid)
   return cp->second;
 }
 
+MemStore::CollectionRef MemStore::new_collection()
+{
+  return CollectionRef(new Collection(g_conf->memstore_page_set,
+				      g_conf->memstore_page_size));
+}
+
 
 // ---------------
 // read operations
@@ -293,7 +299,7 @@ int MemStore::stat(
   ObjectRef o = c->get_object(oid);
   if (!o)
     return -ENOENT;
-  st->st_size = o->data.length();
+  st->st_size = o->get_size();
   st->st_blksize = 4096;
   st->st_blocks = (st->st_size + st->st_blksize - 1) / st->st_blksize;
   st->st_nlink = 1;
@@ -319,16 +325,15 @@ int MemStore::read(
   ObjectRef o = c->get_object(oid);
   if (!o)
     return -ENOENT;
-  if (offset >= o->data.length())
+  if (offset >= o->get_size())
     return 0;
   size_t l = len;
   if (l == 0)  // note: len == 0 means read the entire object
-    l = o->data.length();
-  else if (offset + l > o->data.length())
-    l = o->data.length() - offset;
+    l = o->get_size();
+  else if (offset + l > o->get_size())
+    l = o->get_size() - offset;
   bl.clear();
-  bl.substr_of(o->data, offset, l);
-  return bl.length();
+  return o->read(offset, l, bl);
 }
 
 int MemStore::fiemap(coll_t cid, const ghobject_t& oid,
@@ -344,11 +349,11 @@ int MemStore::fiemap(coll_t cid, const ghobject_t& oid,
   ObjectRef o = c->get_object(oid);
   if (!o)
     return -ENOENT;
-  if (offset >= o->data.length())
+  if (offset >= o->get_size())
     return 0;
   size_t l = len;
-  if (offset + l > o->data.length())
-    l = o->data.length() - offset;
+  if (offset + l > o->get_size())
+    l = o->get_size() - offset;
   map<uint64_t, uint64_t> m;
   m[offset] = l;
   ::encode(m, bl);
@@ -998,7 +1003,7 @@ int MemStore::_touch(coll_t cid, const ghobject_t& oid)
 
   ObjectRef o = c->get_object(oid);
   if (!o) {
-    o.reset(new Object);
+    o = c->create_object();
     c->object_map[oid] = o;
     c->object_hash[oid] = o;
   }
@@ -1021,46 +1026,18 @@ int MemStore::_write(coll_t cid, const ghobject_t& oid,
   ObjectRef o = c->get_object(oid);
   if (!o) {
     // write implicitly creates a missing object
-    o.reset(new Object);
+    o = c->create_object();
     c->object_map[oid] = o;
     c->object_hash[oid] = o;
   }
 
-  int old_size = o->data.length();
-  _write_into_bl(bl, offset, &o->data);
-  used_bytes += (o->data.length() - old_size);
+  int old_size = o->get_size();
+  o->write(offset, bl);
+  used_bytes += (o->get_size() - old_size);
 
   return 0;
 }
 
-void MemStore::_write_into_bl(const bufferlist& src, unsigned offset,
-			      bufferlist *dst)
-{
-  unsigned len = src.length();
-
-  // before
-  bufferlist newdata;
-  if (dst->length() >= offset) {
-    newdata.substr_of(*dst, 0, offset);
-  } else {
-    newdata.substr_of(*dst, 0, dst->length());
-    bufferptr bp(offset - dst->length());
-    bp.zero();
-    newdata.append(bp);
-  }
-
-  newdata.append(src);
-
-  // after
-  if (dst->length() > offset + len) {
-    bufferlist tail;
-    tail.substr_of(*dst, offset + len, dst->length() - (offset + len));
-    newdata.append(tail);
-  }
-
-  dst->claim(newdata);
-}
-
 int MemStore::_zero(coll_t cid, const ghobject_t& oid,
 		    uint64_t offset, size_t len)
 {
@@ -1084,20 +1061,10 @@ int MemStore::_truncate(coll_t cid, const ghobject_t& oid, uint64_t size)
   ObjectRef o = c->get_object(oid);
   if (!o)
     return -ENOENT;
-  if (o->data.length() > size) {
-    bufferlist bl;
-    bl.substr_of(o->data, 0, size);
-    used_bytes -= o->data.length() - size;
-    o->data.claim(bl);
-  } else if (o->data.length() == size) {
-    // do nothing
-  } else {
-    bufferptr bp(size - o->data.length());
-    bp.zero();
-    used_bytes += bp.length();
-    o->data.append(bp);
-  }
-  return 0;
+  int old_size = o->get_size();
+  int r = o->truncate(size);
+  used_bytes += (o->get_size() - old_size);
+  return r;
 }
 
 int MemStore::_remove(coll_t cid, const ghobject_t& oid)
@@ -1114,7 +1081,7 @@ int MemStore::_remove(coll_t cid, const ghobject_t& oid)
   c->object_map.erase(oid);
   c->object_hash.erase(oid);
 
-  used_bytes -= o->data.length();
+  used_bytes -= o->get_size();
 
   return 0;
 }
@@ -1183,12 +1150,13 @@ int MemStore::_clone(coll_t cid, const ghobject_t& oldoid,
     return -ENOENT;
   ObjectRef no = c->get_object(newoid);
   if (!no) {
-    no.reset(new Object);
+    no = c->create_object();
     c->object_map[newoid] = no;
     c->object_hash[newoid] = no;
   }
-  used_bytes += oo->data.length() - no->data.length();
-  no->data = oo->data;
+  used_bytes += oo->get_size() - no->get_size();
+  no->truncate(0);
+  no->clone(oo.get(), 0, oo->get_size(), 0);
   no->omap_header = oo->omap_header;
   no->omap = oo->omap;
   no->xattr = oo->xattr;
@@ -1213,20 +1181,18 @@ int MemStore::_clone_range(coll_t cid, const ghobject_t& oldoid,
     return -ENOENT;
   ObjectRef no = c->get_object(newoid);
   if (!no) {
-    no.reset(new Object);
+    no = c->create_object();
     c->object_map[newoid] = no;
     c->object_hash[newoid] = no;
   }
-  if (srcoff >= oo->data.length())
+  if (srcoff >= oo->get_size())
     return 0;
-  if (srcoff + len >= oo->data.length())
-    len = oo->data.length() - srcoff;
-  bufferlist bl;
-  bl.substr_of(oo->data, srcoff, len);
+  if (srcoff + len >= oo->get_size())
+    len = oo->get_size() - srcoff;
 
-  int old_size = no->data.length();
-  _write_into_bl(bl, dstoff, &no->data);
-  used_bytes += (no->data.length() - old_size);
+  int old_size = no->get_size();
+  no->clone(oo.get(), srcoff, len, dstoff);
+  used_bytes += (no->get_size() - old_size);
 
   return len;
 }
@@ -1324,7 +1290,7 @@ int MemStore::_create_collection(coll_t cid)
   ceph::unordered_map<coll_t,CollectionRef>::iterator cp = coll_map.find(cid);
   if (cp != coll_map.end())
     return -EEXIST;
-  coll_map[cid].reset(new Collection);
+  coll_map[cid] = new_collection();
   return 0;
 }
 
@@ -1440,3 +1406,187 @@ int MemStore::_split_collection(coll_t cid, uint32_t bits, uint32_t match,
 
   return 0;
 }
+
+
+// ---------------
+// object data
+
+int MemStore::BufferlistObject::read(uint64_t offset, uint64_t len,
+				     bufferlist &bl) const
+{
+  bufferlist sub;
+  sub.substr_of(data, offset, len);
+  bl.claim_append(sub);
+  return len;
+}
+
+int MemStore::BufferlistObject::write(uint64_t offset, const bufferlist &src)
+{
+  unsigned len = src.length();
+
+  // before
+  bufferlist newdata;
+  if (data.length() >= offset) {
+    newdata.substr_of(data, 0, offset);
+  } else {
+    newdata.substr_of(data, 0, data.length());
+    bufferptr bp(offset - data.length());
+    bp.zero();
+    newdata.append(bp);
+  }
+
+  newdata.append(src);
+
+  // after
+  if (data.length() > offset + len) {
+    bufferlist tail;
+    tail.substr_of(data, offset + len, data.length() - (offset + len));
+    newdata.append(tail);
+  }
+
+  data.claim(newdata);
+  return 0;
+}
+
+int MemStore::BufferlistObject::clone(Object *src, uint64_t srcoff,
+				      uint64_t len, uint64_t dstoff)
+{
+  bufferlist bl;
+  src->read(srcoff, len, bl);
+  return write(dstoff, bl);
+}
+
+int MemStore::BufferlistObject::truncate(uint64_t size)
+{
+  if (data.length() > size) {
+    bufferlist bl;
+    bl.substr_of(data, 0, size);
+    data.claim(bl);
+  } else if (data.length() == size) {
+    // do nothing
+  } else {
+    bufferptr bp(size - data.length());
+    bp.zero();
+    data.append(bp);
+  }
+  return 0;
+}
+
+int MemStore::PageSetObject::read(uint64_t offset, uint64_t len,
+				  bufferlist &bl) const
+{
+  uint64_t end = offset + len;
+  uint64_t pos = offset;
+  while (pos < end) {
+    uint64_t index = pos / page_size;
+    unsigned pofs = pos % page_size;
+    unsigned plen = MIN(page_size - pofs, end - pos);
+
+    const bufferptr& page = pages[index];
+    if (page.have_raw()) {
+      // shares the page, a later write will copy it first
+      bl.append(page, pofs, plen);
+    } else {
+      bufferptr bp(plen);
+      bp.zero();
+      bl.append(bp);
+    }
+    pos += plen;
+  }
+  return len;
+}
+
+bufferptr& MemStore::PageSetObject::get_page_for_write(uint64_t index,
+						       bool whole)
+{
+  bufferptr& page = pages[index];
+  if (!page.have_raw()) {
+    page = buffer::create_page_aligned(page_size);
+    if (!whole)
+      page.zero();
+  } else if (page.raw_nref() > 1) {
+    // shared with a clone or a reader, copy on write
+    bufferptr copy(buffer::create_page_aligned(page_size));
+    if (!whole)
+      copy.copy_in(0, page_size, page.c_str());
+    page = copy;
+  }
+  return page;
+}
+
+int MemStore::PageSetObject::write(uint64_t offset, const bufferlist &src)
+{
+  uint64_t len = src.length();
+  uint64_t end = offset + len;
+
+  // the tail of the last page beyond data_len is kept zeroed, so growing
+  // the object only needs more (hole) pages
+  if (end > data_len)
+    pages.resize((end + page_size - 1) / page_size);
+
+  bufferlist::iterator p = const_cast<bufferlist&>(src).begin();
+  uint64_t pos = offset;
+  while (pos < end) {
+    uint64_t index = pos / page_size;
+    unsigned pofs = pos % page_size;
+    unsigned plen = MIN(page_size - pofs, end - pos);
+
+    bufferptr& page = get_page_for_write(index, plen == page_size);
+    p.copy(plen, page.c_str() + pofs);
+    pos += plen;
+  }
+
+  data_len = MAX(data_len, end);
+  return 0;
+}
+
+int MemStore::PageSetObject::clone(Object *src, uint64_t srcoff,
+				   uint64_t len, uint64_t dstoff)
+{
+  PageSetObject *s = dynamic_cast<PageSetObject*>(src);
+  if (!s || s == this || s->page_size != page_size ||
+      srcoff % page_size != dstoff % page_size) {
+    bufferlist bl;
+    src->read(srcoff, len, bl);
+    return write(dstoff, bl);
+  }
+
+  uint64_t end = dstoff + len;
+  if (end > data_len)
+    pages.resize((end + page_size - 1) / page_size);
+
+  // source and destination pages line up, share every full page
+  uint64_t pos = 0;
+  while (pos < len) {
+    uint64_t dindex = (dstoff + pos) / page_size;
+    unsigned pofs = (dstoff + pos) % page_size;
+    unsigned plen = MIN(page_size - pofs, len - pos);
+
+    if (plen == page_size) {
+      pages[dindex] = s->pages[(srcoff + pos) / page_size];
+    } else {
+      bufferlist bl;
+      s->read(srcoff + pos, plen, bl);
+      bufferptr& page = get_page_for_write(dindex, false);
+      bl.copy(0, plen, page.c_str() + pofs);
+    }
+    pos += plen;
+  }
+
+  data_len = MAX(data_len, end);
+  return 0;
+}
+
+int MemStore::PageSetObject::truncate(uint64_t size)
+{
+  pages.resize((size + page_size - 1) / page_size);
+  if (size < data_len) {
+    unsigned pofs = size % page_size;
+    if (pofs && pages.back().have_raw()) {
+      bufferptr& page = get_page_for_write(pages.size() - 1, false);
+      page.zero(pofs, page_size - pofs);
+    }
+  }
+  data_len = size;
+  return 0;
+}
@@ -26,13 +26,24 @@
 class MemStore : public ObjectStore {
 public:
   struct Object {
-    bufferlist data;
     map<string,bufferptr> xattr;
     bufferlist omap_header;
     map<string,bufferlist> omap;
 
+    virtual ~Object() {}
+
+    /// data interface, implemented by the object data layouts below
+    virtual size_t get_size() const = 0;
+    virtual int read(uint64_t offset, uint64_t len, bufferlist &bl) const = 0;
+    virtual int write(uint64_t offset, const bufferlist &bl) = 0;
+    virtual int clone(Object *src, uint64_t srcoff, uint64_t len,
+                      uint64_t dstoff) = 0;
+    virtual int truncate(uint64_t offset) = 0;
+
     void encode(bufferlist& bl) const {
       ENCODE_START(1, 1, bl);
+      bufferlist data;
+      read(0, get_size(), data);
       ::encode(data, bl);
       ::encode(xattr, bl);
       ::encode(omap_header, bl);
@@ -41,14 +52,17 @@ public:
     }
     void decode(bufferlist::iterator& p) {
       DECODE_START(1, p);
+      bufferlist data;
       ::decode(data, p);
+      truncate(0);
+      write(0, data);
       ::decode(xattr, p);
       ::decode(omap_header, p);
       ::decode(omap, p);
       DECODE_FINISH(p);
     }
     void dump(Formatter *f) const {
-      f->dump_int("data_len", data.length());
+      f->dump_int("data_len", get_size());
       f->dump_int("omap_header_len", omap_header.length());
 
       f->open_array_section("xattrs");
@@ -76,11 +90,49 @@ public:
   };
   typedef ceph::shared_ptr<Object> ObjectRef;
 
+  /// object data kept in a single bufferlist
+  struct BufferlistObject : public Object {
+    bufferlist data;
+
+    size_t get_size() const { return data.length(); }
+    int read(uint64_t offset, uint64_t len, bufferlist &bl) const;
+    int write(uint64_t offset, const bufferlist &bl);
+    int clone(Object *src, uint64_t srcoff, uint64_t len, uint64_t dstoff);
+    int truncate(uint64_t offset);
+  };
+
+  /**
+   * object data kept in a vector of fixed size pages
+   *
+   * A write only touches the pages it covers instead of rebuilding the
+   * object's bufferlist. Pages are shared with clones and with bufferlists
+   * handed out by read(), and are copied before they are modified while
+   * shared. A page without a buffer is a hole and reads as zeros.
+   */
+  struct PageSetObject : public Object {
+    uint64_t page_size;
+    uint64_t data_len;
+    vector<bufferptr> pages;
+
+    PageSetObject(uint64_t page_size) : page_size(page_size), data_len(0) {}
+
+    size_t get_size() const { return data_len; }
+    int read(uint64_t offset, uint64_t len, bufferlist &bl) const;
+    int write(uint64_t offset, const bufferlist &bl);
+    int clone(Object *src, uint64_t srcoff, uint64_t len, uint64_t dstoff);
+    int truncate(uint64_t offset);
+
+  private:
+    bufferptr& get_page_for_write(uint64_t index, bool whole);
+  };
+
   struct Collection {
     ceph::unordered_map<ghobject_t, ObjectRef> object_hash;  ///< for lookup
     map<ghobject_t, ObjectRef> object_map;        ///< for iteration
     map<string,bufferptr> xattr;
     RWLock lock;   ///< for object_{map,hash}
+    bool use_page_set;
+    uint64_t page_size;
 
     // NOTE: The lock only needs to protect the object_map/hash, not the
     // contents of individual objects.  The osd is already sequencing
@@ -94,6 +146,12 @@ public:
       return o->second;
     }
 
+    ObjectRef create_object() const {
+      if (use_page_set)
+	return ObjectRef(new PageSetObject(page_size));
+      return ObjectRef(new BufferlistObject);
+    }
+
     void encode(bufferlist& bl) const {
       ENCODE_START(1, 1, bl);
       ::encode(xattr, bl);
@@ -115,7 +173,7 @@ public:
       while (s--) {
 	ghobject_t k;
 	::decode(k, p);
-	ObjectRef o(new Object);
+	ObjectRef o = create_object();
 	o->decode(p);
 	object_map.insert(make_pair(k, o));
 	object_hash.insert(make_pair(k, o));
@@ -128,13 +186,16 @@ public:
       for (map<ghobject_t, ObjectRef>::const_iterator p = object_map.begin();
 	   p != object_map.end();
 	   ++p) {
-        result += p->second->data.length();
+        result += p->second->get_size();
       }
 
       return result;
     }
 
-    Collection() : lock("MemStore::Collection::lock") {}
+    Collection(bool use_page_set, uint64_t page_size)
+      : lock("MemStore::Collection::lock"),
+	use_page_set(use_page_set),
+	page_size(page_size) {}
   };
   typedef ceph::shared_ptr<Collection> CollectionRef;
 
@@ -190,6 +251,7 @@ private:
   Mutex apply_lock;    ///< serialize all updates
 
   CollectionRef get_collection(coll_t cid);
+  CollectionRef new_collection();
 
   Finisher finisher;
 
@@ -197,8 +259,6 @@ private:
 
   void _do_transaction(Transaction& t);
 
-  void _write_into_bl(const bufferlist& src, unsigned offset, bufferlist *dst);
-
   int _touch(coll_t cid, const ghobject_t& oid);
   int _write(coll_t cid, const ghobject_t& oid, uint64_t offset, size_t len,
 	      const bufferlist& bl, uint32_t fadvsie_flags = 0);
@@ -57,6 +57,8 @@ enum {
   l_os_j_wr,
   l_os_j_wr_bytes,
   l_os_j_full,
+  l_os_j_wr_ops,
+  l_os_j_group_wait,
   l_os_omap_cache_shard_flush,
   l_os_fdcache,
   l_os_fdcache_hit,
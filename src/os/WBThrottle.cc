@@ -4,9 +4,14 @@
 #include "acconfig.h"
 
 #include "os/WBThrottle.h"
+#include "common/Clock.h"
 #include "common/perf_counters.h"
 
 WBThrottle::WBThrottle(CephContext *cct, string name) :
+  adaptive(false), target_latency(0),
+  drain_bytes(0), drain_ios(0), flush_lat(0),
+  flush_batch(1), batch_left(0),
+  window_bytes(0), window_ios(0), window_flushes(0),
   cur_ios(0), cur_size(0),
   cct(cct),
   logger(NULL),
@@ -28,10 +33,18 @@ WBThrottle::WBThrottle(CephContext *cct, string name) :
   b.add_u64(l_wbthrottle_ios_wb, "ios_wb");
   b.add_u64(l_wbthrottle_inodes_dirtied, "inodes_dirtied");
   b.add_u64(l_wbthrottle_inodes_wb, "inodes_wb");
+  b.add_time_avg(l_wbthrottle_flush_lat, "flush_lat");
+  b.add_u64(l_wbthrottle_drain_rate, "drain_bytes_per_sec");
+  b.add_u64(l_wbthrottle_bytes_start_flusher, "bytes_start_flusher");
+  b.add_u64(l_wbthrottle_ios_start_flusher, "ios_start_flusher");
+  b.add_u64(l_wbthrottle_flush_batch, "flush_batch");
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
   for (unsigned i = l_wbthrottle_first + 1; i != l_wbthrottle_last; ++i)
     logger->set(i, 0);
+  logger->set(l_wbthrottle_bytes_start_flusher, size_limits.first);
+  logger->set(l_wbthrottle_ios_start_flusher, io_limits.first);
+  logger->set(l_wbthrottle_flush_batch, flush_batch);
 
   cct->_conf->add_observer(this);
 }
@@ -78,6 +91,8 @@ const char** WBThrottle::get_tracked_conf_keys() const
     "filestore_wbthrottle_xfs_ios_hard_limit",
     "filestore_wbthrottle_xfs_inodes_start_flusher",
     "filestore_wbthrottle_xfs_inodes_hard_limit",
+    "filestore_wbthrottle_adaptive",
+    "filestore_wbthrottle_adaptive_target_latency",
     NULL
   };
   return KEYS;
@@ -86,6 +101,24 @@ const char** WBThrottle::get_tracked_conf_keys() const
 void WBThrottle::set_from_conf()
 {
   assert(lock.is_locked());
+  set_limits_from_conf();
+  conf_size_limits = size_limits;
+  conf_io_limits = io_limits;
+  bool was_adaptive = adaptive;
+  adaptive = cct->_conf->filestore_wbthrottle_adaptive;
+  target_latency = cct->_conf->filestore_wbthrottle_adaptive_target_latency;
+  if (adaptive && was_adaptive && drain_bytes > 0) {
+    // keep what was learned, within the new bounds
+    adapt_limits();
+  } else if (!adaptive) {
+    flush_batch = 1;
+    batch_left = 0;
+  }
+  cond.Signal();
+}
+
+void WBThrottle::set_limits_from_conf()
+{
   if (fs == BTRFS) {
     size_limits.first =
       cct->_conf->filestore_wbthrottle_btrfs_bytes_start_flusher;
@@ -115,6 +148,80 @@ void WBThrottle::set_from_conf()
   } else {
     assert(0 == "invalid value for fs");
   }
+}
+
+void WBThrottle::flushed(const PendingWB &wb, utime_t lat)
+{
+  assert(lock.is_locked());
+  cur_ios -= wb.ios;
+  logger->dec(l_wbthrottle_ios_dirtied, wb.ios);
+  logger->inc(l_wbthrottle_ios_wb, wb.ios);
+  cur_size -= wb.size;
+  logger->dec(l_wbthrottle_bytes_dirtied, wb.size);
+  logger->inc(l_wbthrottle_bytes_wb, wb.size);
+  logger->dec(l_wbthrottle_inodes_dirtied);
+  logger->inc(l_wbthrottle_inodes_wb);
+  logger->tinc(l_wbthrottle_flush_lat, lat);
+  if (!adaptive)
+    return;
+  utime_t now = ceph_clock_now(cct);
+  if (window_flushes == 0)
+    window_start = now;
+  window_bytes += wb.size;
+  window_ios += wb.ios;
+  window_busy += lat;
+  window_flushes++;
+  if (now - window_start >= utime_t(1, 0) || window_flushes >= 1000)
+    adapt_limits();
+}
+
+/*
+ * Whatever is dirty when FileStore syncs has to be written back within the
+ * sync, so the start_flusher limits are set to what the flusher measured it
+ * can drain within target_latency.  Rates are measured over the time spent
+ * in fdatasync only, so an idle flusher doesn't look like a slow device.
+ */
+void WBThrottle::adapt_limits()
+{
+  assert(lock.is_locked());
+  if (window_flushes && (double)window_busy > 0) {
+    double busy = (double)window_busy;
+    double bytes_rate = (double)window_bytes / busy;
+    double ios_rate = (double)window_ios / busy;
+    double lat = busy / window_flushes;
+    if (drain_bytes == 0) {
+      drain_bytes = bytes_rate;
+      drain_ios = ios_rate;
+      flush_lat = lat;
+    } else {
+      drain_bytes = 0.7 * drain_bytes + 0.3 * bytes_rate;
+      drain_ios = 0.7 * drain_ios + 0.3 * ios_rate;
+      flush_lat = 0.7 * flush_lat + 0.3 * lat;
+    }
+  }
+  window_bytes = window_ios = 0;
+  window_flushes = 0;
+  window_busy = utime_t();
+  if (drain_bytes == 0)
+    return;
+
+  // never above half the hard limit so writers keep some slack, never so
+  // low that the flusher degenerates into syncing every write
+  size_limits.first = MIN(MAX((uint64_t)(target_latency * drain_bytes),
+			      conf_size_limits.first / 16),
+			  conf_size_limits.second / 2);
+  io_limits.first = MIN(MAX((uint64_t)(target_latency * drain_ios),
+			    conf_io_limits.first / 16),
+			conf_io_limits.second / 2);
+  // flush in batches taking about a quarter of the target, so that the
+  // flusher runs ahead of the writers rather than one object behind them
+  double batch = target_latency / 4 / flush_lat;
+  flush_batch = batch >= 64 ? 64 : (batch < 1 ? 1 : (unsigned)batch);
+
+  logger->set(l_wbthrottle_drain_rate, (uint64_t)drain_bytes);
+  logger->set(l_wbthrottle_bytes_start_flusher, size_limits.first);
+  logger->set(l_wbthrottle_ios_start_flusher, io_limits.first);
+  logger->set(l_wbthrottle_flush_batch, flush_batch);
   cond.Signal();
 }
 
@@ -135,20 +242,25 @@ bool WBThrottle::get_next_should_flush(
 {
   assert(lock.is_locked());
   assert(next);
-  while (!stopping &&
-         cur_ios < io_limits.first &&
-         pending_wbs.size() < fd_limits.first &&
-         cur_size < size_limits.first)
-         cond.Wait(lock);
+  while (!stopping && !should_flush())
+    cond.Wait(lock);
   if (stopping)
     return false;
   assert(!pending_wbs.empty());
+  if (batch_left)
+    --batch_left;
+  else
+    batch_left = flush_batch - 1;
   ghobject_t obj(pop_object());
   
   ceph::unordered_map<ghobject_t, pair<PendingWB, FDRef> >::iterator i =
     pending_wbs.find(obj);
   *next = boost::make_tuple(obj, i->second.second, i->second.first);
   pending_wbs.erase(i);
+  // a batch ends with the objects that were dirty when it started, the
+  // next dirty object waits for the start_flusher limits again
+  if (pending_wbs.empty())
+    batch_left = 0;
   return true;
 }
 
@@ -160,6 +272,7 @@ void *WBThrottle::entry()
   while (get_next_should_flush(&wb)) {
     clearing = wb.get<0>();
     lock.Unlock();
+    utime_t start = ceph_clock_now(cct);
 #ifdef HAVE_FDATASYNC
     ::fdatasync(**wb.get<1>());
 #else
@@ -171,16 +284,10 @@ void *WBThrottle::entry()
       assert(fa_r == 0);
     }
 #endif
+    utime_t lat = ceph_clock_now(cct) - start;
     lock.Lock();
     clearing = ghobject_t();
-    cur_ios -= wb.get<2>().ios;
-    logger->dec(l_wbthrottle_ios_dirtied, wb.get<2>().ios);
-    logger->inc(l_wbthrottle_ios_wb, wb.get<2>().ios);
-    cur_size -= wb.get<2>().size;
-    logger->dec(l_wbthrottle_bytes_dirtied, wb.get<2>().size);
-    logger->inc(l_wbthrottle_bytes_wb, wb.get<2>().size);
-    logger->dec(l_wbthrottle_inodes_dirtied);
-    logger->inc(l_wbthrottle_inodes_wb);
+    flushed(wb.get<2>(), lat);
     cond.Signal();
     wb = boost::tuple<ghobject_t, FDRef, PendingWB>();
   }
@@ -238,6 +345,7 @@ void WBThrottle::clear()
   pending_wbs.clear();
   lru.clear();
   rev_lru.clear();
+  batch_left = 0;
   cond.Signal();
 }
 
@@ -259,6 +367,8 @@ void WBThrottle::clear_object(const ghobject_t &hoid)
 
   pending_wbs.erase(i);
   remove_object(hoid);
+  if (pending_wbs.empty())
+    batch_left = 0;
   cond.Signal();
 }
 
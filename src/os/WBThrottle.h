@@ -35,6 +35,11 @@ enum {
   l_wbthrottle_ios_wb,
   l_wbthrottle_inodes_dirtied,
   l_wbthrottle_inodes_wb,
+  l_wbthrottle_flush_lat,
+  l_wbthrottle_drain_rate,
+  l_wbthrottle_bytes_start_flusher,
+  l_wbthrottle_ios_start_flusher,
+  l_wbthrottle_flush_batch,
   l_wbthrottle_last
 };
 
@@ -42,8 +47,15 @@ enum {
  * WBThrottle
  *
  * Tracks, throttles, and flushes outstanding IO
+ *
+ * In adaptive mode the byte and io start_flusher limits follow the rate
+ * at which the flusher actually drains dirty data, so that what is left
+ * dirty for the next sync can be written back within
+ * filestore_wbthrottle_adaptive_target_latency.  The configured limits
+ * only bound the adapted ones.
  */
 class WBThrottle : Thread, public md_config_obs_t {
+protected:
   ghobject_t clearing;
   /* *_limits.first is the start_flusher limit and
    * *_limits.second is the hard limit
@@ -58,6 +70,31 @@ class WBThrottle : Thread, public md_config_obs_t {
   /// Limits on unflushed objects
   pair<uint64_t, uint64_t> fd_limits;
 
+  /// Configured limits, bounds for the adapted ones
+  pair<uint64_t, uint64_t> conf_size_limits;
+  pair<uint64_t, uint64_t> conf_io_limits;
+
+  bool adaptive;         ///< adapt start_flusher limits, @see adapt_limits
+  double target_latency; ///< seconds to write back what is left dirty
+  double drain_bytes;    ///< bytes/s written back by the flusher, average
+  double drain_ios;      ///< ios/s written back by the flusher, average
+  double flush_lat;      ///< seconds per object flush, average
+  unsigned flush_batch;  ///< objects flushed once the flusher starts
+  unsigned batch_left;   ///< objects left in the current batch
+
+  /// Flushes since the last adapt_limits
+  uint64_t window_bytes;
+  uint64_t window_ios;
+  unsigned window_flushes;
+  utime_t window_busy;  ///< time spent flushing
+  utime_t window_start;
+
+  class PendingWB;
+  /// Account a completed flush, adapt the limits every so often
+  void flushed(const PendingWB &wb, utime_t lat);
+  /// Recompute start_flusher limits and flush_batch from the drain rate
+  void adapt_limits();
+
   uint64_t cur_ios;  /// Currently unflushed IOs
   uint64_t cur_size; /// Currently unflushed bytes
 
@@ -115,6 +152,14 @@ class WBThrottle : Thread, public md_config_obs_t {
 
   ceph::unordered_map<ghobject_t, pair<PendingWB, FDRef> > pending_wbs;
 
+  /// whether the flusher has to flush an object now
+  bool should_flush() const {
+    return (batch_left && !pending_wbs.empty()) ||
+      cur_ios >= io_limits.first ||
+      pending_wbs.size() >= fd_limits.first ||
+      cur_size >= size_limits.first;
+  }
+
   /// get next flush to perform
   bool get_next_should_flush(
     boost::tuple<ghobject_t, FDRef, PendingWB> *next ///< [out] next to flush
@@ -129,6 +174,7 @@ private:
   FS fs;
 
   void set_from_conf();
+  void set_limits_from_conf();
 public:
   WBThrottle(CephContext *cct, string name);
   ~WBThrottle();
@@ -159,9 +159,10 @@ int chain_getxattr(const char *fn, const char *name, void *val, size_t size, int
   if (r >= 0) {
     ret = pos;
     /* is there another chunk? that can happen if the last read size span over
-       exactly one block */
-    if (chunk_size == CHAIN_XATTR_MAX_BLOCK_LEN ||
-	chunk_size == CHAIN_XATTR_SHORT_BLOCK_LEN) {
+       exactly one block.  a short last chunk ends the chain, only a full
+       one needs probing */
+    if (r == CHAIN_XATTR_MAX_BLOCK_LEN ||
+	r == CHAIN_XATTR_SHORT_BLOCK_LEN) {
       get_raw_xattr_name(name, i, raw_name, sizeof(raw_name));
       r = sys_getxattr(fn, raw_name, 0, 0);
       if (r > 0) { // there's another chunk.. the original buffer was too small
@@ -233,9 +234,10 @@ int chain_fgetxattr(int fd, const char *name, void *val, size_t size, int *orig_
   if (r >= 0) {
     ret = pos;
     /* is there another chunk? that can happen if the last read size span over
-       exactly one block */
-    if (chunk_size == CHAIN_XATTR_MAX_BLOCK_LEN ||
-	chunk_size == CHAIN_XATTR_SHORT_BLOCK_LEN) {
+       exactly one block.  a short last chunk ends the chain, only a full
+       one needs probing */
+    if (r == CHAIN_XATTR_MAX_BLOCK_LEN ||
+	r == CHAIN_XATTR_SHORT_BLOCK_LEN) {
       get_raw_xattr_name(name, i, raw_name, sizeof(raw_name));
       r = sys_fgetxattr(fd, raw_name, 0, 0);
       if (r > 0) { // there's another chunk.. the original buffer was too small
@@ -261,6 +263,12 @@ static int get_xattr_block_size(size_t size)
   return CHAIN_XATTR_MAX_BLOCK_LEN;
 }
 
+int chain_xattr_chunks(size_t size)
+{
+  size_t block = get_xattr_block_size(size);
+  return size ? (size + block - 1) / block : 1;
+}
+
 int chain_setxattr(const char *fn, const char *name, const void *val, size_t size, int orig_chunks)
 {
   int i = 0, pos = 0;
@@ -79,5 +79,7 @@ int chain_listxattr(const char *fn, char *names, size_t len, map<string, int> *c
 int chain_flistxattr(int fd, char *names, size_t len, map<string, int> *chunks = NULL);
 int chain_removexattr(const char *fn, const char *name);
 int chain_fremovexattr(int fd, const char *name);
+// number of chunks chain_*setxattr stores a value of size bytes in
+int chain_xattr_chunks(size_t size);
 
 #endif
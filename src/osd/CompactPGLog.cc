@@ -0,0 +1,407 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "CompactPGLog.h"
+
+struct CompactPGLog::MatchObject {
+  const vector<Object> &objs;
+  const hobject_t &oid;
+  MatchObject(const vector<Object> &objs, const hobject_t &oid)
+    : objs(objs), oid(oid) {}
+  bool operator()(uint32_t obj) const {
+    return objs[obj].oid == oid;
+  }
+};
+
+struct CompactPGLog::MatchReqid {
+  const CompactPGLog &log;
+  const osd_reqid_t &reqid;
+  MatchReqid(const CompactPGLog &log, const osd_reqid_t &reqid)
+    : log(log), reqid(reqid) {}
+  bool operator()(uint64_t seq) const {
+    return log.at(seq).reqid_is(reqid);
+  }
+};
+
+struct CompactPGLog::MatchSeq {
+  uint64_t seq;
+  MatchSeq(uint64_t seq) : seq(seq) {}
+  bool operator()(uint64_t s) const {
+    return s == seq;
+  }
+};
+
+struct CompactPGLog::MatchExtraReqid {
+  const osd_reqid_t &reqid;
+  uint64_t seq;      ///< 0 for any record
+  MatchExtraReqid(const osd_reqid_t &reqid, uint64_t seq = 0)
+    : reqid(reqid), seq(seq) {}
+  bool operator()(const ExtraReqid &e) const {
+    return e.reqid == reqid && (seq == 0 || e.seq == seq);
+  }
+};
+
+static bool is_indexed_op(uint8_t op)
+{
+  return op == pg_log_entry_t::MODIFY || op == pg_log_entry_t::DELETE;
+}
+
+CompactPGLog::CompactPGLog(uint32_t chunk_size)
+  : chunk_size(chunk_size),
+    tail_seq(1),
+    head_seq(1),
+    first_chunk(0)
+{}
+
+CompactPGLog::~CompactPGLog()
+{
+  free_chunks_before(first_chunk + chunks.size());
+}
+
+size_t CompactPGLog::find_object(const hobject_t &oid) const
+{
+  MatchObject m(objs, oid);
+  return objects.find(probe_hash(oid), m);
+}
+
+uint32_t CompactPGLog::get_object(const hobject_t &oid)
+{
+  size_t pos = find_object(oid);
+  if (pos != ProbeTable<uint32_t>::npos) {
+    uint32_t obj = objects.at(pos);
+    ++objs[obj].refs;
+    return obj;
+  }
+  uint32_t obj;
+  if (free_objs.empty()) {
+    obj = objs.size();
+    objs.push_back(Object());
+  } else {
+    obj = free_objs.back();
+    free_objs.pop_back();
+  }
+  objs[obj].oid = oid;
+  objs[obj].refs = 1;
+  objs[obj].latest = 0;
+  objects.insert(probe_hash(oid), obj);
+  return obj;
+}
+
+void CompactPGLog::put_object(uint32_t obj)
+{
+  Object &o = objs[obj];
+  assert(o.refs > 0);
+  if (--o.refs > 0)
+    return;
+  size_t pos = find_object(o.oid);
+  assert(pos != ProbeTable<uint32_t>::npos);
+  objects.erase(pos);
+  o = Object();
+  free_objs.push_back(obj);
+}
+
+void CompactPGLog::grow_ring()
+{
+  vector<Record> old;
+  old.swap(ring);
+  ring.resize(old.empty() ? 16 : old.size() * 2);
+  for (uint64_t seq = tail_seq; seq < head_seq; ++seq)
+    at(seq) = old[seq & (old.size() - 1)];
+}
+
+void CompactPGLog::encode_extra(const pg_log_entry_t &e, Record *r)
+{
+  if (!e.mod_desc.can_rollback())
+    r->flags |= FLAG_UNROLLBACKABLE;
+  if (e.reverting_to == eversion_t() &&
+      e.snaps.length() == 0 &&
+      (e.mod_desc.empty() || !e.mod_desc.can_rollback()) &&
+      e.extra_reqids.empty() &&
+      !e.has_dirty_extents)
+    return;
+
+  bufferlist bl;
+  ::encode(e.reverting_to, bl);
+  ::encode(e.snaps, bl);
+  ::encode(e.mod_desc, bl);
+  ::encode(e.extra_reqids, bl);
+  ::encode(e.has_dirty_extents, bl);
+  ::encode(e.dirty_extents, bl);
+
+  uint32_t len = bl.length();
+  if (chunks.empty() || chunks.back().len - chunks.back().used < len) {
+    uint32_t clen = std::max(chunk_size, len);
+    chunks.push_back(Chunk(new char[clen], clen));
+  }
+  Chunk &c = chunks.back();
+  bl.copy(0, len, c.data + c.used);
+  r->flags |= FLAG_EXTRA;
+  r->extra_chunk = first_chunk + chunks.size() - 1;
+  r->extra_off = c.used;
+  r->extra_len = len;
+  c.used += len;
+}
+
+void CompactPGLog::free_chunks_before(uint32_t chunk)
+{
+  while (first_chunk < chunk && !chunks.empty()) {
+    delete[] chunks.front().data;
+    chunks.pop_front();
+    ++first_chunk;
+  }
+}
+
+void CompactPGLog::decode_extra(const Record &r, pg_log_entry_t *e) const
+{
+  assert(r.flags & FLAG_EXTRA);
+  assert(r.extra_chunk >= first_chunk);
+  const Chunk &c = chunks[r.extra_chunk - first_chunk];
+  bufferlist bl;
+  bl.append(c.data + r.extra_off, r.extra_len);
+  bufferlist::iterator p = bl.begin();
+  ::decode(e->reverting_to, p);
+  ::decode(e->snaps, p);
+  ::decode(e->mod_desc, p);
+  ::decode(e->extra_reqids, p);
+  ::decode(e->has_dirty_extents, p);
+  ::decode(e->dirty_extents, p);
+}
+
+void CompactPGLog::decode(uint64_t seq, pg_log_entry_t *e) const
+{
+  assert(seq >= tail_seq && seq < head_seq);
+  const Record &r = at(seq);
+  *e = pg_log_entry_t(r.op, objs[r.obj].oid, r.version, r.prior_version,
+		      r.user_version, r.get_reqid(), r.mtime);
+  e->invalid_hash = r.flags & FLAG_INVALID_HASH;
+  e->invalid_pool = r.flags & FLAG_INVALID_POOL;
+  if (r.flags & FLAG_EXTRA)
+    decode_extra(r, e);
+  else if (r.flags & FLAG_UNROLLBACKABLE)
+    e->mod_desc.mark_unrollbackable();
+}
+
+void CompactPGLog::add(const pg_log_entry_t &e)
+{
+  assert(e.version > head);
+  if (size() + 1 > ring.size())
+    grow_ring();
+
+  uint64_t seq = head_seq;
+  Record &r = at(seq);
+  r = Record();
+  r.version = e.version;
+  r.prior_version = e.prior_version;
+  r.user_version = e.user_version;
+  r.mtime = e.mtime;
+  r.reqid_type = e.reqid.name.type();
+  r.reqid_num = e.reqid.name.num();
+  r.reqid_tid = e.reqid.tid;
+  r.reqid_inc = e.reqid.inc;
+  r.op = e.op;
+  if (e.invalid_hash)
+    r.flags |= FLAG_INVALID_HASH;
+  if (e.invalid_pool)
+    r.flags |= FLAG_INVALID_POOL;
+  encode_extra(e, &r);
+
+  r.obj = get_object(e.soid);
+  Object &o = objs[r.obj];
+  r.prev = o.latest;
+  o.latest = seq;
+
+  ++head_seq;
+  head = e.version;
+
+  if (e.reqid_is_indexed()) {
+    MatchReqid m(*this, e.reqid);
+    uint32_t h = probe_hash(e.reqid);
+    size_t pos = caller_ops.find(h, m);
+    if (pos != ProbeTable<uint64_t>::npos)
+      caller_ops.at(pos) = seq;
+    else
+      caller_ops.insert(h, seq);
+  }
+  for (vector<pair<osd_reqid_t, version_t> >::const_iterator j =
+	 e.extra_reqids.begin();
+       j != e.extra_reqids.end();
+       ++j) {
+    extra_caller_ops.insert(probe_hash(j->first),
+			    ExtraReqid(j->first, j->second, seq));
+  }
+}
+
+void CompactPGLog::unindex(uint64_t seq)
+{
+  const Record &r = at(seq);
+  osd_reqid_t reqid = r.get_reqid();
+  if (reqid != osd_reqid_t() && is_indexed_op(r.op)) {
+    MatchSeq m(seq);
+    size_t pos = caller_ops.find(probe_hash(reqid), m);
+    if (pos != ProbeTable<uint64_t>::npos)
+      caller_ops.erase(pos);
+  }
+  if (r.flags & FLAG_EXTRA) {
+    pg_log_entry_t e;
+    decode_extra(r, &e);
+    for (vector<pair<osd_reqid_t, version_t> >::const_iterator j =
+	   e.extra_reqids.begin();
+	 j != e.extra_reqids.end();
+	 ++j) {
+      MatchExtraReqid m(j->first, seq);
+      size_t pos = extra_caller_ops.find(probe_hash(j->first), m);
+      if (pos != ProbeTable<ExtraReqid>::npos)
+	extra_caller_ops.erase(pos);
+    }
+  }
+  // records go from the tail, if this was the newest of its object it
+  // was also the last one
+  if (objs[r.obj].latest == seq)
+    objs[r.obj].latest = 0;
+  put_object(r.obj);
+}
+
+void CompactPGLog::trim(eversion_t s)
+{
+  while (!empty()) {
+    const Record &r = at(tail_seq);
+    if (r.version > s)
+      break;
+    unindex(tail_seq);
+    if (r.flags & FLAG_EXTRA)
+      free_chunks_before(r.extra_chunk);
+    ++tail_seq;
+  }
+  if (empty())
+    free_chunks_before(first_chunk + chunks.size());
+}
+
+void CompactPGLog::clear()
+{
+  vector<Record>().swap(ring);
+  tail_seq = head_seq = 1;
+  head = eversion_t();
+  vector<Object>().swap(objs);
+  vector<uint32_t>().swap(free_objs);
+  objects.clear();
+  caller_ops.clear();
+  extra_caller_ops.clear();
+  free_chunks_before(first_chunk + chunks.size());
+}
+
+void CompactPGLog::get_entry(size_t i, pg_log_entry_t *e) const
+{
+  assert(i < size());
+  decode(tail_seq + i, e);
+}
+
+void CompactPGLog::get_entries(list<pg_log_entry_t> *ls) const
+{
+  for (uint64_t seq = tail_seq; seq < head_seq; ++seq) {
+    ls->push_back(pg_log_entry_t());
+    decode(seq, &ls->back());
+  }
+}
+
+bool CompactPGLog::get_latest(const hobject_t &oid, pg_log_entry_t *e) const
+{
+  size_t pos = find_object(oid);
+  if (pos == ProbeTable<uint32_t>::npos)
+    return false;
+  decode(objs[objects.at(pos)].latest, e);
+  return true;
+}
+
+bool CompactPGLog::logged_req(const osd_reqid_t &r) const
+{
+  uint32_t h = probe_hash(r);
+  MatchReqid m(*this, r);
+  if (caller_ops.find(h, m) != ProbeTable<uint64_t>::npos)
+    return true;
+  MatchExtraReqid me(r);
+  return extra_caller_ops.find(h, me) != ProbeTable<ExtraReqid>::npos;
+}
+
+bool CompactPGLog::get_request(
+  const osd_reqid_t &r,
+  eversion_t *replay_version,
+  version_t *user_version) const
+{
+  assert(replay_version);
+  assert(user_version);
+  uint32_t h = probe_hash(r);
+  MatchReqid m(*this, r);
+  size_t pos = caller_ops.find(h, m);
+  if (pos != ProbeTable<uint64_t>::npos) {
+    const Record &rec = at(caller_ops.at(pos));
+    *replay_version = rec.version;
+    *user_version = rec.user_version;
+    return true;
+  }
+
+  // as with IndexedLog, *a* request for this reqid, not necessarily the
+  // most recent
+  MatchExtraReqid me(r);
+  pos = extra_caller_ops.find(h, me);
+  if (pos != ProbeTable<ExtraReqid>::npos) {
+    const ExtraReqid &e = extra_caller_ops.at(pos);
+    *replay_version = at(e.seq).version;
+    *user_version = e.user_version;
+    return true;
+  }
+  return false;
+}
+
+void CompactPGLog::get_object_reqids(
+  const hobject_t &oid, unsigned max,
+  vector<pair<osd_reqid_t, version_t> > *pls) const
+{
+  size_t pos = find_object(oid);
+  if (pos == ProbeTable<uint32_t>::npos)
+    return;
+  for (uint64_t seq = objs[objects.at(pos)].latest;
+       seq >= tail_seq;
+       seq = at(seq).prev) {
+    const Record &r = at(seq);
+    osd_reqid_t reqid = r.get_reqid();
+    if (reqid != osd_reqid_t() && is_indexed_op(r.op))
+      pls->push_back(make_pair(reqid, r.user_version));
+    if (r.flags & FLAG_EXTRA) {
+      pg_log_entry_t e;
+      decode_extra(r, &e);
+      pls->insert(pls->end(), e.extra_reqids.begin(), e.extra_reqids.end());
+    }
+    if (pls->size() >= max) {
+      if (pls->size() > max)
+	pls->resize(max);
+      return;
+    }
+  }
+}
+
+size_t CompactPGLog::get_memory_usage() const
+{
+  size_t bytes = ring.capacity() * sizeof(Record) +
+    objs.capacity() * sizeof(Object) +
+    free_objs.capacity() * sizeof(uint32_t) +
+    objects.get_memory_usage() +
+    caller_ops.get_memory_usage() +
+    extra_caller_ops.get_memory_usage();
+  for (vector<Object>::const_iterator p = objs.begin(); p != objs.end(); ++p) {
+    if (p->refs)
+      bytes += p->oid.oid.name.capacity() + p->oid.nspace.capacity() +
+	p->oid.get_key().capacity();
+  }
+  for (deque<Chunk>::const_iterator p = chunks.begin(); p != chunks.end(); ++p)
+    bytes += p->len;
+  return bytes;
+}
@@ -0,0 +1,185 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_COMPACT_PG_LOG_H
+#define CEPH_COMPACT_PG_LOG_H
+
+#include "include/assert.h"
+#include "osd_types.h"
+#include "ProbeTable.h"
+
+#include <deque>
+#include <list>
+#include <vector>
+
+/**
+ * CompactPGLog - the entries of a pg log, packed for memory
+ *
+ * Entries are kept in a ring of fixed size records, oldest first, and
+ * numbered from 1 as they are added.  A record refers to its object by
+ * an index into a table of the objects in the log, so each object name
+ * is held once however many entries it has.  The fields most entries
+ * leave empty (reverting_to, snaps, a rollbackable mod_desc,
+ * extra_reqids and dirty_extents) are encoded into an arena of large
+ * chunks, which are freed in order as the tail is trimmed.
+ *
+ * Objects and reqids are looked up in ProbeTables, as in
+ * PGLog::IndexedLog, and give the same answers.  The on-disk and wire
+ * formats of the log are unchanged, entries are rebuilt as
+ * pg_log_entry_t on the way out.  The OSD still keeps the entries in
+ * the list of IndexedLog, which PG and the backends iterate over.
+ */
+class CompactPGLog {
+  enum {
+    FLAG_EXTRA = 1,          ///< has fields encoded in the arena
+    FLAG_UNROLLBACKABLE = 2, ///< mod_desc was marked unrollbackable
+    FLAG_INVALID_HASH = 4,
+    FLAG_INVALID_POOL = 8,
+  };
+
+  struct Record {
+    eversion_t version, prior_version;
+    version_t user_version;
+    utime_t mtime;
+    int64_t reqid_num;
+    ceph_tid_t reqid_tid;
+    int32_t reqid_inc;
+    uint32_t obj;            ///< index into objs
+    uint64_t prev;           ///< previous record of obj, 0 if none
+    uint32_t extra_chunk;    ///< number of the arena chunk of the extra fields
+    uint32_t extra_off, extra_len;
+    uint8_t reqid_type;
+    uint8_t op;
+    uint8_t flags;
+    Record()
+      : user_version(0), reqid_num(0), reqid_tid(0), reqid_inc(0),
+	obj(0), prev(0), extra_chunk(0), extra_off(0), extra_len(0),
+	reqid_type(0), op(0), flags(0) {}
+
+    osd_reqid_t get_reqid() const {
+      return osd_reqid_t(entity_name_t(reqid_type, reqid_num), reqid_inc,
+			 reqid_tid);
+    }
+    bool reqid_is(const osd_reqid_t &r) const {
+      return r.tid == reqid_tid && r.name.num() == reqid_num &&
+	r.inc == reqid_inc && r.name.type() == reqid_type;
+    }
+  };
+
+  struct Object {
+    hobject_t oid;
+    uint64_t latest;         ///< its newest record
+    uint32_t refs;           ///< its records in the log, 0 if unused
+    Object() : latest(0), refs(0) {}
+  };
+
+  struct ExtraReqid {
+    osd_reqid_t reqid;
+    version_t user_version;
+    uint64_t seq;
+    ExtraReqid() : user_version(0), seq(0) {}
+    ExtraReqid(const osd_reqid_t &r, version_t uv, uint64_t seq)
+      : reqid(r), user_version(uv), seq(seq) {}
+  };
+
+  struct Chunk {
+    char *data;
+    uint32_t len, used;
+    Chunk(char *data, uint32_t len) : data(data), len(len), used(0) {}
+  };
+
+  struct MatchObject;
+  struct MatchReqid;
+  struct MatchExtraReqid;
+  struct MatchSeq;
+
+  uint32_t chunk_size;
+
+  std::vector<Record> ring;   ///< power of two, record seq is at seq & mask
+  uint64_t tail_seq;          ///< oldest record
+  uint64_t head_seq;          ///< next record to add
+  eversion_t head;
+
+  std::vector<Object> objs;
+  std::vector<uint32_t> free_objs;
+  ProbeTable<uint32_t> objects;            ///< hobject_t -> objs index
+  ProbeTable<uint64_t> caller_ops;         ///< reqid -> its newest record
+  ProbeTable<ExtraReqid> extra_caller_ops;
+
+  std::deque<Chunk> chunks;
+  uint32_t first_chunk;       ///< number of chunks.front()
+
+  Record &at(uint64_t seq) {
+    return ring[seq & (ring.size() - 1)];
+  }
+  const Record &at(uint64_t seq) const {
+    return ring[seq & (ring.size() - 1)];
+  }
+
+  size_t find_object(const hobject_t &oid) const;
+  uint32_t get_object(const hobject_t &oid);
+  void put_object(uint32_t obj);
+
+  void grow_ring();
+  void encode_extra(const pg_log_entry_t &e, Record *r);
+  void free_chunks_before(uint32_t chunk);
+  void decode_extra(const Record &r, pg_log_entry_t *e) const;
+  void decode(uint64_t seq, pg_log_entry_t *e) const;
+  void unindex(uint64_t seq);
+
+public:
+  explicit CompactPGLog(uint32_t chunk_size = 65536);
+  ~CompactPGLog();
+
+  size_t size() const {
+    return head_seq - tail_seq;
+  }
+  bool empty() const {
+    return head_seq == tail_seq;
+  }
+  /// distinct objects with entries in the log
+  size_t get_num_objects() const {
+    return objects.size();
+  }
+  const eversion_t &get_head() const {
+    return head;
+  }
+
+  /// add e at the head, its version must be newer than any logged
+  void add(const pg_log_entry_t &e);
+  /// drop the entries up to and including s
+  void trim(eversion_t s);
+  void clear();
+
+  /// the i-th entry, oldest first
+  void get_entry(size_t i, pg_log_entry_t *e) const;
+  void get_entries(std::list<pg_log_entry_t> *ls) const;
+
+  bool logged_object(const hobject_t &oid) const {
+    return find_object(oid) != ProbeTable<uint32_t>::npos;
+  }
+  /// the newest entry of oid, false if it has none
+  bool get_latest(const hobject_t &oid, pg_log_entry_t *e) const;
+  bool logged_req(const osd_reqid_t &r) const;
+  /// @see PGLog::IndexedLog::get_request
+  bool get_request(const osd_reqid_t &r,
+		   eversion_t *replay_version,
+		   version_t *user_version) const;
+  /// @see PGLog::IndexedLog::get_object_reqids
+  void get_object_reqids(const hobject_t &oid, unsigned max,
+			 vector<pair<osd_reqid_t, version_t> > *pls) const;
+
+  /// bytes of heap held, including the object names
+  size_t get_memory_usage() const;
+};
+
+#endif
@@ -103,7 +103,8 @@ ostream &operator<<(ostream &lhs, const ECBackend::ReadOp &rhs)
 	     << ", priority=" << rhs.priority
 	     << ", obj_to_source=" << rhs.obj_to_source
 	     << ", source_to_obj=" << rhs.source_to_obj
-	     << ", in_progress=" << rhs.in_progress << ")";
+	     << ", in_progress=" << rhs.in_progress
+	     << ", do_redundant_reads=" << rhs.do_redundant_reads << ")";
 }
 
 void ECBackend::ReadOp::dump(Formatter *f) const
@@ -118,6 +119,7 @@ void ECBackend::ReadOp::dump(Formatter *f) const
   f->dump_stream("obj_to_source") << obj_to_source;
   f->dump_stream("source_to_obj") << source_to_obj;
   f->dump_stream("in_progress") << in_progress;
+  f->dump_bool("do_redundant_reads", do_redundant_reads);
 }
 
 ostream &operator<<(ostream &lhs, const ECBackend::Op &rhs)
@@ -479,7 +481,7 @@ void ECBackend::continue_recovery_op(
       set<pg_shard_t> to_read;
       uint64_t recovery_max_chunk = get_recovery_chunk_size();
       int r = get_min_avail_to_read_shards(
-	op.hoid, want, true, &to_read);
+	op.hoid, want, true, false, &to_read);
       if (r != 0) {
 	// we must have lost a recovery source
 	assert(!op.recovery_progress.first);
@@ -675,6 +677,14 @@ bool ECBackend::handle_message(
   }
   case MSG_OSD_EC_READ: {
     MOSDECSubOpRead *op = static_cast<MOSDECSubOpRead*>(_op->get_req());
+    if (cct->_conf->osd_debug_inject_ec_sub_read_delay > 0) {
+      dout(0) << __func__ << ": injecting a "
+	      << cct->_conf->osd_debug_inject_ec_sub_read_delay
+	      << "s sub read delay" << dendl;
+      utime_t delay;
+      delay.set_from_double(cct->_conf->osd_debug_inject_ec_sub_read_delay);
+      delay.sleep();
+    }
     MOSDECSubOpReadReply *reply = new MOSDECSubOpReadReply;
     reply->pgid = get_parent()->primary_spg_t();
     reply->map_epoch = get_parent()->get_epoch();
@@ -1014,16 +1024,88 @@ shard_to_read_map.find(from);
 
   assert(rop.in_progress.count(from));
   rop.in_progress.erase(from);
-  if (!rop.in_progress.empty()) {
-    dout(10) << __func__ << " readop not complete: " << rop << dendl;
-  } else {
+  if (rop.do_redundant_reads && check_redundant_reads(rop)) {
+    dout(10) << __func__ << " readop decodable, not waiting for "
+	     << rop.in_progress << ": " << rop << dendl;
+    complete_read_op(rop, m);
+  } else if (rop.in_progress.empty()) {
     dout(10) << __func__ << " readop complete: " << rop << dendl;
     complete_read_op(rop, m);
+  } else {
+    dout(10) << __func__ << " readop not complete: " << rop << dendl;
+  }
+}
+
+bool ECBackend::check_redundant_reads(ReadOp &rop)
+{
+  map<hobject_t, set<int> > need;
+  for (map<hobject_t, read_result_t>::iterator i = rop.complete.begin();
+       i != rop.complete.end();
+       ++i) {
+    assert(rop.to_read.count(i->first));
+    if (rop.to_read.find(i->first)->second.want_attrs && !i->second.attrs)
+      return false;
+    set<int> have;
+    if (!i->second.returned.empty()) {
+      for (map<pg_shard_t, bufferlist>::iterator j =
+	     i->second.returned.front().get<2>().begin();
+	   j != i->second.returned.front().get<2>().end();
+	   ++j)
+	have.insert(j->first.shard);
+    }
+    if (ec_impl->minimum_to_decode(rop.want_to_read[i->first], have,
+				   &need[i->first]) < 0)
+      return false;
   }
+
+  // drop the shards past those needed, and the errors of the shards
+  // we won't wait for, as if only the minimum had been read
+  for (map<hobject_t, read_result_t>::iterator i = rop.complete.begin();
+       i != rop.complete.end();
+       ++i) {
+    const set<int> &n = need[i->first];
+    for (list<boost::tuple<
+	   uint64_t, uint64_t, map<pg_shard_t, bufferlist> > >::iterator j =
+	   i->second.returned.begin();
+	 j != i->second.returned.end();
+	 ++j) {
+      map<pg_shard_t, bufferlist> &bufs = j->get<2>();
+      for (map<pg_shard_t, bufferlist>::iterator k = bufs.begin();
+	   k != bufs.end(); ) {
+	if (n.count(k->first.shard))
+	  ++k;
+	else
+	  bufs.erase(k++);
+      }
+    }
+    i->second.errors.clear();
+    i->second.r = 0;
+
+    set<int> all, min;
+    for (set<pg_shard_t>::iterator j = rop.obj_to_source[i->first].begin();
+	 j != rop.obj_to_source[i->first].end();
+	 ++j)
+      all.insert(j->shard);
+    if (ec_impl->minimum_to_decode(rop.want_to_read[i->first], all, &min) == 0 &&
+	min != n)
+      get_parent()->get_logger()->inc(l_osd_ec_fast_read_redundant);
+  }
+  return true;
 }
 
 void ECBackend::complete_read_op(ReadOp &rop, RecoveryMessages *m)
 {
+  // replies still due to a fast read are dropped when they arrive
+  for (set<pg_shard_t>::iterator i = rop.in_progress.begin();
+       i != rop.in_progress.end();
+       ++i) {
+    map<pg_shard_t, set<ceph_tid_t> >::iterator siter =
+      shard_to_read_map.find(*i);
+    assert(siter != shard_to_read_map.end());
+    siter->second.erase(rop.tid);
+    get_parent()->get_logger()->inc(l_osd_ec_fast_read_discarded);
+  }
+  rop.in_progress.clear();
   map<hobject_t, read_request_t>::iterator reqiter =
     rop.to_read.begin();
   map<hobject_t, read_result_t>::iterator resiter =
@@ -1303,17 +1385,17 @@ void ECBackend::submit_transaction(
   dout(10) << "onreadable_sync: " << op->on_local_applied_sync << dendl;
 }
 
-int ECBackend::get_min_avail_to_read_shards(
+void ECBackend::get_all_avail_shards(
   const hobject_t &hoid,
-  const set<int> &want,
   bool for_recovery,
-  set<pg_shard_t> *to_read)
+  set<int> *_have,
+  map<shard_id_t, pg_shard_t> *_shards)
 {
   map<hobject_t, set<pg_shard_t> >::const_iterator miter =
     get_parent()->get_missing_loc_shards().find(hoid);
 
-  set<int> have;
-  map<shard_id_t, pg_shard_t> shards;
+  set<int> &have = *_have;
+  map<shard_id_t, pg_shard_t> &shards = *_shards;
 
   for (set<pg_shard_t>::const_iterator i =
 	 get_parent()->get_acting_shards().begin();
@@ -1363,12 +1445,27 @@ int ECBackend::get_min_avail_to_read_shards(
       }
     }
   }
+}
+
+int ECBackend::get_min_avail_to_read_shards(
+  const hobject_t &hoid,
+  const set<int> &want,
+  bool for_recovery,
+  bool do_redundant_reads,
+  set<pg_shard_t> *to_read)
+{
+  set<int> have;
+  map<shard_id_t, pg_shard_t> shards;
+  get_all_avail_shards(hoid, for_recovery, &have, &shards);
 
   set<int> need;
   int r = ec_impl->minimum_to_decode(want, have, &need);
   if (r < 0)
     return r;
 
+  if (do_redundant_reads)
+    need.swap(have);
+
   if (!to_read)
     return 0;
 
@@ -1384,7 +1481,9 @@ int ECBackend::get_min_avail_to_read_shards(
 void ECBackend::start_read_op(
   int priority,
   map<hobject_t, read_request_t> &to_read,
-  OpRequestRef _op)
+  OpRequestRef _op,
+  bool do_redundant_reads,
+  const map<hobject_t, set<int> > &want_to_read)
 {
   ceph_tid_t tid = get_parent()->get_tid();
   assert(!tid_to_read_map.count(tid));
@@ -1393,6 +1492,8 @@ void ECBackend::start_read_op(
   op.tid = tid;
   op.to_read.swap(to_read);
   op.op = _op;
+  op.do_redundant_reads = do_redundant_reads;
+  op.want_to_read = want_to_read;
   dout(10) << __func__ << ": starting " << op << dendl;
 
   map<pg_shard_t, ECSubRead> messages;
@@ -1694,11 +1795,14 @@ void ECBackend::objects_read_async(
     int chunk = (int)chunk_mapping.size() > i ? chunk_mapping[i] : i;
     want_to_read.insert(chunk);
   }
+  bool fast_read =
+    get_parent()->get_pool().has_flag(pg_pool_t::FLAG_EC_FAST_READ);
   set<pg_shard_t> shards;
   int r = get_min_avail_to_read_shards(
     hoid,
     want_to_read,
     false,
+    fast_read,
     &shards);
   assert(r == 0);
 
@@ -1713,10 +1817,17 @@ void ECBackend::objects_read_async(
 	false,
 	c)));
 
+  map<hobject_t, set<int> > want;
+  if (fast_read) {
+    want[hoid] = want_to_read;
+    get_parent()->get_logger()->inc(l_osd_ec_fast_read);
+  }
   start_read_op(
     CEPH_MSG_PRIO_DEFAULT,
     for_read_op,
-    OpRequestRef());
+    OpRequestRef(),
+    fast_read,
+    want);
   return;
 }
 
@@ -1759,15 +1870,24 @@ void ECBackend::rollback_append(
 void ECBackend::be_deep_scrub(
   const hobject_t &poid,
   uint32_t seed,
+  const object_info_t *oi,
   ScrubMap::object &o,
   ThreadPool::TPHandle &handle) {
   bufferhash h(-1); // we always used -1
-  int r;
+  int r = 0;
   uint64_t stride = cct->_conf->osd_deep_scrub_stride;
   if (stride % sinfo.get_chunk_size())
     stride += sinfo.get_chunk_size() - (stride % sinfo.get_chunk_size());
   uint64_t pos = 0;
-  while (true) {
+  if (oi) {
+    // the shard is unchanged since the last deep scrub, trust its hash
+    // info and only check it against the size on disk
+    dout(20) << __func__ << " " << poid << " unchanged since "
+	     << oi->version << ", not reading it" << dendl;
+    pos = o.size;
+    get_parent()->get_logger()->inc(l_osd_deep_scrub_objects_skipped);
+  }
+  while (!oi) {
     bufferlist bl;
     handle.reset_tp_timeout();
     r = store->read(
@@ -1788,6 +1908,8 @@ void ECBackend::be_deep_scrub(
     if ((unsigned)r < stride)
       break;
   }
+  if (!oi)
+    get_parent()->get_logger()->inc(l_osd_deep_scrub_bytes, pos);
 
   if (r == -EIO) {
     dout(0) << "_scan_list  " << poid << " got "
@@ -1801,7 +1923,8 @@ void ECBackend::be_deep_scrub(
     o.read_error = true;
     o.digest_present = false;
   } else {
-    if (hinfo->get_chunk_hash(get_parent()->whoami_shard().shard) != h.digest()) {
+    if (!oi &&
+	hinfo->get_chunk_hash(get_parent()->whoami_shard().shard) != h.digest()) {
       dout(0) << "_scan_list  " << poid << " got incorrect hash on read" << dendl;
       o.read_error = true;
     }
@@ -294,11 +294,21 @@ public:
     void dump(Formatter *f) const;
 
     set<pg_shard_t> in_progress;
+
+    /// reads go to every available shard and the op completes as soon
+    /// as want_to_read of each object can be decoded (fast read)
+    bool do_redundant_reads;
+    map<hobject_t, set<int> > want_to_read;
+
+    ReadOp() : priority(0), tid(0), do_redundant_reads(false) {}
   };
   friend struct FinishReadOp;
   void filter_read_op(
     const OSDMapRef osdmap,
     ReadOp &op);
+  /// true if every object of rop can be decoded from the shards returned
+  /// so far, in which case the results are trimmed to the shards used
+  bool check_redundant_reads(ReadOp &rop);
   void complete_read_op(ReadOp &rop, RecoveryMessages *m);
   friend ostream &operator<<(ostream &lhs, const ReadOp &rhs);
   map<ceph_tid_t, ReadOp> tid_to_read_map;
@@ -306,7 +316,10 @@ public:
   void start_read_op(
     int priority,
     map<hobject_t, read_request_t> &to_read,
-    OpRequestRef op);
+    OpRequestRef op,
+    bool do_redundant_reads = false,
+    const map<hobject_t, set<int> > &want_to_read =
+      map<hobject_t, set<int> >());
 
 
   /**
@@ -448,11 +461,20 @@ public:
     ErasureCodeInterfaceRef ec_impl,
     uint64_t stripe_width);
 
+  /// Gets the shards holding hoid
+  void get_all_avail_shards(
+    const hobject_t &hoid,     ///< [in] object
+    bool for_recovery,         ///< [in] true if we may use non-acting replicas
+    set<int> *have,            ///< [out] shard ids available
+    map<shard_id_t, pg_shard_t> *shards ///< [out] where they are
+    );
+
   /// Returns to_read replicas sufficient to reconstruct want
   int get_min_avail_to_read_shards(
     const hobject_t &hoid,     ///< [in] object
     const set<int> &want,      ///< [in] desired shards
     bool for_recovery,         ///< [in] true if we may use non-acting replicas
+    bool do_redundant_reads,   ///< [in] true to read every available shard
     set<pg_shard_t> *to_read   ///< [out] shards to read
     ); ///< @return error code, 0 on success
 
@@ -470,6 +492,7 @@ public:
   void be_deep_scrub(
     const hobject_t &obj,
     uint32_t seed,
+    const object_info_t *oi,
     ScrubMap::object &o,
     ThreadPool::TPHandle &handle);
   uint64_t be_get_ondisk_size(uint64_t logical_size) {
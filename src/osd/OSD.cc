@@ -118,6 +118,7 @@
 #include "global/pidfile.h"
 
 #include "include/color.h"
+#include "include/str_list.h"
 #include "perfglue/cpu_profiler.h"
 #include "perfglue/heap_profiler.h"
 
@@ -215,9 +216,9 @@ OSDService::OSDService(OSD *osd) :
   scrubs_active(0),
   agent_lock("OSD::agent_lock"),
   agent_valid_iterator(false),
+  agent_queue_pgs(0),
   agent_ops(0),
   agent_active(true),
-  agent_thread(this),
   agent_stop_flag(false),
   agent_timer_lock("OSD::agent_timer_lock"),
   agent_timer(osd->client_messenger->cct, agent_timer_lock),
@@ -478,7 +479,11 @@ void OSDService::init()
   watch_timer.init();
   agent_timer.init();
 
-  agent_thread.create();
+  for (int i = 0; i < MAX(1, g_conf->osd_agent_threads); ++i) {
+    AgentThread *t = new AgentThread(this);
+    t->create();
+    agent_threads.push_back(t);
+  }
 }
 
 void OSDService::activate_map()
@@ -488,7 +493,7 @@ void OSDService::activate_map()
   agent_active =
     !osdmap->test_flag(CEPH_OSDMAP_NOTIERAGENT) &&
     osd->is_active();
-  agent_cond.Signal();
+  agent_cond.SignalAll();
   agent_lock.Unlock();
 }
 
@@ -501,12 +506,45 @@ public:
   }
 };
 
+/*
+ * The agent threads take turns over the pgs of the highest priority.
+ * A pg is worked on by one thread at a time; a thread finding them all
+ * taken helps with a pg of a lower priority instead.
+ */
+PGRef OSDService::_agent_next_pg()
+{
+  set<PGRef>& top = agent_queue.rbegin()->second;
+  if (!agent_valid_iterator || agent_queue_pos == top.end()) {
+    agent_queue_pos = top.begin();
+    agent_valid_iterator = true;
+  }
+  for (unsigned i = 0; i < top.size(); ++i) {
+    if (agent_queue_pos == top.end())
+      agent_queue_pos = top.begin();
+    PGRef pg = *agent_queue_pos++;
+    if (!agent_busy_pgs.count(pg))
+      return pg;
+  }
+  map<uint64_t, set<PGRef> >::reverse_iterator p = agent_queue.rbegin();
+  for (++p; p != agent_queue.rend(); ++p) {
+    for (set<PGRef>::iterator q = p->second.begin();
+	 q != p->second.end();
+	 ++q) {
+      if (!agent_busy_pgs.count(*q))
+	return *q;
+    }
+  }
+  return PGRef();
+}
+
 void OSDService::agent_entry()
 {
   dout(10) << __func__ << " start" << dendl;
   agent_lock.Lock();
 
   while (!agent_stop_flag) {
+    osd->logger->set(l_osd_agent_queue_pgs, agent_queue_pgs);
+    osd->logger->set(l_osd_agent_ops, agent_ops);
     if (agent_queue.empty()) {
       dout(20) << __func__ << " empty queue" << dendl;
       agent_cond.Wait(agent_lock);
@@ -518,6 +556,7 @@ void OSDService::agent_entry()
 	     << " tiers " << agent_queue.size()
 	     << ", top is " << level
 	     << " with pgs " << top.size()
+	     << ", busy pgs " << agent_busy_pgs.size()
 	     << ", ops " << agent_ops << "/"
 	     << g_conf->osd_agent_max_ops
 	     << (agent_active ? " active" : " NOT ACTIVE")
@@ -529,14 +568,26 @@ void OSDService::agent_entry()
       continue;
     }
 
-    if (!agent_valid_iterator || agent_queue_pos == top.end()) {
-      agent_queue_pos = top.begin();
-      agent_valid_iterator = true;
+    PGRef pg = _agent_next_pg();
+    if (!pg) {
+      dout(20) << __func__ << " all pgs taken" << dendl;
+      agent_cond.Wait(agent_lock);
+      continue;
     }
-    PGRef pg = *agent_queue_pos;
-    int max = g_conf->osd_agent_max_ops - agent_ops;
+    agent_busy_pgs.insert(pg);
+    // reserve a share of the free ops so the other agent threads can work
+    // on other pgs; the flushes we start count twice until we give it back
+    int max = MIN(g_conf->osd_agent_max_ops - agent_ops,
+		  MAX(1, g_conf->osd_agent_max_ops /
+			  MAX(1, g_conf->osd_agent_threads)));
+    agent_ops += max;
+    agent_lock.Unlock();
+    bool worked = pg->agent_work(max);
+    agent_lock.Lock();
+    agent_ops -= max;
+    agent_cond.SignalAll();
     agent_lock.Unlock();
-    if (!pg->agent_work(max)) {
+    if (!worked) {
       dout(10) << __func__ << " " << pg->get_pgid()
 	<< " no agent_work, delay for " << g_conf->osd_agent_delay_time
 	<< " seconds" << dendl;
@@ -549,6 +600,8 @@ void OSDService::agent_entry()
       agent_timer_lock.Unlock();
     }
     agent_lock.Lock();
+    agent_busy_pgs.erase(pg);
+    agent_cond.SignalAll();
   }
   agent_lock.Unlock();
   dout(10) << __func__ << " finish" << dendl;
@@ -569,9 +622,15 @@ void OSDService::agent_stop()
     }
 
     agent_stop_flag = true;
-    agent_cond.Signal();
+    agent_cond.SignalAll();
   }
-  agent_thread.join();
+  for (vector<AgentThread*>::iterator p = agent_threads.begin();
+       p != agent_threads.end();
+       ++p) {
+    (*p)->join();
+    delete *p;
+  }
+  agent_threads.clear();
 }
 
 // -------------------------------------
@@ -1965,6 +2024,7 @@ int OSD::init()
 
   service.init();
   service.publish_map(osdmap);
+  op_shardedwq.update_pool_throttles(osdmap);
   service.publish_superblock(superblock);
 
   osd_lock.Unlock();
@@ -2170,6 +2230,9 @@ void OSD::create_logger()
   osd_plb.add_u64_counter(l_osd_pull,      "pull");       // pull requests sent
   osd_plb.add_u64_counter(l_osd_push,      "push");       // push messages
   osd_plb.add_u64_counter(l_osd_push_outb, "push_out_bytes");  // pushed bytes
+  osd_plb.add_u64_counter(l_osd_push_partial, "push_partial");  // objects pushed as their dirty extents
+  osd_plb.add_u64_counter(l_osd_push_partial_saved_bytes, "push_partial_saved_bytes");  // bytes not pushed thanks to it
+  osd_plb.add_u64_counter(l_osd_push_partial_fallback, "push_partial_fallback");  // partial pushes redone whole
 
   osd_plb.add_u64_counter(l_osd_push_in,    "push_in");        // inbound push messages
   osd_plb.add_u64_counter(l_osd_push_inb,   "push_in_bytes");  // inbound pushed bytes
@@ -2197,6 +2260,17 @@ void OSD::create_logger()
 
   osd_plb.add_u64_counter(l_osd_copyfrom, "copyfrom");
 
+  osd_plb.add_u64_counter(l_osd_ec_fast_read, "ec_fast_read");
+  osd_plb.add_u64_counter(l_osd_ec_fast_read_redundant, "ec_fast_read_redundant");
+  osd_plb.add_u64_counter(l_osd_ec_fast_read_discarded, "ec_fast_read_discarded");
+
+  osd_plb.add_u64_counter(l_osd_chain_repop, "chain_repop");   // repops sent down a replica chain
+  osd_plb.add_u64_counter(l_osd_chain_repop_forward, "chain_repop_forward");   // ... and passed on by a replica
+
+  osd_plb.add_u64_counter(l_osd_deep_scrub_objects, "deep_scrub_objects");   // objects deep scrubbed
+  osd_plb.add_u64_counter(l_osd_deep_scrub_objects_skipped, "deep_scrub_objects_skipped");   // ... whose data was not read
+  osd_plb.add_u64_counter(l_osd_deep_scrub_bytes, "deep_scrub_bytes");   // data read by deep scrub
+
   osd_plb.add_u64_counter(l_osd_tier_promote, "tier_promote");
   osd_plb.add_u64_counter(l_osd_tier_flush, "tier_flush");
   osd_plb.add_u64_counter(l_osd_tier_flush_fail, "tier_flush_fail");
@@ -2213,6 +2287,10 @@ void OSD::create_logger()
   osd_plb.add_u64_counter(l_osd_agent_skip, "agent_skip");
   osd_plb.add_u64_counter(l_osd_agent_flush, "agent_flush");
   osd_plb.add_u64_counter(l_osd_agent_evict, "agent_evict");
+  osd_plb.add_u64_counter(l_osd_agent_flush_bytes, "agent_flush_bytes");   // bytes of the objects the agent flushed
+  osd_plb.add_u64_counter(l_osd_agent_evict_bytes, "agent_evict_bytes");   // ... and evicted
+  osd_plb.add_u64(l_osd_agent_queue_pgs, "agent_queue_pgs");   // pgs with agent work
+  osd_plb.add_u64(l_osd_agent_ops, "agent_ops");   // agent flushes in flight
 
   osd_plb.add_u64_counter(l_osd_object_ctx_cache_hit, "object_ctx_cache_hit");
   osd_plb.add_u64_counter(l_osd_object_ctx_cache_total, "object_ctx_cache_total");
@@ -2328,6 +2406,7 @@ int OSD::shutdown()
   clear_pg_stat_queue();
   
   // finish ops
+  op_shardedwq.clear_pool_throttles();
   op_shardedwq.drain(); // should already be empty except for lagard PGs
   {
     Mutex::Locker l(finished_lock);
@@ -4019,9 +4098,16 @@ void OSD::tick()
 
   check_ops_in_flight();
 
-  // adjust the dynamic mode recovery throttle based on client io rate
-  if (rec_throttle.enabled())
-    adjust_recovery_throttle();
+  // adjust the dynamic mode recovery and pool throttles based on client io rate
+  bool rec_dynamic = rec_throttle.enabled() &&
+    rec_throttle.get_mode() == THROTTLE_MODE_DYNAMIC;
+  if (rec_dynamic || op_shardedwq.has_dynamic_pool_throttles()) {
+    int64_t client_bw, client_iops;
+    get_client_io_rate(&client_bw, &client_iops);
+    if (rec_dynamic)
+      adjust_recovery_throttle(client_bw, client_iops);
+    op_shardedwq.adjust_pool_throttles(client_bw * 1024, client_iops);
+  }
 
   tick_timer.add_event_after(1.0, new C_Tick(this));
 }
@@ -6317,12 +6403,11 @@ void OSD::handle_osd_map(MOSDMap *m)
       t.write(META_COLL, oid, 0, bl.length(), bl);
       pin_map_inc_bl(e, bl);
 
+      // build on the previous epoch, sharing what the incremental
+      // leaves alone with it
       OSDMap *o = new OSDMap;
-      if (e > 1) {
-	bufferlist obl;
-	get_map_bl(e - 1, obl);
-	o->decode(obl);
-      }
+      if (e > 1)
+	o->share_from(*get_map(e - 1));
 
       OSDMap::Incremental inc;
       bufferlist::iterator p = bl.begin();
@@ -6848,6 +6933,7 @@ void OSD::consume_map()
   service.pre_publish_map(osdmap);
   service.await_reserved_maps();
   service.publish_map(osdmap);
+  op_shardedwq.update_pool_throttles(osdmap);
 
   dispatch_sessions_waiting_on_map();
 
@@ -8384,19 +8470,19 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb )
   ShardData* sdata = shard_list[shard_index];
   assert(NULL != sdata);
   sdata->sdata_op_ordering_lock.Lock();
-  if (sdata->pqueue.empty()) {
+  if (sdata->pqueue->empty()) {
     sdata->sdata_op_ordering_lock.Unlock();
     osd->cct->get_heartbeat_map()->reset_timeout(hb, 4, 0);
     sdata->sdata_lock.Lock();
     sdata->sdata_cond.WaitInterval(osd->cct, sdata->sdata_lock, utime_t(2, 0));
     sdata->sdata_lock.Unlock();
     sdata->sdata_op_ordering_lock.Lock();
-    if(sdata->pqueue.empty()) {
+    if(sdata->pqueue->empty()) {
       sdata->sdata_op_ordering_lock.Unlock();
       return;
     }
   }
-  pair<PGRef, OpRequestRef> item = sdata->pqueue.dequeue();
+  pair<PGRef, OpRequestRef> item = sdata->pqueue->dequeue();
   sdata->pg_for_processing[&*(item.first)].push_back(item.second);
   sdata->sdata_op_ordering_lock.Unlock();
   ThreadPool::TPHandle tp_handle(osd->cct, hb, timeout_interval, 
@@ -8451,6 +8537,14 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb )
 }
 
 void OSD::ShardedOpWQ::_enqueue(const pair<PGRef, OpRequestRef> &item) {
+  if (num_pool_throttles.read() &&
+      item.second->get_req()->get_type() == CEPH_MSG_OSD_OP &&
+      _throttle_op(item))
+    return;
+  _enqueue_op(item);
+}
+
+void OSD::ShardedOpWQ::_enqueue_op(const pair<PGRef, OpRequestRef> &item) {
 
   uint32_t shard_index = (((item.first)->get_pgid().ps())% shard_list.size());
 
@@ -8461,10 +8555,10 @@ void OSD::ShardedOpWQ::_enqueue(const pair<PGRef, OpRequestRef> &item) {
   sdata->sdata_op_ordering_lock.Lock();
  
   if (priority >= CEPH_MSG_PRIO_LOW)
-    sdata->pqueue.enqueue_strict(
+    sdata->pqueue->enqueue_strict(
       item.second->get_req()->get_source_inst(), priority, item);
   else
-    sdata->pqueue.enqueue(item.second->get_req()->get_source_inst(),
+    sdata->pqueue->enqueue(item.second->get_req()->get_source_inst(),
       priority, cost, item);
   sdata->sdata_op_ordering_lock.Unlock();
 
@@ -8492,19 +8586,19 @@ void OSD::ShardedOpWQ::_enqueue_front(const pair<PGRef, OpRequestRef> &item) {
     unsigned priority = item.second->get_req()->get_priority();
     unsigned cost = item.second->get_req()->get_cost();
     if (priority >= CEPH_MSG_PRIO_LOW)
-      sdata->pqueue.enqueue_strict_front(
+      sdata->pqueue->enqueue_strict_front(
         item.second->get_req()->get_source_inst(),priority, item);
     else
-      sdata->pqueue.enqueue_front(item.second->get_req()->get_source_inst(),
+      sdata->pqueue->enqueue_front(item.second->get_req()->get_source_inst(),
         priority, cost, item);
   } else {
     unsigned priority = new_item.second->get_req()->get_priority();
     unsigned cost = new_item.second->get_req()->get_cost();
     if (priority >= CEPH_MSG_PRIO_LOW)
-      sdata->pqueue.enqueue_strict_front(
+      sdata->pqueue->enqueue_strict_front(
         new_item.second->get_req()->get_source_inst(),priority, new_item);
     else
-      sdata->pqueue.enqueue_front(new_item.second->get_req()->get_source_inst(),
+      sdata->pqueue->enqueue_front(new_item.second->get_req()->get_source_inst(),
         priority, cost, new_item);
   }
 
@@ -8515,6 +8609,372 @@ void OSD::ShardedOpWQ::_enqueue_front(const pair<PGRef, OpRequestRef> &item) {
 
 }
 
+/*
+ * NOTE: increase the limits of a dynamic mode throttle after 3 consecutive
+ * calls with the client io below its threshold, reset them after 3 above.
+ */
+static void adjust_dynamic_throttle(LeakyBucketThrottle *throttle,
+				    bool below_threshold,
+				    uint64_t *count_below_threshold,
+				    uint64_t *count_above_threshold)
+{
+  if (below_threshold) {
+    (*count_below_threshold)++;
+    // reset above threshold count and increase bucket after 3 consecutive below threshold
+    if (*count_below_threshold >= 3) {
+      *count_above_threshold = 0;
+      throttle->increase_bucket_average();
+    }
+  } else {
+    // reset below threshold count every time above threshold
+    *count_below_threshold = 0;
+    (*count_above_threshold)++;
+    if (*count_above_threshold >= 3)
+      throttle->reset_bucket_average();
+  }
+}
+
+/// bytes a client op reads or writes, as the pool throttles count them
+static uint64_t client_op_bytes(MOSDOp *m)
+{
+  m->finish_decode();
+  uint64_t bytes = m->get_cost();
+  for (vector<OSDOp>::iterator p = m->ops.begin(); p != m->ops.end(); ++p) {
+    if (ceph_osd_op_mode_read(p->op.op) && ceph_osd_op_uses_extent(p->op.op))
+      bytes += p->op.extent.length;
+  }
+  return bytes;
+}
+
+/*
+ * NOTE: returns true if the pool of the client op is throttled, in which
+ * case the op is either parked or enqueued with pool_throttle_lock held so
+ * that it can't overtake the ops parked before it.
+ */
+bool OSD::ShardedOpWQ::_throttle_op(const pair<PGRef, OpRequestRef> &item)
+{
+  Mutex::Locker l(pool_throttle_lock);
+  map<int64_t, PoolThrottle*>::iterator p =
+    pool_throttles.find(item.first->get_pgid().pool());
+  if (p == pool_throttles.end())
+    return false;
+  PoolThrottle *pt = p->second;
+  if (!pt->waiting.empty() || pt->throttle->schedule_timer(false)) {
+    pt->waiting.push_back(make_pair(ceph_clock_now(osd->cct), item));
+    pt->logger->inc(l_osd_pt_throttled);
+    pt->logger->set(l_osd_pt_waiting, pt->waiting.size());
+    return true;
+  }
+  uint64_t bytes = client_op_bytes(static_cast<MOSDOp*>(item.second->get_req()));
+  pt->throttle->account(bytes);
+  pt->logger->inc(l_osd_pt_admitted);
+  pt->logger->inc(l_osd_pt_admitted_bytes, bytes);
+  _enqueue_op(item);
+  return true;
+}
+
+/*
+ * NOTE: enqueue the ops parked on pt as long as its throttle lets them
+ * through, the throttle timer is armed again for the rest.  Called with
+ * pool_throttle_lock held.
+ */
+void OSD::ShardedOpWQ::_admit_throttled_ops(PoolThrottle *pt,
+					     bool release_timer_wait)
+{
+  assert(pool_throttle_lock.is_locked());
+  utime_t now = ceph_clock_now(osd->cct);
+  while (!pt->waiting.empty()) {
+    if (pt->throttle->schedule_timer(release_timer_wait))
+      break;
+    release_timer_wait = false;
+    pair<utime_t, pair<PGRef, OpRequestRef> > &front = pt->waiting.front();
+    uint64_t bytes =
+      client_op_bytes(static_cast<MOSDOp*>(front.second.second->get_req()));
+    pt->throttle->account(bytes);
+    pt->logger->inc(l_osd_pt_admitted);
+    pt->logger->inc(l_osd_pt_admitted_bytes, bytes);
+    pt->logger->tinc(l_osd_pt_wait, now - front.first);
+    _enqueue_op(front.second);
+    pt->waiting.pop_front();
+  }
+  // nothing left to wait for, release the timer wait of the throttle
+  if (pt->waiting.empty() && release_timer_wait)
+    pt->throttle->schedule_timer(true);
+  pt->logger->set(l_osd_pt_waiting, pt->waiting.size());
+}
+
+void OSD::ShardedOpWQ::process_throttled_ops(int64_t pool)
+{
+  Mutex::Locker l(pool_throttle_lock);
+  map<int64_t, PoolThrottle*>::iterator p = pool_throttles.find(pool);
+  // the throttle may be torn down while its timer fired
+  if (p == pool_throttles.end())
+    return;
+  _admit_throttled_ops(p->second, true);
+}
+
+/*
+ * NOTE: the pool throttle is in dynamic mode when a *_max setting is
+ * above its base setting, so that the limits grow up to it while the
+ * client io on the osd stays below osd_pool_client_throttle_*_threshold.
+ */
+LeakyBucketThrottle *OSD::ShardedOpWQ::create_pool_throttle(
+  int64_t pool, const pg_pool_t &p)
+{
+  CephContext *cct = osd->cct;
+  LeakyBucketThrottle *throttle = new LeakyBucketThrottle(cct, 0);
+  if (p.client_throttle_ops_max > p.client_throttle_ops ||
+      p.client_throttle_bps_max > p.client_throttle_bps) {
+    throttle->config_mode(THROTTLE_MODE_DYNAMIC);
+    throttle->config_client_threshold(
+      cct->_conf->osd_pool_client_throttle_bw_threshold,
+      cct->_conf->osd_pool_client_throttle_ops_threshold);
+    if (p.client_throttle_ops)
+      throttle->config(THROTTLE_OPS_TOTAL, p.client_throttle_ops,
+		       MAX(p.client_throttle_ops, p.client_throttle_ops_max));
+    if (p.client_throttle_bps)
+      throttle->config(THROTTLE_BPS_TOTAL, p.client_throttle_bps,
+		       MAX(p.client_throttle_bps, p.client_throttle_bps_max));
+  }
+  if (!throttle->enabled()) {
+    // static mode, or dynamic mode without client thresholds
+    throttle->config_mode(THROTTLE_MODE_STATIC);
+    if (p.client_throttle_ops)
+      throttle->config(THROTTLE_OPS_TOTAL, p.client_throttle_ops, 0);
+    if (p.client_throttle_bps)
+      throttle->config(THROTTLE_BPS_TOTAL, p.client_throttle_bps, 0);
+  }
+  assert(throttle->enabled());
+  throttle->attach_context(new PoolThrottleContext(this, pool));
+  return throttle;
+}
+
+PerfCounters *OSD::ShardedOpWQ::create_pool_throttle_logger(int64_t pool)
+{
+  char name[64];
+  snprintf(name, sizeof(name), "osd-pool-throttle-%lld", (long long)pool);
+  PerfCountersBuilder b(osd->cct, name, l_osd_pt_first, l_osd_pt_last);
+  b.add_u64_counter(l_osd_pt_admitted, "admitted");    // client ops let through
+  b.add_u64_counter(l_osd_pt_admitted_bytes, "admitted_bytes");
+  b.add_u64_counter(l_osd_pt_throttled, "throttled");  // client ops parked
+  b.add_u64(l_osd_pt_waiting, "waiting");              // client ops parked now
+  b.add_time_avg(l_osd_pt_wait, "wait");               // time parked
+  b.add_u64(l_osd_pt_ops_limit, "ops_limit");          // current ops/s limit
+  b.add_u64(l_osd_pt_bps_limit, "bps_limit");          // current bytes/s limit
+  PerfCounters *logger = b.create_perf_counters();
+  osd->cct->get_perfcounters_collection()->add(logger);
+  return logger;
+}
+
+static void set_pool_throttle_limits(PerfCounters *logger,
+				     LeakyBucketThrottle *throttle)
+{
+  map<BucketType, LeakyBucket> buckets;
+  throttle->get_config(buckets);
+  logger->set(l_osd_pt_ops_limit, buckets[THROTTLE_OPS_TOTAL].avg);
+  logger->set(l_osd_pt_bps_limit, buckets[THROTTLE_BPS_TOTAL].avg);
+}
+
+void OSD::ShardedOpWQ::update_pool_throttles(OSDMapRef osdmap)
+{
+  list<LeakyBucketThrottle*> old_throttles;
+  list<PoolThrottle*> removed;
+  {
+    Mutex::Locker l(pool_throttle_lock);
+    const map<int64_t, pg_pool_t> &pools = osdmap->get_pools();
+
+    for (map<int64_t, PoolThrottle*>::iterator p = pool_throttles.begin();
+	 p != pool_throttles.end(); ) {
+      map<int64_t, pg_pool_t>::const_iterator q = pools.find(p->first);
+      if (q != pools.end() && q->second.has_client_throttle()) {
+	++p;
+	continue;
+      }
+      PoolThrottle *pt = p->second;
+      lgeneric_dout(osd->cct, 10) << __func__ << " pool " << p->first
+				  << " no longer throttled, releasing "
+				  << pt->waiting.size() << " ops" << dendl;
+      for (list<pair<utime_t, pair<PGRef, OpRequestRef> > >::iterator i =
+	     pt->waiting.begin(); i != pt->waiting.end(); ++i)
+	_enqueue_op(i->second);
+      pt->waiting.clear();
+      removed.push_back(pt);
+      pool_throttles.erase(p++);
+    }
+
+    for (map<int64_t, pg_pool_t>::const_iterator q = pools.begin();
+	 q != pools.end(); ++q) {
+      const pg_pool_t &pi = q->second;
+      if (!pi.has_client_throttle())
+	continue;
+      PoolThrottle *&pt = pool_throttles[q->first];
+      if (!pt) {
+	pt = new PoolThrottle;
+	pt->logger = create_pool_throttle_logger(q->first);
+      } else if (pt->ops == pi.client_throttle_ops &&
+		 pt->bps == pi.client_throttle_bps &&
+		 pt->ops_max == pi.client_throttle_ops_max &&
+		 pt->bps_max == pi.client_throttle_bps_max) {
+	continue;
+      } else {
+	old_throttles.push_back(pt->throttle);
+      }
+      lgeneric_dout(osd->cct, 10) << __func__ << " pool " << q->first
+				  << " client_throttle "
+				  << pi.client_throttle_ops << "/"
+				  << pi.client_throttle_ops_max << " ops "
+				  << pi.client_throttle_bps << "/"
+				  << pi.client_throttle_bps_max << " bps" << dendl;
+      pt->ops = pi.client_throttle_ops;
+      pt->bps = pi.client_throttle_bps;
+      pt->ops_max = pi.client_throttle_ops_max;
+      pt->bps_max = pi.client_throttle_bps_max;
+      pt->count_above_threshold = pt->count_below_threshold = 0;
+      pt->throttle = create_pool_throttle(q->first, pi);
+      set_pool_throttle_limits(pt->logger, pt->throttle);
+      // the old throttle timer is gone with it
+      _admit_throttled_ops(pt, false);
+    }
+    num_pool_throttles.set(pool_throttles.size());
+  }
+
+  // their timer callbacks take pool_throttle_lock
+  for (list<LeakyBucketThrottle*>::iterator p = old_throttles.begin();
+       p != old_throttles.end(); ++p)
+    delete *p;
+  for (list<PoolThrottle*>::iterator p = removed.begin();
+       p != removed.end(); ++p) {
+    delete (*p)->throttle;
+    osd->cct->get_perfcounters_collection()->remove((*p)->logger);
+    delete (*p)->logger;
+    delete *p;
+  }
+}
+
+void OSD::ShardedOpWQ::clear_pool_throttles()
+{
+  list<PoolThrottle*> removed;
+  {
+    Mutex::Locker l(pool_throttle_lock);
+    for (map<int64_t, PoolThrottle*>::iterator p = pool_throttles.begin();
+	 p != pool_throttles.end(); ++p) {
+      PoolThrottle *pt = p->second;
+      for (list<pair<utime_t, pair<PGRef, OpRequestRef> > >::iterator i =
+	     pt->waiting.begin(); i != pt->waiting.end(); ++i)
+	_enqueue_op(i->second);
+      pt->waiting.clear();
+      removed.push_back(pt);
+    }
+    pool_throttles.clear();
+    num_pool_throttles.set(0);
+  }
+  for (list<PoolThrottle*>::iterator p = removed.begin();
+       p != removed.end(); ++p) {
+    delete (*p)->throttle;
+    osd->cct->get_perfcounters_collection()->remove((*p)->logger);
+    delete (*p)->logger;
+    delete *p;
+  }
+}
+
+bool OSD::ShardedOpWQ::has_dynamic_pool_throttles()
+{
+  if (!num_pool_throttles.read())
+    return false;
+  Mutex::Locker l(pool_throttle_lock);
+  for (map<int64_t, PoolThrottle*>::iterator p = pool_throttles.begin();
+       p != pool_throttles.end(); ++p) {
+    if (p->second->throttle->get_mode() == THROTTLE_MODE_DYNAMIC)
+      return true;
+  }
+  return false;
+}
+
+void OSD::ShardedOpWQ::adjust_pool_throttles(int64_t client_bw,
+					      int64_t client_iops)
+{
+  md_config_t *conf = osd->cct->_conf;
+  bool below_threshold =
+    client_bw <= (int64_t)conf->osd_pool_client_throttle_bw_threshold &&
+    client_iops <= (int64_t)conf->osd_pool_client_throttle_ops_threshold;
+  Mutex::Locker l(pool_throttle_lock);
+  for (map<int64_t, PoolThrottle*>::iterator p = pool_throttles.begin();
+       p != pool_throttles.end(); ++p) {
+    PoolThrottle *pt = p->second;
+    if (pt->throttle->get_mode() != THROTTLE_MODE_DYNAMIC)
+      continue;
+    adjust_dynamic_throttle(pt->throttle, below_threshold,
+			    &pt->count_below_threshold,
+			    &pt->count_above_threshold);
+    set_pool_throttle_limits(pt->logger, pt->throttle);
+  }
+}
+
+void OSD::ShardedOpWQ::OpClassifier::set_pool_qos(const string &s)
+{
+  map<int64_t, MClockOpQueue::ClientInfo> qos;
+  list<string> ls;
+  get_str_list(s, ",", ls);
+  for (list<string>::iterator i = ls.begin(); i != ls.end(); ++i) {
+    long long pool;
+    double res, lim, wgt;
+    char c;
+    if (sscanf(i->c_str(), "%lld:%lf:%lf:%lf%c", &pool, &res, &lim, &wgt, &c) != 4 ||
+	pool < 0 || res < 0 || lim < 0 || wgt < 0) {
+      lgeneric_derr(cct) << "osd_op_queue_mclock_pool_qos: ignoring '" << *i
+		 << "', expected <pool id>:<res>:<lim>:<wgt>" << dendl;
+      continue;
+    }
+    qos[pool] = MClockOpQueue::ClientInfo(res, lim, wgt);
+  }
+  RWLock::WLocker l(lock);
+  pool_qos.swap(qos);
+}
+
+uint64_t OSD::ShardedOpWQ::OpClassifier::classify(
+  const entity_inst_t &cl,
+  const pair<PGRef, OpRequestRef> &item,
+  MClockOpQueue::ClientInfo *info)
+{
+  // op type in the top byte, the pool below for client ops
+  enum { CLIENT_OP, OSD_SUBOP, RECOVERY, SCRUB };
+  md_config_t *conf = cct->_conf;
+  switch (item.second->get_req()->get_type()) {
+  case CEPH_MSG_OSD_OP:
+    {
+      int64_t pool = item.first->get_pgid().pool();
+      RWLock::RLocker l(lock);
+      map<int64_t, MClockOpQueue::ClientInfo>::iterator p = pool_qos.find(pool);
+      if (p != pool_qos.end())
+	*info = p->second;
+      else
+	*info = MClockOpQueue::ClientInfo(conf->osd_op_queue_mclock_client_op_res,
+					  conf->osd_op_queue_mclock_client_op_lim,
+					  conf->osd_op_queue_mclock_client_op_wgt);
+      return ((uint64_t)CLIENT_OP << 56) | (uint64_t)pool;
+    }
+  case MSG_OSD_PG_PUSH:
+  case MSG_OSD_PG_PULL:
+  case MSG_OSD_PG_PUSH_REPLY:
+  case MSG_OSD_PG_SCAN:
+  case MSG_OSD_PG_BACKFILL:
+    *info = MClockOpQueue::ClientInfo(conf->osd_op_queue_mclock_recovery_res,
+				      conf->osd_op_queue_mclock_recovery_lim,
+				      conf->osd_op_queue_mclock_recovery_wgt);
+    return (uint64_t)RECOVERY << 56;
+  case MSG_OSD_REP_SCRUB:
+    *info = MClockOpQueue::ClientInfo(conf->osd_op_queue_mclock_scrub_res,
+				      conf->osd_op_queue_mclock_scrub_lim,
+				      conf->osd_op_queue_mclock_scrub_wgt);
+    return (uint64_t)SCRUB << 56;
+  default:
+    *info = MClockOpQueue::ClientInfo(conf->osd_op_queue_mclock_osd_subop_res,
+				      conf->osd_op_queue_mclock_osd_subop_lim,
+				      conf->osd_op_queue_mclock_osd_subop_wgt);
+    return (uint64_t)OSD_SUBOP << 56;
+  }
+}
+
 
 /*
  * NOTE: dequeue called in worker thread, with pg lock
@@ -8678,6 +9138,7 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_recovery_throttle_ops",
     "osd_recovery_throttle_ops_max",
     "osd_recovery_throttle_ops_client_threshold",
+    "osd_op_queue_mclock_pool_qos",
     NULL
   };
   return KEYS;
@@ -8719,6 +9180,9 @@ void OSD::handle_conf_change(const struct md_config_t *conf,
       changed.count("clog_to_syslog_facility")) {
     update_log_config();
   }
+  if (changed.count("osd_op_queue_mclock_pool_qos")) {
+    op_shardedwq.set_pool_qos(cct->_conf->osd_op_queue_mclock_pool_qos);
+  }
   bool enabled_pre = rec_throttle.enabled();
   if (changed.count("osd_recovery_throttle_mode")) {
     rec_throttle.config_mode(cct->_conf->osd_recovery_throttle_mode);
@@ -8989,45 +9453,42 @@ void OSD::get_object_stats_sum(object_stat_collection_t &stat_sum)
   }
 }
 
+/*
+ * NOTE: the rough client io rate of this OSD since the last call, client_bw
+ * in KB/s.
+ */
+void OSD::get_client_io_rate(int64_t *client_bw, int64_t *client_iops)
+{
+  object_stat_collection_t object_stats_sum;
+  get_object_stats_sum(object_stats_sum);
+  utime_t ts = ceph_clock_now(cct);
+  *client_bw = *client_iops = 0;
+  if (!last_object_stats_sum.is_zero()) {
+    object_stat_collection_t delta_sum = object_stats_sum;
+    delta_sum.sub(last_object_stats_sum);
+    delta_sum.floor(0);
+    utime_t delta_ts = ts - last_object_stats_sum_ts;
+    *client_bw = (delta_sum.sum.num_rd_kb + delta_sum.sum.num_wr_kb) / delta_ts;
+    *client_iops = (delta_sum.sum.num_rd + delta_sum.sum.num_wr) / (double)delta_ts;
+  }
+  last_object_stats_sum = object_stats_sum;
+  last_object_stats_sum_ts = ts;
+}
+
 /*
  * NOTE: adjust the recovery throttle in dynamic mode
  */
-void OSD::adjust_recovery_throttle()
+void OSD::adjust_recovery_throttle(int64_t client_bw, int64_t client_iops)
 {
   dout(20) << __func__ << " recovery throttle mode is "
            << rec_throttle.get_mode() << dendl;
 
   if (rec_throttle.get_mode() == THROTTLE_MODE_DYNAMIC) {
-    object_stat_collection_t object_stats_sum;
-    get_object_stats_sum(object_stats_sum);
-    utime_t ts = ceph_clock_now(cct);
-    int64_t client_bw = 0, client_iops = 0;
-    if (!last_object_stats_sum.is_zero()) {
-      object_stat_collection_t delta_sum = object_stats_sum;
-      delta_sum.sub(last_object_stats_sum);
-      delta_sum.floor(0);
-      utime_t delta_ts = ts - last_object_stats_sum_ts;
-      client_bw = (delta_sum.sum.num_rd_kb + delta_sum.sum.num_wr_kb) / delta_ts;
-      client_iops = (delta_sum.sum.num_rd + delta_sum.sum.num_wr) / (double)delta_ts;
-    }
-    last_object_stats_sum = object_stats_sum;
-    last_object_stats_sum_ts = ts;
-
-    if (client_bw <= cct->_conf->osd_recovery_throttle_bw_client_threshold &&
-        client_iops <= cct->_conf->osd_recovery_throttle_ops_client_threshold) {
-      count_below_threshold++;
-      // reset above threshold count and increase bucket after 3 consecutive below threshold
-      if (count_below_threshold >= 3) {
-        count_above_threshold = 0;
-        rec_throttle.increase_bucket_average();
-      }
-    } else {
-      // reset below threshold count every time above threshold
-      count_below_threshold = 0;
-      count_above_threshold++;
-      if (count_above_threshold >= 3)
-        rec_throttle.reset_bucket_average();
-    }
+    adjust_dynamic_throttle(
+      &rec_throttle,
+      client_bw <= cct->_conf->osd_recovery_throttle_bw_client_threshold &&
+      client_iops <= cct->_conf->osd_recovery_throttle_ops_client_threshold,
+      &count_below_threshold, &count_above_threshold);
   }
 }
 
@@ -53,6 +53,7 @@ using namespace std;
 #include "common/simple_cache.hpp"
 #include "common/sharedptr_registry.hpp"
 #include "common/PrioritizedQueue.h"
+#include "common/MClockQueue.h"
 #include "messages/MOSDOp.h"
 #include "common/LeakyBucketThrottle.h"
 
@@ -100,6 +101,9 @@ enum {
   l_osd_pull,
   l_osd_push,
   l_osd_push_outb,
+  l_osd_push_partial,
+  l_osd_push_partial_saved_bytes,
+  l_osd_push_partial_fallback,
 
   l_osd_push_in,
   l_osd_push_inb,
@@ -127,6 +131,17 @@ enum {
 
   l_osd_copyfrom,
 
+  l_osd_ec_fast_read,
+  l_osd_ec_fast_read_redundant,
+  l_osd_ec_fast_read_discarded,
+
+  l_osd_chain_repop,
+  l_osd_chain_repop_forward,
+
+  l_osd_deep_scrub_objects,
+  l_osd_deep_scrub_objects_skipped,
+  l_osd_deep_scrub_bytes,
+
   l_osd_tier_promote,
   l_osd_tier_flush,
   l_osd_tier_flush_fail,
@@ -143,6 +158,10 @@ enum {
   l_osd_agent_skip,
   l_osd_agent_flush,
   l_osd_agent_evict,
+  l_osd_agent_flush_bytes,
+  l_osd_agent_evict_bytes,
+  l_osd_agent_queue_pgs,
+  l_osd_agent_ops,
 
   l_osd_object_ctx_cache_hit,
   l_osd_object_ctx_cache_total,
@@ -185,6 +204,19 @@ enum {
   rs_last,
 };
 
+// per pool client throttle perf counters
+enum {
+  l_osd_pt_first = 21000,
+  l_osd_pt_admitted,
+  l_osd_pt_admitted_bytes,
+  l_osd_pt_throttled,
+  l_osd_pt_waiting,
+  l_osd_pt_wait,
+  l_osd_pt_ops_limit,
+  l_osd_pt_bps_limit,
+  l_osd_pt_last,
+};
+
 class Messenger;
 class Message;
 class MonClient;
@@ -574,6 +606,8 @@ public:
   map<uint64_t, set<PGRef> > agent_queue;
   set<PGRef>::iterator agent_queue_pos;
   bool agent_valid_iterator;
+  unsigned agent_queue_pgs;    ///< pgs in agent_queue
+  set<PGRef> agent_busy_pgs;   ///< pgs an agent thread is working on
   int agent_ops;
   set<hobject_t> agent_oids;
   bool agent_active;
@@ -584,13 +618,15 @@ public:
       osd->agent_entry();
       return NULL;
     }
-  } agent_thread;
+  };
+  vector<AgentThread*> agent_threads;
   bool agent_stop_flag;
   Mutex agent_timer_lock;
   SafeTimer agent_timer;
 
   void agent_entry();
   void agent_stop();
+  PGRef _agent_next_pg();
 
   void _enqueue(PG *pg, uint64_t priority) {
     if (!agent_queue.empty() &&
@@ -598,8 +634,9 @@ public:
       agent_valid_iterator = false;  // inserting higher-priority queue
     set<PGRef>& nq = agent_queue[priority];
     if (nq.empty())
-      agent_cond.Signal();
+      agent_cond.SignalAll();
     nq.insert(pg);
+    ++agent_queue_pgs;
   }
 
   void _dequeue(PG *pg, uint64_t old_priority) {
@@ -609,6 +646,7 @@ public:
     if (p == agent_queue_pos)
       ++agent_queue_pos;
     oq.erase(p);
+    --agent_queue_pgs;
     if (oq.empty()) {
       if (agent_queue.rbegin()->first == old_priority)
 	agent_valid_iterator = false;
@@ -651,7 +689,7 @@ public:
     --agent_ops;
     assert(agent_oids.count(oid) == 1);
     agent_oids.erase(oid);
-    agent_cond.Signal();
+    agent_cond.SignalAll();
   }
 
   /// check if we are operating on an object
@@ -1475,40 +1513,116 @@ private:
  
   class ShardedOpWQ: public ShardedThreadPool::ShardedWQ <const pair <PGRef, OpRequestRef> &> {
 
+    typedef MClockQueue< pair<PGRef, OpRequestRef>, entity_inst_t> MClockOpQueue;
+
     struct ShardData {
       Mutex sdata_lock;
       Cond sdata_cond;
       Mutex sdata_op_ordering_lock;
       map<PG*, list<OpRequestRef> > pg_for_processing;
-      PrioritizedQueue< pair<PGRef, OpRequestRef>, entity_inst_t> pqueue;
-      ShardData(string lock_name, string ordering_lock, uint64_t max_tok_per_prio, uint64_t min_cost):
+      OpQueue< pair<PGRef, OpRequestRef>, entity_inst_t> *pqueue;
+      ShardData(string lock_name, string ordering_lock,
+		OpQueue< pair<PGRef, OpRequestRef>, entity_inst_t> *pqueue):
           sdata_lock(lock_name.c_str()),
           sdata_op_ordering_lock(ordering_lock.c_str()),
-          pqueue(max_tok_per_prio, min_cost) {}
+          pqueue(pqueue) {}
+      ~ShardData() {
+	delete pqueue;
+      }
+    };
+
+    /**
+     * Client class of the ops for the mclock queue
+     *
+     * Client ops are classed by pool, with the tags given to the pool in
+     * osd_op_queue_mclock_pool_qos or the client op defaults, the other
+     * ops by type.
+     */
+    class OpClassifier : public MClockOpQueue::Classifier {
+      CephContext *cct;
+      RWLock lock;
+      map<int64_t, MClockOpQueue::ClientInfo> pool_qos;
+    public:
+      OpClassifier(CephContext *cct) :
+	cct(cct), lock("OSD::ShardedOpWQ::OpClassifier::lock") {}
+      /// parse osd_op_queue_mclock_pool_qos
+      void set_pool_qos(const string &s);
+      uint64_t classify(const entity_inst_t &cl,
+			const pair<PGRef, OpRequestRef> &item,
+			MClockOpQueue::ClientInfo *info);
+    };
+
+    /**
+     * Client op throttle of a pool
+     *
+     * Client ops of a pool with client_throttle_ops or client_throttle_bps
+     * set wait here, in arrival order, for the pool throttle to let them
+     * into the shards.
+     */
+    struct PoolThrottle {
+      uint64_t ops, bps, ops_max, bps_max; ///< the pool settings
+      LeakyBucketThrottle *throttle;
+      list<pair<utime_t, pair<PGRef, OpRequestRef> > > waiting;
+      uint64_t count_above_threshold;
+      uint64_t count_below_threshold;
+      PerfCounters *logger;
+      PoolThrottle()
+	: ops(0), bps(0), ops_max(0), bps_max(0), throttle(NULL),
+	  count_above_threshold(0), count_below_threshold(0), logger(NULL) {}
+    };
+
+    class PoolThrottleContext : public Context {
+      ShardedOpWQ *wq;
+      int64_t pool;
+    public:
+      PoolThrottleContext(ShardedOpWQ *wq, int64_t pool) : wq(wq), pool(pool) {}
+      virtual void finish(int r) {}
+      virtual void complete(int r) {
+	wq->process_throttled_ops(pool);
+      }
     };
 
     vector<ShardData*> shard_list;
     OSD *osd;
     uint32_t num_shards;
+    OpClassifier classifier;
+
+    Mutex pool_throttle_lock; ///< before the shard locks
+    map<int64_t, PoolThrottle*> pool_throttles;
+    atomic_t num_pool_throttles; ///< skip pool_throttle_lock when 0
+
+    void _enqueue_op(const pair<PGRef, OpRequestRef> &item);
+    bool _throttle_op(const pair<PGRef, OpRequestRef> &item);
+    void _admit_throttled_ops(PoolThrottle *pt, bool release_timer_wait);
+    LeakyBucketThrottle *create_pool_throttle(int64_t pool, const pg_pool_t &p);
+    PerfCounters *create_pool_throttle_logger(int64_t pool);
 
     public:
       ShardedOpWQ(uint32_t pnum_shards, OSD *o, time_t ti, time_t si, ShardedThreadPool* tp):
         ShardedThreadPool::ShardedWQ <const pair <PGRef, OpRequestRef> &>(ti, si, tp),
-        osd(o), num_shards(pnum_shards) {
+        osd(o), num_shards(pnum_shards), classifier(o->cct),
+        pool_throttle_lock("OSD::ShardedOpWQ::pool_throttle_lock") {
+        classifier.set_pool_qos(osd->cct->_conf->osd_op_queue_mclock_pool_qos);
         for(uint32_t i = 0; i < num_shards; i++) {
           char lock_name[32] = {0};
           snprintf(lock_name, sizeof(lock_name), "%s.%d", "OSD:ShardedOpWQ:", i);
           char order_lock[32] = {0};
           snprintf(order_lock, sizeof(order_lock), "%s.%d", "OSD:ShardedOpWQ:order:", i);
-          ShardData* one_shard = new ShardData(lock_name, order_lock, 
-            osd->cct->_conf->osd_op_pq_max_tokens_per_priority, 
-            osd->cct->_conf->osd_op_pq_min_cost);
+          OpQueue< pair<PGRef, OpRequestRef>, entity_inst_t> *pqueue;
+          if (osd->cct->_conf->osd_op_queue == "mclock")
+            pqueue = new MClockOpQueue(
+              osd->cct->_conf->osd_op_queue_mclock_cost_per_io, &classifier);
+          else
+            pqueue = new PrioritizedQueue< pair<PGRef, OpRequestRef>, entity_inst_t>(
+              osd->cct->_conf->osd_op_pq_max_tokens_per_priority,
+              osd->cct->_conf->osd_op_pq_min_cost);
+          ShardData* one_shard = new ShardData(lock_name, order_lock, pqueue);
           shard_list.push_back(one_shard);
         }
       }
 
       ~ShardedOpWQ() {
-
+        clear_pool_throttles();
         while(!shard_list.empty()) {
           delete shard_list.back();
           shard_list.pop_back();
@@ -1538,13 +1652,27 @@ private:
           assert (NULL != sdata);
           sdata->sdata_op_ordering_lock.Lock();
 	  f->open_object_section(lock_name);
-	  sdata->pqueue.dump(f);
+	  sdata->pqueue->dump(f);
 	  f->close_section();
           sdata->sdata_op_ordering_lock.Unlock();
         }
       }
 
-      struct Pred {
+      void set_pool_qos(const string &s) {
+        classifier.set_pool_qos(s);
+      }
+
+      /// (re)configure the pool throttles from the pool settings in osdmap
+      void update_pool_throttles(OSDMapRef osdmap);
+      /// let the ops parked on pool throttles through and drop them
+      void clear_pool_throttles();
+      /// timer callback of the throttle of pool
+      void process_throttled_ops(int64_t pool);
+      bool has_dynamic_pool_throttles();
+      /// adjust the dynamic mode pool throttles, client_bw in bytes/s
+      void adjust_pool_throttles(int64_t client_bw, int64_t client_iops);
+
+      struct Pred : public OpQueue< pair<PGRef, OpRequestRef>, entity_inst_t>::Filter {
         PG *pg;
         Pred(PG *pg) : pg(pg) {}
         bool operator()(const pair<PGRef, OpRequestRef> &op) {
@@ -1558,15 +1686,37 @@ private:
         uint32_t shard_index = pg->get_pgid().ps()% shard_list.size();
         sdata = shard_list[shard_index];
         assert(sdata != NULL);
+        // ops parked on the pool throttle go after the queued ones, hold
+        // the lock across both so none is admitted in between
+        Mutex::Locker l(pool_throttle_lock);
+        list<OpRequestRef> throttled;
+        map<int64_t, PoolThrottle*>::iterator pt =
+          pool_throttles.find(pg->get_pgid().pool());
+        if (pt != pool_throttles.end()) {
+          list<pair<utime_t, pair<PGRef, OpRequestRef> > > &waiting =
+            pt->second->waiting;
+          for (list<pair<utime_t, pair<PGRef, OpRequestRef> > >::iterator i =
+                 waiting.begin(); i != waiting.end(); ) {
+            if (i->second.first == pg) {
+              throttled.push_back(i->second.second);
+              waiting.erase(i++);
+            } else {
+              ++i;
+            }
+          }
+          pt->second->logger->set(l_osd_pt_waiting, waiting.size());
+        }
         if (!dequeued) {
           sdata->sdata_op_ordering_lock.Lock();
-          sdata->pqueue.remove_by_filter(Pred(pg));
+          Pred f(pg);
+          sdata->pqueue->remove_by_filter(f);
           sdata->pg_for_processing.erase(pg);
           sdata->sdata_op_ordering_lock.Unlock();
         } else {
           list<pair<PGRef, OpRequestRef> > _dequeued;
           sdata->sdata_op_ordering_lock.Lock();
-          sdata->pqueue.remove_by_filter(Pred(pg), &_dequeued);
+          Pred f(pg);
+          sdata->pqueue->remove_by_filter(f, &_dequeued);
           for (list<pair<PGRef, OpRequestRef> >::iterator i = _dequeued.begin();
             i != _dequeued.end(); ++i) {
             dequeued->push_back(i->second);
@@ -1578,6 +1728,7 @@ private:
 	    sdata->pg_for_processing.erase(pg);
 	  }
           sdata->sdata_op_ordering_lock.Unlock();          
+          dequeued->splice(dequeued->end(), throttled);
         }
 
       }
@@ -1587,7 +1738,7 @@ private:
         ShardData* sdata = shard_list[shard_index];
         assert(NULL != sdata);
         Mutex::Locker l(sdata->sdata_op_ordering_lock);
-        return sdata->pqueue.empty();
+        return sdata->pqueue->empty();
       }
 
   } op_shardedwq;
@@ -2122,7 +2273,8 @@ protected:
   bool _recover_now();
   void process_throttled_recoveries();
   void get_object_stats_sum(object_stat_collection_t &stat_sum);
-  void adjust_recovery_throttle();
+  void get_client_io_rate(int64_t *client_bw, int64_t *client_iops);
+  void adjust_recovery_throttle(int64_t client_bw, int64_t client_iops);
   void remove_throttled_recoveries(PG *pg);
 
   // replay / delayed pg activation
@@ -875,8 +875,9 @@ void OSDMap::Incremental::generate_test_instances(list<Incremental*>& o)
 void OSDMap::set_epoch(epoch_t e)
 {
   epoch = e;
-  for (map<int64_t,pg_pool_t>::iterator p = pools.begin();
-       p != pools.end();
+  unshare(pools);
+  for (map<int64_t,pg_pool_t>::iterator p = pools->begin();
+       p != pools->end();
        ++p)
     p->second.last_change = e;
 }
@@ -923,6 +924,9 @@ void OSDMap::set_max_osd(int m)
   }
   osd_info.resize(m);
   osd_xinfo.resize(m);
+  unshare(osd_addrs);
+  unshare(osd_uuid);
+  unshare(osd_primary_affinity);
   osd_addrs->client_addr.resize(m);
   osd_addrs->cluster_addr.resize(m);
   osd_addrs->hb_back_addr.resize(m);
@@ -1042,7 +1046,7 @@ uint64_t OSDMap::get_features(int entity_type, uint64_t *pmask) const
     features |= CEPH_FEATURE_CRUSH_V4;
   mask |= CEPH_FEATURES_CRUSH;
 
-  for (map<int64_t,pg_pool_t>::const_iterator p = pools.begin(); p != pools.end(); ++p) {
+  for (map<int64_t,pg_pool_t>::const_iterator p = pools->begin(); p != pools->end(); ++p) {
     if (p->second.has_flag(pg_pool_t::FLAG_HASHPSPOOL)) {
       features |= CEPH_FEATURE_OSDHASHPSPOOL;
     }
@@ -1121,60 +1125,77 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
   if (o->epoch == n->epoch)
     return;
 
-  int diff = 0;
-
-  // do addrs match?
-  if (o->max_osd != n->max_osd)
-    diff++;
-  for (int i = 0; i < o->max_osd && i < n->max_osd; i++) {
-    if ( n->osd_addrs->client_addr[i] &&  o->osd_addrs->client_addr[i] &&
-	*n->osd_addrs->client_addr[i] == *o->osd_addrs->client_addr[i])
-      n->osd_addrs->client_addr[i] = o->osd_addrs->client_addr[i];
-    else
-      diff++;
-    if ( n->osd_addrs->cluster_addr[i] &&  o->osd_addrs->cluster_addr[i] &&
-	*n->osd_addrs->cluster_addr[i] == *o->osd_addrs->cluster_addr[i])
-      n->osd_addrs->cluster_addr[i] = o->osd_addrs->cluster_addr[i];
-    else
-      diff++;
-    if ( n->osd_addrs->hb_back_addr[i] &&  o->osd_addrs->hb_back_addr[i] &&
-	*n->osd_addrs->hb_back_addr[i] == *o->osd_addrs->hb_back_addr[i])
-      n->osd_addrs->hb_back_addr[i] = o->osd_addrs->hb_back_addr[i];
-    else
+  // do addrs match?  parts n shares with the map it was built from
+  // are deduped already, and must not change under that map's readers
+  if (n->osd_addrs != o->osd_addrs && n->osd_addrs.unique()) {
+    int diff = 0;
+    if (o->max_osd != n->max_osd)
       diff++;
-    if ( n->osd_addrs->hb_front_addr[i] &&  o->osd_addrs->hb_front_addr[i] &&
-	*n->osd_addrs->hb_front_addr[i] == *o->osd_addrs->hb_front_addr[i])
-      n->osd_addrs->hb_front_addr[i] = o->osd_addrs->hb_front_addr[i];
-    else
-      diff++;
-  }
-  if (diff == 0) {
-    // zoinks, no differences at all!
-    n->osd_addrs = o->osd_addrs;
+    for (int i = 0; i < o->max_osd && i < n->max_osd; i++) {
+      if ( n->osd_addrs->client_addr[i] &&  o->osd_addrs->client_addr[i] &&
+	  *n->osd_addrs->client_addr[i] == *o->osd_addrs->client_addr[i])
+	n->osd_addrs->client_addr[i] = o->osd_addrs->client_addr[i];
+      else
+	diff++;
+      if ( n->osd_addrs->cluster_addr[i] &&  o->osd_addrs->cluster_addr[i] &&
+	  *n->osd_addrs->cluster_addr[i] == *o->osd_addrs->cluster_addr[i])
+	n->osd_addrs->cluster_addr[i] = o->osd_addrs->cluster_addr[i];
+      else
+	diff++;
+      if ( n->osd_addrs->hb_back_addr[i] &&  o->osd_addrs->hb_back_addr[i] &&
+	  *n->osd_addrs->hb_back_addr[i] == *o->osd_addrs->hb_back_addr[i])
+	n->osd_addrs->hb_back_addr[i] = o->osd_addrs->hb_back_addr[i];
+      else
+	diff++;
+      if ( n->osd_addrs->hb_front_addr[i] &&  o->osd_addrs->hb_front_addr[i] &&
+	  *n->osd_addrs->hb_front_addr[i] == *o->osd_addrs->hb_front_addr[i])
+	n->osd_addrs->hb_front_addr[i] = o->osd_addrs->hb_front_addr[i];
+      else
+	diff++;
+    }
+    if (diff == 0) {
+      // zoinks, no differences at all!
+      n->osd_addrs = o->osd_addrs;
+    }
   }
 
   // does crush match?
-  bufferlist oc, nc;
-  ::encode(*o->crush, oc);
-  ::encode(*n->crush, nc);
-  if (oc.contents_equal(nc)) {
-    n->crush = o->crush;
+  if (n->crush != o->crush) {
+    bufferlist oc, nc;
+    ::encode(*o->crush, oc);
+    ::encode(*n->crush, nc);
+    if (oc.contents_equal(nc)) {
+      n->crush = o->crush;
+    }
+  }
+
+  // do pools match?
+  if (n->pools != o->pools &&
+      o->pools->size() == n->pools->size()) {
+    bufferlist op, np;
+    ::encode(*o->pools, op, CEPH_FEATURES_ALL);
+    ::encode(*n->pools, np, CEPH_FEATURES_ALL);
+    if (op.contents_equal(np))
+      n->pools = o->pools;
   }
 
   // does pg_temp match?
-  if (o->pg_temp->size() == n->pg_temp->size()) {
+  if (n->pg_temp != o->pg_temp &&
+      o->pg_temp->size() == n->pg_temp->size()) {
     if (*o->pg_temp == *n->pg_temp)
       n->pg_temp = o->pg_temp;
   }
 
   // does primary_temp match?
-  if (o->primary_temp->size() == n->primary_temp->size()) {
+  if (n->primary_temp != o->primary_temp &&
+      o->primary_temp->size() == n->primary_temp->size()) {
     if (*o->primary_temp == *n->primary_temp)
       n->primary_temp = o->primary_temp;
   }
 
   // do uuids match?
-  if (o->osd_uuid->size() == n->osd_uuid->size() &&
+  if (n->osd_uuid != o->osd_uuid &&
+      o->osd_uuid->size() == n->osd_uuid->size() &&
       *o->osd_uuid == *n->osd_uuid)
     n->osd_uuid = o->osd_uuid;
 }
@@ -1287,11 +1308,13 @@ int OSDMap::apply_incremental(const Incremental &inc)
   if (inc.new_pool_max != -1)
     pool_max = inc.new_pool_max;
 
+  if (!inc.new_pools.empty() || !inc.old_pools.empty())
+    unshare(pools);
   for (map<int64_t,pg_pool_t>::const_iterator p = inc.new_pools.begin();
        p != inc.new_pools.end();
        ++p) {
-    pools[p->first] = p->second;
-    pools[p->first].last_change = epoch;
+    (*pools)[p->first] = p->second;
+    (*pools)[p->first].last_change = epoch;
   }
   for (map<int64_t,string>::const_iterator p = inc.new_pool_names.begin();
        p != inc.new_pool_names.end();
@@ -1304,7 +1327,7 @@ int OSDMap::apply_incremental(const Incremental &inc)
   for (set<int64_t>::const_iterator p = inc.old_pools.begin();
        p != inc.old_pools.end();
        ++p) {
-    pools.erase(*p);
+    pools->erase(*p);
     name_pool.erase(pool_name[*p]);
     pool_name.erase(*p);
   }
@@ -1352,10 +1375,14 @@ int OSDMap::apply_incremental(const Incremental &inc)
       osd_xinfo[i->first].down_stamp = modified;
     }
     if ((osd_state[i->first] & CEPH_OSD_EXISTS) &&
-	(s & CEPH_OSD_EXISTS))
+	(s & CEPH_OSD_EXISTS)) {
+      unshare(osd_uuid);
       (*osd_uuid)[i->first] = uuid_d();
+    }
     osd_state[i->first] ^= s;
   }
+  if (!inc.new_up_client.empty() || !inc.new_up_cluster.empty())
+    unshare(osd_addrs);
   for (map<int32_t,entity_addr_t>::const_iterator i = inc.new_up_client.begin();
        i != inc.new_up_client.end();
        ++i) {
@@ -1398,10 +1425,14 @@ int OSDMap::apply_incremental(const Incremental &inc)
     osd_xinfo[p->first] = p->second;
 
   // uuid
+  if (!inc.new_uuid.empty())
+    unshare(osd_uuid);
   for (map<int32_t,uuid_d>::const_iterator p = inc.new_uuid.begin(); p != inc.new_uuid.end(); ++p) 
     (*osd_uuid)[p->first] = p->second;
 
   // pg rebuild
+  if (!inc.new_pg_temp.empty())
+    unshare(pg_temp);
   for (map<pg_t, vector<int> >::const_iterator p = inc.new_pg_temp.begin(); p != inc.new_pg_temp.end(); ++p) {
     if (p->second.empty())
       pg_temp->erase(p->first);
@@ -1409,6 +1440,8 @@ int OSDMap::apply_incremental(const Incremental &inc)
       (*pg_temp)[p->first] = p->second;
   }
 
+  if (!inc.new_primary_temp.empty())
+    unshare(primary_temp);
   for (map<pg_t,int32_t>::const_iterator p = inc.new_primary_temp.begin();
       p != inc.new_primary_temp.end();
       ++p) {
@@ -1771,11 +1804,11 @@ void OSDMap::encode_client_old(bufferlist& bl) const
   ::encode(created, bl);
   ::encode(modified, bl);
 
-  // for ::encode(pools, bl);
-  __u32 n = pools.size();
+  // for ::encode(*pools, bl);
+  __u32 n = pools->size();
   ::encode(n, bl);
-  for (map<int64_t,pg_pool_t>::const_iterator p = pools.begin();
-       p != pools.end();
+  for (map<int64_t,pg_pool_t>::const_iterator p = pools->begin();
+       p != pools->end();
        ++p) {
     n = p->first;
     ::encode(n, bl);
@@ -1835,7 +1868,7 @@ void OSDMap::encode_classic(bufferlist& bl, uint64_t features) const
   ::encode(created, bl);
   ::encode(modified, bl);
 
-  ::encode(pools, bl, features);
+  ::encode(*pools, bl, features);
   ::encode(pool_name, bl);
   ::encode(pool_max, bl);
 
@@ -1896,7 +1929,7 @@ void OSDMap::encode(bufferlist& bl, uint64_t features) const
     ::encode(created, bl);
     ::encode(modified, bl);
 
-    ::encode(pools, bl, features);
+    ::encode(*pools, bl, features);
     ::encode(pool_name, bl);
     ::encode(pool_max, bl);
 
@@ -1974,6 +2007,22 @@ void OSDMap::decode(bufferlist& bl)
   decode(p);
 }
 
+void OSDMap::unshare_for_decode()
+{
+  if (!osd_addrs.unique())
+    osd_addrs.reset(new addrs_s);
+  if (!pg_temp.unique())
+    pg_temp.reset(new map<pg_t,vector<int32_t> >);
+  if (!primary_temp.unique())
+    primary_temp.reset(new map<pg_t,int32_t>);
+  if (!pools.unique())
+    pools.reset(new map<int64_t,pg_pool_t>);
+  if (!osd_uuid.unique())
+    osd_uuid.reset(new vector<uuid_d>);
+  if (!crush.unique())
+    crush.reset(new CrushWrapper);
+}
+
 void OSDMap::decode_classic(bufferlist::iterator& p)
 {
   __u32 n, t;
@@ -1992,11 +2041,11 @@ void OSDMap::decode_classic(bufferlist::iterator& p)
       ::decode(max_pools, p);
       pool_max = max_pools;
     }
-    pools.clear();
+    pools->clear();
     ::decode(n, p);
     while (n--) {
       ::decode(t, p);
-      ::decode(pools[t], p);
+      ::decode((*pools)[t], p);
     }
     if (v == 4) {
       ::decode(n, p);
@@ -2012,13 +2061,13 @@ void OSDMap::decode_classic(bufferlist::iterator& p)
       pool_max = n;
     }
   } else {
-    ::decode(pools, p);
+    ::decode(*pools, p);
     ::decode(pool_name, p);
     ::decode(pool_max, p);
   }
   // kludge around some old bug that zeroed out pool_max (#2307)
-  if (pools.size() && pool_max < pools.rbegin()->first) {
-    pool_max = pools.rbegin()->first;
+  if (pools->size() && pool_max < pools->rbegin()->first) {
+    pool_max = pools->rbegin()->first;
   }
 
   ::decode(flags, p);
@@ -2098,6 +2147,8 @@ void OSDMap::decode(bufferlist::iterator& bl)
   size_t tail_offset = 0;
   bufferlist crc_front, crc_tail;
 
+  unshare_for_decode();
+
   DECODE_START_LEGACY_COMPAT_LEN(8, 7, 7, bl); // wrapper
   if (struct_v < 7) {
     int struct_v_size = sizeof(struct_v);
@@ -2116,7 +2167,7 @@ void OSDMap::decode(bufferlist::iterator& bl)
     ::decode(created, bl);
     ::decode(modified, bl);
 
-    ::decode(pools, bl);
+    ::decode(*pools, bl);
     ::decode(pool_name, bl);
     ::decode(pool_max, bl);
 
@@ -2248,7 +2299,7 @@ void OSDMap::dump(Formatter *f) const
   f->dump_int("max_osd", get_max_osd());
 
   f->open_array_section("pools");
-  for (map<int64_t,pg_pool_t>::const_iterator p = pools.begin(); p != pools.end(); ++p) {
+  for (map<int64_t,pg_pool_t>::const_iterator p = pools->begin(); p != pools->end(); ++p) {
     std::string name("<unknown>");
     map<int64_t,string>::const_iterator pni = pool_name.find(p->first);
     if (pni != pool_name.end())
@@ -2401,7 +2452,7 @@ struct qi {
 
 void OSDMap::print_pools(ostream& out) const
 {
-  for (map<int64_t,pg_pool_t>::const_iterator p = pools.begin(); p != pools.end(); ++p) {
+  for (map<int64_t,pg_pool_t>::const_iterator p = pools->begin(); p != pools->end(); ++p) {
     std::string name("<unknown>");
     map<int64_t,string>::const_iterator pni = pool_name.find(p->first);
     if (pni != pool_name.end())
@@ -2615,7 +2666,7 @@ void OSDMap::print_oneline_summary(ostream& out) const
 
 bool OSDMap::crush_ruleset_in_use(int ruleset) const
 {
-  for (map<int64_t,pg_pool_t>::const_iterator p = pools.begin(); p != pools.end(); ++p) {
+  for (map<int64_t,pg_pool_t>::const_iterator p = pools->begin(); p != pools->end(); ++p) {
     if (p->second.crush_ruleset == ruleset)
       return true;
   }
@@ -2684,23 +2735,23 @@ int OSDMap::build_simple(CephContext *cct, epoch_t e, uuid_d &fsid,
   for (vector<string>::iterator p = pool_names.begin();
        p != pool_names.end(); ++p) {
     int64_t pool = ++pool_max;
-    pools[pool].type = pg_pool_t::TYPE_REPLICATED;
-    pools[pool].flags = cct->_conf->osd_pool_default_flags;
+    (*pools)[pool].type = pg_pool_t::TYPE_REPLICATED;
+    (*pools)[pool].flags = cct->_conf->osd_pool_default_flags;
     if (cct->_conf->osd_pool_default_flag_hashpspool)
-      pools[pool].set_flag(pg_pool_t::FLAG_HASHPSPOOL);
+      (*pools)[pool].set_flag(pg_pool_t::FLAG_HASHPSPOOL);
     if (cct->_conf->osd_pool_default_flag_nodelete)
-      pools[pool].set_flag(pg_pool_t::FLAG_NODELETE);
+      (*pools)[pool].set_flag(pg_pool_t::FLAG_NODELETE);
     if (cct->_conf->osd_pool_default_flag_nopgchange)
-      pools[pool].set_flag(pg_pool_t::FLAG_NOPGCHANGE);
+      (*pools)[pool].set_flag(pg_pool_t::FLAG_NOPGCHANGE);
     if (cct->_conf->osd_pool_default_flag_nosizechange)
-      pools[pool].set_flag(pg_pool_t::FLAG_NOSIZECHANGE);
-    pools[pool].size = cct->_conf->osd_pool_default_size;
-    pools[pool].min_size = cct->_conf->get_osd_pool_default_min_size();
-    pools[pool].crush_ruleset = default_replicated_ruleset;
-    pools[pool].object_hash = CEPH_STR_HASH_RJENKINS;
-    pools[pool].set_pg_num(poolbase << pg_bits);
-    pools[pool].set_pgp_num(poolbase << pgp_bits);
-    pools[pool].last_change = epoch;
+      (*pools)[pool].set_flag(pg_pool_t::FLAG_NOSIZECHANGE);
+    (*pools)[pool].size = cct->_conf->osd_pool_default_size;
+    (*pools)[pool].min_size = cct->_conf->get_osd_pool_default_min_size();
+    (*pools)[pool].crush_ruleset = default_replicated_ruleset;
+    (*pools)[pool].object_hash = CEPH_STR_HASH_RJENKINS;
+    (*pools)[pool].set_pg_num(poolbase << pg_bits);
+    (*pools)[pool].set_pgp_num(poolbase << pgp_bits);
+    (*pools)[pool].last_change = epoch;
     pool_name[pool] = *p;
     name_pool[*p] = pool;
   }
@@ -231,7 +231,7 @@ private:
   ceph::shared_ptr< map<pg_t,int32_t > > primary_temp;  // temp primary mapping (e.g. while we rebuild)
   ceph::shared_ptr< vector<__u32> > osd_primary_affinity; ///< 16.16 fixed point, 0x10000 = baseline
 
-  map<int64_t,pg_pool_t> pools;
+  ceph::shared_ptr< map<int64_t,pg_pool_t> > pools;
   map<int64_t,string> pool_name;
   map<string,map<string,string> > erasure_code_profiles;
   map<string,int64_t> name_pool;
@@ -252,6 +252,15 @@ private:
 
   void _calc_up_osd_features();
 
+  /// make p point to a copy of its own before it is changed
+  template <typename T>
+  static void unshare(ceph::shared_ptr<T> &p) {
+    if (p && !p.unique())
+      p.reset(new T(*p));
+  }
+  /// replace the parts shared with other maps before decoding into them
+  void unshare_for_decode();
+
  public:
   bool have_crc() const { return crc_defined; }
   uint32_t get_crc() const { return crc; }
@@ -270,6 +279,7 @@ private:
 	     osd_addrs(new addrs_s),
 	     pg_temp(new map<pg_t,vector<int32_t> >),
 	     primary_temp(new map<pg_t,int32_t>),
+	     pools(new map<int64_t,pg_pool_t>),
 	     osd_uuid(new vector<uuid_d>),
 	     cluster_snapshot_epoch(0),
 	     new_blacklist_entries(false),
@@ -291,6 +301,7 @@ public:
     *this = o;
     primary_temp.reset(new map<pg_t,int32_t>(*o.primary_temp));
     pg_temp.reset(new map<pg_t,vector<int32_t> >(*o.pg_temp));
+    pools.reset(new map<int64_t,pg_pool_t>(*o.pools));
     osd_uuid.reset(new vector<uuid_d>(*o.osd_uuid));
 
     if (o.osd_primary_affinity)
@@ -303,6 +314,16 @@ public:
     // allocate a new CrushWrapper, though.
   }
 
+  /**
+   * copy o, sharing its pools, pg_temp, primary_temp, primary affinity,
+   * uuids, addrs and crush with it.  apply_incremental() and decode()
+   * copy or replace a shared part before changing it, so o must not be
+   * changed any other way while we are alive.
+   */
+  void share_from(const OSDMap& o) {
+    *this = o;
+  }
+
   // map info
   const uuid_d& get_fsid() const { return fsid; }
   void set_fsid(uuid_d& f) { fsid = f; }
@@ -387,6 +408,7 @@ public:
     if (!osd_primary_affinity)
       osd_primary_affinity.reset(new vector<__u32>(max_osd,
 						   CEPH_OSD_DEFAULT_PRIMARY_AFFINITY));
+    unshare(osd_primary_affinity);
     (*osd_primary_affinity)[o] = w;
   }
   unsigned get_primary_affinity(int o) const {
@@ -688,8 +710,8 @@ public:
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
   }
   bool pg_is_ec(pg_t pg) const {
-    map<int64_t, pg_pool_t>::const_iterator i = pools.find(pg.pool());
-    assert(i != pools.end());
+    map<int64_t, pg_pool_t>::const_iterator i = pools->find(pg.pool());
+    assert(i != pools->end());
     return i->second.ec_pool();
   }
   bool get_primary_shard(const pg_t& pgid, spg_t *out) const {
@@ -724,7 +746,7 @@ public:
     return pool_max;
   }
   const map<int64_t,pg_pool_t>& get_pools() const {
-    return pools;
+    return *pools;
   }
   const string& get_pool_name(int64_t p) const {
     map<int64_t, string>::const_iterator i = pool_name.find(p);
@@ -732,29 +754,29 @@ public:
     return i->second;
   }
   bool have_pg_pool(int64_t p) const {
-    return pools.count(p);
+    return pools->count(p);
   }
   const pg_pool_t* get_pg_pool(int64_t p) const {
-    map<int64_t, pg_pool_t>::const_iterator i = pools.find(p);
-    if (i != pools.end())
+    map<int64_t, pg_pool_t>::const_iterator i = pools->find(p);
+    if (i != pools->end())
       return &i->second;
     return NULL;
   }
   unsigned get_pg_size(pg_t pg) const {
-    map<int64_t,pg_pool_t>::const_iterator p = pools.find(pg.pool());
-    assert(p != pools.end());
+    map<int64_t,pg_pool_t>::const_iterator p = pools->find(pg.pool());
+    assert(p != pools->end());
     return p->second.get_size();
   }
   int get_pg_type(pg_t pg) const {
-    map<int64_t,pg_pool_t>::const_iterator p = pools.find(pg.pool());
-    assert(p != pools.end());
+    map<int64_t,pg_pool_t>::const_iterator p = pools->find(pg.pool());
+    assert(p != pools->end());
     return p->second.get_type();
   }
 
 
   pg_t raw_pg_to_pg(pg_t pg) const {
-    map<int64_t,pg_pool_t>::const_iterator p = pools.find(pg.pool());
-    assert(p != pools.end());
+    map<int64_t,pg_pool_t>::const_iterator p = pools->find(pg.pool());
+    assert(p != pools->end());
     return p->second.raw_pg_to_pg(pg);
   }
 
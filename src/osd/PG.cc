@@ -2186,6 +2186,7 @@ void PG::split_into(pg_t child_pgid, PG *child, unsigned split_bits)
   child->info.history = info.history;
   child->info.purged_snaps = info.purged_snaps;
   child->info.last_backfill = info.last_backfill;
+  child->info.last_recovered_at = info.last_recovered_at;
 
   child->info.stats = info.stats;
   info.stats.stats_invalid = true;
@@ -3166,9 +3167,9 @@ void PG::log_weirdness()
 			<< "\n";
   }
   
-  if (pg_log.get_log().caller_ops.size() > pg_log.get_log().log.size()) {
+  if (pg_log.get_log().get_num_caller_ops() > pg_log.get_log().log.size()) {
     osd->clog->error() << info.pgid
-		      << " caller_ops.size " << pg_log.get_log().caller_ops.size()
+		      << " caller_ops.size " << pg_log.get_log().get_num_caller_ops()
 		      << " > log size " << pg_log.get_log().log.size()
 		      << "\n";
   }
@@ -3421,15 +3422,16 @@ void PG::sub_op_scrub_map(OpRequestRef op)
 void PG::_request_scrub_map(
   pg_shard_t replica, eversion_t version,
   hobject_t start, hobject_t end,
-  bool deep, uint32_t seed)
+  bool deep, uint32_t seed, eversion_t trust_digests_to)
 {
   assert(replica != pg_whoami);
   dout(10) << "scrub  requesting scrubmap from osd." << replica
-	   << " deep " << (int)deep << " seed " << seed << dendl;
+	   << " deep " << (int)deep << " seed " << seed
+	   << " trust_digests_to " << trust_digests_to << dendl;
   MOSDRepScrub *repscrubop = new MOSDRepScrub(
     spg_t(info.pgid.pgid, replica.shard), version,
     get_osdmap()->get_epoch(),
-    start, end, deep, seed);
+    start, end, deep, seed, trust_digests_to);
   osd->send_message_osd_cluster(
     replica.osd, repscrubop, get_osdmap()->get_epoch());
 }
@@ -3696,13 +3698,24 @@ void PG::_scan_snaps(ScrubMap &smap)
 int PG::build_scrub_map_chunk(
   ScrubMap &map,
   hobject_t start, hobject_t end, bool deep, uint32_t seed,
+  eversion_t trust_digests_to,
   ThreadPool::TPHandle &handle)
 {
   dout(10) << __func__ << " [" << start << "," << end << ") "
-	   << " seed " << seed << dendl;
+	   << " seed " << seed << " trust_digests_to " << trust_digests_to
+	   << dendl;
 
   map.valid_through = info.last_update;
 
+  // recovery and backfill copy objects without changing their version,
+  // their digest only says what the source shard had
+  if (trust_digests_to != eversion_t() &&
+      info.last_recovered_at >= trust_digests_to) {
+    dout(10) << __func__ << " recovered objects at " << info.last_recovered_at
+	     << ", not trusting digests" << dendl;
+    trust_digests_to = eversion_t();
+  }
+
   // objects
   vector<hobject_t> ls;
   vector<ghobject_t> rollback_obs;
@@ -3718,7 +3731,7 @@ int PG::build_scrub_map_chunk(
   }
 
 
-  get_pgbackend()->be_scan_list(map, ls, deep, seed, handle);
+  get_pgbackend()->be_scan_list(map, ls, deep, seed, trust_digests_to, handle);
   _scan_rollback_obs(rollback_obs, handle);
   _scan_snaps(map);
 
@@ -3795,7 +3808,7 @@ void PG::replica_scrub(
 
   build_scrub_map_chunk(
     map, msg->start, msg->end, msg->deep, msg->seed,
-    handle);
+    msg->trust_digests_to, handle);
 
   vector<OSDOp> scrub(1);
   scrub[0].op.op = CEPH_OSD_OP_SCRUB_MAP;
@@ -3992,6 +4005,20 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
 	else
 	  scrubber.seed = 0;  // compat
 
+	// all but a fraction of the deep scrubs skip reading the objects
+	// unchanged since the last one started, if their digest is known:
+	// objects written while it ran may have been scanned before
+	scrubber.deep_scrub_start = info.last_update;
+	scrubber.trust_digests_to = eversion_t();
+	if (scrubber.deep && scrubber.seed == 0xffffffff &&
+	    !scrubber.must_repair && !state_test(PG_STATE_REPAIR) &&
+	    (double)(rand() % 100) / 100.0 >=
+	      cct->_conf->osd_deep_scrub_full_verify_ratio)
+	  scrubber.trust_digests_to = info.history.last_deep_scrub_start;
+	if (scrubber.trust_digests_to != eversion_t())
+	  dout(10) << "deep scrub trusting the digests of objects unchanged since "
+		   << scrubber.trust_digests_to << dendl;
+
         break;
 
       case PG::Scrubber::NEW_CHUNK:
@@ -4073,7 +4100,7 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
 	  if (*i == pg_whoami) continue;
           _request_scrub_map(*i, scrubber.subset_last_update,
                              scrubber.start, scrubber.end, scrubber.deep,
-			     scrubber.seed);
+			     scrubber.seed, scrubber.trust_digests_to);
           scrubber.waiting_on_whom.insert(*i);
           ++scrubber.waiting_on;
         }
@@ -4108,6 +4135,7 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
         ret = build_scrub_map_chunk(scrubber.primary_scrubmap,
                                     scrubber.start, scrubber.end,
                                     scrubber.deep, scrubber.seed,
+				    scrubber.trust_digests_to,
 				    handle);
         if (ret < 0) {
           dout(5) << "error building scrub map: " << ret << ", aborting" << dendl;
@@ -4371,6 +4399,7 @@ void PG::scrub_finish()
   info.history.last_scrub_stamp = now;
   if (scrubber.deep) {
     info.history.last_deep_scrub = info.last_update;
+    info.history.last_deep_scrub_start = scrubber.deep_scrub_start;
     info.history.last_deep_scrub_stamp = now;
   }
   // Since we don't know which errors were fixed, we can only clear them
@@ -6812,6 +6841,7 @@ boost::statechart::result PG::RecoveryState::Stray::react(const MLogRec& logevt)
     // restart backfill
     pg->unreg_next_scrub();
     pg->info = msg->info;
+    pg->info.last_recovered_at = pg->info.last_update;
     pg->reg_next_scrub();
     pg->dirty_info = true;
     pg->dirty_big_info = true;  // maybe.
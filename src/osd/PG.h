@@ -1106,6 +1106,8 @@ public:
     // deep scrub
     bool deep;
     uint32_t seed;
+    eversion_t trust_digests_to;  ///< eversion_t() to read every object
+    eversion_t deep_scrub_start;  ///< last_update when this deep scrub started
 
     list<Context*> callbacks;
     void add_callback(Context *context) {
@@ -1174,6 +1176,8 @@ public:
       fixed = 0;
       deep = false;
       seed = 0;
+      trust_digests_to = eversion_t();
+      deep_scrub_start = eversion_t();
       run_callbacks();
       inconsistent.clear();
       missing.clear();
@@ -1203,10 +1207,11 @@ public:
     ThreadPool::TPHandle &handle);
   void _request_scrub_map(pg_shard_t replica, eversion_t version,
                           hobject_t start, hobject_t end, bool deep,
-			  uint32_t seed);
+			  uint32_t seed, eversion_t trust_digests_to);
   int build_scrub_map_chunk(
     ScrubMap &map,
     hobject_t start, hobject_t end, bool deep, uint32_t seed,
+    eversion_t trust_digests_to,
     ThreadPool::TPHandle &handle);
   /**
    * returns true if [begin, end) is good to scrub at this time
@@ -321,7 +321,7 @@ PGBackend *PGBackend::build_pg_backend(
  */
 void PGBackend::be_scan_list(
   ScrubMap &map, const vector<hobject_t> &ls, bool deep, uint32_t seed,
-  ThreadPool::TPHandle &handle)
+  eversion_t trust_digests_to, ThreadPool::TPHandle &handle)
 {
   dout(10) << __func__ << " scanning " << ls.size() << " objects"
            << (deep ? " deeply" : "") << dendl;
@@ -351,7 +351,22 @@ void PGBackend::be_scan_list(
 
       // calculate the CRC32 on deep scrubs
       if (deep) {
-	be_deep_scrub(*p, seed, o, handle);
+	object_info_t oi;
+	bool trusted = false;
+	std::map<string, bufferptr>::iterator k = o.attrs.find(OI_ATTR);
+	if (trust_digests_to != eversion_t() && k != o.attrs.end()) {
+	  bufferlist bv;
+	  bv.push_back(k->second);
+	  try {
+	    bufferlist::iterator bliter = bv.begin();
+	    ::decode(oi, bliter);
+	    trusted = oi.version <= trust_digests_to;
+	  } catch (...) {
+	    // the comparison with the other shards will flag it
+	  }
+	}
+	be_deep_scrub(*p, seed, trusted ? &oi : NULL, o, handle);
+	get_parent()->get_logger()->inc(l_osd_deep_scrub_objects);
       }
 
       dout(25) << __func__ << "  " << poid << dendl;
@@ -494,6 +494,11 @@
      virtual void nop() = 0;
      virtual bool empty() const = 0;
      virtual uint64_t get_bytes_written() const = 0;
+     /// data extents of hoid written so far, false if not tracked
+     virtual bool get_dirty_extents(
+       const hobject_t &hoid,            ///< [in] object
+       interval_set<uint64_t> *extents   ///< [out] extents, see pg_log_entry_t
+       ) const { return false; }
      virtual ~PGTransaction() {}
    };
    /// Get implementation specific empty transaction
@@ -593,7 +598,7 @@
    virtual bool scrub_supported() { return false; }
    void be_scan_list(
      ScrubMap &map, const vector<hobject_t> &ls, bool deep, uint32_t seed,
-     ThreadPool::TPHandle &handle);
+     eversion_t trust_digests_to, ThreadPool::TPHandle &handle);
    enum scrub_error_type be_compare_scrub_objects(
      pg_shard_t auth_shard,
      const ScrubMap::object &auth,
@@ -620,9 +625,11 @@
      ostream &errorstream);
    virtual uint64_t be_get_ondisk_size(
      uint64_t logical_size) { assert(0); return 0; }
+   /// oi is set if the data digest it has may be used instead of reading
    virtual void be_deep_scrub(
      const hobject_t &poid,
      uint32_t seed,
+     const object_info_t *oi,
      ScrubMap::object &o,
      ThreadPool::TPHandle &handle) { assert(0); }
 
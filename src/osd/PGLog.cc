@@ -376,20 +376,19 @@ void PGLog::_merge_object_divergent_entries(
 	   << " last_divergent_update: " << last_divergent_update
 	   << dendl;
 
-  ceph::unordered_map<hobject_t, pg_log_entry_t*>::const_iterator objiter =
-    log.objects.find(hoid);
-  if (objiter != log.objects.end() &&
-      objiter->second->version >= first_divergent_update) {
+  const pg_log_entry_t *latest = log.get_latest(hoid);
+  if (latest &&
+      latest->version >= first_divergent_update) {
     /// Case 1)
-    assert(objiter->second->version > last_divergent_update);
+    assert(latest->version > last_divergent_update);
 
     dout(10) << __func__ << ": more recent entry found: "
-	     << *objiter->second << ", already merged" << dendl;
+	     << *latest << ", already merged" << dendl;
 
     // ensure missing has been updated appropriately
-    if (objiter->second->is_update()) {
+    if (latest->is_update()) {
       assert(missing.is_missing(hoid) &&
-	     missing.missing[hoid].need == objiter->second->version);
+	     missing.missing[hoid].need == latest->version);
     } else {
       assert(!missing.is_missing(hoid));
     }
@@ -20,6 +20,7 @@
 // re-include our assert to clobber boost's
 #include "include/assert.h" 
 #include "osd_types.h"
+#include "ProbeTable.h"
 #include "os/ObjectStore.h"
 #include "common/ceph_context.h"
 #include <list>
@@ -55,10 +56,79 @@ struct PGLog {
    * plus some methods to manipulate it all.
    */
   struct IndexedLog : public pg_log_t {
-    ceph::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
-    ceph::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
-    ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
+  private:
+    // ptrs into log.  be careful!  the tables hold no keys, entries are
+    // matched by their soid and reqids
+    ProbeTable<pg_log_entry_t*> objects;          // newest entry per object
+    ProbeTable<pg_log_entry_t*> caller_ops;
+    ProbeTable<pg_log_entry_t*> extra_caller_ops; // one per extra reqid
+
+    struct MatchObject {
+      const hobject_t &oid;
+      explicit MatchObject(const hobject_t &oid) : oid(oid) {}
+      bool operator()(const pg_log_entry_t *e) const {
+	return e->soid == oid;
+      }
+    };
+    struct MatchReqid {
+      const osd_reqid_t &reqid;
+      explicit MatchReqid(const osd_reqid_t &reqid) : reqid(reqid) {}
+      bool operator()(const pg_log_entry_t *e) const {
+	return e->reqid == reqid;
+      }
+    };
+    /// an entry with reqid among its extra_reqids, or entry itself
+    struct MatchExtraReqid {
+      const osd_reqid_t &reqid;
+      const pg_log_entry_t *entry;
+      MatchExtraReqid(const osd_reqid_t &reqid,
+		      const pg_log_entry_t *entry = NULL)
+	: reqid(reqid), entry(entry) {}
+      bool operator()(const pg_log_entry_t *e) const {
+	if (entry)
+	  return e == entry;
+	for (vector<pair<osd_reqid_t, version_t> >::const_iterator i =
+	       e->extra_reqids.begin();
+	     i != e->extra_reqids.end();
+	     ++i) {
+	  if (i->first == reqid)
+	    return true;
+	}
+	return false;
+      }
+    };
 
+    size_t find_object(const hobject_t &oid) const {
+      MatchObject m(oid);
+      return objects.find(probe_hash(oid), m);
+    }
+    size_t find_caller_op(const osd_reqid_t &r) const {
+      MatchReqid m(r);
+      return caller_ops.find(probe_hash(r), m);
+    }
+    void set_latest(pg_log_entry_t *e) {
+      size_t pos = find_object(e->soid);
+      if (pos != ProbeTable<pg_log_entry_t*>::npos)
+	objects.at(pos) = e;
+      else
+	objects.insert(probe_hash(e->soid), e);
+    }
+    void set_caller_op(pg_log_entry_t *e) {
+      size_t pos = find_caller_op(e->reqid);
+      if (pos != ProbeTable<pg_log_entry_t*>::npos)
+	caller_ops.at(pos) = e;
+      else
+	caller_ops.insert(probe_hash(e->reqid), e);
+    }
+    void add_extra_caller_ops(pg_log_entry_t *e) {
+      for (vector<pair<osd_reqid_t, version_t> >::const_iterator j =
+	     e->extra_reqids.begin();
+	   j != e->extra_reqids.end();
+	   ++j)
+	extra_caller_ops.insert(probe_hash(j->first), e);
+    }
+
+  public:
     // recovery pointers
     list<pg_log_entry_t>::iterator complete_to;  // not inclusive of referenced item
     version_t last_requested;           // last object requested by primary
@@ -120,11 +190,29 @@ struct PGLog {
       last_requested = 0;
     }
 
+    /// the newest entry of oid, NULL if it has none
+    const pg_log_entry_t *get_latest(const hobject_t& oid) const {
+      size_t pos = find_object(oid);
+      if (pos == ProbeTable<pg_log_entry_t*>::npos)
+	return NULL;
+      return objects.at(pos);
+    }
     bool logged_object(const hobject_t& oid) const {
-      return objects.count(oid);
+      return find_object(oid) != ProbeTable<pg_log_entry_t*>::npos;
+    }
+    /// distinct objects with entries in the log
+    size_t get_num_objects() const {
+      return objects.size();
+    }
+    size_t get_num_caller_ops() const {
+      return caller_ops.size();
     }
     bool logged_req(const osd_reqid_t &r) const {
-      return caller_ops.count(r) || extra_caller_ops.count(r);
+      if (find_caller_op(r) != ProbeTable<pg_log_entry_t*>::npos)
+	return true;
+      MatchExtraReqid m(r);
+      return extra_caller_ops.find(probe_hash(r), m) !=
+	ProbeTable<pg_log_entry_t*>::npos;
     }
     bool get_request(
       const osd_reqid_t &r,
@@ -132,24 +220,25 @@ struct PGLog {
       version_t *user_version) const {
       assert(replay_version);
       assert(user_version);
-      ceph::unordered_map<osd_reqid_t,pg_log_entry_t*>::const_iterator p;
-      p = caller_ops.find(r);
-      if (p != caller_ops.end()) {
-	*replay_version = p->second->version;
-	*user_version = p->second->user_version;
+      size_t pos = find_caller_op(r);
+      if (pos != ProbeTable<pg_log_entry_t*>::npos) {
+	*replay_version = caller_ops.at(pos)->version;
+	*user_version = caller_ops.at(pos)->user_version;
 	return true;
       }
 
       // warning: we will return *a* request for this reqid, but not
       // necessarily the most recent.
-      p = extra_caller_ops.find(r);
-      if (p != extra_caller_ops.end()) {
+      MatchExtraReqid m(r);
+      pos = extra_caller_ops.find(probe_hash(r), m);
+      if (pos != ProbeTable<pg_log_entry_t*>::npos) {
+	const pg_log_entry_t *e = extra_caller_ops.at(pos);
 	for (vector<pair<osd_reqid_t, version_t> >::const_iterator i =
-	       p->second->extra_reqids.begin();
-	     i != p->second->extra_reqids.end();
+	       e->extra_reqids.begin();
+	     i != e->extra_reqids.end();
 	     ++i) {
 	  if (i->first == r) {
-	    *replay_version = p->second->version;
+	    *replay_version = e->version;
 	    *user_version = i->second;
 	    return true;
 	  }
@@ -164,7 +253,7 @@ struct PGLog {
 			   vector<pair<osd_reqid_t, version_t> > *pls) const {
       // make sure object is present at least once before we do an
       // O(n) search.
-      if (objects.count(oid) == 0)
+      if (!logged_object(oid))
 	return;
       for (list<pg_log_entry_t>::const_reverse_iterator i = log.rbegin();
            i != log.rend();
@@ -190,17 +279,12 @@ struct PGLog {
       for (list<pg_log_entry_t>::iterator i = log.begin();
            i != log.end();
            ++i) {
-        objects[i->soid] = &(*i);
+        set_latest(&(*i));
 	if (i->reqid_is_indexed()) {
 	  //assert(caller_ops.count(i->reqid) == 0);  // divergent merge_log indexes new before unindexing old
-	  caller_ops[i->reqid] = &(*i);
-	}
-	for (vector<pair<osd_reqid_t, version_t> >::const_iterator j =
-	       i->extra_reqids.begin();
-	     j != i->extra_reqids.end();
-	     ++j) {
-	  extra_caller_ops.insert(make_pair(j->first, &(*i)));
+	  set_caller_op(&(*i));
 	}
+	add_extra_caller_ops(&(*i));
       }
 
       rollback_info_trimmed_to_riter = log.rbegin();
@@ -210,19 +294,14 @@ struct PGLog {
     }
 
     void index(pg_log_entry_t& e) {
-      if (objects.count(e.soid) == 0 || 
-          objects[e.soid]->version < e.version)
-        objects[e.soid] = &e;
+      const pg_log_entry_t *latest = get_latest(e.soid);
+      if (!latest || latest->version < e.version)
+        set_latest(&e);
       if (e.reqid_is_indexed()) {
 	//assert(caller_ops.count(i->reqid) == 0);  // divergent merge_log indexes new before unindexing old
-	caller_ops[e.reqid] = &e;
-      }
-      for (vector<pair<osd_reqid_t, version_t> >::const_iterator j =
-	     e.extra_reqids.begin();
-	   j != e.extra_reqids.end();
-	   ++j) {
-	extra_caller_ops.insert(make_pair(j->first, &e));
+	set_caller_op(&e);
       }
+      add_extra_caller_ops(&e);
     }
     void unindex() {
       objects.clear();
@@ -231,26 +310,24 @@ struct PGLog {
     }
     void unindex(pg_log_entry_t& e) {
       // NOTE: this only works if we remove from the _tail_ of the log!
-      if (objects.count(e.soid) && objects[e.soid]->version == e.version)
-        objects.erase(e.soid);
+      size_t pos = find_object(e.soid);
+      if (pos != ProbeTable<pg_log_entry_t*>::npos &&
+	  objects.at(pos)->version == e.version)
+        objects.erase(pos);
       if (e.reqid_is_indexed()) {
-	if (caller_ops.count(e.reqid) &&  // divergent merge_log indexes new before unindexing old
-	    caller_ops[e.reqid] == &e)
-	  caller_ops.erase(e.reqid);
+	pos = find_caller_op(e.reqid);
+	if (pos != ProbeTable<pg_log_entry_t*>::npos &&  // divergent merge_log indexes new before unindexing old
+	    caller_ops.at(pos) == &e)
+	  caller_ops.erase(pos);
       }
       for (vector<pair<osd_reqid_t, version_t> >::const_iterator j =
 	     e.extra_reqids.begin();
 	   j != e.extra_reqids.end();
 	   ++j) {
-	for (ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*>::iterator k =
-	       extra_caller_ops.find(j->first);
-	     k != extra_caller_ops.end() && k->first == j->first;
-	     ++k) {
-	  if (k->second == &e) {
-	    extra_caller_ops.erase(k);
-	    break;
-	  }
-	}
+	MatchExtraReqid m(j->first, &e);
+	pos = extra_caller_ops.find(probe_hash(j->first), m);
+	if (pos != ProbeTable<pg_log_entry_t*>::npos)
+	  extra_caller_ops.erase(pos);
       }
     }
 
@@ -274,16 +351,11 @@ struct PGLog {
       head = e.version;
 
       // to our index
-      objects[e.soid] = &(log.back());
+      set_latest(&(log.back()));
       if (e.reqid_is_indexed()) {
-	caller_ops[e.reqid] = &(log.back());
-      }
-      for (vector<pair<osd_reqid_t, version_t> >::const_iterator j =
-	     e.extra_reqids.begin();
-	   j != e.extra_reqids.end();
-	   ++j) {
-	extra_caller_ops.insert(make_pair(j->first, &(log.back())));
+	set_caller_op(&(log.back()));
       }
+      add_extra_caller_ops(&(log.back()));
     }
 
     void trim(
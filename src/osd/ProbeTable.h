@@ -0,0 +1,152 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_PROBE_TABLE_H
+#define CEPH_PROBE_TABLE_H
+
+#include "include/hash.h"
+#include "osd_types.h"
+
+#include <vector>
+
+/**
+ * ProbeTable - linear probing table of values with their 32 bit hash
+ *
+ * The table does not hold keys: a lookup is given the hash of the key
+ * and a matcher which tells whether a value is the one wanted, so a
+ * value that points to or indexes something holding its key costs no
+ * more than itself and the hash.  Several values may share a key, find
+ * can continue from the position of the previous match.  Erasing shifts
+ * back the values probed past the hole, there are no tombstones.
+ */
+template <typename V>
+class ProbeTable {
+  struct Slot {
+    uint32_t hash;
+    bool used;
+    V val;
+    Slot() : hash(0), used(false), val() {}
+  };
+  std::vector<Slot> slots;  ///< power of two, empty until the first insert
+  size_t count;
+
+  size_t mask() const {
+    return slots.size() - 1;
+  }
+  void grow() {
+    std::vector<Slot> old;
+    old.swap(slots);
+    slots.resize(old.empty() ? 16 : old.size() * 2);
+    for (typename std::vector<Slot>::iterator p = old.begin();
+	 p != old.end();
+	 ++p) {
+      if (!p->used)
+	continue;
+      size_t i = p->hash & mask();
+      while (slots[i].used)
+	i = (i + 1) & mask();
+      slots[i] = *p;
+    }
+  }
+
+public:
+  static const size_t npos = (size_t)-1;
+
+  ProbeTable() : count(0) {}
+
+  size_t size() const {
+    return count;
+  }
+  bool empty() const {
+    return count == 0;
+  }
+  /// bytes of the slots
+  size_t get_memory_usage() const {
+    return slots.capacity() * sizeof(Slot);
+  }
+  V &at(size_t pos) {
+    return slots[pos].val;
+  }
+  const V &at(size_t pos) const {
+    return slots[pos].val;
+  }
+
+  /**
+   * position of the first value from pos on (npos for the start of
+   * the probe sequence) of the given hash that match accepts, or npos
+   */
+  template <typename M>
+  size_t find(uint32_t hash, M &match, size_t pos = npos) const {
+    if (slots.empty())
+      return npos;
+    size_t i = pos == npos ? hash & mask() : (pos + 1) & mask();
+    while (slots[i].used) {
+      if (slots[i].hash == hash && match(slots[i].val))
+	return i;
+      i = (i + 1) & mask();
+    }
+    return npos;
+  }
+
+  void insert(uint32_t hash, const V &val) {
+    if ((count + 1) * 4 > slots.size() * 3)
+      grow();
+    size_t i = hash & mask();
+    while (slots[i].used)
+      i = (i + 1) & mask();
+    slots[i].hash = hash;
+    slots[i].used = true;
+    slots[i].val = val;
+    ++count;
+  }
+
+  /// remove the value at pos, shifting back the ones probed past it
+  void erase(size_t pos) {
+    size_t hole = pos;
+    size_t i = pos;
+    while (true) {
+      i = (i + 1) & mask();
+      if (!slots[i].used)
+	break;
+      size_t home = slots[i].hash & mask();
+      // move i into the hole unless its home lies cyclically in (hole, i]
+      if (((i - home) & mask()) >= ((i - hole) & mask())) {
+	slots[hole] = slots[i];
+	hole = i;
+      }
+    }
+    slots[hole] = Slot();
+    --count;
+  }
+
+  void clear() {
+    std::vector<Slot>().swap(slots);
+    count = 0;
+  }
+};
+
+/// hash of an object for a ProbeTable
+inline uint32_t probe_hash(const hobject_t &oid)
+{
+  static CEPH_HASH_NAMESPACE::hash<hobject_t> H;
+  uint64_t h = H(oid);
+  return (uint32_t)(h ^ (h >> 32));
+}
+
+/// hash of a reqid for a ProbeTable
+inline uint32_t probe_hash(const osd_reqid_t &r)
+{
+  uint64_t h = rjhash64(r.name.num() ^ rjhash64(r.tid) ^ r.inc);
+  return (uint32_t)(h ^ (h >> 32));
+}
+
+#endif
@@ -364,6 +364,19 @@ class RPGTransaction : public PGBackend::PGTransaction {
   set<hobject_t> temp_cleared;
   ObjectStore::Transaction *t;
   uint64_t written;
+  map<hobject_t, interval_set<uint64_t> > dirty; ///< data extents written
+  set<hobject_t> replaced;   ///< objects whose data changed untracked
+  void mark_dirty(const hobject_t &hoid, uint64_t off, uint64_t len) {
+    if (!len || replaced.count(hoid))
+      return;
+    interval_set<uint64_t> ch;
+    ch.insert(off, len);
+    dirty[hoid].union_of(ch);
+  }
+  void mark_replaced(const hobject_t &hoid) {
+    dirty.erase(hoid);
+    replaced.insert(hoid);
+  }
   const coll_t &get_coll_ct(const hobject_t &hoid) {
     if (hoid.is_temp()) {
       temp_cleared.erase(hoid);
@@ -412,16 +425,19 @@ public:
     uint32_t fadvise_flags
     ) {
     written += len;
+    mark_dirty(hoid, off, len);
     t->write(get_coll_ct(hoid), hoid, off, len, bl, fadvise_flags);
   }
   void remove(
     const hobject_t &hoid
     ) {
+    mark_replaced(hoid);
     t->remove(get_coll_rm(hoid), hoid);
   }
   void stash(
     const hobject_t &hoid,
     version_t former_version) {
+    mark_replaced(hoid);
     t->collection_move_rename(
       coll, hoid, coll,
       ghobject_t(hoid, former_version, shard_id_t::NO_SHARD));
@@ -479,6 +495,7 @@ public:
     uint64_t tooff
     ) {
     assert(get_coll(from) == get_coll_ct(to)  && get_coll(from) == coll);
+    mark_dirty(to, tooff, len);
     t->clone_range(coll, from, to, fromoff, len, tooff);
   }
   void clone(
@@ -486,12 +503,15 @@ public:
     const hobject_t &to
     ) {
     assert(get_coll(from) == get_coll_ct(to)  && get_coll(from) == coll);
+    mark_replaced(to);
     t->clone(coll, from, to);
   }
   void rename(
     const hobject_t &from,
     const hobject_t &to
     ) {
+    mark_replaced(from);
+    mark_replaced(to);
     t->collection_move_rename(
       get_coll_rm(from),
       from,
@@ -509,6 +529,8 @@ public:
     const hobject_t &hoid,
     uint64_t off
     ) {
+    // whatever lies past off may be uncovered by a later extension
+    mark_dirty(hoid, off, (uint64_t)-1 - off);
     t->truncate(get_coll(hoid), hoid, off);
   }
   void zero(
@@ -516,6 +538,7 @@ public:
     uint64_t off,
     uint64_t len
     ) {
+    mark_dirty(hoid, off, len);
     t->zero(get_coll(hoid), hoid, off, len);
   }
 
@@ -535,6 +558,19 @@ public:
     assert(to_append);
     written += to_append->written;
     to_append->written = 0;
+    for (set<hobject_t>::iterator i = to_append->replaced.begin();
+	 i != to_append->replaced.end();
+	 ++i)
+      mark_replaced(*i);
+    for (map<hobject_t, interval_set<uint64_t> >::iterator i =
+	   to_append->dirty.begin();
+	 i != to_append->dirty.end();
+	 ++i) {
+      if (!replaced.count(i->first))
+	dirty[i->first].union_of(i->second);
+    }
+    to_append->dirty.clear();
+    to_append->replaced.clear();
     t->append(*(to_append->t));
     for (set<hobject_t>::iterator i = to_append->temp_added.begin();
 	 i != to_append->temp_added.end();
@@ -558,6 +594,18 @@ public:
   uint64_t get_bytes_written() const {
     return written;
   }
+  bool get_dirty_extents(
+    const hobject_t &hoid,
+    interval_set<uint64_t> *extents) const {
+    if (replaced.count(hoid))
+      return false;
+    map<hobject_t, interval_set<uint64_t> >::const_iterator p = dirty.find(hoid);
+    if (p != dirty.end())
+      *extents = p->second;
+    else
+      extents->clear();
+    return true;
+  }
   ~RPGTransaction() { delete t; }
 };
 
@@ -610,6 +658,9 @@ void ReplicatedBackend::submit_transaction(
   assert(t->get_temp_added().size() <= 1);
   assert(t->get_temp_cleared().size() <= 1);
 
+  if (in_progress_ops.empty())
+    choose_repop_chain();
+
   const pair<unordered_map<ceph_tid_t, InProgressOp>::iterator, bool> &ret =
     in_progress_ops.insert(
       make_pair(
@@ -792,6 +843,7 @@ void ReplicatedBackend::sub_op_modify_reply(OpRequestRef op)
 void ReplicatedBackend::be_deep_scrub(
   const hobject_t &poid,
   uint32_t seed,
+  const object_info_t *oi,
   ScrubMap::object &o,
   ThreadPool::TPHandle &handle)
 {
@@ -800,25 +852,36 @@ void ReplicatedBackend::be_deep_scrub(
   bufferlist bl, hdrbl;
   int r;
   __u64 pos = 0;
-  while ( (r = store->read(
-	     coll,
-	     ghobject_t(
-	       poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
-	     pos,
-	     cct->_conf->osd_deep_scrub_stride, bl,
-	     true)) > 0) {
-    handle.reset_tp_timeout();
-    h << bl;
-    pos += bl.length();
-    bl.clear();
-  }
-  if (r == -EIO) {
-    dout(25) << __func__ << "  " << poid << " got "
-	     << r << " on read, read_error" << dendl;
-    o.read_error = true;
+  // the object info digest is a crc32c seeded with -1
+  if (oi && oi->is_data_digest() && seed == 0xffffffff) {
+    dout(20) << __func__ << " " << poid << " unchanged since "
+	     << oi->version << ", using data digest 0x" << std::hex
+	     << oi->data_digest << std::dec << dendl;
+    o.digest = oi->data_digest;
+    o.digest_present = true;
+    get_parent()->get_logger()->inc(l_osd_deep_scrub_objects_skipped);
+  } else {
+    while ( (r = store->read(
+	       coll,
+	       ghobject_t(
+		 poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+	       pos,
+	       cct->_conf->osd_deep_scrub_stride, bl,
+	       true)) > 0) {
+      handle.reset_tp_timeout();
+      h << bl;
+      pos += bl.length();
+      bl.clear();
+    }
+    if (r == -EIO) {
+      dout(25) << __func__ << "  " << poid << " got "
+	       << r << " on read, read_error" << dendl;
+      o.read_error = true;
+    }
+    o.digest = h.digest();
+    o.digest_present = true;
+    get_parent()->get_logger()->inc(l_osd_deep_scrub_bytes, pos);
   }
-  o.digest = h.digest();
-  o.digest_present = true;
 
   bl.clear();
   r = store->omap_get_header(
@@ -1101,6 +1164,33 @@ void ReplicatedBackend::issue_op(
     if (op->op)
       op->op->mark_sub_op_sent(ss.str());
   }
+
+  if (!repop_chain.empty()) {
+    // the first replica passes it on to the rest; all reply to us
+    const pg_shard_t &peer = repop_chain.front();
+    MOSDRepOp *wr = static_cast<MOSDRepOp*>(
+      generate_subop<MOSDRepOp, MSG_OSD_REPOP>(
+	soid,
+	at_version,
+	tid,
+	reqid,
+	pg_trim_to,
+	pg_trim_rollback_to,
+	new_temp_oid,
+	discard_temp_oid,
+	log_entries,
+	hset_hist,
+	op,
+	op_t,
+	peer,
+	parent->get_shard_info().find(peer)->second));
+    wr->forward_to.assign(repop_chain.begin() + 1, repop_chain.end());
+    get_parent()->get_logger()->inc(l_osd_chain_repop);
+    get_parent()->send_message_osd_cluster(
+      peer.osd, wr, get_osdmap()->get_epoch());
+    return;
+  }
+
   for (set<pg_shard_t>::const_iterator i =
 	 parent->get_actingbackfill_shards().begin();
        i != parent->get_actingbackfill_shards().end();
@@ -1151,6 +1241,59 @@ void ReplicatedBackend::issue_op(
   }
 }
 
+void ReplicatedBackend::choose_repop_chain()
+{
+  repop_chain.clear();
+  // backfill targets may be sent empty transactions, so only chain when
+  // every replica gets the whole op, and there are at least two of them
+  const set<pg_shard_t> &peers = parent->get_actingbackfill_shards();
+  if (!get_parent()->get_pool().has_flag(pg_pool_t::FLAG_CHAIN_REPLICATION) ||
+      !(parent->min_peer_features() & CEPH_FEATURE_OSD_CHAIN_REPLICATION) ||
+      peers.size() < 3 ||
+      peers.size() != parent->get_acting_shards().size())
+    return;
+  for (set<pg_shard_t>::const_iterator i = peers.begin();
+       i != peers.end();
+       ++i) {
+    if (*i != parent->whoami_shard())
+      repop_chain.push_back(*i);
+  }
+  dout(10) << __func__ << " " << repop_chain << dendl;
+}
+
+/**
+ * Pass a chained repop on to the next replica before we apply it, so
+ * that the replicas write it at the same time.  The primary stays the
+ * sender, the next replica replies to it directly.
+ */
+void ReplicatedBackend::forward_repop(OpRequestRef op)
+{
+  MOSDRepOp *m = static_cast<MOSDRepOp *>(op->get_req());
+  assert(!m->forward_to.empty());
+  const pg_shard_t &peer = m->forward_to.front();
+  MOSDRepOp *wr = new MOSDRepOp(
+    m->reqid, m->from,
+    spg_t(get_info().pgid.pgid, peer.shard),
+    m->poid, m->acks_wanted,
+    m->map_epoch,
+    m->get_tid(), m->version);
+  wr->set_data(m->get_data());
+  wr->logbl = m->logbl;
+  wr->pg_stats = m->pg_stats;
+  wr->pg_trim_to = m->pg_trim_to;
+  wr->pg_trim_rollback_to = m->pg_trim_rollback_to;
+  wr->new_temp_oid = m->new_temp_oid;
+  wr->discard_temp_oid = m->discard_temp_oid;
+  wr->updated_hit_set_history = m->updated_hit_set_history;
+  wr->forward_to.assign(m->forward_to.begin() + 1, m->forward_to.end());
+  wr->set_priority(m->get_priority());
+
+  dout(20) << __func__ << " " << *wr << " to osd." << peer << dendl;
+  get_parent()->get_logger()->inc(l_osd_chain_repop_forward);
+  get_parent()->send_message_osd_cluster(
+    peer.osd, wr, get_osdmap()->get_epoch());
+}
+
 // sub op modify
 void ReplicatedBackend::sub_op_modify(OpRequestRef op) {
   Message *m = op->get_req();
@@ -1158,6 +1301,10 @@ void ReplicatedBackend::sub_op_modify(OpRequestRef op) {
   if (msg_type == MSG_OSD_SUBOP) {
     sub_op_modify_impl<MOSDSubOp, MSG_OSD_SUBOP>(op);
   } else if (msg_type == MSG_OSD_REPOP) {
+    MOSDRepOp *rm = static_cast<MOSDRepOp *>(m);
+    rm->finish_decode();
+    if (!rm->forward_to.empty())
+      forward_repop(op);
     sub_op_modify_impl<MOSDRepOp, MSG_OSD_REPOP>(op);
   } else {
     assert(0);
@@ -1188,7 +1335,8 @@ void ReplicatedBackend::sub_op_modify_impl(OpRequestRef op)
   // we better not be missing this.
   assert(!parent->get_log().get_missing().is_missing(soid));
 
-  int ackerosd = m->get_source().num();
+  // a forwarded op is acked to the primary, not to the replica before us
+  int ackerosd = m->from.osd;
 
   op->mark_started();
 
@@ -1547,11 +1695,11 @@ void ReplicatedBackend::prepare_pull(
 	     << " at version " << pmissing.missing.find(soid)->second.have
 	     << " rather than at version " << v << dendl;
     v = pmissing.missing.find(soid)->second.have;
-    assert(get_parent()->get_log().get_log().objects.count(soid) &&
-	   (get_parent()->get_log().get_log().objects.find(soid)->second->op ==
+    assert(get_parent()->get_log().get_log().logged_object(soid) &&
+	   (get_parent()->get_log().get_log().get_latest(soid)->op ==
 	    pg_log_entry_t::LOST_REVERT) &&
-	   (get_parent()->get_log().get_log().objects.find(
-	     soid)->second->reverting_to ==
+	   (get_parent()->get_log().get_log().get_latest(
+	     soid)->reverting_to ==
 	    v));
   }
 
@@ -1603,6 +1751,68 @@ void ReplicatedBackend::prepare_pull(
   pi.recovery_progress = op.recovery_progress;
 }
 
+/*
+ * If peer has an older version of head and our log has the extents of
+ * every write to head since that version, only those extents need to be
+ * pushed, the peer applies them to its copy.
+ */
+bool ReplicatedBackend::calc_dirty_subset(
+  ObjectContextRef obc, const hobject_t& head, pg_shard_t peer,
+  interval_set<uint64_t>& data_subset, eversion_t *base_version)
+{
+  if (!cct->_conf->osd_recover_dirty_extents ||
+      !(get_parent()->min_peer_features() & CEPH_FEATURE_OSD_PARTIAL_RECOVERY))
+    return false;
+
+  const pg_missing_t &pmissing = get_parent()->get_shard_missing(peer);
+  map<hobject_t, pg_missing_t::item>::const_iterator m =
+    pmissing.missing.find(head);
+  if (m == pmissing.missing.end() || m->second.have == eversion_t())
+    return false;
+  eversion_t have = m->second.have;
+  const pg_log_t &log = get_parent()->get_log().get_log();
+  if (have < log.tail) {
+    dout(15) << __func__ << " " << head << " peer has " << have
+	     << ", before log tail " << log.tail << dendl;
+    return false;
+  }
+
+  // walk back to the first write since have
+  interval_set<uint64_t> dirty;
+  bool covered = false;
+  for (list<pg_log_entry_t>::const_reverse_iterator p = log.log.rbegin();
+       p != log.log.rend() && p->version > have;
+       ++p) {
+    if (p->soid != head || p->version > obc->obs.oi.version)
+      continue;
+    if (!p->has_dirty_extents) {
+      dout(15) << __func__ << " " << head << " no dirty extents in " << *p
+	       << dendl;
+      return false;
+    }
+    dirty.union_of(p->dirty_extents);
+    covered = p->prior_version == have;
+  }
+  if (!covered)
+    return false;
+
+  interval_set<uint64_t> object;
+  if (obc->obs.oi.size)
+    object.insert(0, obc->obs.oi.size);
+  dirty.intersection_of(object);
+  data_subset.swap(dirty);
+  *base_version = have;
+
+  PerfCounters *logger = get_parent()->get_logger();
+  logger->inc(l_osd_push_partial);
+  logger->inc(l_osd_push_partial_saved_bytes,
+	      obc->obs.oi.size - data_subset.size());
+  dout(10) << __func__ << " " << head << " peer has " << have
+	   << ", pushing " << data_subset << " of " << obc->obs.oi.size
+	   << dendl;
+  return true;
+}
+
 /*
  * intelligently push an object to a replica.  make use of existing
  * clones/heads and dup data ranges where possible.
@@ -1653,6 +1863,14 @@ void ReplicatedBackend::prep_push_to_replica(
 		       pi->second.last_backfill,
 		       data_subset, clone_subsets);
   } else if (soid.snap == CEPH_NOSNAP) {
+    // only what changed since the replica's version?
+    eversion_t base_version;
+    if (calc_dirty_subset(obc, soid, peer, data_subset, &base_version)) {
+      prep_push(obc, soid, peer, oi.version, data_subset, clone_subsets, pop,
+		base_version);
+      return;
+    }
+
     // pushing head or unversioned object.
     // base this on partially on replica's clones?
     SnapSetContext *ssc = obc->ssc;
@@ -1701,7 +1919,8 @@ void ReplicatedBackend::prep_push(
   eversion_t version,
   interval_set<uint64_t> &data_subset,
   map<hobject_t, interval_set<uint64_t> >& clone_subsets,
-  PushOp *pop)
+  PushOp *pop,
+  eversion_t base_version)
 {
   get_parent()->begin_peer_recover(peer, soid);
   // take note.
@@ -1713,6 +1932,7 @@ void ReplicatedBackend::prep_push(
   pi.recovery_info.soid = soid;
   pi.recovery_info.oi = obc->obs.oi;
   pi.recovery_info.version = version;
+  pi.recovery_info.base_version = base_version;
   pi.recovery_progress.first = true;
   pi.recovery_progress.data_recovered_to = 0;
   pi.recovery_progress.data_complete = 0;
@@ -1774,8 +1994,10 @@ void ReplicatedBackend::submit_push_data(
   map<string, bufferlist> &omap_entries,
   ObjectStore::Transaction *t)
 {
+  // the extents pushed apply to our copy of the object
+  bool partial = recovery_info.base_version != eversion_t();
   coll_t target_coll;
-  if (first && complete) {
+  if (first && complete && !partial) {
     target_coll = coll;
   } else {
     dout(10) << __func__ << ": Creating oid "
@@ -1785,10 +2007,26 @@ void ReplicatedBackend::submit_push_data(
   }
 
   if (first) {
-    get_parent()->on_local_recover_start(recovery_info.soid, t);
     t->remove(get_temp_coll(t), recovery_info.soid);
+    if (partial) {
+      dout(10) << __func__ << ": " << recovery_info.soid << " based on "
+	       << recovery_info.base_version << ", applying "
+	       << recovery_info.copy_subset << dendl;
+      t->collection_move(target_coll, coll, recovery_info.soid);
+    }
+    get_parent()->on_local_recover_start(recovery_info.soid, t);
     t->touch(target_coll, recovery_info.soid);
     t->truncate(target_coll, recovery_info.soid, recovery_info.size);
+    if (partial) {
+      // holes in the pushed extents are not sent
+      for (interval_set<uint64_t>::const_iterator p =
+	     recovery_info.copy_subset.begin();
+	   p != recovery_info.copy_subset.end();
+	   ++p)
+	t->zero(target_coll, recovery_info.soid, p.get_start(), p.get_len());
+      t->rmattrs(target_coll, recovery_info.soid);
+      t->omap_clear(target_coll, recovery_info.soid);
+    }
     t->omap_setheader(target_coll, recovery_info.soid, omap_header);
   }
   uint64_t off = 0;
@@ -1808,7 +2046,7 @@ void ReplicatedBackend::submit_push_data(
 	      attrs);
 
   if (complete) {
-    if (!first) {
+    if (target_coll != coll) {
       dout(10) << __func__ << ": Removing oid "
 	       << recovery_info.soid << " from the temp collection" << dendl;
       clear_temp_obj(recovery_info.soid);
@@ -1969,6 +2207,11 @@ void ReplicatedBackend::handle_push(
     pop.after_progress.omap_complete;
 
   response->soid = pop.recovery_info.soid;
+  if (first && pop.recovery_info.base_version != eversion_t() &&
+      !have_push_base(pop.recovery_info)) {
+    response->need_full_push = true;
+    return;
+  }
   submit_push_data(pop.recovery_info,
 		   first,
 		   complete,
@@ -1987,6 +2230,30 @@ void ReplicatedBackend::handle_push(
       t);
 }
 
+/*
+ * A partial push only carries what changed since base_version, check
+ * that this is the version of our copy before applying it.
+ */
+bool ReplicatedBackend::have_push_base(const ObjectRecoveryInfo &recovery_info)
+{
+  bufferlist bv;
+  int r = store->getattr(coll, recovery_info.soid, OI_ATTR, bv);
+  if (r < 0) {
+    dout(10) << __func__ << " " << recovery_info.soid << " base "
+	     << recovery_info.base_version << " but getattr got " << r
+	     << ", asking for a full push" << dendl;
+    return false;
+  }
+  object_info_t oi(bv);
+  if (oi.version != recovery_info.base_version) {
+    dout(10) << __func__ << " " << recovery_info.soid << " base "
+	     << recovery_info.base_version << " but we have " << oi.version
+	     << ", asking for a full push" << dendl;
+    return false;
+  }
+  return true;
+}
+
 void ReplicatedBackend::send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &pushes)
 {
   for (map<pg_shard_t, vector<PushOp> >::iterator i = pushes.begin();
@@ -2278,6 +2545,28 @@ bool ReplicatedBackend::handle_push_reply(pg_shard_t peer, PushReplyOp &op, Push
   } else {
     PushInfo *pi = &pushing[soid][peer];
 
+    if (op.need_full_push && pi->recovery_info.base_version != eversion_t()) {
+      dout(10) << " osd." << peer << " does not have " << soid << " "
+	       << pi->recovery_info.base_version << ", pushing all of it"
+	       << dendl;
+      get_parent()->get_logger()->inc(l_osd_push_partial_fallback);
+      pi->recovery_info.base_version = eversion_t();
+      pi->recovery_info.copy_subset.clear();
+      if (pi->recovery_info.size)
+	pi->recovery_info.copy_subset.insert(0, pi->recovery_info.size);
+      pi->recovery_info.clone_subset.clear();
+      pi->recovery_progress = ObjectRecoveryProgress();
+      pi->stat = object_stat_sum_t();
+      ObjectRecoveryProgress new_progress;
+      int r = build_push_op(
+	pi->recovery_info,
+	pi->recovery_progress, &new_progress, reply,
+	&(pi->stat));
+      assert(r == 0);
+      pi->recovery_progress = new_progress;
+      return true;
+    }
+
     if (!pi->recovery_progress.data_complete) {
       dout(10) << " pushing more from, "
 	       << pi->recovery_progress.data_recovered_to
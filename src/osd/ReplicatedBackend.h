@@ -251,6 +251,7 @@ private:
     ObjectStore::Transaction *t);
   void handle_push(pg_shard_t from, PushOp &op, PushReplyOp *response,
 		   ObjectStore::Transaction *t);
+  bool have_push_base(const ObjectRecoveryInfo &recovery_info);
 
   static void trim_pushed_data(const interval_set<uint64_t> &copy_subset,
 			       const interval_set<uint64_t> &intervals_received,
@@ -312,7 +313,12 @@ private:
 		 eversion_t version,
 		 interval_set<uint64_t> &data_subset,
 		 map<hobject_t, interval_set<uint64_t> >& clone_subsets,
-		 PushOp *op);
+		 PushOp *op,
+		 eversion_t base_version = eversion_t());
+  bool calc_dirty_subset(ObjectContextRef obc, const hobject_t& head,
+			 pg_shard_t peer,
+			 interval_set<uint64_t>& data_subset,
+			 eversion_t *base_version);
   void calc_head_subsets(ObjectContextRef obc, SnapSet& snapset, const hobject_t& head,
 			 const pg_missing_t& missing,
 			 const hobject_t &last_backfill,
@@ -352,6 +358,15 @@ private:
     }
   };
   unordered_map<ceph_tid_t, InProgressOp> in_progress_ops;
+
+  /**
+   * Replicas the repops are chained through, in order, or empty if the
+   * primary sends each replica its own.  It is only chosen again when no
+   * op is in progress: a replica sent some ops by the primary and some
+   * through the chain could otherwise get them out of order.
+   */
+  vector<pg_shard_t> repop_chain;
+  void choose_repop_chain();
 public:
   PGTransaction *get_transaction();
   friend class C_OSD_OnOpCommit;
@@ -409,6 +424,7 @@ private:
   void sub_op_modify(OpRequestRef op);
   template<typename T, int MSGTYPE>
   void sub_op_modify_impl(OpRequestRef op);
+  void forward_repop(OpRequestRef op);
 
   struct RepModify {
     OpRequestRef op;
@@ -449,6 +465,7 @@ private:
   void be_deep_scrub(
     const hobject_t &obj,
     uint32_t seed,
+    const object_info_t *oi,
     ScrubMap::object &o,
     ThreadPool::TPHandle &handle);
   uint64_t be_get_ondisk_size(uint64_t logical_size) { return logical_size; }
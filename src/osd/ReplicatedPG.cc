@@ -208,7 +208,7 @@ void ReplicatedPG::on_local_recover(
   if (pg_log.get_missing().is_missing(recovery_info.soid) &&
       pg_log.get_missing().missing.find(recovery_info.soid)->second.need > recovery_info.version) {
     assert(is_primary());
-    const pg_log_entry_t *latest = pg_log.get_log().objects.find(recovery_info.soid)->second;
+    const pg_log_entry_t *latest = pg_log.get_log().get_latest(recovery_info.soid);
     if (latest->op == pg_log_entry_t::LOST_REVERT &&
 	latest->reverting_to == recovery_info.version) {
       dout(10) << " got old revert version " << recovery_info.version
@@ -271,6 +271,9 @@ void ReplicatedPG::on_local_recover(
       get_osdmap()->get_epoch(),
       info.last_complete));
 
+  // deep scrub must read what this shard got since the last one
+  info.last_recovered_at = info.last_update;
+
   // update pg
   dirty_info = true;
   write_if_dirty(*t);
@@ -4270,6 +4273,7 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
       ++ctx->num_write;
       { // write
         __u32 seq = oi.truncate_seq;
+	uint64_t orig_size = oi.size;
 	tracepoint(osd, do_osd_op_pre_write, soid.oid.name.c_str(), soid.snap.val, oi.size, seq, op.extent.offset, op.extent.length, op.extent.truncate_size, op.extent.truncate_seq);
 	if (op.extent.length != osd_op.indata.length()) {
 	  result = -EINVAL;
@@ -4339,11 +4343,16 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	} else {
 	  t->write(soid, op.extent.offset, op.extent.length, osd_op.indata, op.flags);
 	}
+	bool appending = obs.exists && !oi.is_whiteout() &&
+	  op.extent.offset == orig_size && oi.size == orig_size;
 	write_update_size_and_usage(ctx->delta_stats, oi, ctx->modified_ranges,
 				    op.extent.offset, op.extent.length, true);
 	maybe_create_new_object(ctx);
 	if (op.extent.offset == 0 && op.extent.length == oi.size)
 	  obs.oi.set_data_digest(osd_op.indata.crc32c(-1));
+	else if (appending && oi.is_data_digest())
+	  // crc32c carries on from the digest of the data before
+	  obs.oi.set_data_digest(osd_op.indata.crc32c(oi.data_digest));
 	else
 	  obs.oi.clear_data_digest();
       }
@@ -6006,6 +6015,11 @@ void ReplicatedPG::finish_ctx(OpContext *ctx, int log_op_type, bool maintain_ssc
 				    ctx->obs->oi.version,
 				    ctx->user_at_version, ctx->reqid,
 				    ctx->mtime));
+  if (cct->_conf->osd_recover_dirty_extents && soid.snap == CEPH_NOSNAP &&
+      (log_op_type == pg_log_entry_t::MODIFY ||
+       log_op_type == pg_log_entry_t::CLEAN))
+    ctx->log.back().has_dirty_extents =
+      ctx->op_t->get_dirty_extents(soid, &ctx->log.back().dirty_extents);
   if (soid.snap < CEPH_NOSNAP) {
     set<snapid_t> _snaps(ctx->new_obs.oi.snaps.begin(),
 			 ctx->new_obs.oi.snaps.end());
@@ -7820,10 +7834,10 @@ void ReplicatedPG::populate_obc_watchers(ObjectContextRef obc)
   assert(is_active());
   assert((recovering.count(obc->obs.oi.soid) ||
 	  !is_missing_object(obc->obs.oi.soid)) ||
-	 (pg_log.get_log().objects.count(obc->obs.oi.soid) && // or this is a revert... see recover_primary()
-	  pg_log.get_log().objects.find(obc->obs.oi.soid)->second->op ==
+	 (pg_log.get_log().logged_object(obc->obs.oi.soid) && // or this is a revert... see recover_primary()
+	  pg_log.get_log().get_latest(obc->obs.oi.soid)->op ==
 	    pg_log_entry_t::LOST_REVERT &&
-	  pg_log.get_log().objects.find(obc->obs.oi.soid)->second->reverting_to ==
+	  pg_log.get_log().get_latest(obc->obs.oi.soid)->reverting_to ==
 	    obc->obs.oi.version));
 
   dout(10) << "populate_obc_watchers " << obc->obs.oi.soid << dendl;
@@ -7940,8 +7954,8 @@ ObjectContextRef ReplicatedPG::get_object_context(const hobject_t& soid,
   assert(
     attrs || !pg_log.get_missing().is_missing(soid) ||
     // or this is a revert... see recover_primary()
-    (pg_log.get_log().objects.count(soid) &&
-      pg_log.get_log().objects.find(soid)->second->op ==
+    (pg_log.get_log().logged_object(soid) &&
+      pg_log.get_log().get_latest(soid)->op ==
       pg_log_entry_t::LOST_REVERT));
   ObjectContextRef obc = object_contexts.lookup(soid);
   osd->logger->inc(l_osd_object_ctx_cache_total);
@@ -9427,7 +9441,7 @@ int ReplicatedPG::recover_primary(int max, ThreadPool::TPHandle &handle)
   dout(25) << "recover_primary " << missing.missing << dendl;
 
   // look at log!
-  pg_log_entry_t *latest = 0;
+  const pg_log_entry_t *latest = 0;
   int started = 0;
   int skipped = 0;
 
@@ -9439,8 +9453,8 @@ int ReplicatedPG::recover_primary(int max, ThreadPool::TPHandle &handle)
     hobject_t soid;
     version_t v = p->first;
 
-    if (pg_log.get_log().objects.count(p->second)) {
-      latest = pg_log.get_log().objects.find(p->second)->second;
+    if (pg_log.get_log().logged_object(p->second)) {
+      latest = pg_log.get_log().get_latest(p->second);
       assert(latest->is_update());
       soid = latest->soid;
     } else {
@@ -10821,6 +10835,17 @@ bool ReplicatedPG::agent_work(int start_max)
 					  &ls, &next);
   assert(r >= 0);
   dout(20) << __func__ << " got " << ls.size() << " objects" << dendl;
+
+  // look the whole batch up in each HitSet in turn
+  vector<int> atimes(ls.size(), -1);
+  if (agent_state->evict_mode == TierAgentState::EVICT_MODE_SOME && hit_set)
+    agent_estimate_atimes(ls, &atimes);
+
+  // the further over the dirty target, the more flushes at once
+  int max_flush_ops = MAX(1, (int)(((uint64_t)g_conf->osd_agent_max_ops *
+				     agent_state->flush_effort + 999999) /
+				    1000000));
+
   int started = 0;
   for (vector<hobject_t>::iterator p = ls.begin();
        p != ls.end();
@@ -10877,10 +10902,11 @@ bool ReplicatedPG::agent_work(int start_max)
     }
 
     if (agent_state->flush_mode != TierAgentState::FLUSH_MODE_IDLE &&
+	(int)agent_flush_ops.read() < max_flush_ops &&
 	agent_maybe_flush(obc))
       ++started;
     if (agent_state->evict_mode != TierAgentState::EVICT_MODE_IDLE &&
-	agent_maybe_evict(obc))
+	agent_maybe_evict(obc, atimes[p - ls.begin()]))
       ++started;
     if (started >= start_max) {
       // If finishing early, set "next" to the next object
@@ -10995,10 +11021,12 @@ struct C_AgentFlushStartStop : public Context {
   ReplicatedPGRef pg;
   hobject_t oid;
   C_AgentFlushStartStop(ReplicatedPG *p, hobject_t o) : pg(p), oid(o) {
+    pg->agent_flush_ops.inc();
     pg->osd->agent_start_op(oid);
   }
   void finish(int r) {
     pg->osd->agent_finish_op(oid);
+    pg->agent_flush_ops.dec();
   }
 };
 
@@ -11051,10 +11079,11 @@ bool ReplicatedPG::agent_maybe_flush(ObjectContextRef& obc)
   }
 
   osd->logger->inc(l_osd_agent_flush);
+  osd->logger->inc(l_osd_agent_flush_bytes, obc->obs.oi.size);
   return true;
 }
 
-bool ReplicatedPG::agent_maybe_evict(ObjectContextRef& obc)
+bool ReplicatedPG::agent_maybe_evict(ObjectContextRef& obc, int atime)
 {
   const hobject_t& soid = obc->obs.oi.soid;
   if (obc->obs.oi.is_dirty()) {
@@ -11080,9 +11109,7 @@ bool ReplicatedPG::agent_maybe_evict(ObjectContextRef& obc)
 
   if (agent_state->evict_mode != TierAgentState::EVICT_MODE_FULL) {
     // is this object old and/or cold enough?
-    int atime = -1, temp = 0;
-    if (hit_set)
-      agent_estimate_atime_temp(soid, &atime, NULL /*FIXME &temp*/);
+    int temp = 0;  // FIXME
 
     uint64_t atime_upper = 0, atime_lower = 0;
     if (atime < 0 && obc->obs.oi.mtime != utime_t()) {
@@ -11140,6 +11167,7 @@ bool ReplicatedPG::agent_maybe_evict(ObjectContextRef& obc)
   }
 
   dout(10) << __func__ << " evicting " << obc->obs.oi << dendl;
+  uint64_t size = obc->obs.oi.size;
   RepGather *repop = simple_repop_create(obc);
   OpContext *ctx = repop->ctx;
   ctx->lock_to_release = OpContext::W_LOCK;
@@ -11153,6 +11181,7 @@ bool ReplicatedPG::agent_maybe_evict(ObjectContextRef& obc)
   simple_repop_submit(repop);
   osd->logger->inc(l_osd_tier_evict);
   osd->logger->inc(l_osd_agent_evict);
+  osd->logger->inc(l_osd_agent_evict_bytes, size);
   return true;
 }
 
@@ -11162,7 +11191,7 @@ void ReplicatedPG::agent_stop()
   if (agent_state && !agent_state->is_idle()) {
     agent_state->evict_mode = TierAgentState::EVICT_MODE_IDLE;
     agent_state->flush_mode = TierAgentState::FLUSH_MODE_IDLE;
-    osd->agent_disable_pg(this, agent_state->evict_effort);
+    osd->agent_disable_pg(this, agent_state->get_priority());
   }
 }
 
@@ -11172,7 +11201,7 @@ void ReplicatedPG::agent_delay()
   if (agent_state && !agent_state->is_idle()) {
     assert(agent_state->delaying == false);
     agent_state->delaying = true;
-    osd->agent_disable_pg(this, agent_state->evict_effort);
+    osd->agent_disable_pg(this, agent_state->get_priority());
   }
 }
 
@@ -11289,6 +11318,29 @@ bool ReplicatedPG::agent_choose_mode(bool restart, OpRequestRef op)
     flush_mode = TierAgentState::FLUSH_MODE_ACTIVE;
   }
 
+  // set flush effort in [0..1] range based on where we are between the
+  // dirty and the full targets
+  unsigned flush_effort = 0;
+  if (flush_mode == TierAgentState::FLUSH_MODE_ACTIVE) {
+    uint64_t full_target = MAX(pool.info.cache_target_full_ratio_micro,
+			       flush_target + 1);
+    if (dirty_micro >= full_target) {
+      flush_effort = 1000000;
+    } else {
+      uint64_t over = dirty_micro > flush_target ? dirty_micro - flush_target : 0;
+      uint64_t span = full_target - flush_target;
+      flush_effort = MAX(over * 1000000 / span,
+			 (unsigned)(1000000.0 * g_conf->osd_agent_min_flush_effort));
+      flush_effort = MIN(flush_effort, 1000000u);
+    }
+    // quantize it as the evict effort below
+    uint64_t inc = g_conf->osd_agent_quantize_effort * 1000000;
+    assert(inc > 0);
+    flush_effort -= flush_effort % inc;
+    if (flush_effort < inc)
+      flush_effort = inc;
+  }
+
   // evict mode
   TierAgentState::evict_mode_t evict_mode = TierAgentState::EVICT_MODE_IDLE;
   unsigned evict_effort = 0;
@@ -11349,7 +11401,15 @@ bool ReplicatedPG::agent_choose_mode(bool restart, OpRequestRef op)
     }
     agent_state->evict_mode = evict_mode;
   }
-  uint64_t old_effort = agent_state->evict_effort;
+  uint64_t old_priority = agent_state->get_priority();
+  if (flush_effort != agent_state->flush_effort) {
+    dout(5) << __func__ << " flush_effort "
+	    << ((float)agent_state->flush_effort / 1000000.0)
+	    << " -> "
+	    << ((float)flush_effort / 1000000.0)
+	    << dendl;
+    agent_state->flush_effort = flush_effort;
+  }
   if (evict_effort != agent_state->evict_effort) {
     dout(5) << __func__ << " evict_effort "
 	    << ((float)agent_state->evict_effort / 1000000.0)
@@ -11359,49 +11419,43 @@ bool ReplicatedPG::agent_choose_mode(bool restart, OpRequestRef op)
     agent_state->evict_effort = evict_effort;
   }
 
-  // NOTE: we are using evict_effort as a proxy for *all* agent effort
-  // (including flush).  This is probably fine (they should be
-  // correlated) but it is not precisely correct.
+  // the pgs with the most to flush or evict come first
   if (agent_state->is_idle()) {
     if (!restart && !old_idle) {
-      osd->agent_disable_pg(this, old_effort);
+      osd->agent_disable_pg(this, old_priority);
     }
   } else {
     if (restart || old_idle) {
-      osd->agent_enable_pg(this, agent_state->evict_effort);
-    } else if (old_effort != agent_state->evict_effort) {
-      osd->agent_adjust_pg(this, old_effort, agent_state->evict_effort);
+      osd->agent_enable_pg(this, agent_state->get_priority());
+    } else if (old_priority != agent_state->get_priority()) {
+      osd->agent_adjust_pg(this, old_priority, agent_state->get_priority());
     }
   }
   return requeued;
 }
 
-void ReplicatedPG::agent_estimate_atime_temp(const hobject_t& oid,
-					     int *atime, int *temp)
+void ReplicatedPG::agent_estimate_atimes(const vector<hobject_t>& ls,
+					 vector<int> *atimes)
 {
   assert(hit_set);
-  *atime = -1;
-  if (temp)
-    *temp = 0;
-  if (hit_set->contains(oid)) {
-    *atime = 0;
-    if (temp)
-      ++(*temp);
-    else
-      return;
+  assert(atimes->size() == ls.size());
+  size_t left = ls.size();
+  for (size_t i = 0; i < ls.size(); ++i) {
+    if (hit_set->contains(ls[i])) {
+      (*atimes)[i] = 0;
+      --left;
+    }
   }
   time_t now = ceph_clock_now(NULL).sec();
   for (map<time_t,HitSetRef>::reverse_iterator p =
 	 agent_state->hit_set_map.rbegin();
-       p != agent_state->hit_set_map.rend();
+       left && p != agent_state->hit_set_map.rend();
        ++p) {
-    if (p->second->contains(oid)) {
-      if (*atime < 0)
-	*atime = now - p->first;
-      if (temp)
-	++(*temp);
-      else
-	return;
+    for (size_t i = 0; i < ls.size(); ++i) {
+      if ((*atimes)[i] < 0 && p->second->contains(ls[i])) {
+	(*atimes)[i] = now - p->first;
+	--left;
+      }
     }
   }
 }
@@ -921,6 +921,7 @@ protected:
 
   // agent
   boost::scoped_ptr<TierAgentState> agent_state;
+  atomic_t agent_flush_ops;  ///< agent flushes in flight
 
   friend struct C_AgentFlushStartStop;
   friend struct C_HitSetFlushing;
@@ -928,17 +929,18 @@ protected:
   void agent_setup();       ///< initialize agent state
   bool agent_work(int max); ///< entry point to do some agent work
   bool agent_maybe_flush(ObjectContextRef& obc);  ///< maybe flush
-  bool agent_maybe_evict(ObjectContextRef& obc);  ///< maybe evict
+  bool agent_maybe_evict(ObjectContextRef& obc, int atime);  ///< maybe evict
 
   void agent_load_hit_sets();  ///< load HitSets, if needed
 
-  /// estimate object atime and temperature
+  /// estimate the atimes of a batch of objects, going over the HitSets
+  /// once for all of them
   ///
-  /// @param oid [in] object name
-  /// @param atime [out] seconds since last access (lower bound)
-  /// @param temperature [out] relative temperature (# hitset bins we appear in)
-  void agent_estimate_atime_temp(const hobject_t& oid,
-				 int *atime, int *temperature);
+  /// @param ls [in] object names
+  /// @param atimes [in,out] seconds since last access (lower bound) of
+  ///                       each, left at -1 if not in any HitSet
+  void agent_estimate_atimes(const vector<hobject_t>& ls,
+			     vector<int> *atimes);
 
   /// stop the agent
   void agent_stop();
@@ -69,15 +69,25 @@ struct TierAgentState {
   /// distributed) that i should aim to evict.
   unsigned evict_effort;
 
+  /// share of the agent ops i may use for flushing, by how far i am
+  /// over the dirty target
+  unsigned flush_effort;
+
   TierAgentState()
     : started(0),
       delaying(false),
       hist_age(0),
       flush_mode(FLUSH_MODE_IDLE),
       evict_mode(EVICT_MODE_IDLE),
-      evict_effort(0)
+      evict_effort(0),
+      flush_effort(0)
   {}
 
+  /// priority in the OSD's agent queue
+  unsigned get_priority() const {
+    return MAX(evict_effort, flush_effort);
+  }
+
   /// false if we have any work to do
   bool is_idle() const {
     return
@@ -106,6 +116,7 @@ struct TierAgentState {
     f->dump_string("flush_mode", get_flush_mode_name());
     f->dump_string("evict_mode", get_evict_mode_name());
     f->dump_unsigned("evict_effort", evict_effort);
+    f->dump_unsigned("flush_effort", flush_effort);
     f->dump_stream("position") << position;
     f->open_object_section("atime_hist");
     atime_hist.dump(f);
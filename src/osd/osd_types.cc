@@ -943,6 +943,10 @@ void pg_pool_t::dump(Formatter *f) const
   f->dump_unsigned("min_read_recency_for_promote", min_read_recency_for_promote);
   f->dump_unsigned("stripe_width", get_stripe_width());
   f->dump_unsigned("expected_num_objects", expected_num_objects);
+  f->dump_unsigned("client_throttle_ops", client_throttle_ops);
+  f->dump_unsigned("client_throttle_bps", client_throttle_bps);
+  f->dump_unsigned("client_throttle_ops_max", client_throttle_ops_max);
+  f->dump_unsigned("client_throttle_bps_max", client_throttle_bps_max);
 }
 
 void pg_pool_t::convert_to_pg_shards(const vector<int> &from, set<pg_shard_t>* to) const {
@@ -1252,7 +1256,7 @@ void pg_pool_t::encode(bufferlist& bl, uint64_t features) const
     return;
   }
 
-  ENCODE_START(18, 5, bl);
+  ENCODE_START(19, 5, bl);
   ::encode(type, bl);
   ::encode(size, bl);
   ::encode(crush_ruleset, bl);
@@ -1295,12 +1299,16 @@ void pg_pool_t::encode(bufferlist& bl, uint64_t features) const
   ::encode(min_read_recency_for_promote, bl);
   ::encode(expected_num_objects, bl);
   ::encode(last_tier_change, bl);
+  ::encode(client_throttle_ops, bl);
+  ::encode(client_throttle_bps, bl);
+  ::encode(client_throttle_ops_max, bl);
+  ::encode(client_throttle_bps_max, bl);
   ENCODE_FINISH(bl);
 }
 
 void pg_pool_t::decode(bufferlist::iterator& bl)
 {
-  DECODE_START_LEGACY_COMPAT_LEN(17, 5, 5, bl);
+  DECODE_START_LEGACY_COMPAT_LEN(19, 5, 5, bl);
   ::decode(type, bl);
   ::decode(size, bl);
   ::decode(crush_ruleset, bl);
@@ -1417,6 +1425,17 @@ void pg_pool_t::decode(bufferlist::iterator& bl)
   } else {
     last_tier_change = 0;
   }
+  if (struct_v >= 19) {
+    ::decode(client_throttle_ops, bl);
+    ::decode(client_throttle_bps, bl);
+    ::decode(client_throttle_ops_max, bl);
+    ::decode(client_throttle_bps_max, bl);
+  } else {
+    client_throttle_ops = 0;
+    client_throttle_bps = 0;
+    client_throttle_ops_max = 0;
+    client_throttle_bps_max = 0;
+  }
   DECODE_FINISH(bl);
   calc_pg_masks();
 }
@@ -1473,6 +1492,10 @@ void pg_pool_t::generate_test_instances(list<pg_pool_t*>& o)
   a.erasure_code_profile = "profile in osdmap";
   a.expected_num_objects = 123456;
   a.last_tier_change = 10;
+  a.client_throttle_ops = 100;
+  a.client_throttle_bps = 1048576;
+  a.client_throttle_ops_max = 1000;
+  a.client_throttle_bps_max = 10485760;
   o.push_back(new pg_pool_t(a));
 }
 
@@ -1522,6 +1545,10 @@ ostream& operator<<(ostream& out, const pg_pool_t& p)
   out << " stripe_width " << p.get_stripe_width();
   if (p.expected_num_objects)
     out << " expected_num_objects " << p.expected_num_objects;
+  if (p.has_client_throttle())
+    out << " client_throttle " << p.client_throttle_ops << "/"
+	<< p.client_throttle_ops_max << " ops "
+	<< p.client_throttle_bps << "/" << p.client_throttle_bps_max << " bps";
   return out;
 }
 
@@ -2260,7 +2287,7 @@ void pool_stat_t::generate_test_instances(list<pool_stat_t*>& o)
 
 void pg_history_t::encode(bufferlist &bl) const
 {
-  ENCODE_START(7, 4, bl);
+  ENCODE_START(8, 4, bl);
   ::encode(epoch_created, bl);
   ::encode(last_epoch_started, bl);
   ::encode(last_epoch_clean, bl);
@@ -2274,12 +2301,13 @@ void pg_history_t::encode(bufferlist &bl) const
   ::encode(last_deep_scrub_stamp, bl);
   ::encode(last_clean_scrub_stamp, bl);
   ::encode(last_epoch_marked_full, bl);
+  ::encode(last_deep_scrub_start, bl);
   ENCODE_FINISH(bl);
 }
 
 void pg_history_t::decode(bufferlist::iterator &bl)
 {
-  DECODE_START_LEGACY_COMPAT_LEN(7, 4, 4, bl);
+  DECODE_START_LEGACY_COMPAT_LEN(8, 4, 4, bl);
   ::decode(epoch_created, bl);
   ::decode(last_epoch_started, bl);
   if (struct_v >= 3)
@@ -2304,6 +2332,9 @@ void pg_history_t::decode(bufferlist::iterator &bl)
   if (struct_v >= 7) {
     ::decode(last_epoch_marked_full, bl);
   }
+  if (struct_v >= 8) {
+    ::decode(last_deep_scrub_start, bl);
+  }
   DECODE_FINISH(bl);
 }
 
@@ -2320,6 +2351,7 @@ void pg_history_t::dump(Formatter *f) const
   f->dump_stream("last_scrub") << last_scrub;
   f->dump_stream("last_scrub_stamp") << last_scrub_stamp;
   f->dump_stream("last_deep_scrub") << last_deep_scrub;
+  f->dump_stream("last_deep_scrub_start") << last_deep_scrub_start;
   f->dump_stream("last_deep_scrub_stamp") << last_deep_scrub_stamp;
   f->dump_stream("last_clean_scrub_stamp") << last_clean_scrub_stamp;
 }
@@ -2341,6 +2373,7 @@ void pg_history_t::generate_test_instances(list<pg_history_t*>& o)
   o.back()->last_deep_scrub_stamp = utime_t(14, 15);
   o.back()->last_clean_scrub_stamp = utime_t(16, 17);
   o.back()->last_epoch_marked_full = 18;
+  o.back()->last_deep_scrub_start = eversion_t(11, 12);
 }
 
 
@@ -2348,7 +2381,7 @@ void pg_history_t::generate_test_instances(list<pg_history_t*>& o)
 
 void pg_info_t::encode(bufferlist &bl) const
 {
-  ENCODE_START(30, 26, bl);
+  ENCODE_START(31, 26, bl);
   ::encode(pgid.pgid, bl);
   ::encode(last_update, bl);
   ::encode(last_complete, bl);
@@ -2361,12 +2394,13 @@ void pg_info_t::encode(bufferlist &bl) const
   ::encode(last_user_version, bl);
   ::encode(hit_set, bl);
   ::encode(pgid.shard, bl);
+  ::encode(last_recovered_at, bl);
   ENCODE_FINISH(bl);
 }
 
 void pg_info_t::decode(bufferlist::iterator &bl)
 {
-  DECODE_START_LEGACY_COMPAT_LEN(29, 26, 26, bl);
+  DECODE_START_LEGACY_COMPAT_LEN(31, 26, 26, bl);
   if (struct_v < 23) {
     old_pg_t opgid;
     ::decode(opgid, bl);
@@ -2406,6 +2440,10 @@ void pg_info_t::decode(bufferlist::iterator &bl)
     ::decode(pgid.shard, bl);
   else
     pgid.shard = shard_id_t::NO_SHARD;
+  if (struct_v >= 31)
+    ::decode(last_recovered_at, bl);
+  else
+    last_recovered_at = last_update;  // assume it did
   DECODE_FINISH(bl);
 }
 
@@ -2419,6 +2457,7 @@ void pg_info_t::dump(Formatter *f) const
   f->dump_stream("log_tail") << log_tail;
   f->dump_int("last_user_version", last_user_version);
   f->dump_stream("last_backfill") << last_backfill;
+  f->dump_stream("last_recovered_at") << last_recovered_at;
   f->dump_stream("purged_snaps") << purged_snaps;
   f->open_object_section("history");
   history.dump(f);
@@ -2450,6 +2489,7 @@ void pg_info_t::generate_test_instances(list<pg_info_t*>& o)
   o.back()->last_user_version = 2;
   o.back()->log_tail = eversion_t(7, 8);
   o.back()->last_backfill = hobject_t(object_t("objname"), "key", 123, 456, -1, "");
+  o.back()->last_recovered_at = eversion_t(3, 2);
   {
     list<pg_stat_t*> s;
     pg_stat_t::generate_test_instances(s);
@@ -3001,7 +3041,7 @@ void pg_log_entry_t::decode_with_checksum(bufferlist::iterator& p)
 
 void pg_log_entry_t::encode(bufferlist &bl) const
 {
-  ENCODE_START(10, 4, bl);
+  ENCODE_START(11, 4, bl);
   ::encode(op, bl);
   ::encode(soid, bl);
   ::encode(version, bl);
@@ -3026,12 +3066,14 @@ void pg_log_entry_t::encode(bufferlist &bl) const
   ::encode(user_version, bl);
   ::encode(mod_desc, bl);
   ::encode(extra_reqids, bl);
+  ::encode(has_dirty_extents, bl);
+  ::encode(dirty_extents, bl);
   ENCODE_FINISH(bl);
 }
 
 void pg_log_entry_t::decode(bufferlist::iterator &bl)
 {
-  DECODE_START_LEGACY_COMPAT_LEN(10, 4, 4, bl);
+  DECODE_START_LEGACY_COMPAT_LEN(11, 4, 4, bl);
   ::decode(op, bl);
   if (struct_v < 2) {
     sobject_t old_soid;
@@ -3080,6 +3122,13 @@ void pg_log_entry_t::decode(bufferlist::iterator &bl)
     mod_desc.mark_unrollbackable();
   if (struct_v >= 10)
     ::decode(extra_reqids, bl);
+  if (struct_v >= 11) {
+    ::decode(has_dirty_extents, bl);
+    ::decode(dirty_extents, bl);
+  } else {
+    has_dirty_extents = false;
+    dirty_extents.clear();
+  }
 
   DECODE_FINISH(bl);
 }
@@ -3122,6 +3171,8 @@ void pg_log_entry_t::dump(Formatter *f) const
     mod_desc.dump(f);
     f->close_section();
   }
+  if (has_dirty_extents)
+    f->dump_stream("dirty_extents") << dirty_extents;
 }
 
 void pg_log_entry_t::generate_test_instances(list<pg_log_entry_t*>& o)
@@ -3131,6 +3182,9 @@ void pg_log_entry_t::generate_test_instances(list<pg_log_entry_t*>& o)
   o.push_back(new pg_log_entry_t(MODIFY, oid, eversion_t(1,2), eversion_t(3,4),
 				 1, osd_reqid_t(entity_name_t::CLIENT(777), 8, 999),
 				 utime_t(8,9)));
+  o.push_back(new pg_log_entry_t(*o.back()));
+  o.back()->has_dirty_extents = true;
+  o.back()->dirty_extents.insert(4096, 8192);
 }
 
 ostream& operator<<(ostream& out, const pg_log_entry_t& e)
@@ -4521,7 +4575,7 @@ void ObjectRecoveryProgress::dump(Formatter *f) const
 
 void ObjectRecoveryInfo::encode(bufferlist &bl) const
 {
-  ENCODE_START(2, 1, bl);
+  ENCODE_START(3, 1, bl);
   ::encode(soid, bl);
   ::encode(version, bl);
   ::encode(size, bl);
@@ -4529,13 +4583,14 @@ void ObjectRecoveryInfo::encode(bufferlist &bl) const
   ::encode(ss, bl);
   ::encode(copy_subset, bl);
   ::encode(clone_subset, bl);
+  ::encode(base_version, bl);
   ENCODE_FINISH(bl);
 }
 
 void ObjectRecoveryInfo::decode(bufferlist::iterator &bl,
 				int64_t pool)
 {
-  DECODE_START(2, bl);
+  DECODE_START(3, bl);
   ::decode(soid, bl);
   ::decode(version, bl);
   ::decode(size, bl);
@@ -4543,6 +4598,10 @@ void ObjectRecoveryInfo::decode(bufferlist::iterator &bl,
   ::decode(ss, bl);
   ::decode(copy_subset, bl);
   ::decode(clone_subset, bl);
+  if (struct_v >= 3)
+    ::decode(base_version, bl);
+  else
+    base_version = eversion_t();
   DECODE_FINISH(bl);
 
   if (struct_v < 2) {
@@ -4568,6 +4627,10 @@ void ObjectRecoveryInfo::generate_test_instances(
   o.back()->soid = hobject_t(sobject_t("key", CEPH_NOSNAP));
   o.back()->version = eversion_t(0,0);
   o.back()->size = 100;
+  o.push_back(new ObjectRecoveryInfo(*o.back()));
+  o.back()->version = eversion_t(3,10);
+  o.back()->copy_subset.insert(4096, 4096);
+  o.back()->base_version = eversion_t(2,7);
 }
 
 
@@ -4588,6 +4651,7 @@ void ObjectRecoveryInfo::dump(Formatter *f) const
   }
   f->dump_stream("copy_subset") << copy_subset;
   f->dump_stream("clone_subset") << clone_subset;
+  f->dump_stream("base_version") << base_version;
 }
 
 ostream& operator<<(ostream& out, const ObjectRecoveryInfo &inf)
@@ -4601,6 +4665,7 @@ ostream &ObjectRecoveryInfo::print(ostream &out) const
 	     << soid << "@" << version
 	     << ", copy_subset: " << copy_subset
 	     << ", clone_subset: " << clone_subset
+	     << ", base_version: " << base_version
 	     << ")";
 }
 
@@ -4612,32 +4677,40 @@ void PushReplyOp::generate_test_instances(list<PushReplyOp*> &o)
   o.back()->soid = hobject_t(sobject_t("asdf", 2));
   o.push_back(new PushReplyOp);
   o.back()->soid = hobject_t(sobject_t("asdf", CEPH_NOSNAP));
+  o.back()->need_full_push = true;
 }
 
 void PushReplyOp::encode(bufferlist &bl) const
 {
-  ENCODE_START(1, 1, bl);
+  ENCODE_START(2, 1, bl);
   ::encode(soid, bl);
+  ::encode(need_full_push, bl);
   ENCODE_FINISH(bl);
 }
 
 void PushReplyOp::decode(bufferlist::iterator &bl)
 {
-  DECODE_START(1, bl);
+  DECODE_START(2, bl);
   ::decode(soid, bl);
+  if (struct_v >= 2)
+    ::decode(need_full_push, bl);
+  else
+    need_full_push = false;
   DECODE_FINISH(bl);
 }
 
 void PushReplyOp::dump(Formatter *f) const
 {
   f->dump_stream("soid") << soid;
+  f->dump_bool("need_full_push", need_full_push);
 }
 
 ostream &PushReplyOp::print(ostream &out) const
 {
-  return out
-    << "PushReplyOp(" << soid
-    << ")";
+  out << "PushReplyOp(" << soid;
+  if (need_full_push)
+    out << " need_full_push";
+  return out << ")";
 }
 
 ostream& operator<<(ostream& out, const PushReplyOp &op)
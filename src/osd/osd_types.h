@@ -866,6 +866,8 @@ struct pg_pool_t {
     FLAG_NOPGCHANGE = 1<<5, // pool's pg and pgp num can't be changed
     FLAG_NOSIZECHANGE = 1<<6, // pool's size and min size can't be changed
     FLAG_WRITE_FADVISE_DONTNEED = 1<<7, // write mode with LIBRADOS_OP_FLAG_FADVISE_DONTNEED
+    FLAG_EC_FAST_READ = 1<<8, // read all shards, decode from the first k to arrive
+    FLAG_CHAIN_REPLICATION = 1<<9, // replicas forward writes along a chain
   };
 
   static const char *get_flag_name(int f) {
@@ -878,6 +880,8 @@ struct pg_pool_t {
     case FLAG_NOPGCHANGE: return "nopgchange";
     case FLAG_NOSIZECHANGE: return "nosizechange";
     case FLAG_WRITE_FADVISE_DONTNEED: return "write_fadvise_dontneed";
+    case FLAG_EC_FAST_READ: return "fast_read";
+    case FLAG_CHAIN_REPLICATION: return "chain_replication";
     default: return "???";
     }
   }
@@ -912,6 +916,10 @@ struct pg_pool_t {
       return FLAG_NOSIZECHANGE;
     if (name == "write_fadvise_dontneed")
       return FLAG_WRITE_FADVISE_DONTNEED;
+    if (name == "fast_read")
+      return FLAG_EC_FAST_READ;
+    if (name == "chain_replication")
+      return FLAG_CHAIN_REPLICATION;
     return 0;
   }
 
@@ -1061,6 +1069,14 @@ public:
   uint64_t expected_num_objects; ///< expected number of objects on this pool, a value of 0 indicates
                                  ///< user does not specify any expected value
 
+  /// client io limits enforced by each OSD on the primaries of this pool,
+  /// 0 for none.  The limit rises towards *_max while the OSD is below its
+  /// client io thresholds if *_max is larger.
+  uint64_t client_throttle_ops;     ///< ops/s
+  uint64_t client_throttle_bps;     ///< bytes/s
+  uint64_t client_throttle_ops_max; ///< ops/s
+  uint64_t client_throttle_bps_max; ///< bytes/s
+
   pg_pool_t()
     : flags(0), type(0), size(0), min_size(0),
       crush_ruleset(0), object_hash(0),
@@ -1085,7 +1101,11 @@ public:
       hit_set_count(0),
       min_read_recency_for_promote(0),
       stripe_width(0),
-      expected_num_objects(0)
+      expected_num_objects(0),
+      client_throttle_ops(0),
+      client_throttle_bps(0),
+      client_throttle_ops_max(0),
+      client_throttle_bps_max(0)
   { }
 
   void dump(Formatter *f) const;
@@ -1174,6 +1194,10 @@ public:
     return quota_max_bytes;
   }
 
+  bool has_client_throttle() const {
+    return client_throttle_ops || client_throttle_bps;
+  }
+
   void set_quota_max_objects(uint64_t m) {
     quota_max_objects = m;
   }
@@ -1714,6 +1738,7 @@ struct pg_history_t {
 
   eversion_t last_scrub;
   eversion_t last_deep_scrub;
+  eversion_t last_deep_scrub_start; ///< last_update when last_deep_scrub started
   utime_t last_scrub_stamp;
   utime_t last_deep_scrub_stamp;
   utime_t last_clean_scrub_stamp;
@@ -1759,6 +1784,10 @@ struct pg_history_t {
       last_deep_scrub = other.last_deep_scrub;
       modified = true;
     }
+    if (other.last_deep_scrub_start > last_deep_scrub_start) {
+      last_deep_scrub_start = other.last_deep_scrub_start;
+      modified = true;
+    }
     if (other.last_deep_scrub_stamp > last_deep_scrub_stamp) {
       last_deep_scrub_stamp = other.last_deep_scrub_stamp;
       modified = true;
@@ -1805,6 +1834,7 @@ struct pg_info_t {
   eversion_t log_tail;     // oldest log entry.
 
   hobject_t last_backfill;   // objects >= this and < last_complete may be missing
+  eversion_t last_recovered_at; // last_update when this shard last recovered an object
 
   interval_set<snapid_t> purged_snaps;
 
@@ -2242,9 +2272,16 @@ struct pg_log_entry_t {
 
   vector<pair<osd_reqid_t, version_t> > extra_reqids;
 
+  /// data extents of soid the entry wrote, if has_dirty_extents.  A
+  /// truncation to off is recorded as off up to the end of the address
+  /// space, so that it still covers what a later extension uncovers.
+  bool has_dirty_extents;
+  interval_set<uint64_t> dirty_extents;
+
   pg_log_entry_t()
     : op(0), user_version(0),
-      invalid_hash(false), invalid_pool(false), offset(0) {}
+      invalid_hash(false), invalid_pool(false), offset(0),
+      has_dirty_extents(false) {}
   pg_log_entry_t(int _op, const hobject_t& _soid, 
 		 const eversion_t& v, const eversion_t& pv,
 		 version_t uv,
@@ -2252,7 +2289,7 @@ struct pg_log_entry_t {
     : op(_op), soid(_soid), version(v),
       prior_version(pv), user_version(uv),
       reqid(rid), mtime(mt), invalid_hash(false), invalid_pool(false),
-      offset(0) {}
+      offset(0), has_dirty_extents(false) {}
       
   bool is_clone() const { return op == CLONE; }
   bool is_modify() const { return op == MODIFY; }
@@ -3473,6 +3510,9 @@ struct ObjectRecoveryInfo {
   SnapSet ss;
   interval_set<uint64_t> copy_subset;
   map<hobject_t, interval_set<uint64_t> > clone_subset;
+  /// version of the target's copy of soid that copy_subset is applied
+  /// to, zero if the target starts from an empty object
+  eversion_t base_version;
 
   ObjectRecoveryInfo() : size(0) { }
 
@@ -3515,6 +3555,9 @@ ostream& operator<<(ostream& out, const ObjectRecoveryProgress &prog);
 
 struct PushReplyOp {
   hobject_t soid;
+  bool need_full_push;  ///< our copy is not the base of the partial push
+
+  PushReplyOp() : need_full_push(false) {}
 
   static void generate_test_instances(list<PushReplyOp*>& o);
   void encode(bufferlist &bl) const;
@@ -299,6 +299,7 @@ void Objecter::shutdown()
   rwlock.get_write();
 
   initialized.set(0);
+  _set_submit_osdmap(NULL);
 
   map<int,OSDSession*>::iterator p;
   while (!osd_sessions.empty()) {
@@ -581,7 +582,7 @@ void Objecter::_send_linger_ping(LingerOp *info)
   o->target = info->target;
   o->should_resend = false;
   _send_op_account(o);
-  MOSDOp *m = _prepare_osd_op(o);
+  MOSDOp *m = _prepare_osd_op(o, osdmap->get_epoch());
   o->tid = last_tid.inc();
   _session_op_assign(info->session, o);
   _send_op(o, m);
@@ -1024,6 +1025,11 @@ void Objecter::handle_osd_map(MOSDMap *m)
     return;
   }
 
+  // submitters take the locked path until we are done with the new maps
+  bool new_maps = m->get_last() > osdmap->get_epoch();
+  if (new_maps)
+    _set_submit_osdmap(NULL);
+
   bool was_pauserd = osdmap->test_flag(CEPH_OSDMAP_PAUSERD);
   bool cluster_full = _osdmap_full_flag();
   bool was_pausewr = osdmap->test_flag(CEPH_OSDMAP_PAUSEWR) || cluster_full || _osdmap_has_pool_full();
@@ -1197,6 +1203,10 @@ void Objecter::handle_osd_map(MOSDMap *m)
     }
   }
 
+  // only now, or a new op could get ahead of a resent one to its object
+  if (new_maps)
+    _update_submit_osdmap();
+
   _dump_active();
   
   // finish any Contexts that were waiting on a map update
@@ -1566,6 +1576,11 @@ int Objecter::_get_session(int osd, OSDSession **session, RWLock::Context& lc)
   OSDSession *s = new OSDSession(cct, osd);
   osd_sessions[osd] = s;
   s->con = messenger->get_connection(osdmap->get_inst(osd));
+  if (!session_shards.empty()) {
+    SessionShard *shard = session_shards[osd % session_shards.size()];
+    RWLock::WLocker l(shard->lock);
+    shard->sessions[osd] = s;
+  }
   logger->inc(l_osdc_osd_session_open);
   logger->inc(l_osdc_osd_sessions, osd_sessions.size());
   s->get();
@@ -1610,6 +1625,8 @@ void Objecter::_reopen_session(OSDSession *s)
 void Objecter::close_session(OSDSession *s)
 {
   assert(rwlock.is_wlocked());
+  // or a submitter could be adding an op to it
+  assert(!submit_osdmap);
 
   ldout(cct, 10) << "close_session for osd." << s->osd << dendl;
   if (s->con) {
@@ -1644,6 +1661,11 @@ void Objecter::close_session(OSDSession *s)
   }
 
   osd_sessions.erase(s->osd);
+  if (!session_shards.empty()) {
+    SessionShard *shard = session_shards[s->osd % session_shards.size()];
+    RWLock::WLocker l(shard->lock);
+    shard->sessions.erase(s->osd);
+  }
   s->lock.unlock();
   put_session(s);
 
@@ -2018,24 +2040,139 @@ public:
 
 void Objecter::op_submit(Op *op, ceph_tid_t *ptid, int *ctx_budget)
 {
-  RWLock::RLocker rl(rwlock);
-  RWLock::Context lc(rwlock, RWLock::Context::TakenForRead);
   ceph_tid_t tid = 0;
   if (!ptid)
     ptid = &tid;
+  if (_op_submit_fast(op, ptid, ctx_budget))
+    return;
+
+  RWLock::RLocker rl(rwlock);
+  RWLock::Context lc(rwlock, RWLock::Context::TakenForRead);
   _op_submit_with_budget(op, lc, ptid, ctx_budget);
 }
 
-ceph_tid_t Objecter::_op_submit_with_budget(Op *op, RWLock::Context& lc, ceph_tid_t *ptid, int *ctx_budget)
+RWLock& Objecter::get_submit_lock()
 {
-  assert(initialized.read());
+  // each thread sticks to one shard, handed out in turn
+  static atomic_t next_shard;
+  static __thread int shard = -1;
+  if (shard < 0)
+    shard = next_shard.inc() & 0x7fffffff;
+  return *submit_locks[shard % submit_locks.size()];
+}
+
+Objecter::OSDSession *Objecter::get_shard_session(int osd)
+{
+  SessionShard *shard = session_shards[osd % session_shards.size()];
+  RWLock::RLocker l(shard->lock);
+  map<int,OSDSession*>::iterator p = shard->sessions.find(osd);
+  if (p == shard->sessions.end())
+    return NULL;
+  p->second->get();
+  return p->second;
+}
+
+void Objecter::_set_submit_osdmap(const OSDMap *m)
+{
+  assert(rwlock.is_wlocked());
+  if (!m && !submit_osdmap)
+    return;
+  for (vector<RWLock*>::iterator p = submit_locks.begin();
+       p != submit_locks.end();
+       ++p)
+    (*p)->get_write();
+  const OSDMap *old = submit_osdmap;
+  submit_osdmap = m;
+  for (vector<RWLock*>::iterator p = submit_locks.begin();
+       p != submit_locks.end();
+       ++p)
+    (*p)->unlock();
+  delete old;
+}
+
+void Objecter::_update_submit_osdmap()
+{
+  assert(rwlock.is_wlocked());
+  if (submit_locks.empty() ||
+      !initialized.read() ||
+      osdmap->get_epoch() == 0 ||
+      osdmap->get_epoch() < epoch_barrier ||
+      osdmap->test_flag(CEPH_OSDMAP_PAUSERD | CEPH_OSDMAP_PAUSEWR |
+			CEPH_OSDMAP_FULL) ||
+      _osdmap_has_pool_full()) {
+    _set_submit_osdmap(NULL);
+    return;
+  }
+
+  // the copy shares nothing that osdmap changes in place
+  OSDMap *m = new OSDMap;
+  m->deepish_copy_from(*osdmap);
+  bufferlist bl;
+  osdmap->crush->encode(bl);
+  bufferlist::iterator p = bl.begin();
+  m->crush.reset(new CrushWrapper);
+  m->crush->decode(p);
+  ldout(cct, 10) << __func__ << " epoch " << m->get_epoch() << dendl;
+  _set_submit_osdmap(m);
+}
+
+/**
+ * Submit an op without taking rwlock, mapping it with submit_osdmap.
+ *
+ * Ops to osds we have no session with yet, or that need a timeout, a
+ * throttle or the pool checked against the latest map, are left to the
+ * locked path.
+ *
+ * @returns true if the op was submitted
+ */
+bool Objecter::_op_submit_fast(Op *op, ceph_tid_t *ptid, int *ctx_budget)
+{
+  if (submit_locks.empty() || keep_balanced_budget || osd_timeout > 0)
+    return false;
+
+  RWLock::RLocker sl(get_submit_lock());
+  const OSDMap *map = submit_osdmap;
+  if (!map)
+    return false;
 
+  assert(initialized.read());
+  assert(op->session == NULL);
   assert(op->ops.size() == op->out_bl.size());
   assert(op->ops.size() == op->out_rval.size());
   assert(op->ops.size() == op->out_handler.size());
 
-  // throttle.  before we look at any state, because
-  // take_op_budget() may drop our lock while it blocks.
+  int r = _calc_target(map, &op->target, &op->last_force_resend, false);
+  if (r == RECALC_OP_TARGET_POOL_DNE || op->target.osd < 0)
+    return false;
+  OSDSession *s = get_shard_session(op->target.osd);
+  if (!s)
+    return false;
+
+  // no going back from here; this is _op_submit without the map checks
+  _op_take_budget(op, ctx_budget);
+  _send_op_account(op);
+  assert(op->target.flags & (CEPH_OSD_FLAG_READ|CEPH_OSD_FLAG_WRITE));
+  MOSDOp *m = _prepare_osd_op(op, map->get_epoch());
+
+  s->lock.get_write();
+  if (op->tid == 0)
+    op->tid = last_tid.inc();
+  ldout(cct, 10) << __func__ << " oid " << op->target.base_oid
+		 << " " << op->target.base_oloc << " " << op->target.target_oloc
+		 << " " << op->ops << " tid " << op->tid
+		 << " osd." << s->osd << dendl;
+  _session_op_assign(s, op);
+  _send_op(op, m);
+  // the op may be freed once we drop the session lock
+  *ptid = op->tid;
+  op = NULL;
+  s->lock.unlock();
+  put_session(s);
+  return true;
+}
+
+void Objecter::_op_take_budget(Op *op, int *ctx_budget)
+{
   if (!op->ctx_budgeted || (ctx_budget && (*ctx_budget == -1))) {
     int op_budget = _take_op_budget(op);
     // take and pass out the budget for the first OP
@@ -2044,6 +2181,19 @@ ceph_tid_t Objecter::_op_submit_with_budget(Op *op, RWLock::Context& lc, ceph_ti
       *ctx_budget = op_budget;
     }
   }
+}
+
+ceph_tid_t Objecter::_op_submit_with_budget(Op *op, RWLock::Context& lc, ceph_tid_t *ptid, int *ctx_budget)
+{
+  assert(initialized.read());
+
+  assert(op->ops.size() == op->out_bl.size());
+  assert(op->ops.size() == op->out_rval.size());
+  assert(op->ops.size() == op->out_handler.size());
+
+  // throttle.  before we look at any state, because
+  // take_op_budget() may drop our lock while it blocks.
+  _op_take_budget(op, ctx_budget);
 
   if (osd_timeout > 0) {
     if (op->tid == 0)
@@ -2174,7 +2324,7 @@ ceph_tid_t Objecter::_op_submit(Op *op, RWLock::Context& lc, ceph_tid_t *ptid)
 
   MOSDOp *m = NULL;
   if (need_send) {
-    m = _prepare_osd_op(op);
+    m = _prepare_osd_op(op, osdmap->get_epoch());
   }
 
   s->lock.get_write();
@@ -2372,15 +2522,17 @@ bool Objecter::is_pg_changed(
   return false;      // same primary (tho replicas may have changed)
 }
 
-bool Objecter::target_should_be_paused(op_target_t *t)
+bool Objecter::target_should_be_paused(const OSDMap *map, op_target_t *t)
 {
-  const pg_pool_t *pi = osdmap->get_pg_pool(t->base_oloc.pool);
-  bool pauserd = osdmap->test_flag(CEPH_OSDMAP_PAUSERD);
-  bool pausewr = osdmap->test_flag(CEPH_OSDMAP_PAUSEWR) || _osdmap_full_flag() || pi->has_flag(pg_pool_t::FLAG_FULL);
+  const pg_pool_t *pi = map->get_pg_pool(t->base_oloc.pool);
+  bool pauserd = map->test_flag(CEPH_OSDMAP_PAUSERD);
+  bool pausewr = map->test_flag(CEPH_OSDMAP_PAUSEWR) ||
+    (map->test_flag(CEPH_OSDMAP_FULL) && honor_osdmap_full) ||
+    pi->has_flag(pg_pool_t::FLAG_FULL);
 
   return (t->flags & CEPH_OSD_FLAG_READ && pauserd) ||
          (t->flags & CEPH_OSD_FLAG_WRITE && pausewr) ||
-         (osdmap->get_epoch() < epoch_barrier);
+         (map->get_epoch() < epoch_barrier);
 }
 
 /**
@@ -2464,14 +2616,13 @@ int64_t Objecter::get_object_pg_hash_position(int64_t pool, const string& key,
   return p->raw_hash_to_pg(p->hash_key(key, ns));
 }
 
-int Objecter::_calc_target(op_target_t *t, epoch_t *last_force_resend,  bool any_change)
+int Objecter::_calc_target(const OSDMap *map, op_target_t *t,
+			   epoch_t *last_force_resend, bool any_change)
 {
-  assert(rwlock.is_locked());
-
   bool is_read = t->flags & CEPH_OSD_FLAG_READ;
   bool is_write = t->flags & CEPH_OSD_FLAG_WRITE;
 
-  const pg_pool_t *pi = osdmap->get_pg_pool(t->base_oloc.pool);
+  const pg_pool_t *pi = map->get_pg_pool(t->base_oloc.pool);
   if (!pi) {
     t->osd = -1;
     return RECALC_OP_TARGET_POOL_DNE;
@@ -2479,7 +2630,7 @@ int Objecter::_calc_target(op_target_t *t, epoch_t *last_force_resend,  bool any
 
   bool force_resend = false;
   bool need_check_tiering = false;
-  if (osdmap->get_epoch() == pi->last_force_op_resend) {
+  if (map->get_epoch() == pi->last_force_op_resend) {
     if (last_force_resend && *last_force_resend < pi->last_force_op_resend) {
       *last_force_resend = pi->last_force_op_resend;
       force_resend = true;
@@ -2507,14 +2658,14 @@ int Objecter::_calc_target(op_target_t *t, epoch_t *last_force_resend,  bool any
   if (t->precalc_pgid) {
     assert(t->base_oid.name.empty()); // make sure this is a listing op
     ldout(cct, 10) << __func__ << " have " << t->base_pgid << " pool "
-		   << osdmap->have_pg_pool(t->base_pgid.pool()) << dendl;
-    if (!osdmap->have_pg_pool(t->base_pgid.pool())) {
+		   << map->have_pg_pool(t->base_pgid.pool()) << dendl;
+    if (!map->have_pg_pool(t->base_pgid.pool())) {
       t->osd = -1;
       return RECALC_OP_TARGET_POOL_DNE;
     }
-    pgid = osdmap->raw_pg_to_pg(t->base_pgid);
+    pgid = map->raw_pg_to_pg(t->base_pgid);
   } else {
-    int ret = osdmap->object_locator_to_pg(t->target_oid, t->target_oloc,
+    int ret = map->object_locator_to_pg(t->target_oid, t->target_oloc,
 					   pgid);
     if (ret == -ENOENT) {
       t->osd = -1;
@@ -2527,7 +2678,7 @@ int Objecter::_calc_target(op_target_t *t, epoch_t *last_force_resend,  bool any
   unsigned pg_num = pi->get_pg_num();
   int up_primary, acting_primary;
   vector<int> up, acting;
-  osdmap->pg_to_up_acting_osds(pgid, &up, &up_primary,
+  map->pg_to_up_acting_osds(pgid, &up, &up_primary,
 			       &acting, &acting_primary);
   unsigned prev_seed = ceph_stable_mod(pgid.ps(), t->pg_num, t->pg_num_mask);
   if (any_change && pg_interval_t::is_new_interval(
@@ -2551,7 +2702,7 @@ int Objecter::_calc_target(op_target_t *t, epoch_t *last_force_resend,  bool any
 
   bool need_resend = false;
 
-  bool paused = target_should_be_paused(t);
+  bool paused = target_should_be_paused(map, t);
   if (!paused && paused != t->paused) {
     t->paused = false;
     need_resend = true;
@@ -2592,7 +2743,7 @@ int Objecter::_calc_target(op_target_t *t, epoch_t *last_force_resend,  bool any
 	int best = -1;
 	int best_locality = 0;
 	for (unsigned i = 0; i < acting.size(); ++i) {
-	  int locality = osdmap->crush->get_common_ancestor_distance(
+	  int locality = map->crush->get_common_ancestor_distance(
 		 cct, acting[i], crush_location);
 	  ldout(cct, 20) << __func__ << " localize: rank " << i
 			 << " osd." << acting[i]
@@ -2816,10 +2967,8 @@ void Objecter::finish_op(OSDSession *session, ceph_tid_t tid)
   _finish_op(op, 0);
 }
 
-MOSDOp *Objecter::_prepare_osd_op(Op *op)
+MOSDOp *Objecter::_prepare_osd_op(Op *op, epoch_t epoch)
 {
-  assert(rwlock.is_locked());
-
   int flags = op->target.flags;
   flags |= CEPH_OSD_FLAG_KNOWN_REDIR;
   if (op->oncommit || op->oncommit_sync)
@@ -2836,7 +2985,7 @@ MOSDOp *Objecter::_prepare_osd_op(Op *op)
   MOSDOp *m = new MOSDOp(client_inc.read(), op->tid, 
 			 op->target.target_oid, op->target.target_oloc,
 			 op->target.pgid,
-			 osdmap->get_epoch(),
+			 epoch,
 			 flags, op->features);
 
   m->set_snapid(op->snapid);
@@ -2863,12 +3012,12 @@ MOSDOp *Objecter::_prepare_osd_op(Op *op)
 
 void Objecter::_send_op(Op *op, MOSDOp *m)
 {
-  assert(rwlock.is_locked());
   assert(op->session->lock.is_locked());
 
   if (!m) {
+    assert(rwlock.is_locked());
     assert(op->tid > 0);
-    m = _prepare_osd_op(op);
+    m = _prepare_osd_op(op, osdmap->get_epoch());
   }
 
   ldout(cct, 15) << "_send_op " << op->tid << " to osd." << op->session->osd << dendl;
@@ -4609,6 +4758,17 @@ Objecter::OSDSession::~OSDSession()
 Objecter::~Objecter()
 {
   delete osdmap;
+  delete submit_osdmap;
+  for (vector<SessionShard*>::iterator p = session_shards.begin();
+       p != session_shards.end();
+       ++p) {
+    assert((*p)->sessions.empty());
+    delete *p;
+  }
+  for (vector<RWLock*>::iterator p = submit_locks.begin();
+       p != submit_locks.end();
+       ++p)
+    delete *p;
 
   assert(homeless_session->get_nref() == 1);
   assert(num_homeless_ops.read() == 0);
@@ -4644,6 +4804,9 @@ void Objecter::set_epoch_barrier(epoch_t epoch)
                 << ") current epoch " << osdmap->get_epoch() << dendl;
   if (epoch >= epoch_barrier) {
     epoch_barrier = epoch;
+    // ops wait for the barrier on the locked path
+    if (epoch > osdmap->get_epoch())
+      _set_submit_osdmap(NULL);
     _maybe_request_map();
   }
 }
@@ -25,6 +25,7 @@
 #include "common/Timer.h"
 #include "common/RWLock.h"
 #include "include/rados/rados_types.hpp"
+#include "include/stringify.h"
 
 #include <list>
 #include <map>
@@ -1736,6 +1737,36 @@ public:
 
   OSDSession *homeless_session;
 
+  /**
+   * The osd sessions again, split up by osd id, for op_submit to find
+   * them without rwlock.  Sessions are added and removed with rwlock
+   * held for write.
+   */
+  struct SessionShard {
+    RWLock lock;
+    map<int,OSDSession*> sessions;
+    SessionShard() : lock("Objecter::SessionShard::lock") {}
+  };
+  vector<SessionShard*> session_shards;
+
+  /**
+   * A read-only copy of osdmap that op_submit maps ops with, so that it
+   * does not need rwlock.  handle_osd_map replaces it rather than
+   * changing it.  It is NULL while a new map is being applied and while
+   * the map pauses or blocks some ops, which then take the locked path.
+   *
+   * Each submitting thread uses one of submit_locks, for read, from
+   * mapping its op until the op is on its session; replacing the copy
+   * takes them all for write.
+   */
+  const OSDMap *submit_osdmap;
+  vector<RWLock*> submit_locks;
+
+  RWLock& get_submit_lock();
+  void _set_submit_osdmap(const OSDMap *m);
+  void _update_submit_osdmap();
+  OSDSession *get_shard_session(int osd);
+
   // ops waiting for an osdmap with a new pool or confirmation that
   // the pool does not exist (may be expanded to other uses later)
   map<uint64_t, LingerOp*>       check_latest_map_lingers;
@@ -1746,7 +1777,7 @@ public:
 
   double mon_timeout, osd_timeout;
 
-  MOSDOp *_prepare_osd_op(Op *op);
+  MOSDOp *_prepare_osd_op(Op *op, epoch_t epoch);
   void _send_op(Op *op, MOSDOp *m = NULL);
   void _send_op_account(Op *op);
   void _cancel_linger_op(Op *op);
@@ -1768,8 +1799,13 @@ public:
   bool _osdmap_full_flag() const;
   bool _osdmap_has_pool_full() const;
 
-  bool target_should_be_paused(op_target_t *op);
-  int _calc_target(op_target_t *t, epoch_t *last_force_resend=0, bool any_change=false);
+  bool target_should_be_paused(const OSDMap *map, op_target_t *op);
+  int _calc_target(const OSDMap *map, op_target_t *t,
+		   epoch_t *last_force_resend, bool any_change);
+  int _calc_target(op_target_t *t, epoch_t *last_force_resend=0, bool any_change=false) {
+    assert(rwlock.is_locked());
+    return _calc_target(osdmap, t, last_force_resend, any_change);
+  }
   int _map_session(op_target_t *op, OSDSession **s,
 		   RWLock::Context& lc);
 
@@ -1846,9 +1882,9 @@ private:
   int calc_op_budget(Op *op);
   void _throttle_op(Op *op, int op_size=0);
   int _take_op_budget(Op *op) {
-    assert(rwlock.is_locked());
     int op_budget = calc_op_budget(op);
     if (keep_balanced_budget) {
+      assert(rwlock.is_locked());
       _throttle_op(op, op_budget);
     } else {
       // op_throttle_bytes.take(op_budget);
@@ -1894,10 +1930,18 @@ private:
     linger_callback_lock("Objecter::linger_callback_lock"),
     num_homeless_ops(0),
     homeless_session(new OSDSession(cct, -1)),
+    submit_osdmap(NULL),
     mon_timeout(mon_timeout),
     osd_timeout(osd_timeout),
     epoch_barrier(0)
-  { }
+  {
+    for (int i = 0; i < cct->_conf->objecter_submit_shards; ++i) {
+      session_shards.push_back(new SessionShard);
+      // distinct names, as replacing submit_osdmap takes them all
+      submit_locks.push_back(new RWLock("Objecter::submit_lock::" +
+					stringify(i)));
+    }
+  }
   ~Objecter();
 
   void init();
@@ -1968,6 +2012,8 @@ private:
   // low-level
   ceph_tid_t _op_submit(Op *op, RWLock::Context& lc, ceph_tid_t *ptid);
   ceph_tid_t _op_submit_with_budget(Op *op, RWLock::Context& lc, ceph_tid_t *ptid, int *ctx_budget = NULL);
+  void _op_take_budget(Op *op, int *ctx_budget);
+  bool _op_submit_fast(Op *op, ceph_tid_t *ptid, int *ctx_budget);
   inline void unregister_op(Op *op);
 
   // public interface
@@ -76,6 +76,9 @@ void _usage()
   cerr << "  quota set                  set quota params\n";
   cerr << "  quota enable               enable quota\n";
   cerr << "  quota disable              disable quota\n";
+  cerr << "  qos set                    set request rate limits\n";
+  cerr << "  qos enable                 enable request rate limits\n";
+  cerr << "  qos disable                disable request rate limits\n";
   cerr << "  region get                 show region info\n";
   cerr << "  regions list               list all regions set on this cluster\n";
   cerr << "  region set                 set region info (requires infile)\n";
@@ -189,6 +192,12 @@ void _usage()
   cerr << "   --max-objects             specify max objects (negative value to disable)\n";
   cerr << "   --max-size                specify max size (in bytes, negative value to disable)\n";
   cerr << "   --quota-scope             scope of quota (bucket, user)\n";
+  cerr << "\nQoS options:\n";
+  cerr << "   --bucket                  specified bucket for qos command, otherwise applies to --uid\n";
+  cerr << "   --max-ops                 max requests per second (negative value to disable)\n";
+  cerr << "   --max-bytes               max bytes per second (negative value to disable)\n";
+  cerr << "   --burst-ops               requests allowed above --max-ops in a burst\n";
+  cerr << "   --burst-bytes             bytes allowed above --max-bytes in a burst\n";
   cout << "\nOrphans search options:\n";
   cout << "   --pool                    data pool to scan for leaked rados objects in\n";
   cout << "   --num-shards              num of shards to use for keeping the temporary scan info\n";
@@ -259,6 +268,9 @@ enum {
   OPT_QUOTA_SET,
   OPT_QUOTA_ENABLE,
   OPT_QUOTA_DISABLE,
+  OPT_QOS_SET,
+  OPT_QOS_ENABLE,
+  OPT_QOS_DISABLE,
   OPT_GC_LIST,
   OPT_GC_PROCESS,
   OPT_ORPHANS_FIND,
@@ -317,6 +329,7 @@ static int get_cmd(const char *cmd, const char *prev_cmd, bool *need_more)
       strcmp(cmd, "pool") == 0 ||
       strcmp(cmd, "pools") == 0 ||
       strcmp(cmd, "quota") == 0 ||
+      strcmp(cmd, "qos") == 0 ||
       strcmp(cmd, "region") == 0 ||
       strcmp(cmd, "regions") == 0 ||
       strcmp(cmd, "region-map") == 0 ||
@@ -463,6 +476,13 @@ static int get_cmd(const char *cmd, const char *prev_cmd, bool *need_more)
       return OPT_QUOTA_ENABLE;
     if (strcmp(cmd, "disable") == 0)
       return OPT_QUOTA_DISABLE;
+  } else if (strcmp(prev_cmd, "qos") == 0) {
+    if (strcmp(cmd, "set") == 0)
+      return OPT_QOS_SET;
+    if (strcmp(cmd, "enable") == 0)
+      return OPT_QOS_ENABLE;
+    if (strcmp(cmd, "disable") == 0)
+      return OPT_QOS_DISABLE;
   } else if (strcmp(prev_cmd, "regions") == 0) {
     if (strcmp(cmd, "list") == 0)
       return OPT_REGION_LIST;
@@ -901,6 +921,87 @@ int set_user_quota(int opt_cmd, RGWUser& user, RGWUserAdminOpState& op_state, in
   return 0;
 }
 
+struct qos_params {
+  int64_t max_ops;
+  int64_t max_bytes;
+  int64_t burst_ops;
+  int64_t burst_bytes;
+  bool have_max_ops;
+  bool have_max_bytes;
+  bool have_burst_ops;
+  bool have_burst_bytes;
+
+  qos_params() : max_ops(-1), max_bytes(-1), burst_ops(-1), burst_bytes(-1),
+                 have_max_ops(false), have_max_bytes(false),
+                 have_burst_ops(false), have_burst_bytes(false) {}
+};
+
+void set_qos_info(RGWQoSInfo& qos, int opt_cmd, qos_params& params)
+{
+  switch (opt_cmd) {
+    case OPT_QOS_ENABLE:
+      qos.enabled = true;
+
+      // falling through on purpose
+
+    case OPT_QOS_SET:
+      if (params.have_max_ops) {
+        qos.max_ops = params.max_ops;
+      }
+      if (params.have_max_bytes) {
+        qos.max_bytes = params.max_bytes;
+      }
+      if (params.have_burst_ops) {
+        qos.burst_ops = params.burst_ops;
+      }
+      if (params.have_burst_bytes) {
+        qos.burst_bytes = params.burst_bytes;
+      }
+      break;
+    case OPT_QOS_DISABLE:
+      qos.enabled = false;
+      break;
+  }
+}
+
+int set_bucket_qos(RGWRados *store, int opt_cmd, string& bucket_name, qos_params& params)
+{
+  RGWBucketInfo bucket_info;
+  map<string, bufferlist> attrs;
+  RGWObjectCtx obj_ctx(store);
+  int r = store->get_bucket_info(obj_ctx, bucket_name, bucket_info, NULL, &attrs);
+  if (r < 0) {
+    cerr << "could not get bucket info for bucket=" << bucket_name << ": " << cpp_strerror(-r) << std::endl;
+    return -r;
+  }
+
+  set_qos_info(bucket_info.qos, opt_cmd, params);
+
+  r = store->put_bucket_instance_info(bucket_info, false, 0, &attrs);
+  if (r < 0) {
+    cerr << "ERROR: failed writing bucket instance info: " << cpp_strerror(-r) << std::endl;
+    return -r;
+  }
+  return 0;
+}
+
+int set_user_qos(int opt_cmd, RGWUser& user, RGWUserAdminOpState& op_state, qos_params& params)
+{
+  RGWUserInfo& user_info = op_state.get_user_info();
+
+  set_qos_info(user_info.qos, opt_cmd, params);
+
+  op_state.set_qos(user_info.qos);
+
+  string err;
+  int r = user.modify(op_state, &err);
+  if (r < 0) {
+    cerr << "ERROR: failed updating user info: " << cpp_strerror(-r) << ": " << err << std::endl;
+    return -r;
+  }
+  return 0;
+}
+
 static bool bucket_object_check_filter(const string& name)
 {
   string ns;
@@ -1188,6 +1289,7 @@ int main(int argc, char **argv)
   int64_t max_size = -1;
   bool have_max_objects = false;
   bool have_max_size = false;
+  qos_params qos;
   int include_all = false;
 
   int sync_stats = false;
@@ -1302,6 +1404,34 @@ int main(int argc, char **argv)
         return EINVAL;
       }
       have_max_objects = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--max-ops", (char*)NULL)) {
+      qos.max_ops = (int64_t)strict_strtoll(val.c_str(), 10, &err);
+      if (!err.empty()) {
+        cerr << "ERROR: failed to parse max ops: " << err << std::endl;
+        return EINVAL;
+      }
+      qos.have_max_ops = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--max-bytes", (char*)NULL)) {
+      qos.max_bytes = (int64_t)strict_strtoll(val.c_str(), 10, &err);
+      if (!err.empty()) {
+        cerr << "ERROR: failed to parse max bytes: " << err << std::endl;
+        return EINVAL;
+      }
+      qos.have_max_bytes = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--burst-ops", (char*)NULL)) {
+      qos.burst_ops = (int64_t)strict_strtoll(val.c_str(), 10, &err);
+      if (!err.empty()) {
+        cerr << "ERROR: failed to parse burst ops: " << err << std::endl;
+        return EINVAL;
+      }
+      qos.have_burst_ops = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--burst-bytes", (char*)NULL)) {
+      qos.burst_bytes = (int64_t)strict_strtoll(val.c_str(), 10, &err);
+      if (!err.empty()) {
+        cerr << "ERROR: failed to parse burst bytes: " << err << std::endl;
+        return EINVAL;
+      }
+      qos.have_burst_bytes = true;
     } else if (ceph_argparse_witharg(args, i, &val, "--date", "--time", (char*)NULL)) {
       date = val;
       if (end_date.empty())
@@ -3320,5 +3450,20 @@ next:
     }
   }
 
+  bool qos_op = (opt_cmd == OPT_QOS_SET || opt_cmd == OPT_QOS_ENABLE || opt_cmd == OPT_QOS_DISABLE);
+
+  if (qos_op) {
+    if (bucket_name.empty() && user_id.empty()) {
+      cerr << "ERROR: bucket name or uid is required for qos operation" << std::endl;
+      return EINVAL;
+    }
+
+    if (!bucket_name.empty()) {
+      set_bucket_qos(store, opt_cmd, bucket_name, qos);
+    } else {
+      set_user_qos(opt_cmd, user, user_op, qos);
+    }
+  }
+
   return 0;
 }
@@ -1506,6 +1506,8 @@ int RGWDataChangesLog::renew_entries()
   lock.Lock();
   map<rgw_bucket_shard, bool> entries;
   entries.swap(cur_cycle);
+  if (perfcounter)
+    perfcounter->set(l_rgw_data_log_window, 0);
   lock.Unlock();
 
   map<rgw_bucket_shard, bool>::iterator iter;
@@ -1545,6 +1547,10 @@ int RGWDataChangesLog::renew_entries()
     utime_t now = ceph_clock_now(cct);
 
     int ret = store->time_log_add(oids[miter->first], entries);
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_data_log_flush);
+      perfcounter->inc(l_rgw_data_log_flush_entries, entries.size());
+    }
     if (ret < 0) {
       /* we don't really need to have a special handling for failed cases here,
        * as this is just an optimization. */
@@ -1578,6 +1584,8 @@ void RGWDataChangesLog::register_renew(rgw_bucket_shard& bs)
 {
   Mutex::Locker l(lock);
   cur_cycle[bs] = true;
+  if (perfcounter)
+    perfcounter->set(l_rgw_data_log_window, cur_cycle.size());
 }
 
 void RGWDataChangesLog::update_renewed(rgw_bucket_shard& bs, utime_t& expiration)
@@ -1638,7 +1646,7 @@ int RGWDataChangesLog::add_entry(rgw_bucket& bucket, int shard_id) {
   status->cond = new RefCountedCond;
   status->pending = true;
 
-  string& oid = oids[choose_oid(bs)];
+  int index = choose_oid(bs);
   utime_t expiration;
 
   int ret;
@@ -1663,10 +1671,13 @@ int RGWDataChangesLog::add_entry(rgw_bucket& bucket, int shard_id) {
     change.timestamp = now;
     ::encode(change, bl);
     string section;
+    cls_log_entry entry;
+
+    store->time_log_prepare_entry(entry, now, section, change.key, bl);
 
     ldout(cct, 20) << "RGWDataChangesLog::add_entry() sending update with now=" << now << " cur_expiration=" << expiration << dendl;
 
-    ret = store->time_log_add(oid, now, section, change.key, bl);
+    ret = flush_entry(index, entry);
 
     now = ceph_clock_now(cct);
 
@@ -1688,6 +1699,63 @@ int RGWDataChangesLog::add_entry(rgw_bucket& bucket, int shard_id) {
   return ret;
 }
 
+int RGWDataChangesLog::flush_entry(int index, cls_log_entry& entry)
+{
+  LogShard& shard = log_shards[index];
+
+  Mutex::Locker l(shard.lock);
+
+  if (!shard.cur) {
+    shard.cur = new LogBatch;
+  }
+  LogBatch *batch = shard.cur;
+  batch->entries.push_back(entry);
+  batch->refs++;
+
+  while (!batch->done) {
+    if (shard.flushing) {
+      shard.cond.Wait(shard.lock);
+      continue;
+    }
+
+    /* nobody is writing this shard, our batch is the current one */
+    assert(batch == shard.cur);
+    shard.flushing = true;
+
+    int window = cct->_conf->rgw_data_log_batch_window_ms;
+    if (window > 0) {
+      utime_t interval;
+      interval.set_from_double((double)window / 1000.0);
+      shard.cond.WaitInterval(cct, shard.lock, interval);
+    }
+
+    shard.cur = NULL;
+    shard.lock.Unlock();
+
+    ldout(cct, 20) << "RGWDataChangesLog::flush_entry() writing " << batch->entries.size()
+                   << " entries to " << oids[index] << dendl;
+
+    int ret = store->time_log_add(oids[index], batch->entries);
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_data_log_flush);
+      perfcounter->inc(l_rgw_data_log_flush_entries, batch->entries.size());
+    }
+
+    shard.lock.Lock();
+    batch->ret = ret;
+    batch->done = true;
+    shard.flushing = false;
+    shard.cond.Signal();
+  }
+
+  int ret = batch->ret;
+  if (--batch->refs == 0) {
+    delete batch;
+  }
+
+  return ret;
+}
+
 int RGWDataChangesLog::list_entries(int shard, utime_t& start_time, utime_t& end_time, int max_entries,
 				    list<rgw_data_change>& entries,
 				    const string& marker,
@@ -1805,6 +1873,7 @@ RGWDataChangesLog::~RGWDataChangesLog() {
   renew_thread->join();
   delete renew_thread;
   delete[] oids;
+  delete[] log_shards;
 }
 
 void *RGWDataChangesLog::ChangesRenewThread::entry() {
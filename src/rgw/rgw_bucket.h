@@ -354,6 +354,34 @@ class RGWDataChangesLog {
 
   map<rgw_bucket_shard, bool> cur_cycle;
 
+  /*
+   * Entries that need to go out right away are queued on their log shard
+   * and written by a single cls_log_add per batch. The first writer that
+   * finds no flush in progress writes the batch, everyone queued behind it
+   * waits for the result.
+   */
+  struct LogBatch {
+    list<cls_log_entry> entries;
+    bool done;
+    int ret;
+    int refs;
+
+    LogBatch() : done(false), ret(0), refs(0) {}
+  };
+
+  struct LogShard {
+    Mutex lock;
+    Cond cond;
+    LogBatch *cur;
+    bool flushing;
+
+    LogShard() : lock("RGWDataChangesLog::LogShard"), cur(NULL), flushing(false) {}
+  };
+
+  LogShard *log_shards;
+
+  int flush_entry(int index, cls_log_entry& entry);
+
   void _get_change(const rgw_bucket_shard& bs, ChangeStatusPtr& status);
   void register_renew(rgw_bucket_shard& bs);
   void update_renewed(rgw_bucket_shard& bs, utime_t& expiration);
@@ -379,6 +407,7 @@ public:
     num_shards = cct->_conf->rgw_data_log_num_shards;
 
     oids = new string[num_shards];
+    log_shards = new LogShard[num_shards];
 
     string prefix = cct->_conf->rgw_data_log_obj_prefix;
 
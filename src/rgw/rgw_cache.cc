@@ -64,6 +64,63 @@ int ObjectCache::get(string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cac
   return 0;
 }
 
+bool ObjectCache::start_fetch(const string& name, uint32_t mask)
+{
+  if (!cct->_conf->rgw_cache_coalesce_misses) {
+    return true;
+  }
+
+  {
+    RWLock::RLocker l(lock);
+    if (!enabled) {
+      return true;
+    }
+  }
+
+  Mutex::Locker l(fetch_lock);
+
+  pair<string, uint32_t> key(name, mask);
+  map<pair<string, uint32_t>, ObjectCacheFetch *>::iterator iter = fetches.find(key);
+  if (iter == fetches.end()) {
+    fetches[key] = new ObjectCacheFetch;
+    return true;
+  }
+
+  ObjectCacheFetch *fetch = iter->second;
+  ldout(cct, 10) << "cache fetch: name=" << name << " : waiting for in-flight fetch" << dendl;
+  if (perfcounter) perfcounter->inc(l_rgw_cache_coalesced);
+
+  fetch->waiters++;
+  while (!fetch->done) {
+    fetch->cond.Wait(fetch_lock);
+  }
+  if (--fetch->waiters == 0) {
+    delete fetch;
+  }
+
+  return false;
+}
+
+void ObjectCache::finish_fetch(const string& name, uint32_t mask)
+{
+  Mutex::Locker l(fetch_lock);
+
+  map<pair<string, uint32_t>, ObjectCacheFetch *>::iterator iter = fetches.find(make_pair(name, mask));
+  assert(iter != fetches.end());
+
+  ObjectCacheFetch *fetch = iter->second;
+  fetches.erase(iter);
+
+  if (fetch->waiters == 0) {
+    delete fetch;
+    return;
+  }
+
+  ldout(cct, 10) << "cache fetch: name=" << name << " : waking " << fetch->waiters << " waiters" << dendl;
+  fetch->done = true;
+  fetch->cond.Signal();
+}
+
 bool ObjectCache::chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_entries, RGWChainedCache::Entry *chained_entry)
 {
   RWLock::WLocker l(lock);
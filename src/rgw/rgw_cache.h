@@ -11,6 +11,8 @@
 #include "include/utime.h"
 #include "include/assert.h"
 #include "common/RWLock.h"
+#include "common/Mutex.h"
+#include "common/Cond.h"
 
 enum {
   UPDATE_OBJ,
@@ -137,6 +139,19 @@ struct ObjectCacheEntry {
   ObjectCacheEntry() : lru_promotion_ts(0), gen(0) {}
 };
 
+/*
+ * A fetch of a cache entry that is currently in progress. Concurrent misses
+ * on the same entry wait for the fetch to complete instead of all going to
+ * rados (single-flight).
+ */
+struct ObjectCacheFetch {
+  int waiters;
+  bool done;
+  Cond cond;
+
+  ObjectCacheFetch() : waiters(0), done(false) {}
+};
+
 class ObjectCache {
   std::map<string, ObjectCacheEntry> cache_map;
   std::list<string> lru;
@@ -150,13 +165,24 @@ class ObjectCache {
 
   bool enabled;
 
+  Mutex fetch_lock;
+  std::map<pair<string, uint32_t>, ObjectCacheFetch *> fetches;
+
   void touch_lru(string& name, ObjectCacheEntry& entry, std::list<string>::iterator& lru_iter);
   void remove_lru(string& name, std::list<string>::iterator& lru_iter);
 
   void do_invalidate_all();
 public:
-  ObjectCache() : lru_size(0), lru_counter(0), lru_window(0), lock("ObjectCache"), cct(NULL), enabled(false) { }
+  ObjectCache() : lru_size(0), lru_counter(0), lru_window(0), lock("ObjectCache"), cct(NULL), enabled(false),
+                  fetch_lock("ObjectCache::fetch_lock") { }
   int get(std::string& name, ObjectCacheInfo& bl, uint32_t mask, rgw_cache_entry_info *cache_info);
+  /*
+   * Called after a cache miss. Returns true if the caller should fetch the
+   * entry itself (and then call finish_fetch()), false if it waited for a
+   * concurrent fetch of the same entry and should retry the cache lookup.
+   */
+  bool start_fetch(const std::string& name, uint32_t mask);
+  void finish_fetch(const std::string& name, uint32_t mask);
   void put(std::string& name, ObjectCacheInfo& bl, rgw_cache_entry_info *cache_info);
   void remove(std::string& name);
   void set_ctx(CephContext *_cct) {
@@ -171,6 +197,35 @@ public:
   void invalidate_all();
 };
 
+/* finishes a fetch started with ObjectCache::start_fetch() when going out of scope */
+class ObjectCacheFetchGuard {
+  ObjectCache& cache;
+  string name;
+  uint32_t mask;
+  bool owner;
+  bool waited;
+
+public:
+  ObjectCacheFetchGuard(ObjectCache& _cache, const string& _name, uint32_t _mask) :
+    cache(_cache), name(_name), mask(_mask), owner(false), waited(false) {}
+  ~ObjectCacheFetchGuard() {
+    if (owner)
+      cache.finish_fetch(name, mask);
+  }
+
+  /* returns true if the caller should fetch the entry */
+  bool start() {
+    if (waited) {
+      /* already waited on a concurrent fetch and still missed (e.g., the
+       * result was not cacheable), don't serialize behind another one */
+      return true;
+    }
+    owner = cache.start_fetch(name, mask);
+    waited = !owner;
+    return owner;
+  }
+};
+
 template <class T>
 class RGWCache  : public T
 {
@@ -310,7 +365,13 @@ int RGWCache<T>::get_system_obj(RGWObjectCtx& obj_ctx, RGWRados::SystemObject::R
   if (objv_tracker)
     flags |= CACHE_FLAG_OBJV;
   
-  if (cache.get(name, info, flags, cache_info) == 0) {
+  ObjectCacheFetchGuard fetch(cache, name, flags);
+  int r;
+  do {
+    r = cache.get(name, info, flags, cache_info);
+  } while (r < 0 && !fetch.start());
+
+  if (r == 0) {
     if (info.status < 0)
       return info.status;
 
@@ -325,7 +386,7 @@ int RGWCache<T>::get_system_obj(RGWObjectCtx& obj_ctx, RGWRados::SystemObject::R
       objv_tracker->read_version = info.version;
     return bl.length();
   }
-  int r = T::get_system_obj(obj_ctx, read_state, objv_tracker, obj, obl, ofs, end, cache_info);
+  r = T::get_system_obj(obj_ctx, read_state, objv_tracker, obj, obl, ofs, end, cache_info);
   if (r < 0) {
     if (r == -ENOENT) { // only update ENOENT, we'd rather retry other errors
       info.status = r;
@@ -523,7 +584,12 @@ int RGWCache<T>::raw_obj_stat(rgw_obj& obj, uint64_t *psize, time_t *pmtime,
   uint32_t flags = CACHE_FLAG_META | CACHE_FLAG_XATTRS;
   if (objv_tracker)
     flags |= CACHE_FLAG_OBJV;
-  int r = cache.get(name, info, flags, NULL);
+  ObjectCacheFetchGuard fetch(cache, name, flags);
+  int r;
+  do {
+    r = cache.get(name, info, flags, NULL);
+  } while (r < 0 && !fetch.start());
+
   if (r == 0) {
     if (info.status < 0)
       return info.status;
@@ -48,10 +48,19 @@ int rgw_perf_start(CephContext *cct)
 
   plb.add_u64_counter(l_rgw_cache_hit, "cache_hit");
   plb.add_u64_counter(l_rgw_cache_miss, "cache_miss");
+  plb.add_u64_counter(l_rgw_cache_coalesced, "cache_coalesced");
 
   plb.add_u64_counter(l_rgw_keystone_token_cache_hit, "keystone_token_cache_hit");
   plb.add_u64_counter(l_rgw_keystone_token_cache_miss, "keystone_token_cache_miss");
 
+  plb.add_u64_counter(l_rgw_qos_pass, "qos_pass");
+  plb.add_u64_counter(l_rgw_qos_delay, "qos_delay");
+  plb.add_u64_counter(l_rgw_qos_reject, "qos_reject");
+
+  plb.add_u64(l_rgw_data_log_window, "data_log_window");
+  plb.add_u64_counter(l_rgw_data_log_flush, "data_log_flush");
+  plb.add_u64_counter(l_rgw_data_log_flush_entries, "data_log_flush_entries");
+
   perfcounter = plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(perfcounter);
   return 0;
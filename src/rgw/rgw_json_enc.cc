@@ -418,6 +418,7 @@ void RGWUserInfo::dump(Formatter *f) const
   encode_json("placement_tags", placement_tags, f);
   encode_json("bucket_quota", bucket_quota, f);
   encode_json("user_quota", user_quota, f);
+  encode_json("qos", qos, f);
   encode_json("temp_url_keys", temp_url_keys, f);
 }
 
@@ -471,6 +472,7 @@ void RGWUserInfo::decode_json(JSONObj *obj)
   JSONDecoder::decode_json("placement_tags", placement_tags, obj);
   JSONDecoder::decode_json("bucket_quota", bucket_quota, obj);
   JSONDecoder::decode_json("user_quota", user_quota, obj);
+  JSONDecoder::decode_json("qos", qos, obj);
   JSONDecoder::decode_json("temp_url_keys", temp_url_keys, obj);
 }
 
@@ -488,6 +490,24 @@ void RGWQuotaInfo::decode_json(JSONObj *obj)
   JSONDecoder::decode_json("enabled", enabled, obj);
 }
 
+void RGWQoSInfo::dump(Formatter *f) const
+{
+  f->dump_bool("enabled", enabled);
+  f->dump_int("max_ops", max_ops);
+  f->dump_int("max_bytes", max_bytes);
+  f->dump_int("burst_ops", burst_ops);
+  f->dump_int("burst_bytes", burst_bytes);
+}
+
+void RGWQoSInfo::decode_json(JSONObj *obj)
+{
+  JSONDecoder::decode_json("enabled", enabled, obj);
+  JSONDecoder::decode_json("max_ops", max_ops, obj);
+  JSONDecoder::decode_json("max_bytes", max_bytes, obj);
+  JSONDecoder::decode_json("burst_ops", burst_ops, obj);
+  JSONDecoder::decode_json("burst_bytes", burst_bytes, obj);
+}
+
 void rgw_bucket::dump(Formatter *f) const
 {
   encode_json("name", name, f);
@@ -555,6 +575,7 @@ void RGWBucketInfo::dump(Formatter *f) const
   encode_json("placement_rule", placement_rule, f);
   encode_json("has_instance_obj", has_instance_obj, f);
   encode_json("quota", quota, f);
+  encode_json("qos", qos, f);
   encode_json("num_shards", num_shards, f);
   encode_json("bi_shard_hash_type", (uint32_t)bucket_index_shard_hash_type, f);
 }
@@ -568,6 +589,7 @@ void RGWBucketInfo::decode_json(JSONObj *obj) {
   JSONDecoder::decode_json("placement_rule", placement_rule, obj);
   JSONDecoder::decode_json("has_instance_obj", has_instance_obj, obj);
   JSONDecoder::decode_json("quota", quota, obj);
+  JSONDecoder::decode_json("qos", qos, obj);
   JSONDecoder::decode_json("num_shards", num_shards, obj);
   uint32_t hash_type;
   JSONDecoder::decode_json("bi_shard_hash_type", hash_type, obj);
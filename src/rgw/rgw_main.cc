@@ -607,6 +607,13 @@ static int process_request(RGWRados *store, RGWREST *rest, RGWRequest *req, RGWC
   }
 
 
+  req->log(s, "checking qos");
+  ret = store->get_qos_handler()->throttle_request(s);
+  if (ret < 0) {
+    abort_early(s, op, ret);
+    goto done;
+  }
+
   req->log(s, "init op");
   ret = op->init_processing();
   if (ret < 0) {
@@ -645,6 +652,9 @@ static int process_request(RGWRados *store, RGWREST *rest, RGWRequest *req, RGWC
   op->pre_exec();
   op->execute();
   op->complete();
+  if (s->op == OP_GET) {
+    store->get_qos_handler()->account_bytes(s, s->cio->get_bytes_sent());
+  }
 done:
   int r = client_io->complete_request();
   if (r < 0) {
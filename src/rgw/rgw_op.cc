@@ -3334,6 +3334,30 @@ void RGWCompleteMultipart::pre_exec()
   rgw_bucket_object_pre_exec(s);
 }
 
+void *RGWCompleteMultipart::KeepaliveThread::entry()
+{
+  Mutex::Locker l(lock);
+  while (!done) {
+    cond.WaitInterval(op->s->cct, lock, interval);
+    if (done)
+      break;
+    op->send_partial_response();
+  }
+  return NULL;
+}
+
+RGWCompleteMultipart::KeepaliveThread::~KeepaliveThread()
+{
+  if (!is_started())
+    return;
+
+  lock.Lock();
+  done = true;
+  cond.Signal();
+  lock.Unlock();
+  join();
+}
+
 void RGWCompleteMultipart::execute()
 {
   RGWMultiCompleteUpload *parts;
@@ -3388,9 +3412,8 @@ void RGWCompleteMultipart::execute()
   mp.init(s->object.name, upload_id);
   meta_oid = mp.get_meta();
 
-  int total_parts = 0;
   int handled_parts = 0;
-  int max_parts = 1000;
+  int num_parts = parts->parts.size();
   int marker = 0;
   bool truncated;
 
@@ -3431,67 +3454,74 @@ void RGWCompleteMultipart::execute()
   }
   /* End added */
 
-  do {
-    ret = list_multipart_parts(store, s, upload_id, meta_oid, max_parts, marker, obj_parts, &marker, &truncated);
-    if (ret == -ENOENT) {
-      ret = -ERR_NO_SUCH_UPLOAD;
-    }
-    if (ret < 0)
+  KeepaliveThread keepalive(this, s->cct->_conf->rgw_multipart_complete_keepalive_interval);
+  if (s->cct->_conf->rgw_multipart_complete_keepalive_interval > 0)
+    keepalive.create();
+
+  /*
+   * Every part recorded its own info and manifest in the meta object's omap
+   * when it was uploaded, so fetch them all at once: a part listing that is
+   * paged by 1000 entries takes ten round trips for a 10,000 part upload, and
+   * for unsorted (v1) upload ids each page reads back the whole omap.
+   */
+  ret = list_multipart_parts(store, s, upload_id, meta_oid, num_parts, marker, obj_parts, &marker, &truncated);
+  if (ret == -ENOENT) {
+    ret = -ERR_NO_SUCH_UPLOAD;
+  }
+  if (ret < 0)
+    return;
+
+  if (truncated || (int)obj_parts.size() != num_parts) {
+    ret = -ERR_INVALID_PART;
+    return;
+  }
+
+  for (obj_iter = obj_parts.begin(); iter != parts->parts.end() && obj_iter != obj_parts.end(); ++iter, ++obj_iter, ++handled_parts) {
+    uint64_t part_size = obj_iter->second.size;
+    if (handled_parts < (int)parts->parts.size() - 1 &&
+        part_size < min_part_size) {
+      ret = -ERR_TOO_SMALL;
       return;
+    }
 
-    total_parts += obj_parts.size();
-    if (!truncated && total_parts != (int)parts->parts.size()) {
+    char petag[CEPH_CRYPTO_MD5_DIGESTSIZE];
+    if (iter->first != (int)obj_iter->first) {
+      ldout(s->cct, 0) << "NOTICE: parts num mismatch: next requested: " << iter->first << " next uploaded: " << obj_iter->first << dendl;
+      ret = -ERR_INVALID_PART;
+      return;
+    }
+    string part_etag = rgw_string_unquote(iter->second);
+    if (part_etag.compare(obj_iter->second.etag) != 0) {
+      ldout(s->cct, 0) << "NOTICE: etag mismatch: part: " << iter->first << " etag: " << iter->second << dendl;
       ret = -ERR_INVALID_PART;
       return;
     }
 
-    for (obj_iter = obj_parts.begin(); iter != parts->parts.end() && obj_iter != obj_parts.end(); ++iter, ++obj_iter, ++handled_parts) {
-      uint64_t part_size = obj_iter->second.size;
-      if (handled_parts < (int)parts->parts.size() - 1 &&
-          part_size < min_part_size) {
-        ret = -ERR_TOO_SMALL;
-        return;
-      }
-
-      char petag[CEPH_CRYPTO_MD5_DIGESTSIZE];
-      if (iter->first != (int)obj_iter->first) {
-        ldout(s->cct, 0) << "NOTICE: parts num mismatch: next requested: " << iter->first << " next uploaded: " << obj_iter->first << dendl;
-        ret = -ERR_INVALID_PART;
-        return;
-      }
-      string part_etag = rgw_string_unquote(iter->second);
-      if (part_etag.compare(obj_iter->second.etag) != 0) {
-        ldout(s->cct, 0) << "NOTICE: etag mismatch: part: " << iter->first << " etag: " << iter->second << dendl;
-        ret = -ERR_INVALID_PART;
-        return;
-      }
+    hex_to_buf(obj_iter->second.etag.c_str(), petag, CEPH_CRYPTO_MD5_DIGESTSIZE);
+    hash.Update((const byte *)petag, sizeof(petag));
 
-      hex_to_buf(obj_iter->second.etag.c_str(), petag, CEPH_CRYPTO_MD5_DIGESTSIZE);
-      hash.Update((const byte *)petag, sizeof(petag));
+    RGWUploadPartInfo& obj_part = obj_iter->second;
 
-      RGWUploadPartInfo& obj_part = obj_iter->second;
+    /* update manifest for part */
+    string oid = mp.get_part(obj_iter->second.num);
+    rgw_obj src_obj;
+    src_obj.init_ns(s->bucket, oid, mp_ns);
 
-      /* update manifest for part */
-      string oid = mp.get_part(obj_iter->second.num);
-      rgw_obj src_obj;
-      src_obj.init_ns(s->bucket, oid, mp_ns);
-
-      if (obj_part.manifest.empty()) {
-        ldout(s->cct, 0) << "ERROR: empty manifest for object part: obj=" << src_obj << dendl;
-        ret = -ERR_INVALID_PART;
-        return;
-      } else {
-        manifest.append(obj_part.manifest);
-      }
+    if (obj_part.manifest.empty()) {
+      ldout(s->cct, 0) << "ERROR: empty manifest for object part: obj=" << src_obj << dendl;
+      ret = -ERR_INVALID_PART;
+      return;
+    } else {
+      manifest.append(obj_part.manifest);
+    }
 
-      rgw_obj_key remove_key;
-      src_obj.get_index_key(&remove_key);
+    rgw_obj_key remove_key;
+    src_obj.get_index_key(&remove_key);
 
-      remove_objs.push_back(remove_key);
+    remove_objs.push_back(remove_key);
 
-      ofs += obj_part.size;
-    }
-  } while (truncated);
+    ofs += obj_part.size;
+  }
   hash.Final((byte *)final_etag);
 
   buf_to_hex((unsigned char *)final_etag, sizeof(final_etag), final_etag_str);
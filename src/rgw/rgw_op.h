@@ -893,6 +893,26 @@ protected:
   char *data;
   int len;
 
+  /*
+   * Sends the partial response every rgw_multipart_complete_keepalive_interval
+   * seconds from the time it is created until it is destroyed, so that the
+   * client doesn't time out while execute() is blocked on RADOS.
+   */
+  class KeepaliveThread : public Thread {
+    RGWCompleteMultipart *op;
+    utime_t interval;
+    Mutex lock;
+    Cond cond;
+    bool done;
+
+  public:
+    KeepaliveThread(RGWCompleteMultipart *_op, int _interval)
+      : op(_op), interval(_interval, 0), lock("RGWCompleteMultipart::KeepaliveThread"),
+        done(false) {}
+    ~KeepaliveThread();
+    void *entry();
+  };
+
 public:
   RGWCompleteMultipart() {
     ret = 0;
@@ -908,6 +928,7 @@ public:
   void execute();
 
   virtual int get_params() = 0;
+  virtual void send_partial_response() {}
   virtual void send_response() = 0;
   virtual const string name() { return "complete_multipart"; }
   virtual RGWOpType get_type() { return RGW_OP_COMPLETE_MULTIPART; }
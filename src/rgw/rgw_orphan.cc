@@ -186,6 +186,8 @@ int RGWOrphanSearch::init(const string& job_name, RGWOrphanSearchInfo *info) {
       return r;
   }
 
+  num_threads = max(1, (int)store->ctx()->_conf->rgw_orphan_scan_threads);
+
   index_objs_prefix = RGW_ORPHAN_INDEX_PREFIX + string(".");
   index_objs_prefix += job_name;
 
@@ -249,34 +251,172 @@ int RGWOrphanSearch::log_oids(map<int, string>& log_shards, map<int, list<string
   return 0;
 }
 
-int RGWOrphanSearch::build_all_oids_index()
+void *RGWOrphanSearch::Worker::entry()
 {
-  librados::Rados *rados = store->get_rados_handle();
+  search->worker_loop(handler);
+  return NULL;
+}
 
-  librados::IoCtx ioctx;
+void RGWOrphanSearch::worker_loop(work_handler_t handler)
+{
+  while (true) {
+    lock.Lock();
+    if (items_exhausted || workers_ret < 0) {
+      break;
+    }
+    lock.Unlock();
 
-  int ret = rados->ioctx_create(search_info.pool.c_str(), ioctx);
-  if (ret < 0) {
-    lderr(store->ctx()) << __func__ << ": ioctx_create() returned ret=" << ret << dendl;
-    return ret;
+    /* once claimed, an item is handled even if another worker hits the end */
+    int item = next_item.inc() - 1;
+    if (item >= num_items) {
+      lock.Lock();
+      break;
+    }
+
+    int r = (this->*handler)(item);
+
+    lock.Lock();
+    if (r < 0 && workers_ret == 0) {
+      workers_ret = r;
+    } else if (r > 0) {
+      /* handler reached the end of the work items */
+      items_exhausted = true;
+    } else {
+      ++items_done;
+    }
+    lock.Unlock();
+  }
+
+  --workers_running;
+  cond.Signal();
+  lock.Unlock();
+}
+
+int RGWOrphanSearch::run_workers(int items, uint64_t total_entries, work_handler_t handler)
+{
+  next_item.set(0);
+  num_items = items;
+  items_exhausted = false;
+  items_done = 0;
+  workers_ret = 0;
+  entries_handled.set(0);
+  entries_total = total_entries;
+  stage_start = ceph_clock_now(store->ctx());
+
+  int n = min(num_threads, items);
+
+  list<Worker *> workers;
+  lock.Lock();
+  workers_running = n;
+  for (int i = 0; i < n; i++) {
+    Worker *worker = new Worker(this, handler);
+    worker->create();
+    workers.push_back(worker);
   }
 
+  while (workers_running > 0) {
+#define PROGRESS_INTERVAL_SECS 10
+    cond.WaitInterval(store->ctx(), lock, utime_t(PROGRESS_INTERVAL_SECS, 0));
+    log_progress();
+  }
+  int ret = workers_ret;
+  lock.Unlock();
+
+  for (list<Worker *>::iterator iter = workers.begin(); iter != workers.end(); ++iter) {
+    (*iter)->join();
+    delete *iter;
+  }
+
+  return ret;
+}
+
+void RGWOrphanSearch::dump_progress(Formatter *f)
+{
+  utime_t elapsed = ceph_clock_now(store->ctx()) - stage_start;
+  uint64_t entries = entries_handled.read();
+
+  f->open_object_section("progress");
+  f->dump_string("job_name", search_info.job_name);
+  f->dump_int("stage", search_stage.stage);
+  f->dump_int("threads", num_threads);
+  f->dump_int("items_done", items_done);
+  if (num_items != INT_MAX) {
+    f->dump_int("items_total", num_items);
+  }
+  f->dump_unsigned("entries", entries);
+  if (entries_total) {
+    f->dump_unsigned("entries_total", entries_total);
+  }
+  f->dump_float("elapsed", (double)elapsed);
+
+  /* estimate from whatever total we know of */
+  double eta = -1;
+  if (entries_total && entries > 0 && entries < entries_total) {
+    eta = (double)elapsed * (entries_total - entries) / entries;
+  } else if (num_items != INT_MAX && items_done > 0) {
+    eta = (double)elapsed * (num_items - items_done) / items_done;
+  }
+  if (eta >= 0) {
+    f->dump_float("eta", eta);
+  }
+  f->close_section();
+}
+
+void RGWOrphanSearch::log_progress()
+{
+  JSONFormatter f;
+  dump_progress(&f);
+  stringstream ss;
+  f.flush(ss);
+  cout << ss.str() << std::endl;
+  ldout(store->ctx(), 1) << "orphan search progress: " << ss.str() << dendl;
+}
+
+bool RGWOrphanSearch::StatusHook::call(std::string command, cmdmap_t& cmdmap, std::string format,
+                                       bufferlist& out)
+{
+  Formatter *f = Formatter::create(format, "json-pretty", "json-pretty");
+  search->lock.Lock();
+  search->dump_progress(f);
+  search->lock.Unlock();
+  stringstream ss;
+  f->flush(ss);
+  out.append(ss);
+  delete f;
+  return true;
+}
+
+int RGWOrphanSearch::list_pool_pg(int pg)
+{
+  librados::IoCtx ioctx;
+  ioctx.dup(data_ioctx);
   ioctx.set_namespace(librados::all_nspaces);
-  librados::NObjectIterator i = ioctx.nobjects_begin();
+
+  librados::NObjectIterator i = ioctx.nobjects_begin(pg);
   librados::NObjectIterator i_end = ioctx.nobjects_end();
 
+  /*
+   * seeking past the last pg either folds back onto an earlier pg or ends
+   * the listing, in both cases there are no more pgs to hand out
+   */
+  if (i == i_end || i.get_pg_hash_position() < (uint32_t)pg) {
+    return 1;
+  }
+
+  ldout(store->ctx(), 10) << "listing pg " << pg << dendl;
+
   map<int, list<string> > oids;
 
   int count = 0;
-  uint64_t total = 0;
+  int ret;
 
-  cout << "logging all objects in the pool" << std::endl;
-
-  for (; i != i_end; ++i) {
+  for (; i != i_end && i.get_pg_hash_position() == (uint32_t)pg; ++i) {
     string nspace = i->get_nspace();
     string oid = i->get_oid();
     string locator = i->get_locator();
 
+    entries_handled.inc();
+
     ssize_t pos = oid.find('_');
     if (pos < 0) {
       cout << "unidentified oid: " << oid << ", skipping" << std::endl;
@@ -308,9 +448,7 @@ int RGWOrphanSearch::build_all_oids_index()
     oids[shard].push_back(oid);
 
 #define COUNT_BEFORE_FLUSH 1000
-    ++total;
     if (++count >= COUNT_BEFORE_FLUSH) {
-      ldout(store->ctx(), 1) << "iterated through " << total << " objects" << dendl;
       ret = log_oids(all_objs_index, oids);
       if (ret < 0) {
         cerr << __func__ << ": ERROR: log_oids() returned ret=" << ret << std::endl;
@@ -325,10 +463,28 @@ int RGWOrphanSearch::build_all_oids_index()
     cerr << __func__ << ": ERROR: log_oids() returned ret=" << ret << std::endl;
     return ret;
   }
-  
+
   return 0;
 }
 
+int RGWOrphanSearch::build_all_oids_index()
+{
+  /* pool stats are only used for estimating progress */
+  uint64_t num_objects = 0;
+  list<string> pools;
+  pools.push_back(search_info.pool);
+  librados::stats_map stats;
+  int ret = store->get_rados_handle()->get_pool_stats(pools, stats);
+  if (ret == 0 && stats.find(search_info.pool) != stats.end()) {
+    num_objects = stats[search_info.pool].num_objects;
+  }
+
+  cout << "logging all objects in the pool" << std::endl;
+
+  /* the number of pgs is discovered while listing, see list_pool_pg() */
+  return run_workers(INT_MAX, num_objects, &RGWOrphanSearch::list_pool_pg);
+}
+
 int RGWOrphanSearch::build_buckets_instance_index()
 {
   void *handle;
@@ -534,44 +690,67 @@ int RGWOrphanSearch::build_linked_oids_for_bucket(const string& bucket_instance_
   return 0;
 }
 
-int RGWOrphanSearch::build_linked_oids_index()
+int RGWOrphanSearch::build_linked_oids_for_shard(int shard)
 {
+  string marker;
+  bool save_marker;
+
+  lock.Lock();
+  if (done_shards.count(shard)) {
+    lock.Unlock();
+    return 0;
+  }
+  /* only the lowest shard that is not done yet keeps a resume marker */
+  save_marker = (shard == search_stage.shard);
+  if (save_marker) {
+    marker = search_stage.marker;
+  }
+  lock.Unlock();
+
+  ldout(store->ctx(), 0) << "building linked oids index: " << shard << "/" << buckets_instance_index.size() << dendl;
+
   map<int, list<string> > oids;
-  map<int, string>::iterator iter = buckets_instance_index.find(search_stage.shard);
-  for (; iter != buckets_instance_index.end(); ++iter) {
-    ldout(store->ctx(), 0) << "building linked oids index: " << iter->first << "/" << buckets_instance_index.size() << dendl;
-    bool truncated;
-
-    string oid = iter->second;
-
-    do {
-      map<string, bufferlist> entries;
-      int ret = orphan_store.read_entries(oid, search_stage.marker, &entries, &truncated);
-      if (ret == -ENOENT) {
-        truncated = false;
-        ret = 0;
-      }
+  string oid = buckets_instance_index[shard];
+  bool truncated;
 
-      if (ret < 0) {
-        lderr(store->ctx()) << __func__ << ": ERROR: read_entries() oid=" << oid << " returned ret=" << ret << dendl;
-        return ret;
-      }
+  do {
+    map<string, bufferlist> entries;
+    int ret = orphan_store.read_entries(oid, marker, &entries, &truncated);
+    if (ret == -ENOENT) {
+      truncated = false;
+      ret = 0;
+    }
 
-      if (entries.empty()) {
-        break;
-      }
+    if (ret < 0) {
+      lderr(store->ctx()) << __func__ << ": ERROR: read_entries() oid=" << oid << " returned ret=" << ret << dendl;
+      return ret;
+    }
 
-      for (map<string, bufferlist>::iterator eiter = entries.begin(); eiter != entries.end(); ++eiter) {
-        ldout(store->ctx(), 20) << " indexed entry: " << eiter->first << dendl;
-        ret = build_linked_oids_for_bucket(eiter->first, oids);
-      }
+    if (entries.empty()) {
+      break;
+    }
 
-      search_stage.shard = iter->first;
-      search_stage.marker = entries.rbegin()->first; /* last entry */
-    } while (truncated);
+    for (map<string, bufferlist>::iterator eiter = entries.begin(); eiter != entries.end(); ++eiter) {
+      ldout(store->ctx(), 20) << " indexed entry: " << eiter->first << dendl;
+      ret = build_linked_oids_for_bucket(eiter->first, oids);
+      entries_handled.inc();
+    }
 
-    search_stage.marker.clear();
-  }
+    marker = entries.rbegin()->first; /* last entry */
+
+    if (save_marker) {
+      ret = log_oids(linked_objs_index, oids);
+      if (ret < 0) {
+        cerr << __func__ << ": ERROR: log_oids() returned ret=" << ret << std::endl;
+        return ret;
+      }
+      oids.clear();
+
+      Mutex::Locker l(lock);
+      search_stage.marker = marker;
+      save_state();
+    }
+  } while (truncated);
 
   int ret = log_oids(linked_objs_index, oids);
   if (ret < 0) {
@@ -579,11 +758,29 @@ int RGWOrphanSearch::build_linked_oids_index()
     return ret;
   }
 
-  save_state();
+  Mutex::Locker l(lock);
+  done_shards.insert(shard);
+  if (shard == search_stage.shard) {
+    while (done_shards.count(search_stage.shard)) {
+      ++search_stage.shard;
+    }
+    search_stage.marker.clear();
+    save_state();
+  }
 
   return 0;
 }
 
+int RGWOrphanSearch::build_linked_oids_index()
+{
+  done_shards.clear();
+  for (int i = 0; i < search_stage.shard; i++) {
+    done_shards.insert(i);
+  }
+
+  return run_workers(buckets_instance_index.size(), 0, &RGWOrphanSearch::build_linked_oids_for_shard);
+}
+
 class OMAPReader {
   librados::IoCtx ioctx;
   string oid;
@@ -634,82 +831,99 @@ int OMAPReader::get_next(string *key, bufferlist *pbl, bool *done)
   return get_next(key, pbl, done);
 }
 
-int RGWOrphanSearch::compare_oid_indexes()
+int RGWOrphanSearch::compare_oid_shard(int shard)
 {
-  assert(linked_objs_index.size() == all_objs_index.size());
-
   librados::IoCtx& ioctx = orphan_store.get_ioctx();
 
-  librados::IoCtx data_ioctx;
-
-  librados::Rados *rados = store->get_rados_handle();
-
-  int ret = rados->ioctx_create(search_info.pool.c_str(), data_ioctx);
-  if (ret < 0) {
-    lderr(store->ctx()) << __func__ << ": ioctx_create() returned ret=" << ret << dendl;
-    return ret;
-  }
-
   uint64_t time_threshold = search_info.start_time.sec() - stale_secs;
 
-  map<int, string>::iterator liter = linked_objs_index.begin();
-  map<int, string>::iterator aiter = all_objs_index.begin();
+  OMAPReader linked_entries(ioctx, linked_objs_index[shard]);
+  OMAPReader all_entries(ioctx, all_objs_index[shard]);
 
-  for (; liter != linked_objs_index.end(); ++liter, ++aiter) {
-    OMAPReader linked_entries(ioctx, liter->second);
-    OMAPReader all_entries(ioctx, aiter->second);
+  bool done;
 
-    bool done;
+  string cur_linked;
+  bool linked_done = false;
 
-    string cur_linked;
-    bool linked_done = false;
+  /* both indexes are sorted omap keys, merge them */
+  do {
+    string key;
+    int r = all_entries.get_next(&key, NULL, &done);
+    if (r < 0) {
+      return r;
+    }
+    if (done) {
+      break;
+    }
 
+    entries_handled.inc();
 
-    do {
-      string key;
-      int r = all_entries.get_next(&key, NULL, &done);
+    string key_fp = obj_fingerprint(key);
+
+    while (cur_linked < key_fp && !linked_done) {
+      r = linked_entries.get_next(&cur_linked, NULL, &linked_done);
       if (r < 0) {
         return r;
       }
-      if (done) {
-        break;
-      }
+    }
 
-      string key_fp = obj_fingerprint(key);
+    if (cur_linked == key_fp) {
+      ldout(store->ctx(), 20) << "linked: " << key << dendl;
+      continue;
+    }
 
-      while (cur_linked < key_fp && !linked_done) {
-        r = linked_entries.get_next(&cur_linked, NULL, &linked_done);
-        if (r < 0) {
-          return r;
-        }
+    time_t mtime;
+    r = data_ioctx.stat(key, NULL, &mtime);
+    if (r < 0) {
+      if (r != -ENOENT) {
+        lderr(store->ctx()) << "ERROR: ioctx.stat(" << key << ") returned ret=" << r << dendl;
       }
+      continue;
+    }
+    if (stale_secs && (uint64_t)mtime >= time_threshold) {
+      ldout(store->ctx(), 20) << "skipping: " << key << " (mtime=" << mtime << " threshold=" << time_threshold << ")" << dendl;
+      continue;
+    }
+    ldout(store->ctx(), 20) << "leaked: " << key << dendl;
+    Mutex::Locker l(lock);
+    cout << "leaked: " << key << std::endl;
+  } while (!done);
 
-      if (cur_linked == key_fp) {
-        ldout(store->ctx(), 20) << "linked: " << key << dendl;
-        continue;
-      }
+  return 0;
+}
 
-      time_t mtime;
-      r = data_ioctx.stat(key, NULL, &mtime);
-      if (r < 0) {
-        if (r != -ENOENT) {
-          lderr(store->ctx()) << "ERROR: ioctx.stat(" << key << ") returned ret=" << r << dendl;
-        }
-        continue;
-      }
-      if (stale_secs && (uint64_t)mtime >= time_threshold) {
-        ldout(store->ctx(), 20) << "skipping: " << key << " (mtime=" << mtime << " threshold=" << time_threshold << ")" << dendl;
-        continue;
-      }
-      ldout(store->ctx(), 20) << "leaked: " << key << dendl;
-      cout << "leaked: " << key << std::endl;
-    } while (!done);
-  }
+int RGWOrphanSearch::compare_oid_indexes()
+{
+  assert(linked_objs_index.size() == all_objs_index.size());
 
-  return 0;
+  return run_workers(linked_objs_index.size(), 0, &RGWOrphanSearch::compare_oid_shard);
 }
 
 int RGWOrphanSearch::run()
+{
+  librados::Rados *rados = store->get_rados_handle();
+
+  int r = rados->ioctx_create(search_info.pool.c_str(), data_ioctx);
+  if (r < 0) {
+    lderr(store->ctx()) << __func__ << ": ioctx_create() returned ret=" << r << dendl;
+    return r;
+  }
+
+  AdminSocket *admin_socket = store->ctx()->get_admin_socket();
+  r = admin_socket->register_command("orphans status", "orphans status", &status_hook,
+                                     "show progress of the running orphan search");
+  if (r < 0) {
+    lderr(store->ctx()) << "error registering admin socket command: " << cpp_strerror(-r) << dendl;
+  }
+
+  r = run_stages();
+
+  admin_socket->unregister_command("orphans status");
+
+  return r;
+}
+
+int RGWOrphanSearch::run_stages()
 {
   int r;
 
@@ -18,6 +18,11 @@
 #include "common/config.h"
 #include "common/Formatter.h"
 #include "common/errno.h"
+#include "common/Mutex.h"
+#include "common/Cond.h"
+#include "common/Thread.h"
+#include "common/admin_socket.h"
+#include "include/atomic.h"
 
 #include "rgw_rados.h"
 
@@ -162,6 +167,53 @@ class RGWOrphanSearch {
   uint16_t max_concurrent_ios;
   uint64_t stale_secs;
 
+  /*
+   * Each stage is split into independent work items (PGs of the data pool
+   * for LSPOOL, index shards for ITERATE_BI and COMPARE) that are handed out
+   * to num_threads worker threads. The state below is shared by the workers
+   * of the stage that is currently running.
+   */
+  int num_threads;
+
+  Mutex lock;
+  Cond cond;
+  atomic_t next_item;
+  int num_items;
+  bool items_exhausted;
+  int items_done;
+  int workers_running;
+  int workers_ret;
+  atomic64_t entries_handled;
+  uint64_t entries_total;
+  utime_t stage_start;
+  set<int> done_shards;
+
+  librados::IoCtx data_ioctx;
+
+  typedef int (RGWOrphanSearch::*work_handler_t)(int item);
+
+  class Worker : public Thread {
+    RGWOrphanSearch *search;
+    work_handler_t handler;
+  public:
+    Worker(RGWOrphanSearch *_search, work_handler_t _handler) : search(_search), handler(_handler) {}
+    void *entry();
+  };
+
+  class StatusHook : public AdminSocketHook {
+    RGWOrphanSearch *search;
+  public:
+    StatusHook(RGWOrphanSearch *_search) : search(_search) {}
+    bool call(std::string command, cmdmap_t& cmdmap, std::string format,
+              bufferlist& out);
+  };
+  StatusHook status_hook;
+
+  void worker_loop(work_handler_t handler);
+  int run_workers(int items, uint64_t total_entries, work_handler_t handler);
+  void dump_progress(Formatter *f);
+  void log_progress();
+
   struct log_iter_info {
     string oid;
     list<string>::iterator cur;
@@ -180,8 +232,15 @@ class RGWOrphanSearch {
 
 
   int remove_index(map<int, string>& index);
+
+  int list_pool_pg(int pg);
+  int build_linked_oids_for_shard(int shard);
+  int compare_oid_shard(int shard);
 public:
-  RGWOrphanSearch(RGWRados *_store, int _max_ios, uint64_t _stale_secs) : store(_store), orphan_store(store), max_concurrent_ios(_max_ios), stale_secs(_stale_secs) {}
+  RGWOrphanSearch(RGWRados *_store, int _max_ios, uint64_t _stale_secs) : store(_store), orphan_store(store), max_concurrent_ios(_max_ios), stale_secs(_stale_secs),
+                                                                          num_threads(1), lock("RGWOrphanSearch::lock"), num_items(0), items_exhausted(false),
+                                                                          items_done(0), workers_running(0), workers_ret(0), entries_total(0),
+                                                                          status_hook(this) {}
 
   int save_state() {
     RGWOrphanSearchState state;
@@ -201,6 +260,7 @@ public:
   int compare_oid_indexes();
 
   int run();
+  int run_stages();
   int finish();
 };
 
@@ -0,0 +1,207 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "include/ceph_hash.h"
+#include "common/Clock.h"
+#include "common/LeakyBucketThrottle.h"
+
+#include "rgw_common.h"
+#include "rgw_qos.h"
+
+#define dout_subsys ceph_subsys_rgw
+
+using namespace std;
+
+RGWQoSHandler::RGWQoSHandler(CephContext *_cct) : cct(_cct)
+{
+  num_shards = max(1, cct->_conf->rgw_qos_table_shards);
+  shards = new Shard[num_shards];
+}
+
+RGWQoSHandler::~RGWQoSHandler()
+{
+  for (unsigned i = 0; i < num_shards; i++) {
+    map<string, Entry>& entries = shards[i].entries;
+    for (map<string, Entry>::iterator iter = entries.begin(); iter != entries.end(); ++iter) {
+      delete iter->second.throttle;
+    }
+  }
+  delete[] shards;
+}
+
+RGWQoSHandler::Shard& RGWQoSHandler::get_shard(const string& key)
+{
+  uint32_t hash = ceph_str_hash_linux(key.c_str(), key.size());
+  return shards[hash % num_shards];
+}
+
+/* drop throttles that haven't been used for a while, they are idle by now */
+void RGWQoSHandler::trim_shard(Shard& shard, utime_t now)
+{
+  utime_t expire = now;
+  expire -= utime_t(cct->_conf->rgw_qos_idle_expire, 0);
+
+  map<string, Entry>::iterator iter = shard.entries.begin();
+  while (iter != shard.entries.end()) {
+    if (iter->second.last_used < expire && !iter->second.delayed) {
+      ldout(cct, 20) << "qos: expiring throttle for " << iter->first << dendl;
+      delete iter->second.throttle;
+      shard.entries.erase(iter++);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+static void config_throttle(LeakyBucketThrottle *throttle, const RGWQoSInfo& info)
+{
+  throttle->config_mode(THROTTLE_MODE_STATIC);
+  throttle->config(THROTTLE_OPS_TOTAL, max<int64_t>(info.max_ops, 0), max<int64_t>(info.burst_ops, 0));
+  throttle->config(THROTTLE_BPS_TOTAL, max<int64_t>(info.max_bytes, 0), max<int64_t>(info.burst_bytes, 0));
+}
+
+/* caller must hold the shard lock for as long as the entry is used */
+RGWQoSHandler::Entry& RGWQoSHandler::get_entry(const string& key, const RGWQoSInfo& info)
+{
+  Shard& shard = get_shard(key);
+  assert(shard.lock.is_locked());
+
+  utime_t now = ceph_clock_now(cct);
+
+  map<string, Entry>::iterator iter = shard.entries.find(key);
+  if (iter == shard.entries.end()) {
+    if (shard.entries.size() * num_shards >= (size_t)cct->_conf->rgw_qos_max_entries) {
+      trim_shard(shard, now);
+    }
+    Entry& entry = shard.entries[key];
+    entry.throttle = new LeakyBucketThrottle(cct, 0);
+    entry.info = info;
+    config_throttle(entry.throttle, info);
+    iter = shard.entries.find(key);
+  } else if (iter->second.info != info) {
+    /* limits were changed through the user or bucket metadata */
+    ldout(cct, 10) << "qos: reconfiguring throttle for " << key << dendl;
+    delete iter->second.throttle;
+    iter->second.throttle = new LeakyBucketThrottle(cct, 0);
+    iter->second.info = info;
+    config_throttle(iter->second.throttle, info);
+  }
+  iter->second.last_used = now;
+
+  return iter->second;
+}
+
+static bool is_write_op(req_state *s)
+{
+  return (s->op == OP_PUT || s->op == OP_POST || s->op == OP_DELETE || s->op == OP_COPY);
+}
+
+/* the limits that apply to this request, keyed by their throttle table key */
+static void get_targets(req_state *s, list<pair<string, const RGWQoSInfo *> >& targets)
+{
+  if (s->user.qos.is_limited()) {
+    targets.push_back(make_pair(string("user:") + s->user.user_id, &s->user.qos));
+  }
+  if (!s->bucket.name.empty() && s->bucket_info.qos.is_limited()) {
+    targets.push_back(make_pair(string("bucket:") + s->bucket.name, &s->bucket_info.qos));
+  }
+}
+
+int RGWQoSHandler::throttle_request(req_state *s)
+{
+  list<pair<string, const RGWQoSInfo *> > targets;
+  get_targets(s, targets);
+
+  if (targets.empty()) {
+    return 0;
+  }
+
+  bool is_write = is_write_op(s);
+  uint64_t in_bytes = (is_write && s->content_length > 0 ? s->content_length : 0);
+
+  double wait = 0;
+  bool too_many_delayed = false;
+  int max_delayed = cct->_conf->rgw_qos_max_delayed;
+  list<pair<string, const RGWQoSInfo *> >::iterator iter;
+  for (iter = targets.begin(); iter != targets.end(); ++iter) {
+    Shard& shard = get_shard(iter->first);
+    Mutex::Locker l(shard.lock);
+    Entry& entry = get_entry(iter->first, *iter->second);
+    double w = entry.throttle->compute_wait(is_write);
+    if (w > 0 && entry.delayed >= max_delayed) {
+      too_many_delayed = true;
+    }
+    wait = max(wait, w);
+  }
+
+  /*
+   * a sleeping request holds a frontend thread, don't let a single user
+   * or bucket tie up more than a few of them
+   */
+  if (wait > cct->_conf->rgw_qos_max_delay || too_many_delayed) {
+    ldout(cct, 10) << "qos: rejecting request, would need to wait " << wait << "s"
+                   << (too_many_delayed ? " behind other delayed requests" : "") << dendl;
+    if (perfcounter) perfcounter->inc(l_rgw_qos_reject);
+    return -ERR_SLOW_DOWN;
+  }
+
+  /* the request is admitted, account it against all limits */
+  for (iter = targets.begin(); iter != targets.end(); ++iter) {
+    Shard& shard = get_shard(iter->first);
+    Mutex::Locker l(shard.lock);
+    Entry& entry = get_entry(iter->first, *iter->second);
+    entry.throttle->adjust(THROTTLE_OPS_TOTAL, 1, 0);
+    if (in_bytes) {
+      entry.throttle->adjust(THROTTLE_BPS_TOTAL, in_bytes, 0);
+    }
+    if (wait > 0) {
+      entry.delayed++;
+    }
+  }
+
+  if (wait > 0) {
+    ldout(cct, 10) << "qos: delaying request for " << wait << "s" << dendl;
+    if (perfcounter) perfcounter->inc(l_rgw_qos_delay);
+    utime_t delay;
+    delay.set_from_double(wait);
+    delay.sleep();
+
+    for (iter = targets.begin(); iter != targets.end(); ++iter) {
+      Shard& shard = get_shard(iter->first);
+      Mutex::Locker l(shard.lock);
+      Entry& entry = get_entry(iter->first, *iter->second);
+      entry.delayed--;
+    }
+  } else {
+    if (perfcounter) perfcounter->inc(l_rgw_qos_pass);
+  }
+
+  return 0;
+}
+
+void RGWQoSHandler::account_bytes(req_state *s, uint64_t bytes)
+{
+  if (!bytes) {
+    return;
+  }
+
+  list<pair<string, const RGWQoSInfo *> > targets;
+  get_targets(s, targets);
+
+  for (list<pair<string, const RGWQoSInfo *> >::iterator iter = targets.begin();
+       iter != targets.end(); ++iter) {
+    Shard& shard = get_shard(iter->first);
+    Mutex::Locker l(shard.lock);
+    Entry& entry = get_entry(iter->first, *iter->second);
+    entry.throttle->adjust(THROTTLE_BPS_TOTAL, bytes, 0);
+  }
+}
@@ -0,0 +1,124 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_RGW_QOS_H
+#define CEPH_RGW_QOS_H
+
+#include <string>
+#include <map>
+
+#include "include/types.h"
+#include "include/utime.h"
+#include "common/Mutex.h"
+
+class CephContext;
+class JSONObj;
+class LeakyBucketThrottle;
+struct req_state;
+
+/*
+ * Request rate limits of a user or a bucket. Limits are enforced per
+ * radosgw instance by leaky buckets, a limit <= 0 means unlimited.
+ */
+struct RGWQoSInfo {
+  bool enabled;
+  int64_t max_ops;      /* requests per second */
+  int64_t max_bytes;    /* bytes per second */
+  int64_t burst_ops;    /* requests allowed above max_ops in a burst */
+  int64_t burst_bytes;  /* bytes allowed above max_bytes in a burst */
+
+  RGWQoSInfo() : enabled(false), max_ops(-1), max_bytes(-1), burst_ops(-1), burst_bytes(-1) {}
+
+  bool is_limited() const {
+    return enabled && (max_ops > 0 || max_bytes > 0);
+  }
+
+  bool operator==(const RGWQoSInfo& o) const {
+    return enabled == o.enabled && max_ops == o.max_ops && max_bytes == o.max_bytes &&
+           burst_ops == o.burst_ops && burst_bytes == o.burst_bytes;
+  }
+  bool operator!=(const RGWQoSInfo& o) const {
+    return !(*this == o);
+  }
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(enabled, bl);
+    ::encode(max_ops, bl);
+    ::encode(max_bytes, bl);
+    ::encode(burst_ops, bl);
+    ::encode(burst_bytes, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::iterator& bl) {
+    DECODE_START(1, bl);
+    ::decode(enabled, bl);
+    ::decode(max_ops, bl);
+    ::decode(max_bytes, bl);
+    ::decode(burst_ops, bl);
+    ::decode(burst_bytes, bl);
+    DECODE_FINISH(bl);
+  }
+
+  void dump(Formatter *f) const;
+
+  void decode_json(JSONObj *obj);
+};
+WRITE_CLASS_ENCODER(RGWQoSInfo)
+
+/*
+ * Holds one leaky bucket throttle per throttled user and bucket, in a table
+ * sharded by key so that lookups from different request threads don't
+ * contend on a single lock.
+ */
+class RGWQoSHandler {
+  struct Entry {
+    LeakyBucketThrottle *throttle;
+    RGWQoSInfo info;
+    utime_t last_used;
+    int delayed;  /* requests currently sleeping on this throttle */
+
+    Entry() : throttle(NULL), delayed(0) {}
+  };
+
+  struct Shard {
+    Mutex lock;
+    std::map<std::string, Entry> entries;
+
+    Shard() : lock("RGWQoSHandler::Shard::lock") {}
+  };
+
+  CephContext *cct;
+  unsigned num_shards;
+  Shard *shards;
+
+  Shard& get_shard(const std::string& key);
+  Entry& get_entry(const std::string& key, const RGWQoSInfo& info);
+  void trim_shard(Shard& shard, utime_t now);
+
+public:
+  RGWQoSHandler(CephContext *_cct);
+  ~RGWQoSHandler();
+
+  /*
+   * Admit a request against the user and bucket limits. Sleeps for short
+   * delays, returns -ERR_SLOW_DOWN if the request would have to wait longer
+   * than rgw_qos_max_delay, or if rgw_qos_max_delayed requests of the same
+   * user or bucket are already sleeping.
+   */
+  int throttle_request(req_state *s);
+
+  /* account the payload of a completed request */
+  void account_bytes(req_state *s, uint64_t bytes);
+};
+
+#endif
@@ -2201,6 +2201,7 @@ void RGWRados::finalize()
     delete conn;
   }
   RGWQuotaHandler::free_handler(quota_handler);
+  delete qos_handler;
   /* Begin added by hechuang */
   ac->terminate();
   /* End added */
@@ -2732,6 +2733,7 @@ int RGWRados::init_complete()
   }
 
   quota_handler = RGWQuotaHandler::generate_handler(this, quota_threads);
+  qos_handler = new RGWQoSHandler(cct);
 
   bucket_index_max_shards = (cct->_conf->rgw_override_bucket_index_max_shards ? cct->_conf->rgw_override_bucket_index_max_shards :
                              zone_public_config.bucket_index_max_shards);
@@ -1431,6 +1431,7 @@ protected:
   string trans_id_suffix;
 
   RGWQuotaHandler *quota_handler;
+  RGWQoSHandler *qos_handler;
 
   Finisher *finisher;
 
@@ -1460,6 +1461,7 @@ public:
                num_rados_handles_2(0),handle_lock_2("rados_handle_lock_2"),
                pools_initialized(false),
                quota_handler(NULL),
+               qos_handler(NULL),
                finisher(NULL),
                rest_master_conn(NULL),
                meta_mgr(NULL), data_log(NULL) {}
@@ -1468,6 +1470,8 @@ public:
     return max_req_id.inc();
   }
 
+  RGWQoSHandler *get_qos_handler() { return qos_handler; }
+
   void set_context(CephContext *_cct) {
     cct = _cct;
   }
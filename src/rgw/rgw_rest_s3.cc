@@ -1896,12 +1896,43 @@ void RGWInitMultipart_ObjStore_S3::send_response()
   }
 }
 
+void RGWCompleteMultipart_ObjStore_S3::send_partial_response()
+{
+  if (!sent_header) {
+    dump_errno(s);
+    end_header(s, this, "application/xml");
+    dump_start(s);
+    rgw_flush_formatter(s, s->formatter);
+    sent_header = true;
+  } else {
+    /* Whitespace after the XML declaration keeps the connection alive
+     * while the upload is being completed, this is what S3 does too.
+     */
+    s->cio->write(" ", 1);
+  }
+}
+
 void RGWCompleteMultipart_ObjStore_S3::send_response()
 {
-  if (ret)
-    set_req_state_err(s, ret);
-  dump_errno(s);
-  end_header(s, this, "application/xml");
+  if (sent_header) {
+    /* the 200 status is out already, errors can only go in the body */
+    if (ret) {
+      set_req_state_err(s, ret);
+      s->formatter->open_object_section("Error");
+      if (!s->err.s3_code.empty())
+        s->formatter->dump_string("Code", s->err.s3_code);
+      if (!s->err.message.empty())
+        s->formatter->dump_string("Message", s->err.message);
+      s->formatter->close_section();
+      rgw_flush_formatter_and_reset(s, s->formatter);
+      return;
+    }
+  } else {
+    if (ret)
+      set_req_state_err(s, ret);
+    dump_errno(s);
+    end_header(s, this, "application/xml");
+  }
   if (ret == 0) { 
     dump_start(s);
     s->formatter->open_object_section_in_ns("CompleteMultipartUploadResult",
@@ -281,10 +281,12 @@ public:
 };
 
 class RGWCompleteMultipart_ObjStore_S3 : public RGWCompleteMultipart_ObjStore {
+  bool sent_header;
 public:
-  RGWCompleteMultipart_ObjStore_S3() {}
+  RGWCompleteMultipart_ObjStore_S3() : sent_header(false) {}
   ~RGWCompleteMultipart_ObjStore_S3() {}
 
+  void send_partial_response();
   void send_response();
 };
 
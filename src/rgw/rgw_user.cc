@@ -1794,6 +1794,9 @@ int RGWUser::execute_add(RGWUserAdminOpState& op_state, std::string *err_msg)
   if (op_state.has_user_quota())
     user_info.user_quota = op_state.get_user_quota();
 
+  if (op_state.has_qos())
+    user_info.qos = op_state.get_qos();
+
   // update the request
   op_state.set_user_info(user_info);
   op_state.set_populated();
@@ -2002,6 +2005,9 @@ int RGWUser::execute_modify(RGWUserAdminOpState& op_state, std::string *err_msg)
   if (op_state.has_user_quota())
     user_info.user_quota = op_state.get_user_quota();
 
+  if (op_state.has_qos())
+    user_info.qos = op_state.get_qos();
+
   if (op_state.has_suspension_op()) {
     __u8 suspended = op_state.get_suspension_status();
     user_info.suspended = suspended;
@@ -183,9 +183,11 @@ struct RGWUserAdminOpState {
 
   bool bucket_quota_specified;
   bool user_quota_specified;
+  bool qos_specified;
 
   RGWQuotaInfo bucket_quota;
   RGWQuotaInfo user_quota;
+  RGWQoSInfo qos;
 
   void set_access_key(std::string& access_key) {
     if (access_key.empty())
@@ -319,6 +321,11 @@ struct RGWUserAdminOpState {
     user_quota_specified = true;
   }
 
+  void set_qos(RGWQoSInfo& _qos) {
+    qos = _qos;
+    qos_specified = true;
+  }
+
   bool is_populated() { return populated; }
   bool is_initialized() { return initialized; }
   bool has_existing_user() { return existing_user; }
@@ -339,6 +346,7 @@ struct RGWUserAdminOpState {
   bool will_generate_subuser() { return gen_subuser; }
   bool has_bucket_quota() { return bucket_quota_specified; }
   bool has_user_quota() { return user_quota_specified; }
+  bool has_qos() { return qos_specified; }
   void set_populated() { populated = true; }
   void clear_populated() { populated = false; }
   void set_initialized() { initialized = true; }
@@ -355,6 +363,7 @@ struct RGWUserAdminOpState {
   uint32_t get_op_mask() { return op_mask; }
   RGWQuotaInfo& get_bucket_quota() { return bucket_quota; }
   RGWQuotaInfo& get_user_quota() { return user_quota; }
+  RGWQoSInfo& get_qos() { return qos; }
 
   std::string get_user_id() { return user_id; }
   std::string get_subuser() { return subuser; }
@@ -448,6 +457,7 @@ struct RGWUserAdminOpState {
     bucket_quota_specified = false;
     temp_url_key_specified = false;
     user_quota_specified = false;
+    qos_specified = false;
   }
 };
 
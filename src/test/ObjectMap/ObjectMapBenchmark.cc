@@ -0,0 +1,156 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Concurrent omap set/get against DBObjectMap on top of leveldb or rocksdb,
+ * run with an increasing number of threads to show how omap ops on
+ * unrelated objects scale.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <string>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+#include "common/debug.h"
+#include "common/Cycles.h"
+#include "common/errno.h"
+#include "common/Formatter.h"
+#include "common/Thread.h"
+#include "common/perf_counters.h"
+#include "global/global_init.h"
+#include "os/DBObjectMap.h"
+#include "os/KeyValueDB.h"
+#include "test/perf_bench.h"
+
+static const int objects_per_thread = 64;
+
+static ghobject_t object_name(int thread, int i)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "omap_%d_%d", thread, i);
+  return ghobject_t(hobject_t(sobject_t(object_t(buf), CEPH_NOSNAP)));
+}
+
+class OmapThread : public Thread {
+  ObjectMap *omap;
+  int id;
+  int ops;
+  bufferlist value;
+
+public:
+  OmapThread(ObjectMap *omap, int id, int ops)
+    : omap(omap), id(id), ops(ops) {
+    value.append(string(100, 'v'));
+  }
+
+  void *entry() {
+    for (int i = 0; i < ops; i++) {
+      ghobject_t oid = object_name(id, rand() % objects_per_thread);
+      char key[32];
+      snprintf(key, sizeof(key), "key_%d", rand() % 128);
+      if (i % 2 == 0) {
+	map<string, bufferlist> to_set;
+	to_set[key] = value;
+	omap->set_keys(oid, to_set);
+      } else {
+	set<string> to_get;
+	to_get.insert(key);
+	map<string, bufferlist> got;
+	omap->get_values(oid, to_get, &got);
+      }
+    }
+    return NULL;
+  }
+};
+
+static int run(const string &type, const string &path, int threads, int ops)
+{
+  ::system((string("rm -fr ") + path).c_str());
+  int r = ::mkdir(path.c_str(), 0777);
+  if (r < 0) {
+    cerr << "unable to create " << path << ": " << cpp_strerror(errno) << std::endl;
+    return -errno;
+  }
+
+  KeyValueDB *store = KeyValueDB::create(g_ceph_context, type, path);
+  if (!store) {
+    cerr << "unknown key value store type " << type << std::endl;
+    return -EINVAL;
+  }
+  stringstream err;
+  store->init();
+  r = store->create_and_open(err);
+  if (r < 0) {
+    cerr << "unable to open " << type << " in " << path << ": " << err.str() << std::endl;
+    delete store;
+    return r;
+  }
+
+  DBObjectMap *omap = new DBObjectMap(store);
+  r = omap->init();
+  if (r < 0) {
+    cerr << "unable to init DBObjectMap: " << cpp_strerror(r) << std::endl;
+    delete omap;
+    return r;
+  }
+
+  vector<OmapThread*> workers;
+  for (int i = 0; i < threads; i++)
+    workers.push_back(new OmapThread(omap, i, ops));
+
+  uint64_t start = Cycles::rdtsc();
+  for (int i = 0; i < threads; i++)
+    workers[i]->create();
+  for (int i = 0; i < threads; i++) {
+    workers[i]->join();
+    delete workers[i];
+  }
+  uint64_t us = Cycles::to_microseconds(Cycles::rdtsc() - start);
+
+  uint64_t total = (uint64_t)threads * ops;
+  cerr << " " << type << " " << threads << " threads: " << total << " ops in "
+       << us << "us, " << (us ? total * 1000000 / us : 0) << " ops/s" << std::endl;
+
+  JSONFormatter f(true);
+  g_ceph_context->get_perfcounters_collection()->dump_formatted(&f, false, "dbobjectmap");
+  f.flush(cerr);
+  cerr << std::endl;
+
+  delete omap;
+  return 0;
+}
+
+int omap_bench(const vector<const char*> &args)
+{
+  string type = perf_bench_arg(args, 0, "leveldb");
+  int max_threads = perf_bench_arg(args, 1, 32);
+  int ops = perf_bench_arg(args, 2, 20000);
+  if (max_threads <= 0 || ops <= 0)
+    return -EINVAL;
+
+  cerr << "omap stripes " << g_conf->filestore_omap_header_stripes
+       << ", header cache " << g_conf->filestore_omap_header_cache_size << std::endl;
+
+  string path = "omap_bench_temp_dir." + type;
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    int r = run(type, path, threads, ops);
+    if (r < 0)
+      return r;
+  }
+  ::system((string("rm -fr ") + path).c_str());
+  return 0;
+}
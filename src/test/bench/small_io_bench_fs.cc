@@ -14,6 +14,9 @@
 #include <fstream>
 
 #include "common/Formatter.h"
+#include "common/Finisher.h"
+#include "common/Mutex.h"
+#include "common/Cond.h"
 
 #include "bencher.h"
 #include "rados_backend.h"
@@ -21,6 +24,7 @@
 #include "distribution.h"
 #include "global/global_init.h"
 #include "os/FileStore.h"
+#include "os/FileJournal.h"
 #include "testfilestore_backend.h"
 #include "common/perf_counters.h"
 
@@ -41,6 +45,133 @@ struct MorePrinting : public DetailedStatCollector::AdditionalPrinting {
   }
 };
 
+/*
+ * Journal only mode: keep num-concurrent-ops transactions of io-size bytes
+ * in flight against a bare FileJournal and report IOPS and commit latency
+ * percentiles.
+ */
+struct JournalBench {
+  Mutex lock;
+  Cond cond;
+  unsigned in_flight;
+  uint64_t completed_seq;
+  vector<double> latencies;
+
+  JournalBench() : lock("JournalBench::lock"), in_flight(0), completed_seq(0) {}
+
+  struct C_Committed : public Context {
+    JournalBench *bench;
+    uint64_t seq;
+    utime_t start;
+    C_Committed(JournalBench *bench, uint64_t seq, utime_t start)
+      : bench(bench), seq(seq), start(start) {}
+    void finish(int r) {
+      utime_t lat = ceph_clock_now(g_ceph_context) - start;
+      Mutex::Locker l(bench->lock);
+      bench->latencies.push_back(lat);
+      bench->completed_seq = MAX(bench->completed_seq, seq);
+      bench->in_flight--;
+      bench->cond.Signal();
+    }
+  };
+
+  int run(const string &path, unsigned concurrent, unsigned io_size,
+	  unsigned duration, unsigned max_ops);
+};
+
+static double percentile(const vector<double> &sorted, double p)
+{
+  if (sorted.empty())
+    return 0;
+  size_t i = (size_t)(p * (sorted.size() - 1));
+  return sorted[i];
+}
+
+int JournalBench::run(const string &path, unsigned concurrent, unsigned io_size,
+		      unsigned duration, unsigned max_ops)
+{
+  Finisher finisher(g_ceph_context);
+  Cond sync_cond;
+  uuid_d fsid;
+  fsid.generate_random();
+
+  finisher.start();
+  FileJournal j(fsid, &finisher, &sync_cond, path.c_str(),
+		g_conf->journal_dio, g_conf->journal_aio,
+		g_conf->journal_force_aio);
+  int r = j.create();
+  if (r < 0) {
+    cout << "journal create failed: " << r << std::endl;
+    finisher.stop();
+    return r;
+  }
+  j.make_writeable();
+  j.set_wait_on_full(true);
+
+  if (max_ops == 0 && duration == 0)
+    max_ops = 100000;
+
+  bufferlist data;
+  data.append_zero(io_size);
+  coll_t cid("journal_bench");
+  hobject_t oid(sobject_t("journal_bench_obj", 0));
+
+  utime_t start = ceph_clock_now(g_ceph_context);
+  utime_t end = start;
+  end += utime_t(duration, 0);
+  uint64_t seq = 0;
+  uint64_t trimmed_seq = 0;
+
+  lock.Lock();
+  while ((!max_ops || seq < max_ops) &&
+	 (!duration || ceph_clock_now(g_ceph_context) < end)) {
+    while (in_flight >= concurrent)
+      cond.Wait(lock);
+    uint64_t to_trim = completed_seq;
+    in_flight++;
+    lock.Unlock();
+
+    // let the journal wrap
+    if (to_trim >= trimmed_seq + 1000) {
+      j.commit_start(to_trim);
+      j.committed_thru(to_trim);
+      trimmed_seq = to_trim;
+    }
+
+    ObjectStore::Transaction t;
+    t.write(cid, oid, (seq * io_size) % (4 << 20), io_size, data);
+    list<ObjectStore::Transaction*> tls;
+    tls.push_back(&t);
+    bufferlist tbl;
+    int orig_len = j._op_journal_transactions_prepare(tls, tbl);
+    ++seq;
+    j.submit_entry(seq, tbl, orig_len,
+		   new C_Committed(this, seq, ceph_clock_now(g_ceph_context)));
+
+    lock.Lock();
+  }
+  while (in_flight > 0)
+    cond.Wait(lock);
+  lock.Unlock();
+
+  double elapsed = ceph_clock_now(g_ceph_context) - start;
+  j.close();
+  finisher.stop();
+
+  sort(latencies.begin(), latencies.end());
+  cout << "journal " << path << ": " << seq << " ops of " << io_size
+       << " bytes, " << concurrent << " in flight, "
+       << (g_conf->journal_aio_batch ? "batched aio" : "aio") << std::endl;
+  cout << "  iops " << (elapsed > 0 ? seq / elapsed : 0) << std::endl;
+  cout << "  latency p50 " << percentile(latencies, 0.5) * 1000000 << "us"
+       << " p90 " << percentile(latencies, 0.9) * 1000000 << "us"
+       << " p99 " << percentile(latencies, 0.99) * 1000000 << "us"
+       << " p99.9 " << percentile(latencies, 0.999) * 1000000 << "us"
+       << " max " << (latencies.empty() ? 0 : latencies.back() * 1000000) << "us"
+       << std::endl;
+  return 0;
+}
+
 int main(int argc, char **argv)
 {
   po::options_description desc("Allowed options");
@@ -80,6 +211,8 @@ int main(int argc, char **argv)
      "don't dump per op stats")
     ("num-writers", po::value<unsigned>()->default_value(1),
      "num write threads")
+    ("journal-only", po::value<bool>()->default_value(false),
+     "only write io-size transactions to the journal, report iops and latency")
     ;
 
   vector<string> ceph_option_strings;
@@ -113,14 +246,29 @@ int main(int argc, char **argv)
   common_init_finish(g_ceph_context);
   g_ceph_context->_conf->apply_changes(NULL);
 
-  if (!vm.count("filestore-path") || !vm.count("journal-path")) {
-    cout << "Must provide filestore-path and journal-path" << std::endl
-	 << desc << std::endl;
+  if (vm.count("help")) {
+    cout << desc << std::endl;
     return 1;
   }
 
-  if (vm.count("help")) {
-    cout << desc << std::endl;
+  if (vm["journal-only"].as<bool>()) {
+    if (!vm.count("journal-path")) {
+      cout << "Must provide journal-path" << std::endl
+	   << desc << std::endl;
+      return 1;
+    }
+    JournalBench bench;
+    int r = bench.run(vm["journal-path"].as<string>(),
+		      vm["num-concurrent-ops"].as<unsigned>(),
+		      vm["io-size"].as<unsigned>(),
+		      vm["duration"].as<unsigned>(),
+		      vm["max-ops"].as<unsigned>());
+    return r < 0 ? 1 : 0;
+  }
+
+  if (!vm.count("filestore-path") || !vm.count("journal-path")) {
+    cout << "Must provide filestore-path and journal-path" << std::endl
+	 << desc << std::endl;
     return 1;
   }
 
@@ -0,0 +1,162 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Simulates an OSD op shard serving a latency sensitive index pool, a
+ * bulk ingest pool saturating the OSD and some recovery, with the
+ * prioritized and the mclock op queue.  Ops arrive at random and are
+ * served one at a time with a service time growing with their size, in
+ * simulated time.  Reports the achieved iops and latencies per workload.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+#include "common/debug.h"
+#include "common/MClockQueue.h"
+#include "common/PrioritizedQueue.h"
+#include "global/global_init.h"
+#include "test/perf_bench.h"
+
+static const double server_iops = 2000;
+static const double server_bw = 400 << 20;
+
+struct Workload {
+  const char *name;
+  unsigned priority;
+  int clients;
+  double rate;          ///< ops/s offered over all clients
+  unsigned size;
+  double res, lim, wgt; ///< mclock tags
+};
+
+static Workload workloads[] = {
+  { "index",    63,  4,  200,      4096, 300, 0, 100 },
+  { "bulk",     63, 32, 2000,     65536,   0, 0, 100 },
+  { "recovery", 10,  1,   40,   1 << 20,   0, 0,  10 },
+};
+static const int num_workloads = sizeof(workloads) / sizeof(workloads[0]);
+
+struct SimOp {
+  int workload;
+  double arrival;
+  SimOp(int workload, double arrival) : workload(workload), arrival(arrival) {}
+};
+
+static double sim_now;
+
+class SimClassifier : public MClockQueue<SimOp, int>::Classifier {
+public:
+  uint64_t classify(const int &cl, const SimOp &op,
+		    MClockQueue<SimOp, int>::ClientInfo *info) {
+    const Workload &w = workloads[op.workload];
+    *info = MClockQueue<SimOp, int>::ClientInfo(w.res, w.lim, w.wgt);
+    return op.workload;
+  }
+};
+
+class SimMClockQueue : public MClockQueue<SimOp, int> {
+public:
+  SimMClockQueue(uint64_t cost_per_io, Classifier *c)
+    : MClockQueue<SimOp, int>(cost_per_io, c) {}
+protected:
+  double get_time() const {
+    return sim_now;
+  }
+};
+
+static double interval(double rate)
+{
+  return -::log(1.0 - drand48()) / rate;
+}
+
+static void run(const char *mode, OpQueue<SimOp, int> *q, double seconds)
+{
+  srand48(0);
+  vector<double> next(num_workloads);
+  vector<vector<double> > lat(num_workloads);
+  for (int i = 0; i < num_workloads; i++)
+    next[i] = interval(workloads[i].rate);
+
+  sim_now = 0;
+  double busy_until = 0;
+  while (true) {
+    int a = min_element(next.begin(), next.end()) - next.begin();
+    if (!q->empty() && busy_until <= next[a]) {
+      sim_now = max(sim_now, busy_until);
+      if (sim_now >= seconds)
+	break;
+      SimOp op = q->dequeue();
+      busy_until = sim_now + 1.0 / server_iops +
+	workloads[op.workload].size / server_bw;
+      lat[op.workload].push_back(busy_until - op.arrival);
+    } else {
+      sim_now = next[a];
+      if (sim_now >= seconds)
+	break;
+      const Workload &w = workloads[a];
+      int client = a * 1000 + rand() % w.clients;
+      q->enqueue(client, w.priority, w.size, SimOp(a, sim_now));
+      next[a] += interval(w.rate);
+    }
+  }
+
+  cerr << " " << mode << ":" << std::endl;
+  for (int i = 0; i < num_workloads; i++) {
+    vector<double> &l = lat[i];
+    sort(l.begin(), l.end());
+    double sum = 0;
+    for (vector<double>::iterator p = l.begin(); p != l.end(); ++p)
+      sum += *p;
+    cerr << "  " << workloads[i].name << ": "
+	 << l.size() / seconds << " of " << workloads[i].rate << " iops";
+    if (!l.empty())
+      cerr << ", latency avg " << sum / l.size() * 1000
+	   << "ms p99 " << l[l.size() * 99 / 100] * 1000 << "ms";
+    cerr << std::endl;
+  }
+  cerr << "  " << q->length() << " ops left queued" << std::endl;
+}
+
+int op_queue_bench(const vector<const char*> &args)
+{
+  double seconds = perf_bench_arg(args, 0, 60.0);
+  workloads[0].res = perf_bench_arg(args, 1, workloads[0].res);
+  if (seconds <= 0 || workloads[0].res < 0)
+    return -EINVAL;
+
+  cerr << seconds << "s at " << server_iops << " iops and "
+       << (server_bw / (1 << 20)) << " MB/s" << std::endl;
+  for (int i = 0; i < num_workloads; i++) {
+    const Workload &w = workloads[i];
+    cerr << " " << w.name << ": " << w.rate << " ops/s of " << w.size
+	 << " bytes from " << w.clients << " clients, priority " << w.priority
+	 << ", mclock res " << w.res << " lim " << w.lim << " wgt " << w.wgt
+	 << std::endl;
+  }
+
+  PrioritizedQueue<SimOp, int> pq(g_conf->osd_op_pq_max_tokens_per_priority,
+				  g_conf->osd_op_pq_min_cost);
+  run("prioritized", &pq, seconds);
+
+  SimClassifier classifier;
+  SimMClockQueue mq(g_conf->osd_op_queue_mclock_cost_per_io, &classifier);
+  run("mclock", &mq, seconds);
+  return 0;
+}
@@ -0,0 +1,186 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <map>
+#include "common/MClockQueue.h"
+#include "common/ceph_argparse.h"
+#include "global/global_context.h"
+#include "global/global_init.h"
+#include <gtest/gtest.h>
+
+// class and sequence number
+typedef pair<int, int> Item;
+
+class TestClassifier : public MClockQueue<Item, int>::Classifier {
+public:
+  map<int, MClockQueue<Item, int>::ClientInfo> info;
+  uint64_t classify(const int &cl, const Item &item,
+		    MClockQueue<Item, int>::ClientInfo *i) {
+    *i = info[item.first];
+    return item.first;
+  }
+};
+
+// with a clock the test advances
+class TestQueue : public MClockQueue<Item, int> {
+public:
+  double now;
+  TestQueue(Classifier *c) : MClockQueue<Item, int>(1, c), now(1000) {}
+protected:
+  double get_time() const {
+    return now;
+  }
+};
+
+static void fill(TestQueue &q, int cl, int n)
+{
+  for (int i = 0; i < n; ++i)
+    q.enqueue(cl, 0, 1, Item(cl, i));
+}
+
+// dequeue n items over a second, counting them per class
+static map<int, int> run(TestQueue &q, int n)
+{
+  map<int, int> served;
+  for (int i = 0; i < n && !q.empty(); ++i) {
+    served[q.dequeue().first]++;
+    q.now += 1.0 / n;
+  }
+  return served;
+}
+
+TEST(MClockQueue, fifo) {
+  TestClassifier c;
+  TestQueue q(&c);
+  fill(q, 1, 10);
+  ASSERT_EQ(10u, q.length());
+  for (int i = 0; i < 10; ++i)
+    ASSERT_EQ(Item(1, i), q.dequeue());
+  ASSERT_TRUE(q.empty());
+}
+
+TEST(MClockQueue, strict) {
+  TestClassifier c;
+  TestQueue q(&c);
+  fill(q, 1, 2);
+  q.enqueue_strict(1, 10, Item(0, 0));
+  q.enqueue_strict(1, 20, Item(0, 1));
+  q.enqueue_strict_front(1, 20, Item(0, 2));
+  ASSERT_EQ(Item(0, 2), q.dequeue());
+  ASSERT_EQ(Item(0, 1), q.dequeue());
+  ASSERT_EQ(Item(0, 0), q.dequeue());
+  ASSERT_EQ(Item(1, 0), q.dequeue());
+  q.enqueue_front(1, 0, 1, Item(1, -1));
+  ASSERT_EQ(Item(1, -1), q.dequeue());
+  ASSERT_EQ(Item(1, 1), q.dequeue());
+  ASSERT_TRUE(q.empty());
+}
+
+TEST(MClockQueue, weight) {
+  TestClassifier c;
+  c.info[1] = MClockQueue<Item, int>::ClientInfo(0, 0, 1);
+  c.info[2] = MClockQueue<Item, int>::ClientInfo(0, 0, 3);
+  TestQueue q(&c);
+  fill(q, 1, 2000);
+  fill(q, 2, 2000);
+  map<int, int> served = run(q, 1000);
+  ASSERT_NEAR(250, served[1], 5);
+  ASSERT_NEAR(750, served[2], 5);
+}
+
+TEST(MClockQueue, reservation) {
+  TestClassifier c;
+  c.info[1] = MClockQueue<Item, int>::ClientInfo(200, 0, 1);
+  c.info[2] = MClockQueue<Item, int>::ClientInfo(0, 0, 1000);
+  TestQueue q(&c);
+  fill(q, 1, 2000);
+  fill(q, 2, 2000);
+  map<int, int> served = run(q, 1000);
+  ASSERT_NEAR(200, served[1], 5);
+  ASSERT_NEAR(800, served[2], 5);
+}
+
+TEST(MClockQueue, limit) {
+  TestClassifier c;
+  c.info[1] = MClockQueue<Item, int>::ClientInfo(0, 100, 1000);
+  c.info[2] = MClockQueue<Item, int>::ClientInfo(0, 0, 1);
+  TestQueue q(&c);
+  fill(q, 1, 2000);
+  fill(q, 2, 2000);
+  map<int, int> served = run(q, 1000);
+  ASSERT_NEAR(100, served[1], 5);
+  ASSERT_NEAR(900, served[2], 5);
+
+  // nothing else to do, the limit doesn't leave the queue idle
+  TestQueue q2(&c);
+  fill(q2, 1, 2000);
+  served = run(q2, 1000);
+  ASSERT_EQ(1000, served[1]);
+}
+
+TEST(MClockQueue, cost) {
+  TestClassifier c;
+  c.info[1] = MClockQueue<Item, int>::ClientInfo(0, 0, 1);
+  c.info[2] = MClockQueue<Item, int>::ClientInfo(0, 0, 1);
+  TestQueue q(&c);
+  for (int i = 0; i < 2000; ++i) {
+    q.enqueue(1, 0, 1, Item(1, i));
+    q.enqueue(2, 0, 4, Item(2, i));
+  }
+  map<int, int> served = run(q, 1000);
+  ASSERT_NEAR(800, served[1], 5);
+  ASSERT_NEAR(200, served[2], 5);
+}
+
+struct ClassFilter : public OpQueue<Item, int>::Filter {
+  int cl;
+  ClassFilter(int cl) : cl(cl) {}
+  bool operator()(const Item &item) {
+    return item.first == cl;
+  }
+};
+
+TEST(MClockQueue, remove) {
+  TestClassifier c;
+  TestQueue q(&c);
+  fill(q, 1, 5);
+  fill(q, 2, 5);
+  q.enqueue(3, 0, 1, Item(1, 5));
+  q.enqueue_strict(1, 10, Item(1, 6));
+  ASSERT_EQ(12u, q.length());
+
+  list<Item> removed;
+  ClassFilter f(1);
+  q.remove_by_filter(f, &removed);
+  ASSERT_EQ(7u, removed.size());
+  ASSERT_EQ(5u, q.length());
+
+  removed.clear();
+  q.remove_by_class(2, &removed);
+  ASSERT_EQ(5u, removed.size());
+  ASSERT_TRUE(q.empty());
+}
+
+int main(int argc, char **argv) {
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+// Local Variables:
+// compile-command: "cd ../.. ; make unittest_mclock_queue && ./unittest_mclock_queue # --gtest_filter=*.* --log-to-stderr=true"
+// End:
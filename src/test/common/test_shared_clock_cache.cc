@@ -0,0 +1,153 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <stdio.h>
+#include "common/Thread.h"
+#include "common/shared_clock_cache.hpp"
+#include "common/ceph_argparse.h"
+#include "global/global_init.h"
+#include <gtest/gtest.h>
+
+using namespace std::tr1;
+
+TEST(SharedClockCache, add) {
+  SharedClockCache<int, int> cache;
+  int value = 2;
+  shared_ptr<int> ptr = cache.add(1, new int(value));
+  ASSERT_EQ(ptr, cache.lookup(1));
+  ASSERT_EQ(value, *cache.lookup(1));
+  ASSERT_FALSE(cache.lookup(2));
+}
+
+TEST(SharedClockCache, existed) {
+  SharedClockCache<int, int> cache;
+  bool existed = true;
+  shared_ptr<int> ptr = cache.add(0, new int(0), &existed);
+  ASSERT_FALSE(existed);
+  int *tmpint = new int(1);
+  shared_ptr<int> ptr2 = cache.add(0, tmpint, &existed);
+  ASSERT_TRUE(existed);
+  ASSERT_EQ(ptr, ptr2);
+  delete tmpint;
+}
+
+TEST(SharedClockCache, clock) {
+  const size_t SIZE = 5;
+  SharedClockCache<int, int> cache(NULL, SIZE);
+
+  for (size_t i = 0; i < SIZE; ++i)
+    cache.add(i, new int(i));
+  // referenced entries get a second chance
+  ASSERT_TRUE(cache.lookup(0));
+  ASSERT_TRUE(cache.lookup(1));
+  cache.add(SIZE, new int(SIZE));
+  ASSERT_TRUE(cache.lookup(0));
+  ASSERT_TRUE(cache.lookup(1));
+  ASSERT_FALSE(cache.lookup(2));
+
+  for (size_t i = SIZE + 1; i < 3 * SIZE; ++i)
+    cache.add(i, new int(i));
+  ASSERT_FALSE(cache.lookup(0));
+  ASSERT_TRUE(cache.lookup(3 * SIZE - 1));
+}
+
+TEST(SharedClockCache, referenced) {
+  const size_t SIZE = 2;
+  SharedClockCache<int, int> cache(NULL, SIZE);
+
+  // a value evicted from the cache stays reachable while it is referenced
+  shared_ptr<int> ptr = cache.add(0, new int(0));
+  for (size_t i = 1; i < 4 * SIZE; ++i)
+    cache.add(i, new int(i));
+  ASSERT_EQ(ptr, cache.lookup(0));
+
+  bool existed = false;
+  int *tmpint = new int(1);
+  ASSERT_EQ(ptr, cache.add(0, tmpint, &existed));
+  ASSERT_TRUE(existed);
+  delete tmpint;
+
+  cache.purge(0);
+  ASSERT_FALSE(cache.lookup(0));
+  shared_ptr<int> ptr2 = cache.add(0, new int(0), &existed);
+  ASSERT_FALSE(existed);
+  ASSERT_FALSE(ptr == ptr2);
+  ptr = shared_ptr<int>();
+  ASSERT_EQ(ptr2, cache.lookup(0));
+}
+
+TEST(SharedClockCache, set_size) {
+  SharedClockCache<int, int> cache(NULL, 10);
+  for (int i = 0; i < 10; ++i)
+    cache.add(i, new int(i));
+  cache.set_size(1);
+  int cached = 0;
+  for (int i = 0; i < 10; ++i)
+    if (cache.lookup(i))
+      cached++;
+  ASSERT_EQ(1, cached);
+}
+
+class LookupThread : public Thread {
+public:
+  SharedClockCache<int, int> &cache;
+  int keys;
+  int misses;
+
+  LookupThread(SharedClockCache<int, int> &cache, int keys)
+    : cache(cache), keys(keys), misses(0) {}
+
+  void *entry() {
+    for (int i = 0; i < 10000; ++i) {
+      int key = i % keys;
+      shared_ptr<int> ptr = cache.lookup(key);
+      if (!ptr) {
+	misses++;
+	bool existed;
+	int *value = new int(key);
+	ptr = cache.add(key, value, &existed);
+	if (existed)
+	  delete value;
+      }
+      assert(*ptr == key);
+    }
+    return NULL;
+  }
+};
+
+TEST(SharedClockCache, concurrent) {
+  SharedClockCache<int, int> cache(NULL, 8);
+  vector<LookupThread*> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.push_back(new LookupThread(cache, 16));
+    threads.back()->create();
+  }
+  for (int i = 0; i < 8; ++i) {
+    threads[i]->join();
+    delete threads[i];
+  }
+}
+
+int main(int argc, char **argv) {
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+// Local Variables:
+// compile-command: "cd ../.. ; make unittest_shared_clock_cache && ./unittest_shared_clock_cache # --gtest_filter=*.* --log-to-stderr=true"
+// End:
@@ -210,6 +210,36 @@ function TEST_rados_put_get_shec() {
     ./ceph osd erasure-code-profile rm $profile
 }
 
+function TEST_rados_get_fast_read_slow_shard() {
+    local dir=$1
+    local poolname=ecpool
+
+    ! ./ceph osd pool set rbd fast_read 1 || return 1
+    ./ceph osd pool set $poolname fast_read 1 || return 1
+    ./ceph osd pool get $poolname fast_read | grep 'fast_read: true' || return 1
+
+    for marker in AAA BBB CCCC DDDD ; do
+        printf "%*s" 1024 $marker
+    done > $dir/ORIGINAL
+    ./rados --pool $poolname put FASTREAD $dir/ORIGINAL || return 1
+
+    #
+    # delay the replies of the OSD holding the second data shard, the
+    # read must not wait for it
+    #
+    local -a osds=($(get_osds $poolname FASTREAD))
+    local slow=${osds[1]}
+    ./ceph tell osd.$slow injectargs -- --osd-debug-inject-ec-sub-read-delay 5 || return 1
+    timeout 4 ./rados --pool $poolname get FASTREAD $dir/COPY || return 1
+    diff $dir/ORIGINAL $dir/COPY || return 1
+    CEPH_ARGS='' ./ceph --admin-daemon $dir/ceph-osd.${osds[0]}.asok perf dump | \
+        grep -E '"ec_fast_read_redundant": *[1-9]' || return 1
+    ./ceph tell osd.$slow injectargs -- --osd-debug-inject-ec-sub-read-delay 0 || return 1
+
+    ./ceph osd pool set $poolname fast_read 0 || return 1
+    rm $dir/ORIGINAL $dir/COPY
+}
+
 function TEST_alignment_constraints() {
     local payload=ABC
     echo "$payload" > $dir/ORIGINAL
@@ -0,0 +1,152 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Lists a FileStore collection holding a large number of empty objects,
+ * all at once and in backfill sized chunks, sequentially, with parallel
+ * subdir listing and with the directory listing cache.  The store is
+ * created once and remounted for every mode; drop the page cache in
+ * between runs for cold numbers.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <string>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+#include "common/debug.h"
+#include "common/Cycles.h"
+#include "common/errno.h"
+#include "global/global_init.h"
+#include "os/ObjectStore.h"
+#include "test/perf_bench.h"
+
+static const coll_t cid("bench");
+static const string path = "collection_list_bench_temp_dir";
+
+static ghobject_t object_name(int i)
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "benchmark_object_%d", i);
+  return ghobject_t(hobject_t(sobject_t(object_t(buf), CEPH_NOSNAP)));
+}
+
+static int populate(int num_objects)
+{
+  ObjectStore *store = ObjectStore::create(g_ceph_context, "filestore", path, "");
+  if (!store || store->mkfs() < 0 || store->mount() < 0) {
+    cerr << "unable to set up filestore in " << path << std::endl;
+    delete store;
+    return -EIO;
+  }
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid);
+    store->apply_transaction(t);
+  }
+  uint64_t start = Cycles::rdtsc();
+  for (int i = 0; i < num_objects; ) {
+    ObjectStore::Transaction t;
+    for (int j = 0; j < 1000 && i < num_objects; j++, i++)
+      t.touch(cid, object_name(i));
+    store->apply_transaction(t);
+  }
+  cerr << " created " << num_objects << " objects in "
+       << Cycles::to_seconds(Cycles::rdtsc() - start) << "s" << std::endl;
+  store->umount();
+  delete store;
+  return 0;
+}
+
+static int run(const char *mode, int threads, int cache_dirs, int num_objects,
+	       int chunk)
+{
+  ostringstream t, c;
+  t << threads;
+  c << cache_dirs;
+  g_ceph_context->_conf->set_val("filestore_list_threads", t.str().c_str());
+  g_ceph_context->_conf->set_val("filestore_list_cache_dirs", c.str().c_str());
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  ObjectStore *store = ObjectStore::create(g_ceph_context, "filestore", path, "");
+  if (!store || store->mount() < 0) {
+    cerr << "unable to mount filestore in " << path << std::endl;
+    delete store;
+    return -EIO;
+  }
+
+  vector<ghobject_t> ls;
+  uint64_t start = Cycles::rdtsc();
+  int r = store->collection_list(cid, ls);
+  double full = Cycles::to_seconds(Cycles::rdtsc() - start);
+  if (r < 0 || (int)ls.size() != num_objects) {
+    cerr << "full listing returned " << ls.size() << " objects, r = " << r << std::endl;
+    return -EIO;
+  }
+
+  unsigned listed = 0;
+  ghobject_t next;
+  start = Cycles::rdtsc();
+  while (!next.is_max()) {
+    ls.clear();
+    r = store->collection_list_partial(cid, next, chunk, chunk, 0, &ls, &next);
+    if (r < 0) {
+      cerr << "chunked listing failed: " << cpp_strerror(r) << std::endl;
+      return r;
+    }
+    listed += ls.size();
+  }
+  double chunked = Cycles::to_seconds(Cycles::rdtsc() - start);
+  if ((int)listed != num_objects) {
+    cerr << "chunked listing returned " << listed << " objects" << std::endl;
+    return -EIO;
+  }
+
+  cerr << " " << mode << ": full listing " << full << "s, "
+       << chunk << " object chunks " << chunked << "s" << std::endl;
+
+  store->umount();
+  delete store;
+  return 0;
+}
+
+int collection_list_bench(const vector<const char*> &args)
+{
+  int num_objects = perf_bench_arg(args, 0, 1000000);
+  int threads = perf_bench_arg(args, 1, 8);
+  int chunk = perf_bench_arg(args, 2, 512);
+  if (num_objects <= 0 || threads <= 0 || chunk <= 0)
+    return -EINVAL;
+
+  ::system((string("rm -fr ") + path).c_str());
+  if (::mkdir(path.c_str(), 0777) < 0) {
+    int r = -errno;
+    cerr << "unable to create " << path << ": " << cpp_strerror(r) << std::endl;
+    return r;
+  }
+  int r = populate(num_objects);
+  if (r == 0)
+    r = run("sequential", 0, 0, num_objects, chunk);
+  if (r == 0)
+    r = run("parallel", threads, 0, num_objects, chunk);
+  if (r == 0)
+    r = run("cached", 0, 16, num_objects, chunk);
+  if (r == 0)
+    r = run("parallel+cached", threads, 16, num_objects, chunk);
+
+  ::system((string("rm -fr ") + path).c_str());
+  return r;
+}
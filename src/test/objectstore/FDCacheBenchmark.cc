@@ -0,0 +1,159 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Concurrent small reads of FileStore objects whose fds are all cached,
+ * so that every lfn_open is an FDCache hit, for the LRU and the clock
+ * FDCache with an increasing number of shards.  Each thread reads from
+ * its own collection to keep the collection index lock out of the way.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <string>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+#include "common/debug.h"
+#include "common/Cycles.h"
+#include "common/errno.h"
+#include "common/Thread.h"
+#include "global/global_init.h"
+#include "os/ObjectStore.h"
+#include "test/perf_bench.h"
+
+static coll_t collection_name(int thread)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "bench_%d", thread);
+  return coll_t(buf);
+}
+
+static ghobject_t object_name(int i)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "obj_%d", i);
+  return ghobject_t(hobject_t(sobject_t(object_t(buf), CEPH_NOSNAP)));
+}
+
+class ReadThread : public Thread {
+  ObjectStore *store;
+  coll_t cid;
+  int objects;
+  int ops;
+
+public:
+  ReadThread(ObjectStore *store, coll_t cid, int objects, int ops)
+    : store(store), cid(cid), objects(objects), ops(ops) {}
+
+  void *entry() {
+    for (int i = 0; i < ops; i++) {
+      bufferlist bl;
+      store->read(cid, object_name(rand() % objects), 0, 1, bl);
+    }
+    return NULL;
+  }
+};
+
+static int run(const char *mode, bool clock, int shards, int threads,
+	       int objects, int ops)
+{
+  ostringstream ss;
+  ss << shards;
+  g_ceph_context->_conf->set_val("filestore_fd_cache_clock", clock ? "true" : "false");
+  g_ceph_context->_conf->set_val("filestore_fd_cache_shards", ss.str().c_str());
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  string path = string("fdcache_bench_temp_dir.") + mode;
+  ::system((string("rm -fr ") + path).c_str());
+  int r = ::mkdir(path.c_str(), 0777);
+  if (r < 0) {
+    cerr << "unable to create " << path << ": " << cpp_strerror(errno) << std::endl;
+    return -errno;
+  }
+
+  ObjectStore *store = ObjectStore::create(g_ceph_context, "filestore", path, "");
+  if (!store || store->mkfs() < 0 || store->mount() < 0) {
+    cerr << "unable to set up filestore in " << path << std::endl;
+    delete store;
+    return -EIO;
+  }
+
+  bufferlist data;
+  data.append("x");
+  for (int t = 0; t < threads; t++) {
+    ObjectStore::Transaction tx;
+    tx.create_collection(collection_name(t));
+    for (int i = 0; i < objects; i++)
+      tx.write(collection_name(t), object_name(i), 0, data.length(), data);
+    store->apply_transaction(tx);
+  }
+  // warm up the cache with every object
+  for (int t = 0; t < threads; t++) {
+    for (int i = 0; i < objects; i++) {
+      bufferlist bl;
+      store->read(collection_name(t), object_name(i), 0, 1, bl);
+    }
+  }
+
+  vector<ReadThread*> workers;
+  for (int t = 0; t < threads; t++)
+    workers.push_back(new ReadThread(store, collection_name(t), objects, ops));
+
+  uint64_t start = Cycles::rdtsc();
+  for (int t = 0; t < threads; t++)
+    workers[t]->create();
+  for (int t = 0; t < threads; t++) {
+    workers[t]->join();
+    delete workers[t];
+  }
+  uint64_t ticks = Cycles::rdtsc() - start;
+
+  ostringstream name;
+  name << mode << " " << shards << " shards";
+  perf_bench_report(name.str(), (uint64_t)threads * ops, "reads", ticks);
+
+  store->umount();
+  delete store;
+  return ::system((string("rm -fr ") + path).c_str());
+}
+
+int fdcache_bench(const vector<const char*> &args)
+{
+  int threads = perf_bench_arg(args, 0, 32);
+  int objects = perf_bench_arg(args, 1, 32);
+  int ops = perf_bench_arg(args, 2, 100000);
+  if (threads <= 0 || objects <= 0 || ops <= 0)
+    return -EINVAL;
+
+  // every fd must stay cached whatever the shard count
+  ostringstream ss;
+  ss << threads * objects * 64;
+  g_ceph_context->_conf->set_val("filestore_fd_cache_size", ss.str().c_str());
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  cerr << threads << " threads reading 1 byte from " << objects
+       << " objects each" << std::endl;
+
+  for (int shards = 1; shards <= 32; shards *= 2) {
+    int r = run("lru", false, shards, threads, objects, ops);
+    if (r < 0)
+      return r;
+    r = run("clock", true, shards, threads, objects, ops);
+    if (r < 0)
+      return r;
+  }
+  return 0;
+}
@@ -0,0 +1,151 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Random 4 KB reads and overwrites against KeyValueStore objects with 1 KB
+ * strips, with and without the strip cache.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <string>
+#include <iostream>
+
+using namespace std;
+
+#include "common/debug.h"
+#include "common/Cycles.h"
+#include "common/errno.h"
+#include "common/Formatter.h"
+#include "common/perf_counters.h"
+#include "global/global_init.h"
+#include "os/ObjectStore.h"
+#include "test/perf_bench.h"
+
+static const uint64_t object_size = 1 << 20;
+static const uint64_t io_size = 4 << 10;
+
+static const coll_t cid("bench");
+
+static ghobject_t object_name(int i)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "obj_%d", i);
+  return ghobject_t(hobject_t(sobject_t(object_t(buf), CEPH_NOSNAP)));
+}
+
+static bufferlist generate(uint64_t len)
+{
+  bufferptr bp(len);
+  for (unsigned i = 0; i < len; i++)
+    bp[i] = rand();
+  bufferlist bl;
+  bl.append(bp);
+  return bl;
+}
+
+/* unaligned, so that every write is a read-modify-write of its end strips */
+static uint64_t random_offset()
+{
+  return (rand() % ((object_size - io_size) / 512)) * 512;
+}
+
+static void report(const char *mode, const char *name, int times, uint64_t ticks)
+{
+  perf_bench_report(string(mode) + " " + name, times, "ops", ticks);
+}
+
+static int run(const char *mode, const char *cache_size, int num_objects, int times)
+{
+  g_ceph_context->_conf->set_val("keyvaluestore_strip_cache_size", cache_size);
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  string path = string("keyvaluestore_bench_temp_dir.") + mode;
+  int r = ::mkdir(path.c_str(), 0777);
+  if (r < 0 && errno != EEXIST) {
+    cerr << "unable to create " << path << ": " << cpp_strerror(errno) << std::endl;
+    return -errno;
+  }
+
+  ObjectStore *store = ObjectStore::create(g_ceph_context, "keyvaluestore", path, "");
+  if (!store || store->mkfs() < 0 || store->mount() < 0) {
+    cerr << "unable to set up keyvaluestore in " << path << std::endl;
+    delete store;
+    return -EIO;
+  }
+
+  bufferlist full = generate(object_size);
+  bufferlist data = generate(io_size);
+
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid);
+    store->apply_transaction(t);
+  }
+  for (int i = 0; i < num_objects; i++) {
+    ObjectStore::Transaction t;
+    t.write(cid, object_name(i), 0, object_size, full);
+    store->apply_transaction(t);
+  }
+
+  uint64_t ticks = 0;
+  for (int i = 0; i < times; i++) {
+    ObjectStore::Transaction t;
+    t.write(cid, object_name(rand() % num_objects), random_offset(), io_size, data);
+    uint64_t start = Cycles::rdtsc();
+    store->apply_transaction(t);
+    ticks += Cycles::rdtsc() - start;
+  }
+  report(mode, "overwrite", times, ticks);
+
+  ticks = 0;
+  for (int i = 0; i < times; i++) {
+    bufferlist bl;
+    uint64_t start = Cycles::rdtsc();
+    store->read(cid, object_name(rand() % num_objects), random_offset(), io_size, bl);
+    ticks += Cycles::rdtsc() - start;
+  }
+  report(mode, "read", times, ticks);
+
+  JSONFormatter f(true);
+  g_ceph_context->get_perfcounters_collection()->dump_formatted(&f, false);
+  f.flush(cerr);
+  cerr << std::endl;
+
+  store->umount();
+  delete store;
+  return ::system((string("rm -fr ") + path).c_str());
+}
+
+int keyvaluestore_bench(const vector<const char*> &args)
+{
+  int num_objects = perf_bench_arg(args, 0, 16);
+  int times = perf_bench_arg(args, 1, 10000);
+  string cache_size = perf_bench_arg(args, 2, "67108864");
+  if (num_objects <= 0 || times <= 0)
+    return -EINVAL;
+
+  g_ceph_context->_conf->set_val(
+    "enable_experimental_unrecoverable_data_corrupting_features",
+    "keyvaluestore");
+  g_ceph_context->_conf->set_val("keyvaluestore_default_strip_size", "1024");
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  cerr << num_objects << " objects of " << object_size << " bytes, "
+       << times << " random ops of " << io_size << " bytes" << std::endl;
+
+  int r = run("uncached", "0", num_objects, times);
+  if (r < 0)
+    return r;
+  return run("cached", cache_size.c_str(), num_objects, times);
+}
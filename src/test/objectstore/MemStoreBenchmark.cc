@@ -0,0 +1,151 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Random 4 KB overwrites against 4 MB MemStore objects, with and without
+ * clones, for the bufferlist and the page set object data layouts.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <string>
+#include <iostream>
+
+using namespace std;
+
+#include "common/debug.h"
+#include "common/Cycles.h"
+#include "common/errno.h"
+#include "global/global_init.h"
+#include "os/ObjectStore.h"
+#include "test/perf_bench.h"
+
+static const uint64_t object_size = 4 << 20;
+static const uint64_t write_size = 4 << 10;
+
+static const coll_t cid("bench");
+
+static ghobject_t object_name(int i, const char *prefix)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%s_%d", prefix, i);
+  return ghobject_t(hobject_t(sobject_t(object_t(buf), CEPH_NOSNAP)));
+}
+
+static bufferlist generate(uint64_t len)
+{
+  bufferptr bp(len);
+  for (unsigned i = 0; i < len; i++)
+    bp[i] = rand();
+  bufferlist bl;
+  bl.append(bp);
+  return bl;
+}
+
+static uint64_t random_writes(ObjectStore *store, int num_objects, int times,
+			      const char *prefix, bufferlist& data)
+{
+  uint64_t ticks = 0;
+  for (int i = 0; i < times; i++) {
+    ghobject_t oid = object_name(rand() % num_objects, prefix);
+    uint64_t off = (rand() % (object_size / write_size)) * write_size;
+    ObjectStore::Transaction t;
+    t.write(cid, oid, off, write_size, data);
+    uint64_t start = Cycles::rdtsc();
+    store->apply_transaction(t);
+    ticks += Cycles::rdtsc() - start;
+  }
+  return ticks;
+}
+
+static void report(const char *layout, const char *name, int times, uint64_t ticks)
+{
+  perf_bench_report(string(layout) + " " + name, times, "writes", ticks);
+}
+
+static int run(const char *layout, bool page_set, int num_objects, int times)
+{
+  g_ceph_context->_conf->set_val("memstore_page_set", page_set ? "true" : "false");
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  string path = string("memstore_bench_temp_dir.") + layout;
+  int r = ::mkdir(path.c_str(), 0777);
+  if (r < 0 && errno != EEXIST) {
+    cerr << "unable to create " << path << ": " << cpp_strerror(errno) << std::endl;
+    return -errno;
+  }
+
+  ObjectStore *store = ObjectStore::create(g_ceph_context, "memstore", path, "");
+  if (store->mkfs() < 0 || store->mount() < 0) {
+    cerr << "unable to set up memstore in " << path << std::endl;
+    delete store;
+    return -EIO;
+  }
+
+  bufferlist full = generate(object_size);
+  bufferlist data = generate(write_size);
+
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid);
+    store->apply_transaction(t);
+  }
+  for (int i = 0; i < num_objects; i++) {
+    ObjectStore::Transaction t;
+    t.write(cid, object_name(i, "obj"), 0, object_size, full);
+    store->apply_transaction(t);
+  }
+
+  uint64_t ticks = random_writes(store, num_objects, times, "obj", data);
+  report(layout, "overwrite", times, ticks);
+
+  // clone every object and overwrite the clones
+  uint64_t start = Cycles::rdtsc();
+  for (int i = 0; i < num_objects; i++) {
+    ObjectStore::Transaction t;
+    t.clone(cid, object_name(i, "obj"), object_name(i, "clone"));
+    store->apply_transaction(t);
+  }
+  report(layout, "clone", num_objects, Cycles::rdtsc() - start);
+
+  ticks = random_writes(store, num_objects, times, "clone", data);
+  report(layout, "overwrite clones", times, ticks);
+
+  // don't let umount save gigabytes of object data
+  for (int i = 0; i < num_objects; i++) {
+    ObjectStore::Transaction t;
+    t.remove(cid, object_name(i, "obj"));
+    t.remove(cid, object_name(i, "clone"));
+    store->apply_transaction(t);
+  }
+
+  store->umount();
+  delete store;
+  return ::system((string("rm -fr ") + path).c_str());
+}
+
+int memstore_bench(const vector<const char*> &args)
+{
+  int num_objects = perf_bench_arg(args, 0, 16);
+  int times = perf_bench_arg(args, 1, 10000);
+  if (num_objects <= 0 || times <= 0)
+    return -EINVAL;
+
+  cerr << num_objects << " objects of " << object_size << " bytes, "
+       << times << " random writes of " << write_size << " bytes" << std::endl;
+
+  int r = run("bufferlist", false, num_objects, times);
+  if (r < 0)
+    return r;
+  return run("page_set", true, num_objects, times);
+}
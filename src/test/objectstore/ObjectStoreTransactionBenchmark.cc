@@ -14,6 +14,7 @@
  *
  */
 
+#include <errno.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string>
@@ -21,11 +22,11 @@
 
 using namespace std;
 
-#include "common/ceph_argparse.h"
 #include "common/debug.h"
 #include "common/Cycles.h"
 #include "global/global_init.h"
 #include "os/ObjectStore.h"
+#include "test/perf_bench.h"
 
 class Transaction {
  private:
@@ -239,26 +240,10 @@ const ghobject_t PerfCase::info_oid(hobject_t(sobject_t(object_t("infos"), 0)));
 Transaction::Tick Transaction::write_ticks, Transaction::setattr_ticks, Transaction::omap_setkeys_ticks, Transaction::omap_rmkeys_ticks;
 Transaction::Tick Transaction::encode_ticks, Transaction::decode_ticks, Transaction::iterate_ticks;
 
-void usage(const string &name) {
-  cerr << "Usage: " << name << " [times] "
-       << std::endl;
-}
-
-int main(int argc, char **argv)
+static int transaction_bench(const vector<const char*> &args)
 {
-  vector<const char*> args;
-  argv_to_vec(argc, (const char **)argv, args);
-
-  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
-  common_init_finish(g_ceph_context);
-  g_ceph_context->_conf->apply_changes(NULL);
-  Cycles::init();
-
-  cerr << "args: " << args << std::endl;
-  if (args.size() < 1) {
-    usage(argv[0]);
-    return 1;
-  }
+  if (args.size() < 1)
+    return -EINVAL;
 
   uint64_t times = atoi(args[0]);
   PerfCase c;
@@ -268,3 +253,37 @@ int main(int argc, char **argv)
 
   return 0;
 }
+
+int memstore_bench(const vector<const char*> &args);
+int keyvaluestore_bench(const vector<const char*> &args);
+int fdcache_bench(const vector<const char*> &args);
+int wbthrottle_bench(const vector<const char*> &args);
+int collection_list_bench(const vector<const char*> &args);
+int xattr_bench(const vector<const char*> &args);
+int omap_bench(const vector<const char*> &args);
+
+static const PerfBench benches[] = {
+  { "transaction", "<times>", "encode rados 4k write transactions",
+    1, transaction_bench },
+  { "memstore", "[objects] [writes]", "4k overwrites of memstore objects",
+    2, memstore_bench },
+  { "keyvaluestore", "[objects] [ops] [cache bytes]",
+    "4k reads and writes of keyvaluestore objects", 3, keyvaluestore_bench },
+  { "fdcache", "[threads] [objects per thread] [ops per thread]",
+    "filestore reads of cached fds", 3, fdcache_bench },
+  { "wbthrottle", "[dir] [seconds] [sync interval]",
+    "static and adaptive writeback throttling", 3, wbthrottle_bench },
+  { "collection_list", "[objects] [threads] [chunk]",
+    "full and chunked filestore collection listing", 3,
+    collection_list_bench },
+  { "xattr", "[objects] [attrs per object] [ops]",
+    "filestore getattrs of unpacked and packed xattrs", 3, xattr_bench },
+  { "omap", "[leveldb|rocksdb] [max threads] [ops per thread]",
+    "DBObjectMap header and key updates", 3, omap_bench },
+};
+
+int main(int argc, char **argv)
+{
+  return perf_bench_main(argc, (const char **)argv, benches,
+			 sizeof(benches) / sizeof(benches[0]));
+}
@@ -0,0 +1,175 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Random writes to a set of files throttled by a WBThrottle, with a
+ * FileStore style sync every interval, for the static and the adaptive
+ * throttle.  Point it at a directory on the device to measure, e.g. a
+ * loop mounted file or tmpfs.
+ */
+
+#include "acconfig.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <iostream>
+
+using namespace std;
+
+#include "common/debug.h"
+#include "common/Clock.h"
+#include "common/errno.h"
+#include "common/Formatter.h"
+#include "common/perf_counters.h"
+#include "global/global_init.h"
+#include "os/WBThrottle.h"
+#include "test/perf_bench.h"
+
+static const int num_files = 64;
+static const uint64_t file_size = 64 << 20;
+
+static ghobject_t object_name(int i)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "obj_%d", i);
+  return ghobject_t(hobject_t(sobject_t(object_t(buf), CEPH_NOSNAP)));
+}
+
+static int do_sync(int dirfd)
+{
+#ifdef HAVE_SYS_SYNCFS
+  if (::syncfs(dirfd) < 0)
+    return -errno;
+#else
+  ::sync();
+#endif
+  return 0;
+}
+
+static int run(const char *mode, bool adaptive, const string &dir,
+	       int seconds, double sync_interval)
+{
+  g_ceph_context->_conf->set_val("filestore_wbthrottle_adaptive",
+				 adaptive ? "true" : "false");
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  string path = dir + "/wbthrottle_bench_temp_dir." + mode;
+  ::system((string("rm -fr ") + path).c_str());
+  if (::mkdir(path.c_str(), 0777) < 0) {
+    cerr << "unable to create " << path << ": " << cpp_strerror(errno) << std::endl;
+    return -errno;
+  }
+  int dirfd = ::open(path.c_str(), O_RDONLY);
+  if (dirfd < 0) {
+    cerr << "unable to open " << path << ": " << cpp_strerror(errno) << std::endl;
+    return -errno;
+  }
+
+  vector<FDRef> fds;
+  for (int i = 0; i < num_files; i++) {
+    char name[64];
+    snprintf(name, sizeof(name), "%s/obj_%d", path.c_str(), i);
+    int fd = ::open(name, O_RDWR|O_CREAT, 0644);
+    if (fd < 0) {
+      cerr << "unable to create " << name << ": " << cpp_strerror(errno) << std::endl;
+      return -errno;
+    }
+    fds.push_back(FDRef(new FDCache::FD(fd)));
+  }
+
+  WBThrottle *throttle = new WBThrottle(g_ceph_context, mode);
+  throttle->start();
+
+  bufferptr bp(1 << 20);
+  for (unsigned i = 0; i < bp.length(); i++)
+    bp[i] = rand();
+
+  uint64_t writes = 0, bytes = 0;
+  int syncs = 0;
+  double sync_total = 0, sync_max = 0;
+  utime_t start = ceph_clock_now(g_ceph_context);
+  utime_t end = start;
+  end += utime_t(seconds, 0);
+  utime_t next_sync = start;
+  next_sync += sync_interval;
+  utime_t now = start;
+  while (now < end) {
+    int i = rand() % num_files;
+    uint64_t len = (1 + rand() % 16) * 4096;
+    uint64_t off = (rand() % ((file_size - len) / 4096)) * 4096;
+    throttle->throttle();
+    if (::pwrite(**fds[i], bp.c_str(), len, off) != (ssize_t)len) {
+      cerr << "write failed: " << cpp_strerror(errno) << std::endl;
+      break;
+    }
+    throttle->queue_wb(fds[i], object_name(i), off, len, false);
+    writes++;
+    bytes += len;
+
+    now = ceph_clock_now(g_ceph_context);
+    if (now >= next_sync) {
+      // what FileStore::sync_entry does on commit
+      do_sync(dirfd);
+      throttle->clear();
+      utime_t lat = ceph_clock_now(g_ceph_context) - now;
+      sync_total += (double)lat;
+      if ((double)lat > sync_max)
+	sync_max = lat;
+      syncs++;
+      now = ceph_clock_now(g_ceph_context);
+      next_sync = now;
+      next_sync += sync_interval;
+    }
+  }
+  double elapsed = now - start;
+
+  cerr << " " << mode << ": " << writes << " writes, "
+       << (uint64_t)(bytes / elapsed) / 1024 << " KB/s, "
+       << syncs << " syncs, avg " << (syncs ? sync_total / syncs : 0)
+       << "s max " << sync_max << "s" << std::endl;
+
+  JSONFormatter f(true);
+  g_ceph_context->get_perfcounters_collection()->dump_formatted(
+    &f, false, (string("WBThrottle-") + mode).c_str());
+  f.flush(cerr);
+  cerr << std::endl;
+
+  throttle->stop();
+  throttle->clear();
+  delete throttle;
+  fds.clear();
+  ::close(dirfd);
+  return ::system((string("rm -fr ") + path).c_str());
+}
+
+int wbthrottle_bench(const vector<const char*> &args)
+{
+  string dir = perf_bench_arg(args, 0, ".");
+  int seconds = perf_bench_arg(args, 1, 30);
+  double sync_interval = perf_bench_arg(args, 2,
+					(double)g_conf->filestore_max_sync_interval);
+  if (seconds <= 0 || sync_interval <= 0)
+    return -EINVAL;
+
+  cerr << num_files << " files in " << dir << ", sync every "
+       << sync_interval << "s, adaptive target "
+       << g_conf->filestore_wbthrottle_adaptive_target_latency << "s" << std::endl;
+
+  int r = run("static", false, dir, seconds, sync_interval);
+  if (r < 0)
+    return r;
+  return run("adaptive", true, dir, seconds, sync_interval);
+}
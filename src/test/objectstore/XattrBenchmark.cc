@@ -0,0 +1,163 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * FileStore getattrs of objects carrying a dozen small attrs, like RGW
+ * head objects, with one xattr per attr, packed xattrs without and with
+ * the decode cache.  The xattr syscalls issued are counted by wrapping
+ * the libc calls, so run it on a file system with user xattrs.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <string>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+#include "common/debug.h"
+#include "common/Cycles.h"
+#include "common/errno.h"
+#include "global/global_init.h"
+#include "include/atomic.h"
+#include "os/ObjectStore.h"
+#include "test/perf_bench.h"
+
+static atomic_t xattr_syscalls;
+
+#if defined(__linux__)
+extern "C" {
+ssize_t fgetxattr(int fd, const char *name, void *value, size_t size)
+{
+  xattr_syscalls.inc();
+  return syscall(SYS_fgetxattr, fd, name, value, size);
+}
+
+int fsetxattr(int fd, const char *name, const void *value, size_t size,
+	      int flags)
+{
+  xattr_syscalls.inc();
+  return syscall(SYS_fsetxattr, fd, name, value, size, flags);
+}
+
+ssize_t flistxattr(int fd, char *list, size_t size)
+{
+  xattr_syscalls.inc();
+  return syscall(SYS_flistxattr, fd, list, size);
+}
+
+int fremovexattr(int fd, const char *name)
+{
+  xattr_syscalls.inc();
+  return syscall(SYS_fremovexattr, fd, name);
+}
+}
+#endif
+
+static const coll_t cid("bench");
+
+static ghobject_t object_name(int i)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "obj_%d", i);
+  return ghobject_t(hobject_t(sobject_t(object_t(buf), CEPH_NOSNAP)));
+}
+
+static int run(const char *mode, bool packed, int cache_size,
+	       int objects, int attrs, int ops)
+{
+  ostringstream ss;
+  ss << cache_size;
+  g_ceph_context->_conf->set_val("filestore_xattr_packed", packed ? "true" : "false");
+  g_ceph_context->_conf->set_val("filestore_xattr_packed_cache_size", ss.str().c_str());
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  string path = string("xattr_bench_temp_dir.") + mode;
+  ::system((string("rm -fr ") + path).c_str());
+  if (::mkdir(path.c_str(), 0777) < 0) {
+    cerr << "unable to create " << path << ": " << cpp_strerror(errno) << std::endl;
+    return -errno;
+  }
+
+  ObjectStore *store = ObjectStore::create(g_ceph_context, "filestore", path, "");
+  if (!store || store->mkfs() < 0 || store->mount() < 0) {
+    cerr << "unable to set up filestore in " << path << std::endl;
+    delete store;
+    return -EIO;
+  }
+
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid);
+    for (int i = 0; i < objects; i++) {
+      t.touch(cid, object_name(i));
+      for (int a = 0; a < attrs; a++) {
+	char name[32];
+	snprintf(name, sizeof(name), "_user.rgw.attr%d", a);
+	bufferlist bl;
+	bl.append(string(16 + (a * 37) % 200, 'a' + a % 26));
+	t.setattr(cid, object_name(i), name, bl);
+      }
+    }
+    store->apply_transaction(t);
+  }
+
+  xattr_syscalls.set(0);
+  uint64_t start = Cycles::rdtsc();
+  for (int i = 0; i < ops; i++) {
+    map<string, bufferptr> aset;
+    int r = store->getattrs(cid, object_name(rand() % objects), aset);
+    if (r < 0 || (int)aset.size() != attrs) {
+      cerr << "getattrs returned " << aset.size() << " attrs, r = " << r << std::endl;
+      break;
+    }
+  }
+  uint64_t us = Cycles::to_microseconds(Cycles::rdtsc() - start);
+
+  cerr << " " << mode << ": " << (double)xattr_syscalls.read() / ops
+       << " xattr syscalls and " << (double)us / ops << "us per getattrs"
+       << std::endl;
+
+  store->umount();
+  delete store;
+  return ::system((string("rm -fr ") + path).c_str());
+}
+
+int xattr_bench(const vector<const char*> &args)
+{
+  int objects = perf_bench_arg(args, 0, 1000);
+  int attrs = perf_bench_arg(args, 1, 12);
+  int ops = perf_bench_arg(args, 2, 100000);
+  if (objects <= 0 || attrs <= 0 || ops <= 0)
+    return -EINVAL;
+
+  // keep every attr inline so that only the xattr layout differs
+  ostringstream ss;
+  ss << attrs;
+  g_ceph_context->_conf->set_val("filestore_max_inline_xattrs", ss.str().c_str());
+  g_ceph_context->_conf->set_val("filestore_max_inline_xattr_size", "4096");
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  cerr << objects << " objects with " << attrs << " attrs" << std::endl;
+
+  int r = run("unpacked", false, 0, objects, attrs, ops);
+  if (r < 0)
+    return r;
+  r = run("packed", true, 0, objects, attrs, ops);
+  if (r < 0)
+    return r;
+  return run("packed+cache", true, objects, objects, attrs, ops);
+}
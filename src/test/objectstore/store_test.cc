@@ -16,10 +16,12 @@
 #include <string.h>
 #include <iostream>
 #include <time.h>
+#include <glob.h>
 #include <sys/mount.h>
 #include "os/ObjectStore.h"
 #include "os/FileStore.h"
 #include "os/KeyValueStore.h"
+#include "os/chain_xattr.h"
 #ifdef HAVE_XSTORE
 #include "os/xstore/XStore.h"
 #endif
@@ -1764,6 +1766,228 @@ TEST(DummyTest, ValueParameterizedTestsAreNotSupportedOnThisPlatform) {}
 #endif
 
 
+static void check_attrs(ObjectStore *store, coll_t cid, const ghobject_t &hoid,
+			map<string, bufferlist> &attrs)
+{
+  map<string, bufferptr> aset;
+  ASSERT_EQ(0, store->getattrs(cid, hoid, aset));
+  ASSERT_EQ(attrs.size(), aset.size());
+  for (map<string, bufferptr>::iterator i = aset.begin();
+       i != aset.end();
+       ++i) {
+    bufferlist bl;
+    bl.push_back(i->second);
+    ASSERT_TRUE(attrs[i->first] == bl);
+
+    bufferptr bp;
+    ASSERT_EQ((int)attrs[i->first].length(),
+	      store->getattr(cid, hoid, i->first.c_str(), bp));
+  }
+}
+
+static ObjectStore *remount(ObjectStore *store, bool packed)
+{
+  if (store)
+    store->umount();
+  delete store;
+  g_ceph_context->_conf->set_val("filestore_xattr_packed",
+				 packed ? "true" : "false");
+  g_ceph_context->_conf->apply_changes(NULL);
+  store = ObjectStore::create(g_ceph_context, "filestore",
+			      "store_test_temp_dir", "store_test_temp_journal");
+  EXPECT_EQ(0, store->mount());
+  return store;
+}
+
+TEST(FileStoreTest, PackedXattrs) {
+  coll_t cid("packed");
+  ghobject_t hoid(hobject_t("packed", "", CEPH_NOSNAP, 0, 0, ""));
+  ghobject_t clone(hobject_t("packed_clone", "", CEPH_NOSNAP, 0, 0, ""));
+  bufferlist small, big;
+  small.append("small");
+  big.append(string(10000, 'b'));
+  map<string, bufferlist> attrs;
+
+  ASSERT_EQ(0, ::system("rm -fr store_test_temp_dir store_test_temp_journal"));
+  ASSERT_EQ(0, ::mkdir("store_test_temp_dir", 0777));
+  ObjectStore *store = ObjectStore::create(g_ceph_context, "filestore",
+					   "store_test_temp_dir",
+					   "store_test_temp_journal");
+  ASSERT_EQ(0, store->mkfs());
+  delete store;
+
+  // attrs stored one xattr each are converted on the next setattrs
+  store = remount(NULL, false);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid);
+    t.touch(cid, hoid);
+    t.setattr(cid, hoid, "attr1", small);
+    t.setattr(cid, hoid, "attr2", big);
+    t.setattr(cid, hoid, "attr3", small);
+    ASSERT_EQ(0, store->apply_transaction(t));
+    attrs["attr1"] = small;
+    attrs["attr2"] = big;
+    attrs["attr3"] = small;
+  }
+  store = remount(store, true);
+  check_attrs(store, cid, hoid, attrs);
+  {
+    ObjectStore::Transaction t;
+    t.setattr(cid, hoid, "attr4", small);
+    t.rmattr(cid, hoid, "attr1");
+    t.clone(cid, hoid, clone);
+    ASSERT_EQ(0, store->apply_transaction(t));
+    attrs["attr4"] = small;
+    attrs.erase("attr1");
+  }
+  check_attrs(store, cid, hoid, attrs);
+  check_attrs(store, cid, clone, attrs);
+  bufferptr bp;
+  ASSERT_EQ(-ENODATA, store->getattr(cid, hoid, "attr1", bp));
+
+  // and stay packed once packing is disabled
+  store = remount(store, false);
+  check_attrs(store, cid, hoid, attrs);
+  check_attrs(store, cid, clone, attrs);
+
+  // an unpacked copy left behind by an interrupted conversion doesn't hide
+  // the packed one, and is gone after the next setattrs
+  glob_t g;
+  ASSERT_EQ(0, ::glob("store_test_temp_dir/current/packed/packed__head_*",
+		      0, NULL, &g));
+  ASSERT_EQ(1u, g.gl_pathc);
+  string fn = g.gl_pathv[0];
+  globfree(&g);
+  ASSERT_LE(0, chain_setxattr(fn.c_str(), "user.ceph.attr3", "stale value", 11));
+  {
+    map<string, bufferptr> got;
+    ASSERT_EQ(0, store->getattrs(cid, hoid, got));
+    ASSERT_EQ(string("small"), string(got["attr3"].c_str(),
+				      got["attr3"].length()));
+  }
+  {
+    ObjectStore::Transaction t;
+    t.setattr(cid, hoid, "attr5", small);
+    t.setattr(cid, hoid, "attr3", big);
+    t.rmattr(cid, hoid, "attr4");
+    ASSERT_EQ(0, store->apply_transaction(t));
+    attrs["attr5"] = small;
+    attrs["attr3"] = big;
+    attrs.erase("attr4");
+  }
+  check_attrs(store, cid, hoid, attrs);
+  {
+    ObjectStore::Transaction t;
+    t.rmattrs(cid, hoid);
+    ASSERT_EQ(0, store->apply_transaction(t));
+    attrs.clear();
+  }
+  check_attrs(store, cid, hoid, attrs);
+
+  store->umount();
+  delete store;
+  g_ceph_context->_conf->set_val("filestore_xattr_packed", "false");
+  g_ceph_context->_conf->apply_changes(NULL);
+  ASSERT_EQ(0, ::system("rm -fr store_test_temp_dir store_test_temp_journal"));
+}
+
+static bool wait_for_glob(const char *pattern, bool present)
+{
+  for (int i = 0; i < 300; ++i) {
+    glob_t g;
+    bool found = ::glob(pattern, 0, NULL, &g) == 0;
+    if (found)
+      globfree(&g);
+    if (found == present)
+      return true;
+    usleep(100000);
+  }
+  return false;
+}
+
+TEST(FileStoreTest, RecreateDuringBackgroundSplit) {
+  coll_t cid("split");
+  ghobject_t objs[17];
+  for (int i = 0; i < 17; ++i) {
+    ostringstream name;
+    name << "obj" << i;
+    objs[i] = ghobject_t(hobject_t(object_t(name.str()), "", CEPH_NOSNAP,
+				   i, 0, ""));
+  }
+  const ghobject_t &hoid = objs[3];
+  bufferlist old_data, new_data;
+  old_data.append("old data");
+  new_data.append("new");
+  map<string, bufferlist> old_keys, new_keys;
+  old_keys["old_key"] = old_data;
+  new_keys["new_key"] = new_data;
+
+  ASSERT_EQ(0, ::system("rm -fr store_test_temp_dir store_test_temp_journal"));
+  ASSERT_EQ(0, ::mkdir("store_test_temp_dir", 0777));
+  g_ceph_context->_conf->set_val("filestore_split_background", "true");
+  g_ceph_context->_conf->set_val("filestore_merge_threshold", "1");
+  g_ceph_context->_conf->set_val("filestore_split_multiple", "1");
+  g_ceph_context->_conf->set_val("filestore_debug_split_delay", "3");
+  g_ceph_context->_conf->apply_changes(NULL);
+  ObjectStore *store = ObjectStore::create(g_ceph_context, "filestore",
+					   "store_test_temp_dir",
+					   "store_test_temp_journal");
+  ASSERT_EQ(0, store->mkfs());
+  delete store;
+  store = remount(NULL, false);
+
+  // the 17th object queues a background split of the collection root
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid);
+    for (int i = 0; i < 17; ++i)
+      t.touch(cid, objs[i]);
+    t.write(cid, hoid, 0, old_data.length(), old_data);
+    t.omap_setkeys(cid, hoid, old_keys);
+    ASSERT_EQ(0, store->apply_transaction(t));
+  }
+  ASSERT_TRUE(wait_for_glob(
+      "store_test_temp_dir/current/split/.split/*/obj3_*", true));
+
+  // removed and created again while the split holds a link to it
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    ASSERT_EQ(0, store->apply_transaction(t));
+  }
+  {
+    ObjectStore::Transaction t;
+    t.touch(cid, hoid);
+    t.write(cid, hoid, 0, new_data.length(), new_data);
+    t.omap_setkeys(cid, hoid, new_keys);
+    ASSERT_EQ(0, store->apply_transaction(t));
+  }
+  ASSERT_TRUE(wait_for_glob("store_test_temp_dir/current/split/.split",
+			    false));
+  ASSERT_TRUE(wait_for_glob(
+      "store_test_temp_dir/current/split/DIR_3/obj3_*", true));
+
+  store = remount(store, false);
+  bufferlist bl;
+  ASSERT_EQ((int)new_data.length(), store->read(cid, hoid, 0, 100, bl));
+  ASSERT_TRUE(bl.contents_equal(new_data));
+  bufferlist header;
+  map<string, bufferlist> keys;
+  ASSERT_EQ(0, store->omap_get(cid, hoid, &header, &keys));
+  ASSERT_EQ(1u, keys.size());
+  ASSERT_EQ(1u, keys.count("new_key"));
+
+  store->umount();
+  delete store;
+  g_ceph_context->_conf->set_val("filestore_split_background", "false");
+  g_ceph_context->_conf->set_val("filestore_merge_threshold", "10");
+  g_ceph_context->_conf->set_val("filestore_split_multiple", "2");
+  g_ceph_context->_conf->set_val("filestore_debug_split_delay", "0");
+  g_ceph_context->_conf->apply_changes(NULL);
+  ASSERT_EQ(0, ::system("rm -fr store_test_temp_dir store_test_temp_journal"));
+}
+
 //
 // support tests for qa/workunits/filestore/filestore.sh
 //
@@ -0,0 +1,174 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <stdio.h>
+#include <fcntl.h>
+#include "os/WBThrottle.h"
+#include "common/ceph_argparse.h"
+#include "global/global_init.h"
+#include <gtest/gtest.h>
+
+/// Drives the flusher logic from the test instead of the flusher thread
+class TestWBThrottle : public WBThrottle {
+  FDRef fd;
+
+public:
+  TestWBThrottle() : WBThrottle(g_ceph_context, "test") {
+    fd = FDRef(new FDCache::FD(::open("/dev/null", O_RDONLY)));
+    Mutex::Locker l(lock);
+    stopping = false;
+  }
+  ~TestWBThrottle() {
+    clear();
+  }
+
+  static ghobject_t object(int i) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "obj_%d", i);
+    return ghobject_t(hobject_t(sobject_t(object_t(buf), CEPH_NOSNAP)));
+  }
+
+  void write(int i, uint64_t len) {
+    queue_wb(fd, object(i), 0, len, false);
+  }
+
+  /// flush every dirty object, each taking lat
+  void flush_all(utime_t lat) {
+    Mutex::Locker l(lock);
+    while (!pending_wbs.empty()) {
+      ghobject_t oid = pop_object();
+      PendingWB wb = pending_wbs[oid].first;
+      pending_wbs.erase(oid);
+      flushed(wb, lat);
+    }
+  }
+
+  /// flush the object the flusher would flush next, if any
+  bool flush_next() {
+    Mutex::Locker l(lock);
+    if (!should_flush())
+      return false;
+    boost::tuple<ghobject_t, FDRef, PendingWB> wb;
+    EXPECT_TRUE(get_next_should_flush(&wb));
+    flushed(wb.get<2>(), utime_t(0, 1000000));
+    return true;
+  }
+
+  bool wants_flush() {
+    Mutex::Locker l(lock);
+    return should_flush();
+  }
+
+  uint64_t bytes_start_flusher() {
+    Mutex::Locker l(lock);
+    return size_limits.first;
+  }
+  uint64_t ios_start_flusher() {
+    Mutex::Locker l(lock);
+    return io_limits.first;
+  }
+  unsigned batch() {
+    Mutex::Locker l(lock);
+    return flush_batch;
+  }
+};
+
+class WBThrottleTest : public ::testing::Test {
+public:
+  static void set(const char *key, const char *val) {
+    g_ceph_context->_conf->set_val(key, val);
+  }
+
+  virtual void SetUp() {
+    set("filestore_wbthrottle_adaptive", "true");
+    set("filestore_wbthrottle_adaptive_target_latency", "0.5");
+    set("filestore_wbthrottle_xfs_bytes_start_flusher", "16777216");
+    set("filestore_wbthrottle_xfs_bytes_hard_limit", "67108864");
+    set("filestore_wbthrottle_xfs_ios_start_flusher", "160");
+    set("filestore_wbthrottle_xfs_ios_hard_limit", "320");
+    g_ceph_context->_conf->apply_changes(NULL);
+  }
+
+  /// 1000 flushes are enough to adapt the limits
+  static void adapt(TestWBThrottle *t, uint64_t len, utime_t lat) {
+    for (int i = 0; i < 1000; i++)
+      t->write(i, len);
+    t->flush_all(lat);
+  }
+};
+
+TEST_F(WBThrottleTest, adapt_limits_bounds) {
+  // 1GB/s and 1000 ios/s would allow far more than half the hard limits
+  TestWBThrottle fast;
+  adapt(&fast, 1 << 20, utime_t(0, 1000000));
+  EXPECT_EQ(67108864u / 2, fast.bytes_start_flusher());
+  EXPECT_EQ(320u / 2, fast.ios_start_flusher());
+  EXPECT_EQ(64u, fast.batch());
+
+  // a few bytes/s can't go below a sixteenth of the configured limits
+  TestWBThrottle slow;
+  adapt(&slow, 4096, utime_t(1, 0));
+  EXPECT_EQ(16777216u / 16, slow.bytes_start_flusher());
+  EXPECT_EQ(160u / 16, slow.ios_start_flusher());
+  EXPECT_EQ(1u, slow.batch());
+}
+
+TEST_F(WBThrottleTest, batch) {
+  // start flushing at 10 dirty ios, in batches of 64 objects
+  set("filestore_wbthrottle_xfs_ios_start_flusher", "16");
+  set("filestore_wbthrottle_xfs_ios_hard_limit", "20");
+  g_ceph_context->_conf->apply_changes(NULL);
+  TestWBThrottle t;
+  adapt(&t, 1, utime_t(0, 1000000));
+  ASSERT_EQ(10u, t.ios_start_flusher());
+  ASSERT_EQ(64u, t.batch());
+
+  for (int i = 0; i < 9; i++)
+    t.write(i, 1);
+  EXPECT_FALSE(t.wants_flush());
+
+  // once started, the batch goes on below the limit until nothing is dirty
+  t.write(9, 1);
+  int flushed = 0;
+  while (t.flush_next())
+    flushed++;
+  EXPECT_EQ(10, flushed);
+
+  // the batch ended when it ran out of objects, a new one waits for the limit
+  t.write(10, 1);
+  EXPECT_FALSE(t.wants_flush());
+  t.flush_all(utime_t(0, 1000000));
+
+  // same when the objects are cleared, e.g. because they are removed
+  for (int i = 0; i < 10; i++)
+    t.write(i, 1);
+  EXPECT_TRUE(t.flush_next());
+  for (int i = 1; i < 10; i++)
+    t.clear_object(TestWBThrottle::object(i));
+  t.write(10, 1);
+  EXPECT_FALSE(t.wants_flush());
+}
+
+int main(int argc, char **argv) {
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+// Local Variables:
+// compile-command: "cd ../.. ; make unittest_wbthrottle ; ./unittest_wbthrottle"
+// End:
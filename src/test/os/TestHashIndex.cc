@@ -0,0 +1,252 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "os/HashIndex.h"
+#include "os/chain_xattr.h"
+#include "common/ceph_argparse.h"
+#include "global/global_init.h"
+#include <gtest/gtest.h>
+
+class CountingSplitQueue : public HashIndex::SplitQueue {
+public:
+  int queued;
+  CountingSplitQueue() : queued(0) {}
+  void queue_split(HashIndex *index) {
+    queued++;
+  }
+};
+
+/// splits a directory holding more than 16 objects, inline above 32
+class TestHashIndex : public ::testing::Test {
+public:
+  class Index : public HashIndex {
+  public:
+    Index(const char *base_path, SplitQueue *queue)
+      : HashIndex(coll_t("ABC"), base_path, 1, 1,
+		  CollectionIndex::HOBJECT_WITH_POOL, 0, queue) {}
+
+    int prepare(const vector<string> &path) {
+      return prepare_background_split(path);
+    }
+    int complete(const vector<string> &path) {
+      RWLock::WLocker l(access_lock);
+      return complete_background_split(path);
+    }
+    void queue(const vector<string> &path) {
+      queue_background_split(path);
+    }
+  };
+
+  string base;
+  CountingSplitQueue queue;
+  Index *index;
+
+  TestHashIndex() : index(NULL) {}
+
+  virtual void SetUp() {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "hash_index_test.%d", getpid());
+    base = buf;
+    ::system((string("rm -fr ") + base).c_str());
+    ASSERT_EQ(0, ::mkdir(base.c_str(), 0700));
+    index = new Index(base.c_str(), &queue);
+    ASSERT_EQ(0, index->init());
+  }
+
+  virtual void TearDown() {
+    delete index;
+    ::system((string("rm -fr ") + base).c_str());
+  }
+
+  /// objects 0..15 hash to the 16 subdirs of the collection root
+  static ghobject_t object(int i) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "obj_%d", i);
+    return ghobject_t(hobject_t(object_t(buf), "", CEPH_NOSNAP, i, 0, ""));
+  }
+
+  /// create the object file and tell the index, as FileStore does
+  void create(int i) {
+    IndexedPath path;
+    int exists;
+    ASSERT_EQ(0, index->lookup(object(i), &path, &exists));
+    ASSERT_EQ(0, exists);
+    int fd = ::creat(path->path(), 0600);
+    ASSERT_LE(0, fd);
+    ::close(fd);
+    ASSERT_EQ(0, index->created(object(i), path->path()));
+  }
+
+  bool exists_below_root(int i) {
+    IndexedPath path;
+    int exists = 0;
+    EXPECT_EQ(0, index->lookup(object(i), &path, &exists));
+    return exists && string(path->path()).find('/', base.size() + 1) != string::npos;
+  }
+
+  bool shadow_exists() {
+    return ::access((base + "/.split").c_str(), F_OK) == 0;
+  }
+
+  set<ghobject_t> list() {
+    vector<ghobject_t> ls;
+    EXPECT_EQ(0, index->collection_list(&ls));
+    return set<ghobject_t>(ls.begin(), ls.end());
+  }
+};
+
+TEST_F(TestHashIndex, background_split) {
+  const vector<string> root;
+
+  // crossing the threshold queues the split instead of doing it
+  for (int i = 0; i < 17; i++)
+    create(i);
+  EXPECT_EQ(1, queue.queued);
+  EXPECT_FALSE(exists_below_root(0));
+
+  EXPECT_EQ(0, index->prepare(root));
+  EXPECT_TRUE(shadow_exists());
+  EXPECT_FALSE(exists_below_root(0));
+
+  // writes between the two phases, one of them to an object already
+  // linked into the shadow
+  create(17);
+  create(18);
+  ASSERT_EQ(0, index->unlink(object(3)));
+  ASSERT_EQ(0, index->unlink(object(16)));
+
+  EXPECT_EQ(0, index->complete(root));
+  EXPECT_FALSE(shadow_exists());
+
+  set<ghobject_t> expected;
+  for (int i = 0; i < 19; i++) {
+    if (i == 3 || i == 16)
+      continue;
+    expected.insert(object(i));
+    EXPECT_TRUE(exists_below_root(i)) << i;
+  }
+  EXPECT_EQ(expected, list());
+
+  // the split queued again by the later writes finds nothing left to do
+  EXPECT_EQ(1, index->prepare(root));
+  EXPECT_EQ(0, index->do_background_splits());
+  EXPECT_EQ(expected, list());
+}
+
+TEST_F(TestHashIndex, cleanup_after_prepare) {
+  const vector<string> root;
+
+  for (int i = 0; i < 17; i++)
+    create(i);
+  EXPECT_EQ(0, index->prepare(root));
+  EXPECT_TRUE(shadow_exists());
+
+  // crash before complete: a new index finds only the shadow left behind
+  delete index;
+  index = new Index(base.c_str(), &queue);
+  EXPECT_EQ(0, index->cleanup());
+  EXPECT_FALSE(shadow_exists());
+
+  set<ghobject_t> expected;
+  for (int i = 0; i < 17; i++) {
+    expected.insert(object(i));
+    EXPECT_FALSE(exists_below_root(i)) << i;
+  }
+  EXPECT_EQ(expected, list());
+}
+
+TEST_F(TestHashIndex, drop_private_links) {
+  const vector<string> root;
+
+  for (int i = 0; i < 17; i++)
+    create(i);
+  EXPECT_EQ(0, index->prepare(root));
+
+  // the shadow link of an object is not one of its own
+  IndexedPath path;
+  int exists;
+  ASSERT_EQ(0, index->lookup(object(3), &path, &exists));
+  struct stat st;
+  ASSERT_EQ(0, ::stat(path->path(), &st));
+  EXPECT_EQ(2u, st.st_nlink);
+  EXPECT_EQ(1, index->drop_private_links(object(3), st));
+  ASSERT_EQ(0, ::stat(path->path(), &st));
+  EXPECT_EQ(1u, st.st_nlink);
+  EXPECT_EQ(0, index->drop_private_links(object(3), st));
+
+  // so removing and creating it again doesn't resurrect the old file
+  ASSERT_EQ(0, index->unlink(object(3)));
+  create(3);
+  EXPECT_EQ(0, index->complete(root));
+  EXPECT_TRUE(exists_below_root(3));
+}
+
+TEST_F(TestHashIndex, background_split_error) {
+  const vector<string> root;
+
+  for (int i = 0; i < 17; i++)
+    create(i);
+  index->queue(vector<string>(1, "5"));
+  EXPECT_EQ(2, queue.queued);
+
+  // the shadow can't be created, the split of the root fails
+  int fd = ::creat((base + "/.split").c_str(), 0600);
+  ASSERT_LE(0, fd);
+  ::close(fd);
+  EXPECT_GT(0, index->do_background_splits());
+  // and the index is queued again for the split still pending
+  EXPECT_EQ(3, queue.queued);
+  EXPECT_FALSE(exists_below_root(0));
+
+  ASSERT_EQ(0, ::unlink((base + "/.split").c_str()));
+  EXPECT_EQ(0, index->do_background_splits());
+  EXPECT_FALSE(exists_below_root(0));
+
+  // the failed split is queued again by the next create
+  create(17);
+  EXPECT_EQ(4, queue.queued);
+  EXPECT_EQ(0, index->do_background_splits());
+  for (int i = 0; i < 18; i++)
+    EXPECT_TRUE(exists_below_root(i)) << i;
+}
+
+int main(int argc, char **argv) {
+  int fd = ::creat("detect", 0600);
+  int ret = chain_fsetxattr(fd, "user.test", "A", 1);
+  ::close(fd);
+  ::unlink("detect");
+  if (ret < 0) {
+    cerr << "SKIP HashIndex because unable to test for xattr" << std::endl;
+  } else {
+    vector<const char*> args;
+    argv_to_vec(argc, (const char **)argv, args);
+
+    global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+    common_init_finish(g_ceph_context);
+
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+  }
+}
+
+/*
+ * Local Variables:
+ * compile-command: "cd ../.. ;
+ *   make unittest_hashindex &&
+ *   valgrind --tool=memcheck ./unittest_hashindex \
+ *   # --gtest_filter=TestHashIndex.* --log-to-stderr=true --debug-filestore=20"
+ * End:
+ */
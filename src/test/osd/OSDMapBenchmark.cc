@@ -0,0 +1,203 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Applies a series of synthetic incrementals (osds going down and up,
+ * pg_temp changes, the odd pool change) to a map of many osds, the way
+ * the OSD does, keeping the most recent maps as its map cache would.
+ * Each map is built either by decoding the previous full map, or by
+ * sharing the previous map's unchanged parts.  Reports the time per
+ * epoch and the heap held by the cached maps.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+#include "common/debug.h"
+#include "common/Cycles.h"
+#include "global/global_init.h"
+#include "include/stringify.h"
+#include "osd/OSDMap.h"
+#include "test/perf_bench.h"
+
+static size_t heap_used()
+{
+  struct mallinfo mi = mallinfo();
+  return (size_t)(unsigned)mi.uordblks + (size_t)(unsigned)mi.hblkhd;
+}
+
+static entity_addr_t osd_addr(int osd, epoch_t e)
+{
+  entity_addr_t addr;
+  addr.set_family(AF_INET);
+  addr.set_port(6800 + osd % 100);
+  addr.nonce = e;
+  return addr;
+}
+
+static void set_up(OSDMap::Incremental *inc, int osd, epoch_t e)
+{
+  inc->new_up_client[osd] = osd_addr(osd, e);
+  inc->new_up_cluster[osd] = osd_addr(osd, e);
+  inc->new_hb_back_up[osd] = osd_addr(osd, e);
+  inc->new_hb_front_up[osd] = osd_addr(osd, e);
+}
+
+/// the encoded initial map and the incrementals that follow it
+static void make_maps(int osds, int epochs, int pg_temps,
+		      bufferlist *first, vector<bufferlist> *incs)
+{
+  OSDMap osdmap;
+  uuid_d fsid;
+  fsid.generate_random();
+  osdmap.build_simple(g_ceph_context, 0, fsid, osds, 6, 6);
+  OSDMap::Incremental boot(osdmap.get_epoch() + 1);
+  boot.fsid = fsid;
+  for (int i = 0; i < osds; ++i) {
+    boot.new_state[i] = CEPH_OSD_EXISTS | CEPH_OSD_NEW;
+    set_up(&boot, i, boot.epoch);
+    boot.new_weight[i] = CEPH_OSD_IN;
+    uuid_d uuid;
+    uuid.generate_random();
+    boot.new_uuid[i] = uuid;
+  }
+  osdmap.apply_incremental(boot);
+  osdmap.encode(*first, CEPH_FEATURES_ALL);
+
+  const pg_pool_t *pool = osdmap.get_pg_pool(0);
+  vector<pg_t> temps;
+  srand48(0);
+  for (int e = 0; e < epochs; ++e) {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = fsid;
+    inc.modified = ceph_clock_now(g_ceph_context);
+
+    // an osd goes down, one that was down comes back
+    int down = lrand48() % osds;
+    if (osdmap.is_up(down)) {
+      inc.new_state[down] = CEPH_OSD_UP;
+      inc.new_up_thru[down] = osdmap.get_epoch();
+    }
+    for (int i = 0; i < osds; ++i) {
+      int o = (down + 1 + i) % osds;
+      if (!osdmap.is_up(o)) {
+	set_up(&inc, o, inc.epoch);
+	break;
+      }
+    }
+
+    // the pgs that were remapped go back, others are remapped
+    for (int i = 0; i < pg_temps; ++i) {
+      if (temps.size() >= (size_t)pg_temps * 10) {
+	size_t n = lrand48() % temps.size();
+	inc.new_pg_temp[temps[n]].clear();
+	temps[n] = temps.back();
+	temps.pop_back();
+      }
+      pg_t pgid = osdmap.raw_pg_to_pg(pg_t(lrand48() % pool->get_pg_num(), 0));
+      vector<int> &acting = inc.new_pg_temp[pgid];
+      for (unsigned n = 0; n < pool->get_size(); ++n)
+	acting.push_back((pgid.ps() + n * 7) % osds);
+      temps.push_back(pgid);
+    }
+
+    // now and then a snapshot
+    if (e % 20 == 0) {
+      pg_pool_t *p = inc.get_new_pool(0, pool);
+      p->add_snap(stringify(e).c_str(), inc.modified);
+    }
+
+    bufferlist bl;
+    inc.encode(bl, CEPH_FEATURES_ALL);
+    incs->push_back(bl);
+    osdmap.apply_incremental(inc);
+    pool = osdmap.get_pg_pool(0);
+  }
+}
+
+static void run(const char *mode, bool share, bufferlist &first,
+		vector<bufferlist> &incs, size_t cache)
+{
+  size_t base = heap_used();
+  deque<OSDMap*> maps;
+  OSDMap *o = new OSDMap;
+  o->decode(first);
+  maps.push_back(o);
+  bufferlist prev_bl = first;
+
+  uint64_t start = Cycles::rdtsc();
+  for (vector<bufferlist>::iterator p = incs.begin();
+       p != incs.end();
+       ++p) {
+    OSDMap::Incremental inc;
+    bufferlist::iterator bp = p->begin();
+    inc.decode(bp);
+
+    // as OSD::handle_osd_map does
+    o = new OSDMap;
+    if (share)
+      o->share_from(*maps.back());
+    else
+      o->decode(prev_bl);
+    o->apply_incremental(inc);
+    bufferlist fbl;
+    o->encode(fbl, CEPH_FEATURES_ALL);
+    if (g_conf->osd_map_dedup)
+      OSDMap::dedup(maps.back(), o);
+    prev_bl.claim(fbl);
+
+    maps.push_back(o);
+    if (maps.size() > cache) {
+      delete maps.front();
+      maps.pop_front();
+    }
+  }
+  uint64_t ns = Cycles::to_nanoseconds(Cycles::rdtsc() - start);
+  size_t bytes = heap_used() - base - prev_bl.length();
+
+  cerr << " " << mode << ": " << ns / 1000 / incs.size() << "us per epoch, "
+       << bytes / (1 << 20) << " MB for " << maps.size() << " maps ("
+       << bytes / maps.size() / 1024 << " KB each)" << std::endl;
+
+  while (!maps.empty()) {
+    delete maps.front();
+    maps.pop_front();
+  }
+}
+
+int osdmap_bench(const vector<const char*> &args)
+{
+  int osds = perf_bench_arg(args, 0, 1000);
+  int epochs = perf_bench_arg(args, 1, 1000);
+  int pg_temps = perf_bench_arg(args, 2, 20);
+  int cache = perf_bench_arg(args, 3, (int)g_conf->osd_map_cache_size);
+  if (osds <= 0 || epochs <= 0 || pg_temps < 0 || cache <= 0)
+    return -EINVAL;
+
+  bufferlist first;
+  vector<bufferlist> incs;
+  make_maps(osds, epochs, pg_temps, &first, &incs);
+  cerr << epochs << " incrementals over " << osds << " osds, "
+       << first.length() / 1024 << " KB full map, keeping " << cache
+       << " maps" << std::endl;
+
+  run("decoded", false, first, incs, cache);
+  run("shared", true, first, incs, cache);
+  return 0;
+}
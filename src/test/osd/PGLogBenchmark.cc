@@ -0,0 +1,201 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Fills the logs of a number of PGs with rbd like writes, trimming them
+ * to a fixed length, with PGLog::IndexedLog and with CompactPGLog.
+ * Reports the heap bytes per entry and the cost of looking up reqids
+ * and objects in each.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+#include "common/debug.h"
+#include "common/Cycles.h"
+#include "include/hash.h"
+#include "osd/CompactPGLog.h"
+#include "osd/PGLog.h"
+#include "test/perf_bench.h"
+
+static hobject_t object_name(int pg, int obj)
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "rbd_data.%x.%016x", pg, obj);
+  hobject_t hoid;
+  hoid.oid = buf;
+  hoid.set_hash(rjhash32(obj) << 8 | pg);
+  hoid.pool = 1;
+  return hoid;
+}
+
+static osd_reqid_t reqid(int pg, unsigned v)
+{
+  return osd_reqid_t(entity_name_t::CLIENT((v * 7919 + pg) % 100), 0, v);
+}
+
+static pg_log_entry_t make_entry(int pg, unsigned v, int objects)
+{
+  // a fresh name each time, as if decoded from the message
+  pg_log_entry_t e(pg_log_entry_t::MODIFY, object_name(pg, lrand48() % objects),
+		   eversion_t(1, v), eversion_t(1, v - 1), v, reqid(pg, v),
+		   utime_t(v, 0));
+  e.mod_desc.mark_unrollbackable();
+  e.has_dirty_extents = true;
+  e.dirty_extents.insert(lrand48() % 1024 * 4096, 4096 << (lrand48() % 5));
+  return e;
+}
+
+static size_t heap_used()
+{
+  struct mallinfo mi = mallinfo();
+  return (size_t)(unsigned)mi.uordblks + (size_t)(unsigned)mi.hblkhd;
+}
+
+struct Logs {
+  virtual void add(int pg, const pg_log_entry_t &e) = 0;
+  virtual void trim(int pg, eversion_t s) = 0;
+  virtual bool logged_req(int pg, const osd_reqid_t &r) = 0;
+  virtual bool logged_object(int pg, const hobject_t &oid) = 0;
+  virtual ~Logs() {}
+};
+
+struct NoopHandler : public PGLog::LogEntryHandler {
+  void rollback(const pg_log_entry_t &entry) {}
+  void remove(const hobject_t &hoid) {}
+  void trim(const pg_log_entry_t &entry) {}
+};
+
+struct IndexedLogs : public Logs {
+  vector<PGLog::IndexedLog*> logs;
+  NoopHandler h;
+  IndexedLogs(int pgs) {
+    for (int i = 0; i < pgs; i++)
+      logs.push_back(new PGLog::IndexedLog);
+  }
+  ~IndexedLogs() {
+    for (vector<PGLog::IndexedLog*>::iterator p = logs.begin();
+	 p != logs.end();
+	 ++p)
+      delete *p;
+  }
+  void add(int pg, const pg_log_entry_t &e) {
+    logs[pg]->add(e);
+  }
+  void trim(int pg, eversion_t s) {
+    logs[pg]->can_rollback_to = logs[pg]->head;
+    logs[pg]->trim(&h, s, 0);
+  }
+  bool logged_req(int pg, const osd_reqid_t &r) {
+    return logs[pg]->logged_req(r);
+  }
+  bool logged_object(int pg, const hobject_t &oid) {
+    return logs[pg]->logged_object(oid);
+  }
+};
+
+struct CompactLogs : public Logs {
+  vector<CompactPGLog*> logs;
+  CompactLogs(int pgs) {
+    for (int i = 0; i < pgs; i++)
+      logs.push_back(new CompactPGLog);
+  }
+  ~CompactLogs() {
+    for (vector<CompactPGLog*>::iterator p = logs.begin(); p != logs.end(); ++p)
+      delete *p;
+  }
+  void add(int pg, const pg_log_entry_t &e) {
+    logs[pg]->add(e);
+  }
+  void trim(int pg, eversion_t s) {
+    logs[pg]->trim(s);
+  }
+  bool logged_req(int pg, const osd_reqid_t &r) {
+    return logs[pg]->logged_req(r);
+  }
+  bool logged_object(int pg, const hobject_t &oid) {
+    return logs[pg]->logged_object(oid);
+  }
+};
+
+static void run(const char *mode, Logs *logs, size_t base,
+		int pgs, int entries, int objects, int lookups)
+{
+  // twice the log length, so that the logs have been trimmed
+  srand48(0);
+  for (int v = 1; v <= 2 * entries; v++) {
+    for (int pg = 0; pg < pgs; pg++) {
+      logs->add(pg, make_entry(pg, v, objects));
+      if (v > entries)
+	logs->trim(pg, eversion_t(1, v - entries));
+    }
+  }
+  size_t bytes = heap_used() - base;
+
+  // half of the reqids were trimmed
+  vector<pair<int, osd_reqid_t> > reqids;
+  vector<pair<int, hobject_t> > oids;
+  for (int i = 0; i < lookups; i++) {
+    int pg = lrand48() % pgs;
+    reqids.push_back(make_pair(pg, reqid(pg, 1 + lrand48() % (2 * entries))));
+    oids.push_back(make_pair(pg, object_name(pg, lrand48() % objects)));
+  }
+  int found = 0;
+  uint64_t start = Cycles::rdtsc();
+  for (vector<pair<int, osd_reqid_t> >::iterator p = reqids.begin();
+       p != reqids.end();
+       ++p)
+    found += logs->logged_req(p->first, p->second);
+  uint64_t req_ns = Cycles::to_nanoseconds(Cycles::rdtsc() - start);
+  start = Cycles::rdtsc();
+  for (vector<pair<int, hobject_t> >::iterator p = oids.begin();
+       p != oids.end();
+       ++p)
+    found += logs->logged_object(p->first, p->second);
+  uint64_t obj_ns = Cycles::to_nanoseconds(Cycles::rdtsc() - start);
+
+  cerr << " " << mode << ": " << bytes / (pgs * entries) << " bytes per entry, "
+       << bytes / (1 << 20) << " MB in all, "
+       << (double)req_ns / lookups << "ns per reqid and "
+       << (double)obj_ns / lookups << "ns per object lookup ("
+       << found << " found)" << std::endl;
+}
+
+int pglog_bench(const vector<const char*> &args)
+{
+  int pgs = perf_bench_arg(args, 0, 50);
+  int entries = perf_bench_arg(args, 1, 3000);
+  int objects = perf_bench_arg(args, 2, 1000);
+  int lookups = perf_bench_arg(args, 3, 1000000);
+  if (pgs <= 0 || entries <= 0 || objects <= 0 || lookups <= 0)
+    return -EINVAL;
+
+  cerr << pgs << " pgs with " << entries << " log entries over "
+       << objects << " objects each" << std::endl;
+
+  size_t base = heap_used();
+  IndexedLogs *ilogs = new IndexedLogs(pgs);
+  run("IndexedLog", ilogs, base, pgs, entries, objects, lookups);
+  delete ilogs;
+
+  base = heap_used();
+  CompactLogs *clogs = new CompactLogs(pgs);
+  run("CompactPGLog", clogs, base, pgs, entries, objects, lookups);
+  delete clogs;
+  return 0;
+}
@@ -0,0 +1,226 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <stdlib.h>
+#include "osd/CompactPGLog.h"
+#include "osd/PGLog.h"
+#include "common/ceph_argparse.h"
+#include "global/global_init.h"
+#include <gtest/gtest.h>
+
+static hobject_t mk_obj(unsigned id)
+{
+  hobject_t hoid;
+  stringstream ss;
+  ss << "obj_" << id;
+  hoid.oid = ss.str();
+  hoid.set_hash(id);
+  hoid.pool = 1;
+  return hoid;
+}
+
+static osd_reqid_t mk_reqid(unsigned client, ceph_tid_t tid)
+{
+  return osd_reqid_t(entity_name_t::CLIENT(client), 0, tid);
+}
+
+static pg_log_entry_t mk_entry(int op, unsigned obj, unsigned v,
+			       const osd_reqid_t &reqid)
+{
+  pg_log_entry_t e(op, mk_obj(obj), eversion_t(1, v), eversion_t(1, v - 1),
+		   v, reqid, utime_t(v, 0));
+  e.mod_desc.mark_unrollbackable();
+  return e;
+}
+
+static void expect_same(const pg_log_entry_t &a, const pg_log_entry_t &b)
+{
+  bufferlist abl, bbl;
+  ::encode(a, abl);
+  ::encode(b, bbl);
+  EXPECT_TRUE(abl.contents_equal(bbl)) << a << " != " << b;
+  EXPECT_EQ(a.mod_desc.can_rollback(), b.mod_desc.can_rollback());
+}
+
+struct NoopHandler : public PGLog::LogEntryHandler {
+  void rollback(const pg_log_entry_t &entry) {}
+  void remove(const hobject_t &hoid) {}
+  void trim(const pg_log_entry_t &entry) {}
+};
+
+TEST(CompactPGLog, entries) {
+  list<pg_log_entry_t> in;
+  in.push_back(mk_entry(pg_log_entry_t::MODIFY, 1, 1, mk_reqid(1, 1)));
+  in.push_back(mk_entry(pg_log_entry_t::MODIFY, 2, 2, mk_reqid(1, 2)));
+  in.back().mod_desc = ObjectModDesc();
+  in.back().mod_desc.append(4096);
+  in.push_back(mk_entry(pg_log_entry_t::CLONE, 1, 3, osd_reqid_t()));
+  in.back().soid.snap = 3;
+  ::encode(vector<snapid_t>(1, snapid_t(3)), in.back().snaps);
+  in.push_back(mk_entry(pg_log_entry_t::MODIFY, 1, 4, mk_reqid(2, 1)));
+  in.back().extra_reqids.push_back(make_pair(mk_reqid(3, 7), 2));
+  in.back().has_dirty_extents = true;
+  in.back().dirty_extents.insert(0, 8192);
+  in.push_back(mk_entry(pg_log_entry_t::LOST_REVERT, 2, 5, osd_reqid_t()));
+  in.back().reverting_to = eversion_t(1, 2);
+  in.back().invalid_hash = true;
+  in.push_back(mk_entry(pg_log_entry_t::DELETE, 3, 6, mk_reqid(1, 3)));
+  in.back().mod_desc = ObjectModDesc();
+
+  CompactPGLog log(64);
+  for (list<pg_log_entry_t>::iterator p = in.begin(); p != in.end(); ++p)
+    log.add(*p);
+  ASSERT_EQ(in.size(), log.size());
+  ASSERT_EQ(4u, log.get_num_objects());
+  ASSERT_EQ(eversion_t(1, 6), log.get_head());
+
+  list<pg_log_entry_t> out;
+  log.get_entries(&out);
+  ASSERT_EQ(in.size(), out.size());
+  list<pg_log_entry_t>::iterator q = out.begin();
+  for (list<pg_log_entry_t>::iterator p = in.begin(); p != in.end(); ++p, ++q)
+    expect_same(*p, *q);
+
+  pg_log_entry_t e;
+  ASSERT_TRUE(log.get_latest(mk_obj(1), &e));
+  expect_same(*++++++in.begin(), e);
+  ASSERT_FALSE(log.get_latest(mk_obj(4), &e));
+
+  eversion_t v;
+  version_t uv;
+  ASSERT_TRUE(log.get_request(mk_reqid(3, 7), &v, &uv));
+  ASSERT_EQ(eversion_t(1, 4), v);
+  ASSERT_EQ(2u, uv);
+
+  log.trim(eversion_t(1, 4));
+  ASSERT_EQ(2u, log.size());
+  ASSERT_FALSE(log.logged_object(mk_obj(1)));
+  ASSERT_FALSE(log.logged_req(mk_reqid(3, 7)));
+  ASSERT_FALSE(log.logged_req(mk_reqid(1, 1)));
+  ASSERT_TRUE(log.logged_req(mk_reqid(1, 3)));
+  log.get_entry(0, &e);
+  expect_same(*----in.end(), e);
+
+  log.trim(eversion_t(1, 6));
+  ASSERT_TRUE(log.empty());
+  ASSERT_EQ(0u, log.get_num_objects());
+}
+
+// random adds and trims, the answers must match IndexedLog's
+TEST(CompactPGLog, indexed_log) {
+  srand(0);
+  NoopHandler h;
+  PGLog::IndexedLog ilog;
+  CompactPGLog clog(1024);
+  const unsigned objects = 200, clients = 10;
+  unsigned v = 0;
+  ceph_tid_t tid = 0;
+  for (int round = 0; round < 20; ++round) {
+    for (int i = 0; i < 500; ++i) {
+      ++v;
+      int op = rand() % 10 ? pg_log_entry_t::MODIFY : pg_log_entry_t::DELETE;
+      osd_reqid_t reqid = rand() % 20 ? mk_reqid(rand() % clients, ++tid) :
+	// a resent op
+	mk_reqid(rand() % clients, tid / 2);
+      pg_log_entry_t e = mk_entry(op, rand() % objects, v, reqid);
+      if (rand() % 50 == 0)
+	e.extra_reqids.push_back(make_pair(mk_reqid(clients, v), v));
+      if (rand() % 3 == 0) {
+	e.has_dirty_extents = true;
+	e.dirty_extents.insert(rand() % 64 * 4096, 4096);
+      }
+      ilog.add(e);
+      clog.add(e);
+    }
+    eversion_t s(1, v - rand() % 1000);
+    ilog.can_rollback_to = ilog.head;
+    ilog.trim(&h, s, 0);
+    clog.trim(s);
+
+    ASSERT_EQ(ilog.log.size(), clog.size());
+    ASSERT_EQ(ilog.get_num_objects(), clog.get_num_objects());
+    size_t i = 0;
+    for (list<pg_log_entry_t>::iterator p = ilog.log.begin();
+	 p != ilog.log.end();
+	 ++p, ++i) {
+      pg_log_entry_t e;
+      clog.get_entry(i, &e);
+      expect_same(*p, e);
+    }
+    for (unsigned o = 0; o < objects; ++o) {
+      hobject_t oid = mk_obj(o);
+      ASSERT_EQ(ilog.logged_object(oid), clog.logged_object(oid));
+      if (ilog.logged_object(oid)) {
+	pg_log_entry_t e;
+	ASSERT_TRUE(clog.get_latest(oid, &e));
+	expect_same(*ilog.get_latest(oid), e);
+      }
+      vector<pair<osd_reqid_t, version_t> > ir, cr;
+      ilog.get_object_reqids(oid, 5, &ir);
+      clog.get_object_reqids(oid, 5, &cr);
+      ASSERT_EQ(ir, cr);
+    }
+    for (unsigned c = 0; c <= clients; ++c) {
+      for (ceph_tid_t t = 0; t <= tid; t += 7) {
+	osd_reqid_t r = mk_reqid(c, t);
+	ASSERT_EQ(ilog.logged_req(r), clog.logged_req(r));
+	eversion_t iv, cv;
+	version_t iuv = 0, cuv = 0;
+	ASSERT_EQ(ilog.get_request(r, &iv, &iuv),
+		  clog.get_request(r, &cv, &cuv));
+	ASSERT_EQ(iv, cv);
+	ASSERT_EQ(iuv, cuv);
+      }
+    }
+  }
+}
+
+TEST(CompactPGLog, arena) {
+  CompactPGLog log(4096);
+  size_t steady = 0;
+  for (unsigned v = 1; v <= 10000; ++v) {
+    pg_log_entry_t e = mk_entry(pg_log_entry_t::MODIFY, v % 100, v,
+				mk_reqid(1, v));
+    e.has_dirty_extents = true;
+    e.dirty_extents.insert(v * 4096, 4096);
+    log.add(e);
+    if (v > 1000)
+      log.trim(eversion_t(1, v - 1000));
+    if (v == 2000)
+      steady = log.get_memory_usage();
+  }
+  ASSERT_EQ(1000u, log.size());
+  // the chunks of the trimmed entries are gone
+  size_t bytes = log.get_memory_usage();
+  ASSERT_LE(bytes, steady + 2 * 4096);
+
+  log.trim(eversion_t(1, 10000));
+  ASSERT_TRUE(log.empty());
+  ASSERT_LT(log.get_memory_usage(), bytes);
+  log.clear();
+  ASSERT_EQ(0u, log.get_memory_usage());
+}
+
+int main(int argc, char **argv) {
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+// Local Variables:
+// compile-command: "cd ../.. ; make unittest_compact_pglog && ./unittest_compact_pglog # --gtest_filter=*.* --log-to-stderr=true"
+// End:
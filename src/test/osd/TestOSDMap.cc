@@ -400,3 +400,62 @@ TEST_F(OSDMapTest, PrimaryAffinity) {
     osdmap.set_primary_affinity(1, 0x10000);
   }
 }
+
+TEST_F(OSDMapTest, ShareFrom) {
+  set_up_map();
+  pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, 0, -1));
+  vector<int> old_acting;
+  osdmap.pg_to_acting_osds(pgid, old_acting);
+  bufferlist old_bl;
+  osdmap.encode(old_bl, CEPH_FEATURES_ALL);
+
+  OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+  inc.fsid = osdmap.get_fsid();
+  vector<int> temp;
+  temp.push_back(old_acting[2]);
+  temp.push_back(old_acting[1]);
+  temp.push_back(old_acting[0]);
+  inc.new_pg_temp[pgid] = temp;
+  inc.new_primary_affinity[0] = 0x8000;
+
+  // built on osdmap, the parts the incremental leaves alone are shared
+  OSDMap shared;
+  shared.share_from(osdmap);
+  ASSERT_EQ(0, shared.apply_incremental(inc));
+  ASSERT_EQ(&osdmap.get_pools(), &shared.get_pools());
+  vector<int> acting;
+  shared.pg_to_acting_osds(pgid, acting);
+  ASSERT_EQ(temp, acting);
+  ASSERT_EQ(0x8000u, shared.get_primary_affinity(0));
+
+  // osdmap is unchanged
+  osdmap.pg_to_acting_osds(pgid, acting);
+  ASSERT_EQ(old_acting, acting);
+  ASSERT_EQ((unsigned)CEPH_OSD_DEFAULT_PRIMARY_AFFINITY,
+	    osdmap.get_primary_affinity(0));
+  bufferlist bl;
+  osdmap.encode(bl, CEPH_FEATURES_ALL);
+  ASSERT_TRUE(bl.contents_equal(old_bl));
+
+  // and the result is the same as that of a copy
+  OSDMap copy;
+  copy.deepish_copy_from(osdmap);
+  ASSERT_EQ(0, copy.apply_incremental(inc));
+  bufferlist shared_bl, copy_bl;
+  shared.encode(shared_bl, CEPH_FEATURES_ALL);
+  copy.encode(copy_bl, CEPH_FEATURES_ALL);
+  ASSERT_TRUE(shared_bl.contents_equal(copy_bl));
+
+  // a pool change copies the pools
+  OSDMap::Incremental pool_inc(shared.get_epoch() + 1);
+  pool_inc.fsid = shared.get_fsid();
+  pg_pool_t *p = pool_inc.get_new_pool(0, shared.get_pg_pool(0));
+  p->set_flag(pg_pool_t::FLAG_NODELETE);
+  OSDMap next;
+  next.share_from(shared);
+  ASSERT_EQ(0, next.apply_incremental(pool_inc));
+  ASSERT_NE(&shared.get_pools(), &next.get_pools());
+  ASSERT_TRUE(next.get_pg_pool(0)->has_flag(pg_pool_t::FLAG_NODELETE));
+  ASSERT_FALSE(shared.get_pg_pool(0)->has_flag(pg_pool_t::FLAG_NODELETE));
+  ASSERT_FALSE(osdmap.get_pg_pool(0)->has_flag(pg_pool_t::FLAG_NODELETE));
+}
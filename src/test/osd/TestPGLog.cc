@@ -369,9 +369,9 @@ TEST_F(PGLogTest, rewind_divergent_log) {
     rewind_divergent_log(t, newhead, info, &h,
 			 dirty_info, dirty_big_info);
 
-    EXPECT_TRUE(log.objects.count(divergent));
+    EXPECT_TRUE(log.logged_object(divergent));
     EXPECT_TRUE(missing.is_missing(divergent_object));
-    EXPECT_EQ(1U, log.objects.count(divergent_object));
+    EXPECT_TRUE(log.logged_object(divergent_object));
     EXPECT_EQ(2U, log.log.size());
     EXPECT_TRUE(remove_snap.empty());
     EXPECT_TRUE(t.empty());
@@ -438,7 +438,7 @@ TEST_F(PGLogTest, rewind_divergent_log) {
 			 dirty_info, dirty_big_info);
 
     EXPECT_TRUE(missing.is_missing(divergent_object));
-    EXPECT_EQ(0U, log.objects.count(divergent_object));
+    EXPECT_FALSE(log.logged_object(divergent_object));
     EXPECT_TRUE(log.empty());
     EXPECT_TRUE(remove_snap.empty());
     EXPECT_TRUE(t.empty());
@@ -1056,7 +1056,7 @@ TEST_F(PGLogTest, merge_log) {
     }
 
     EXPECT_FALSE(missing.have_missing());
-    EXPECT_EQ(1U, log.objects.count(divergent_object));
+    EXPECT_TRUE(log.logged_object(divergent_object));
     EXPECT_EQ(3U, log.log.size());
     EXPECT_TRUE(remove_snap.empty());
     EXPECT_TRUE(t.empty());
@@ -1076,7 +1076,7 @@ TEST_F(PGLogTest, merge_log) {
        to be divergent.
     */
     EXPECT_TRUE(missing.is_missing(divergent_object));
-    EXPECT_EQ(1U, log.objects.count(divergent_object));
+    EXPECT_TRUE(log.logged_object(divergent_object));
     EXPECT_EQ(4U, log.log.size());
     /* DELETE entries from olog that are appended to the hed of the
        log are also added to remove_snap.
@@ -0,0 +1,86 @@
+#!/bin/bash
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+source test/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export CEPH_MON="127.0.0.1:7112"
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-host=$CEPH_MON "
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        $func $dir || return 1
+    done
+}
+
+function get_perf_counter() {
+    local dir=$1
+    local osd=$2
+    local counter=$3
+
+    CEPH_ARGS='' \
+        ceph --format xml daemon $dir/ceph-osd.$osd.asok \
+        perf dump 2> /dev/null | \
+        $XMLSTARLET sel -t -m "//osd/$counter" -v . -n
+}
+
+function TEST_chain_replication() {
+    local dir=$1
+    local poolname=rbd
+
+    setup $dir || return 1
+    run_mon $dir a --osd_pool_default_size=3 || return 1
+    run_osd $dir 0 || return 1
+    run_osd $dir 1 || return 1
+    run_osd $dir 2 || return 1
+    wait_for_clean || return 1
+
+    ceph osd pool set $poolname chain_replication 1 || return 1
+    ceph osd pool get $poolname chain_replication | \
+        grep 'chain_replication: true' || return 1
+
+    dd if=/dev/urandom of=$dir/ORIGINAL bs=1024 count=4096 2> /dev/null
+    rados --pool $poolname put SOMETHING $dir/ORIGINAL || return 1
+    rados --pool $poolname get SOMETHING $dir/COPY || return 1
+    diff $dir/ORIGINAL $dir/COPY || return 1
+
+    # the primary sent it to one replica, which passed it on to the other
+    local primary=$(get_primary $poolname SOMETHING)
+    test $(get_perf_counter $dir $primary chain_repop) -gt 0 || return 1
+    local forwarded=0
+    for osd in $(get_osds $poolname SOMETHING) ; do
+        test $osd = $primary && continue
+        forwarded=$(($forwarded + \
+            $(get_perf_counter $dir $osd chain_repop_forward)))
+    done
+    test $forwarded -gt 0 || return 1
+
+    rados --pool $poolname bench 5 write -b 4194304 --no-cleanup || return 1
+    rados --pool $poolname bench 5 seq || return 1
+
+    ceph osd pool set $poolname chain_replication 0 || return 1
+    rados --pool $poolname put SOMETHING $dir/ORIGINAL || return 1
+    wait_for_clean || return 1
+
+    teardown $dir || return 1
+}
+
+main osd-chain-replication "$@"
+
+# Local Variables:
+# compile-command: "cd ../.. ; make -j4 && test/osd/osd-chain-replication.sh"
+# End:
@@ -0,0 +1,112 @@
+#!/bin/bash
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+source test/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export CEPH_MON="127.0.0.1:7113"
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-host=$CEPH_MON "
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        $func $dir || return 1
+    done
+}
+
+function get_perf_counter() {
+    local dir=$1
+    local osd=$2
+    local counter=$3
+
+    CEPH_ARGS='' \
+        ceph --format xml daemon $dir/ceph-osd.$osd.asok \
+        perf dump 2> /dev/null | \
+        $XMLSTARLET sel -t -m "//osd/$counter" -v . -n
+}
+
+##
+# Write SOMETHING, stop the replica and change SOMETHING while it is
+# down. If **remove** is true, also remove the replica's copy behind
+# its back. Then restart the replica, wait for it to recover and
+# check its copy.
+#
+function recover_replica() {
+    local dir=$1
+    local remove=$2
+    local poolname=rbd
+
+    setup $dir || return 1
+    run_mon $dir a --osd_pool_default_size=2 || return 1
+    run_osd $dir 0 || return 1
+    run_osd $dir 1 || return 1
+    wait_for_clean || return 1
+
+    dd if=/dev/urandom of=$dir/ORIGINAL bs=1024 count=4096 2> /dev/null
+    rados --pool $poolname put SOMETHING $dir/ORIGINAL || return 1
+    head -c 3145728 $dir/ORIGINAL > $dir/EXPECTED
+
+    local primary=$(get_primary $poolname SOMETHING)
+    local replica=$(get_not_primary $poolname SOMETHING)
+    ceph osd set noout || return 1
+    kill_daemons $dir TERM osd.$replica || return 1
+    ceph osd down $replica || return 1
+
+    # only the truncated tail is dirty
+    rados --pool $poolname truncate SOMETHING 3145728 || return 1
+    if $remove ; then
+        ceph-objectstore-tool \
+            --data-path $dir/$replica \
+            --journal-path $dir/$replica/journal \
+            SOMETHING remove || return 1
+    fi
+
+    activate_osd $dir $replica || return 1
+    ceph osd unset noout || return 1
+    wait_for_clean || return 1
+
+    test $(get_perf_counter $dir $primary push_partial) -gt 0 || return 1
+    local fallback=$(get_perf_counter $dir $primary push_partial_fallback)
+    if $remove ; then
+        test $fallback -gt 0 || return 1
+    else
+        test $fallback = 0 || return 1
+    fi
+
+    objectstore_tool $dir $replica SOMETHING get-bytes | \
+        cmp - $dir/EXPECTED || return 1
+
+    teardown $dir || return 1
+}
+
+function TEST_partial_recovery() {
+    local dir=$1
+
+    recover_replica $dir false || return 1
+}
+
+function TEST_partial_recovery_without_base() {
+    local dir=$1
+
+    # the replica no longer has the version the primary pushes from
+    recover_replica $dir true || return 1
+}
+
+main osd-partial-recovery "$@"
+
+# Local Variables:
+# compile-command: "cd ../.. ; make -j4 && test/osd/osd-partial-recovery.sh"
+# End:
@@ -155,6 +155,80 @@ function corrupt_and_repair_two() {
     diff $dir/ORIGINAL $dir/COPY || return 1
 }
 
+function deep_scrub() {
+    local pgid=$1
+    local last_scrub=$(get_last_scrub_stamp $pgid)
+
+    ceph pg deep-scrub $pgid
+    for ((i=0; i < $TIMEOUT; i++)); do
+        if test "$last_scrub" != "$(get_last_scrub_stamp $pgid)" ; then
+            return 0
+        fi
+        sleep 1
+    done
+    return 1
+}
+
+function get_perf_counter() {
+    local dir=$1
+    local osd=$2
+    local counter=$3
+
+    CEPH_ARGS='' \
+        ceph --format xml daemon $dir/ceph-osd.$osd.asok \
+        perf dump 2> /dev/null | \
+        $XMLSTARLET sel -t -m "//osd/$counter" -v . -n
+}
+
+#
+# A deep scrub does not read the objects that did not change since
+# the previous one, the object info digest stands for them
+#
+function TEST_incremental_deep_scrub() {
+    local dir=$1
+    local poolname=rbd
+
+    setup $dir || return 1
+    run_mon $dir a --osd_pool_default_size=2 || return 1
+    run_osd $dir 0 --osd_deep_scrub_full_verify_ratio=0 || return 1
+    run_osd $dir 1 --osd_deep_scrub_full_verify_ratio=0 || return 1
+
+    add_something $dir $poolname
+    local pg=$(get_pg $poolname SOMETHING)
+    local primary=$(get_primary $poolname SOMETHING)
+    # an object of the same pg that is never rewritten
+    local untouched
+    for ((i=0; ; i++)); do
+        untouched=UNTOUCHED_$i
+        test "$(get_pg $poolname $untouched)" = $pg && break
+    done
+    rados --pool $poolname put $untouched $dir/ORIGINAL || return 1
+
+    # the first deep scrub reads everything
+    deep_scrub $pg || return 1
+    test $(get_perf_counter $dir $primary deep_scrub_objects_skipped) = 0 || return 1
+    test $(get_perf_counter $dir $primary deep_scrub_bytes) -gt 0 || return 1
+
+    deep_scrub $pg || return 1
+    test $(get_perf_counter $dir $primary deep_scrub_objects_skipped) -gt 0 || return 1
+
+    # a rewritten object is read again, the untouched one is not
+    local objects=$(get_perf_counter $dir $primary deep_scrub_objects)
+    local skipped=$(get_perf_counter $dir $primary deep_scrub_objects_skipped)
+    local bytes=$(get_perf_counter $dir $primary deep_scrub_bytes)
+    dd if=/dev/urandom of=$dir/REWRITTEN bs=1024 count=4 2> /dev/null
+    rados --pool $poolname put SOMETHING $dir/REWRITTEN || return 1
+    deep_scrub $pg || return 1
+    test $(get_perf_counter $dir $primary deep_scrub_objects) = \
+        $(($objects + 2)) || return 1
+    test $(get_perf_counter $dir $primary deep_scrub_objects_skipped) = \
+        $(($skipped + 1)) || return 1
+    test $(get_perf_counter $dir $primary deep_scrub_bytes) = \
+        $(($bytes + 4096)) || return 1
+
+    teardown $dir || return 1
+}
+
 main osd-scrub-repair "$@"
 
 # Local Variables:
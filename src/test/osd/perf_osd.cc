@@ -0,0 +1,40 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <vector>
+
+using namespace std;
+
+#include "test/perf_bench.h"
+
+int op_queue_bench(const vector<const char*> &args);
+int objecter_bench(const vector<const char*> &args);
+int osdmap_bench(const vector<const char*> &args);
+int pglog_bench(const vector<const char*> &args);
+
+static const PerfBench benches[] = {
+  { "op_queue", "[seconds] [index reservation]",
+    "simulated client and recovery ops through the op queues", 2,
+    op_queue_bench },
+  { "objecter", "[max threads] [ops per thread] [osds]",
+    "objecter reads submitted from many threads", 3, objecter_bench },
+  { "osdmap", "[osds] [epochs] [pg_temps per epoch] [cached maps]",
+    "decoding and caching a run of osdmap epochs", 4, osdmap_bench },
+  { "pglog", "[pgs] [entries per pg] [objects per pg] [lookups]",
+    "memory and lookups of IndexedLog and CompactPGLog", 4, pglog_bench },
+};
+
+int main(int argc, char **argv)
+{
+  return perf_bench_main(argc, (const char **)argv, benches,
+			 sizeof(benches) / sizeof(benches[0]));
+}
@@ -1306,6 +1306,46 @@ TEST(shard_id_t, iostream) {
     ASSERT_EQ(out.str(), "0,1,2");
 }
 
+TEST(pg_log_entry_t, dirty_extents) {
+  hobject_t oid(object_t("objname"), "key", 123, 456, 0, "");
+  pg_log_entry_t e(pg_log_entry_t::MODIFY, oid, eversion_t(1,2),
+		   eversion_t(1,1), 2, osd_reqid_t(), utime_t());
+  e.has_dirty_extents = true;
+  e.dirty_extents.insert(0, 4096);
+  e.dirty_extents.insert(1 << 20, (uint64_t)-1 - (1 << 20));
+
+  bufferlist bl;
+  ::encode(e, bl);
+  pg_log_entry_t d;
+  bufferlist::iterator p = bl.begin();
+  ::decode(d, p);
+  ASSERT_TRUE(d.has_dirty_extents);
+  ASSERT_EQ(e.dirty_extents, d.dirty_extents);
+
+  pg_log_entry_t none(pg_log_entry_t::MODIFY, oid, eversion_t(1,3),
+		      eversion_t(1,2), 3, osd_reqid_t(), utime_t());
+  bl.clear();
+  ::encode(none, bl);
+  p = bl.begin();
+  ::decode(d, p);
+  ASSERT_FALSE(d.has_dirty_extents);
+  ASSERT_TRUE(d.dirty_extents.empty());
+}
+
+TEST(ObjectRecoveryInfo, base_version) {
+  ObjectRecoveryInfo info;
+  info.soid = hobject_t(sobject_t("key", CEPH_NOSNAP));
+  info.copy_subset.insert(8192, 4096);
+  info.base_version = eversion_t(3, 7);
+  bufferlist bl;
+  ::encode(info, bl);
+  ObjectRecoveryInfo d;
+  bufferlist::iterator p = bl.begin();
+  ::decode(d, p);
+  ASSERT_EQ(info.base_version, d.base_version);
+  ASSERT_EQ(info.copy_subset, d.copy_subset);
+}
+
 /*
  * Local Variables:
  * compile-command: "cd ../.. ;
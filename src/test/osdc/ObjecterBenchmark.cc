@@ -0,0 +1,200 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Submits reads from a number of threads through an Objecter whose
+ * messenger drops every message, with the objecter lock on every submit
+ * (objecter_submit_shards = 0) and without it.  Reports the submits per
+ * second for each number of threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+#include "common/debug.h"
+#include "common/Cycles.h"
+#include "common/Thread.h"
+#include "global/global_init.h"
+#include "include/stringify.h"
+#include "messages/MOSDMap.h"
+#include "mon/MonClient.h"
+#include "msg/SimplePolicyMessenger.h"
+#include "osd/OSDMap.h"
+#include "osdc/Objecter.h"
+#include "test/perf_bench.h"
+
+struct DropConnection : public Connection {
+  DropConnection(CephContext *cct, Messenger *m) : Connection(cct, m) {}
+  bool is_connected() {
+    return true;
+  }
+  int send_message(Message *m) {
+    m->put();
+    return 0;
+  }
+  void send_keepalive() {}
+  void mark_down() {}
+  void mark_disposable() {}
+};
+
+struct DropMessenger : public SimplePolicyMessenger {
+  DropMessenger(CephContext *cct)
+    : SimplePolicyMessenger(cct, entity_name_t::CLIENT(-1), "drop", 0) {}
+  void set_addr_unknowns(entity_addr_t &addr) {}
+  int get_dispatch_queue_len() {
+    return 0;
+  }
+  double get_dispatch_queue_max_age(utime_t now) {
+    return 0;
+  }
+  void set_cluster_protocol(int p) {}
+  void set_policy_throttlers(int type, Throttle *bytes, Throttle *msgs) {}
+  int bind(const entity_addr_t& bind_addr) {
+    return 0;
+  }
+  void wait() {}
+  int send_message(Message *m, const entity_inst_t& dest) {
+    m->put();
+    return 0;
+  }
+  ConnectionRef get_connection(const entity_inst_t& dest) {
+    ConnectionRef con = new DropConnection(cct, this);
+    con->set_peer_type(dest.name.type());
+    con->set_peer_addr(dest.addr);
+    return con;
+  }
+  ConnectionRef get_loopback_connection() {
+    return new DropConnection(cct, this);
+  }
+  void mark_down(const entity_addr_t& a) {}
+  void mark_down_all() {}
+};
+
+struct C_Nothing : public Context {
+  void finish(int r) {}
+};
+
+static void send_map(Objecter *objecter, int osds)
+{
+  OSDMap osdmap;
+  uuid_d fsid;  // as the MonClient's
+  osdmap.build_simple(g_ceph_context, 0, fsid, osds, 8, 8);
+  OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+  inc.fsid = fsid;
+  for (int i = 0; i < osds; ++i) {
+    entity_addr_t addr;
+    addr.nonce = i;
+    inc.new_state[i] = CEPH_OSD_EXISTS | CEPH_OSD_NEW;
+    inc.new_up_client[i] = addr;
+    inc.new_up_cluster[i] = addr;
+    inc.new_hb_back_up[i] = addr;
+    inc.new_hb_front_up[i] = addr;
+    inc.new_weight[i] = CEPH_OSD_IN;
+  }
+  osdmap.apply_incremental(inc);
+
+  MOSDMap *m = new MOSDMap(fsid);
+  osdmap.encode(m->maps[osdmap.get_epoch()], CEPH_FEATURES_ALL);
+  objecter->handle_osd_map(m);
+  m->put();
+}
+
+class Submitter : public Thread {
+  Objecter *objecter;
+  vector<object_t> oids;
+  bufferlist bl;
+public:
+  vector<ceph_tid_t> tids;
+  uint64_t cycles;
+
+  Submitter(Objecter *o, int id, int ops) : objecter(o), cycles(0) {
+    for (int i = 0; i < ops; i++) {
+      char buf[64];
+      snprintf(buf, sizeof(buf), "obj_%d_%d", id, i);
+      oids.push_back(object_t(buf));
+    }
+    tids.reserve(ops);
+  }
+  void *entry() {
+    object_locator_t oloc(0);
+    uint64_t start = Cycles::rdtsc();
+    for (vector<object_t>::iterator p = oids.begin(); p != oids.end(); ++p)
+      tids.push_back(objecter->read(*p, oloc, 0, 4096, CEPH_NOSNAP, &bl, 0,
+				    new C_Nothing));
+    cycles = Cycles::rdtsc() - start;
+    return NULL;
+  }
+};
+
+static void run(const char *mode, int max_threads, int ops, int osds)
+{
+  DropMessenger msgr(g_ceph_context);
+  MonClient monc(g_ceph_context);
+  Objecter objecter(g_ceph_context, &msgr, &monc, NULL, 0, 0);
+  objecter.init();
+  send_map(&objecter, osds);
+
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    vector<Submitter*> submitters;
+    for (int i = 0; i < threads; i++)
+      submitters.push_back(new Submitter(&objecter, i, ops));
+    uint64_t start = Cycles::rdtsc();
+    for (int i = 0; i < threads; i++)
+      submitters[i]->create();
+    uint64_t thread_cycles = 0;
+    for (int i = 0; i < threads; i++) {
+      submitters[i]->join();
+      thread_cycles += submitters[i]->cycles;
+    }
+    double secs = Cycles::to_seconds(Cycles::rdtsc() - start);
+    double thread_secs = Cycles::to_seconds(thread_cycles) / threads;
+
+    cerr << " " << mode << ": " << threads << " threads, "
+	 << (uint64_t)(threads * ops / secs) << " submits/sec, "
+	 << (uint64_t)(ops / thread_secs) << " per thread" << std::endl;
+
+    // nothing will answer them
+    for (int i = 0; i < threads; i++) {
+      for (vector<ceph_tid_t>::iterator p = submitters[i]->tids.begin();
+	   p != submitters[i]->tids.end();
+	   ++p)
+	objecter.op_cancel(*p, -ECANCELED);
+      delete submitters[i];
+    }
+  }
+  objecter.shutdown();
+}
+
+int objecter_bench(const vector<const char*> &args)
+{
+  int max_threads = perf_bench_arg(args, 0, 16);
+  int ops = perf_bench_arg(args, 1, 20000);
+  int osds = perf_bench_arg(args, 2, 10);
+  if (max_threads <= 0 || ops <= 0 || osds <= 0)
+    return -EINVAL;
+
+  cerr << "reads from up to " << max_threads << " threads, " << ops
+       << " each, over " << osds << " osds" << std::endl;
+
+  string shards = g_conf->objecter_submit_shards > 0 ?
+    stringify(g_conf->objecter_submit_shards) : string("16");
+  g_ceph_context->_conf->set_val("objecter_submit_shards", "0");
+  run("locked", max_threads, ops, osds);
+  g_ceph_context->_conf->set_val("objecter_submit_shards", shards.c_str());
+  run("sharded", max_threads, ops, osds);
+  return 0;
+}
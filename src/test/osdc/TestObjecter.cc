@@ -0,0 +1,282 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "common/Cond.h"
+#include "common/Mutex.h"
+#include "common/Thread.h"
+#include "messages/MOSDMap.h"
+#include "messages/MOSDOp.h"
+#include "mon/MonClient.h"
+#include "msg/SimplePolicyMessenger.h"
+#include "osd/OSDMap.h"
+#include "osdc/Objecter.h"
+#include "test/unit.h"
+
+/// every MOSDOp sent, in order, and what to do when one is resent
+struct SentOps {
+  struct Sent {
+    int osd;
+    ceph_tid_t tid;
+  };
+  Mutex lock;
+  Cond cond;
+  vector<Sent> sent;
+  ceph_tid_t hook_tid;   ///< call hook when this op is resent
+  Context *hook;
+
+  SentOps() : lock("SentOps::lock"), hook_tid(0), hook(NULL) {}
+
+  int count(ceph_tid_t tid) {
+    int n = 0;
+    for (vector<Sent>::iterator p = sent.begin(); p != sent.end(); ++p)
+      if (p->tid == tid)
+	n++;
+    return n;
+  }
+
+  /// position of the first (or last) send of tid to osd, -1 if none
+  int find(int osd, ceph_tid_t tid, bool last) {
+    int found = -1;
+    for (unsigned i = 0; i < sent.size(); ++i) {
+      if (sent[i].osd == osd && sent[i].tid == tid) {
+	found = i;
+	if (!last)
+	  break;
+      }
+    }
+    return found;
+  }
+};
+
+struct RecordConnection : public Connection {
+  SentOps *ops;
+  RecordConnection(CephContext *cct, Messenger *m, SentOps *o)
+    : Connection(cct, m), ops(o) {}
+  bool is_connected() {
+    return true;
+  }
+  int send_message(Message *m) {
+    if (m->get_type() == CEPH_MSG_OSD_OP) {
+      Mutex::Locker l(ops->lock);
+      SentOps::Sent s;
+      s.osd = get_peer_addr().nonce;
+      s.tid = m->get_tid();
+      ops->sent.push_back(s);
+      ops->cond.Signal();
+      if (s.tid == ops->hook_tid && ops->count(s.tid) == 2 && ops->hook) {
+	Context *c = ops->hook;
+	ops->hook = NULL;
+	ops->lock.Unlock();
+	c->complete(0);
+	ops->lock.Lock();
+      }
+    }
+    m->put();
+    return 0;
+  }
+  void send_keepalive() {}
+  void mark_down() {}
+  void mark_disposable() {}
+};
+
+struct RecordMessenger : public SimplePolicyMessenger {
+  SentOps *ops;
+  RecordMessenger(CephContext *cct, SentOps *o)
+    : SimplePolicyMessenger(cct, entity_name_t::CLIENT(-1), "record", 0),
+      ops(o) {}
+  void set_addr_unknowns(entity_addr_t &addr) {}
+  int get_dispatch_queue_len() {
+    return 0;
+  }
+  double get_dispatch_queue_max_age(utime_t now) {
+    return 0;
+  }
+  void set_cluster_protocol(int p) {}
+  void set_policy_throttlers(int type, Throttle *bytes, Throttle *msgs) {}
+  int bind(const entity_addr_t& bind_addr) {
+    return 0;
+  }
+  void wait() {}
+  int send_message(Message *m, const entity_inst_t& dest) {
+    m->put();
+    return 0;
+  }
+  ConnectionRef get_connection(const entity_inst_t& dest) {
+    ConnectionRef con = new RecordConnection(cct, this, ops);
+    con->set_peer_type(dest.name.type());
+    con->set_peer_addr(dest.addr);
+    return con;
+  }
+  ConnectionRef get_loopback_connection() {
+    return new RecordConnection(cct, this, ops);
+  }
+  void mark_down(const entity_addr_t& a) {}
+  void mark_down_all() {}
+};
+
+struct C_Nothing : public Context {
+  void finish(int r) {}
+};
+
+/// reads an object from its own thread
+class Reader : public Thread {
+  Objecter *objecter;
+  object_t oid;
+  bufferlist bl;
+public:
+  ceph_tid_t tid;
+  Reader(Objecter *o, const object_t &oid) : objecter(o), oid(oid), tid(0) {}
+  void *entry() {
+    tid = objecter->read(oid, object_locator_t(0), 0, 4096, CEPH_NOSNAP,
+			 &bl, 0, new C_Nothing);
+    return NULL;
+  }
+};
+
+/// starts the reader and gives it a second to get its op sent
+struct C_StartReader : public Context {
+  Reader *reader;
+  SentOps *ops;
+  C_StartReader(Reader *r, SentOps *o) : reader(r), ops(o) {}
+  void finish(int r) {
+    Mutex::Locker l(ops->lock);
+    size_t sent = ops->sent.size();
+    reader->create();
+    utime_t until = ceph_clock_now(g_ceph_context);
+    until += 1.0;
+    while (ops->sent.size() == sent &&
+	   ceph_clock_now(g_ceph_context) < until)
+      ops->cond.WaitUntil(ops->lock, until);
+  }
+};
+
+class ObjecterTest : public ::testing::Test {
+public:
+  static const int OSDS = 8;
+  SentOps ops;
+  RecordMessenger *msgr;
+  MonClient *monc;
+  Objecter *objecter;
+  OSDMap osdmap;
+  uuid_d fsid;  // as the MonClient's
+  bufferlist bl;  // nothing is ever read into it
+
+  ObjecterTest() : msgr(NULL), monc(NULL), objecter(NULL) {}
+
+  virtual void SetUp() {
+    msgr = new RecordMessenger(g_ceph_context, &ops);
+    monc = new MonClient(g_ceph_context);
+    objecter = new Objecter(g_ceph_context, msgr, monc, NULL, 0, 0);
+    objecter->init();
+
+    osdmap.build_simple(g_ceph_context, 0, fsid, OSDS, 8, 8);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = fsid;
+    for (int i = 0; i < OSDS; ++i) {
+      entity_addr_t addr;
+      addr.nonce = i;
+      inc.new_state[i] = CEPH_OSD_EXISTS | CEPH_OSD_NEW;
+      inc.new_up_client[i] = addr;
+      inc.new_up_cluster[i] = addr;
+      inc.new_hb_back_up[i] = addr;
+      inc.new_hb_front_up[i] = addr;
+      inc.new_weight[i] = CEPH_OSD_IN;
+    }
+    osdmap.apply_incremental(inc);
+    send_map();
+  }
+
+  virtual void TearDown() {
+    objecter->shutdown();
+    delete objecter;
+    delete monc;
+    delete msgr;
+  }
+
+  void send_map() {
+    MOSDMap *m = new MOSDMap(fsid);
+    osdmap.encode(m->maps[osdmap.get_epoch()], CEPH_FEATURES_ALL);
+    objecter->handle_osd_map(m);
+    m->put();
+  }
+
+  /// a new map that makes every op of pool 0 be resent
+  void force_resend() {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = fsid;
+    pg_pool_t *pool = inc.get_new_pool(0, osdmap.get_pg_pool(0));
+    pool->last_force_op_resend = inc.epoch;
+    osdmap.apply_incremental(inc);
+    send_map();
+  }
+
+  int primary(const object_t &oid) {
+    pg_t pgid;
+    EXPECT_EQ(0, osdmap.object_locator_to_pg(oid, object_locator_t(0), pgid));
+    return osdmap.get_pg_acting_primary(osdmap.raw_pg_to_pg(pgid));
+  }
+
+  ceph_tid_t read(const object_t &oid) {
+    return objecter->read(oid, object_locator_t(0), 0, 4096, CEPH_NOSNAP,
+			  &bl, 0, new C_Nothing);
+  }
+};
+
+TEST_F(ObjecterTest, resend_before_submit) {
+  // two objects on different osds
+  object_t first("first");
+  object_t second;
+  for (int i = 0; second.name.empty(); ++i) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "second_%d", i);
+    if (primary(object_t(buf)) != primary(first))
+      second = object_t(buf);
+  }
+  int osd = primary(second);
+
+  ceph_tid_t first_tid = read(first);
+  ceph_tid_t second_tid = read(second);
+  ASSERT_LE(0, ops.find(osd, second_tid, false));
+
+  // while the new map resends the first op, a read of the second object
+  // must wait until its earlier op was resent too
+  Reader reader(objecter, second);
+  {
+    Mutex::Locker l(ops.lock);
+    ops.hook_tid = first_tid;
+    ops.hook = new C_StartReader(&reader, &ops);
+  }
+  force_resend();
+  reader.join();
+
+  {
+    Mutex::Locker l(ops.lock);
+    EXPECT_EQ(2, ops.count(first_tid));
+    EXPECT_EQ(2, ops.count(second_tid));
+    int resent = ops.find(osd, second_tid, true);
+    int submitted = ops.find(osd, reader.tid, false);
+    EXPECT_LE(0, submitted);
+    EXPECT_LT(resent, submitted);
+  }
+
+  objecter->op_cancel(first_tid, -ECANCELED);
+  objecter->op_cancel(second_tid, -ECANCELED);
+  objecter->op_cancel(reader.tid, -ECANCELED);
+}
+
+// Local Variables:
+// compile-command: "cd ../.. ; make unittest_objecter ; ./unittest_objecter"
+// End:
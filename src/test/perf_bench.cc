@@ -0,0 +1,98 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+
+#include "common/ceph_argparse.h"
+#include "common/config.h"
+#include "common/Cycles.h"
+#include "global/global_context.h"
+#include "global/global_init.h"
+#include "test/perf_bench.h"
+
+static void usage(const char *tool, const PerfBench *benches, unsigned count)
+{
+  cerr << "Usage: " << tool << " <benchmark> [args...]" << std::endl;
+  for (unsigned i = 0; i < count; ++i) {
+    string cmd = string(benches[i].name) + " " + benches[i].usage;
+    cerr << "  " << left << setw(48) << cmd << benches[i].description
+	 << std::endl;
+  }
+}
+
+int perf_bench_main(int argc, const char **argv,
+		    const PerfBench *benches, unsigned count)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+  g_ceph_context->_conf->apply_changes(NULL);
+  Cycles::init();
+
+  if (args.empty()) {
+    usage(argv[0], benches, count);
+    return 1;
+  }
+
+  const PerfBench *b = benches;
+  if (!isdigit(args[0][0])) {
+    while (b != benches + count && strcmp(b->name, args[0]))
+      ++b;
+    if (b == benches + count) {
+      usage(argv[0], benches, count);
+      return 1;
+    }
+    args.erase(args.begin());
+  }
+
+  int r = -EINVAL;
+  if (args.size() <= b->max_args)
+    r = b->run(args);
+  if (r == -EINVAL)
+    cerr << "Usage: " << argv[0] << " " << b->name << " " << b->usage
+	 << std::endl;
+  return r < 0 ? 1 : 0;
+}
+
+int perf_bench_arg(const vector<const char*> &args, unsigned i, int def)
+{
+  return i < args.size() ? atoi(args[i]) : def;
+}
+
+double perf_bench_arg(const vector<const char*> &args, unsigned i, double def)
+{
+  return i < args.size() ? atof(args[i]) : def;
+}
+
+string perf_bench_arg(const vector<const char*> &args, unsigned i,
+		      const char *def)
+{
+  return i < args.size() ? args[i] : def;
+}
+
+void perf_bench_report(const string &name, uint64_t count, const char *what,
+		       uint64_t ticks)
+{
+  uint64_t us = Cycles::to_microseconds(ticks);
+  cerr << " " << name << ": " << count << " " << what << " in " << us
+       << "us, " << (us ? count * 1000000 / us : 0) << " " << what << "/s"
+       << std::endl;
+}
@@ -0,0 +1,52 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_TEST_PERF_BENCH_H
+#define CEPH_TEST_PERF_BENCH_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * One benchmark of a ceph_perf_* tool.  The tool runs the benchmark
+ * named by its first argument, with the arguments that follow.
+ */
+struct PerfBench {
+  const char *name;
+  const char *usage;        ///< its arguments, e.g. "[objects] [ops]"
+  const char *description;
+  unsigned max_args;
+  /// @returns 0, -EINVAL if the arguments are wrong, or another error
+  int (*run)(const std::vector<const char*> &args);
+};
+
+/**
+ * main() of a ceph_perf_* tool: init the global context and run the
+ * benchmark its arguments name.  A first argument that is a number is
+ * passed to the first benchmark, for tools that used to run only that.
+ */
+int perf_bench_main(int argc, const char **argv,
+		    const PerfBench *benches, unsigned count);
+
+/// argument i as an integer, def if there are fewer arguments
+int perf_bench_arg(const std::vector<const char*> &args, unsigned i, int def);
+double perf_bench_arg(const std::vector<const char*> &args, unsigned i,
+		      double def);
+std::string perf_bench_arg(const std::vector<const char*> &args, unsigned i,
+			   const char *def);
+
+/// print "<name>: <count> <what> in <n>us, <rate> <what>/s"
+void perf_bench_report(const std::string &name, uint64_t count,
+		       const char *what, uint64_t ticks);
+
+#endif